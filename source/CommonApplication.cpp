@@ -4,8 +4,10 @@
 #include "font/IconsFontAwesome6.h"
 #include "font/IconsMaterialDesignIcons.h"
 #include "implot/implot.h"
+#include "implot3d/implot3d.h"
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/DebugNew.h>
 #include <Urho3D/Engine/Engine.h>
 #include <Urho3D/Graphics/AnimatedModel.h>
@@ -18,6 +20,7 @@
 #include <Urho3D/Graphics/Octree.h>
 #include <Urho3D/Graphics/Renderer.h>
 #include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/IO/File.h>
 #include <Urho3D/Input/Input.h>
 #include <Urho3D/Navigation/CrowdAgent.h>
 #include <Urho3D/Navigation/DynamicNavigationMesh.h>
@@ -28,6 +31,7 @@
 #include <Urho3D/RenderPipeline/ShaderConsts.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Scene/Scene.h>
+#include <Urho3D/SystemUI/ImGui.h>
 #include <Urho3D/UI/Font.h>
 #include <Urho3D/UI/Text.h>
 #include <Urho3D/UI/UI.h>
@@ -37,9 +41,78 @@
 EM_JS( int, get_canvas_w, (), { return document.getElementById( "canvas" ).offsetWidth; } );
 EM_JS( int, get_canvas_h, (), { return document.getElementById( "canvas" ).offsetHeight; } );
 //
+// 热力图纹理: 每列一个像素. 环形滚动由 ImPlot 在接缝处拆成两个矩形绘制, 不依赖 wrap 寻址
+static void* implot_texture_create( int width, int height, void* user_data )
+{
+    auto* texture = new Texture2D( static_cast< Context* >( user_data ) );
+    texture->AddRef();
+    texture->SetNumLevels( 1 );
+    texture->SetFilterMode( FILTER_NEAREST );
+    texture->SetAddressMode( TextureCoordinate::U, ADDRESS_CLAMP );
+    texture->SetAddressMode( TextureCoordinate::V, ADDRESS_CLAMP );
+    texture->SetSize( width, height, TextureFormat::TEX_FORMAT_RGBA8_UNORM );
+    return texture;
+}
+//
+static void implot_texture_update( void* texture, int x, int y, int w, int h, const ImU32* pixels, void* user_data )
+{
+    static_cast< Texture2D* >( texture )->SetData( 0, x, y, w, h, pixels );
+}
+//
+static ImTextureID implot_texture_id( void* texture, void* user_data )
+{
+    return ToImTextureID( static_cast< Texture2D* >( texture ) );
+}
+//
+static void implot_texture_destroy( void* texture, void* user_data )
+{
+    static_cast< Texture2D* >( texture )->ReleaseRef();
+}
+//
+#if URHO3D_THREADING
+// 大数据量曲线的顶点生成分发到引擎的 WorkQueue
+static void implot_work_queue_parallel_for( int count, ImPlotParallelTask task, void* task_data, void* user_data )
+{
+    ForEachParallel( static_cast< WorkQueue* >( user_data ), 1u, ( unsigned )count,
+                     [ = ]( unsigned begin, unsigned end )
+                     {
+                         task( ( int )begin, ( int )end, task_data );
+                     } );
+}
+#endif
+//
 CommonApplication::CommonApplication( Context* context ) : Application( context )
 {
+    // 默认显示估计加速度, 速度, 位置
+    for ( int i = 0; i < sensor_channel_count; i++ )
+    {
+        chart_channels_[ i ] = ( i >= 16 );
+    }
+    chart_columns_     = 3;
+    chart_events_      = true;
+    histogram_channel_ = 3;
+    allan_sample_rate_ = 100.0;
+    allan_loading_     = false;
     //
+    mag_coverage_.assign( MAG_CALIBRATION::coverage_cols * MAG_CALIBRATION::coverage_rows, 0.0f );
+    mag_coverage_revision_   = ( uint32_t )-1;
+    mag_coverage_uploaded_   = ( uint32_t )-1;
+    mag_coverage_cells_      = 0;
+    bake_sample_rate_        = 100.0f;
+    bake_rotation_tolerance_ = 0.1f;
+    bake_position_tolerance_ = 0.001f;
+    bake_path_               = "IndexedDB/Animations/Session.ani";
+    bake_seconds_            = 0.0f;
+    bake_samples_            = 0;
+    bake_keys_               = 0;
+    playback_                = nullptr;
+    playback_active_         = false;
+    playback_paused_         = false;
+    playback_time_           = 0.0f;
+    event_sensor_            = 0;
+    event_kind_              = 0;
+    capture_path_            = "Session.fmc";
+    export_format_           = export_format_columnar;
 }
 //
 void CommonApplication::Setup()
@@ -73,11 +146,26 @@ void CommonApplication::Start()
     FmRegisterOjbj();
     setup_style_of_imgui();
     ImPlot::CreateContext();
+    ImPlot3D::CreateContext();
+    ImPlotTextureCallbacks texture_callbacks;
+    texture_callbacks.Create   = implot_texture_create;
+    texture_callbacks.Update   = implot_texture_update;
+    texture_callbacks.GetID    = implot_texture_id;
+    texture_callbacks.Destroy  = implot_texture_destroy;
+    texture_callbacks.UserData = context_;
+    ImPlot::SetTextureCallbacks( texture_callbacks );
+#if URHO3D_THREADING
+    ImPlot::SetParallelFor( implot_work_queue_parallel_for, GetSubsystem< WorkQueue >() );
+#endif
     //
     CreateScene();
     //
     SetupViewport();
     CreateLog();
+    // 录制文件经虚拟文件系统读写, 浏览器中该目录在 IDBFS 上
+    GetSubsystem< FileSystem >()->CreateDirsRecursive( "IndexedDB/Captures/" );
+    capture_mount_ = MakeShared< MountedDirectory >( context_, "IndexedDB/Captures/", "capture" );
+    GetSubsystem< VirtualFileSystem >()->Mount( capture_mount_ );
     //
     auto* input = context_->GetSubsystem< Input >();
     // Subscribe key down event
@@ -87,14 +175,82 @@ void CommonApplication::Start()
 }
 void CommonApplication::Stop()
 {
+    synth_local_stop();
+    ingest_stop();
+    replay_.stop();
+    capture_writer.close();
+    if ( export_job_ )
+    {
+        export_job_->cancelled = true;
+    }
+    if ( allan_job_ )
+    {
+        allan_job_->cancelled = true;
+    }
+    if ( bake_job_ )
+    {
+        bake_job_->cancelled = true;
+    }
+    ImPlot3D::DestroyContext();
     ImPlot::DestroyContext();
 }
 
 void CommonApplication::Update( StringHash eventType, VariantMap& eventData )
 {
+    // 没有数据线程时 (WASM 无 pthread), 合成数据源在主循环上产生数据
+    synth_local_update();
+    {
+        // 所有传感器在同一播放时刻插值, 供动作捕捉与多传感器视图使用; 显示用的姿态与位置另做平滑插值
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        const double now = sensor_timeline.now();
+        sensor_timeline.update( now );
+        pose_interpolator.sample( now );
+    }
+    capture_writer.tick();
+    // 导出在主线程上分步读取, 编码在 WorkQueue 上
+    if ( export_job_ && export_pump( export_job_, 0.004 ) )
+    {
+        const CAPTURE_RECOVERY& source = export_job_->reader.result;
+        if ( export_job_->failed )
+        {
+            URHO3D_LOGERROR( "Export of {} failed", capture_path_ );
+        }
+        else
+        {
+            URHO3D_LOGINFO( "Exported {} rows, {:.1f} MB in {:.2f} s{}", export_job_->rows, export_job_->bytes / 1e6, export_job_->seconds,
+                            source.truncated ? " (capture truncated)" : "" );
+        }
+        export_job_.reset();
+    }
+    // 重放录制文件 (Recover) 同样分步读取, 帧在主线程上走接收流程
+    if ( replay_.active && replay_.pump( 0.004 ) )
+    {
+        const CAPTURE_RECOVERY& recovery = replay_.reader.result;
+        URHO3D_LOGINFO( "Recovered {} frames and {} events in {} blocks from {} ({} parts{})", recovery.frames, recovery.events, recovery.blocks, capture_path_,
+                        recovery.parts, recovery.truncated ? fmt::format( ", {} trailing bytes discarded", recovery.discarded ) : "" );
+    }
+    // Allan 方差的录制文件同样在主线程上分步读取; 读取期间不录制, 接收线程不会写入 allan_capture
+    if ( allan_loading_ && allan_capture_read( allan_reader_, allan_capture, 0.004 ) )
+    {
+        const CAPTURE_RECOVERY& source = allan_reader_.result;
+        URHO3D_LOGINFO( "Loaded {} Allan samples from {} ({} blocks{})", allan_capture.size(), capture_path_, source.blocks,
+                        source.truncated ? ", capture truncated" : "" );
+        allan_reader_  = CAPTURE_READER();
+        allan_loading_ = false;
+    }
+    history_ = sensor_history_acquire();
+    // 3D 视图始终需要姿态与位置
+    flow_control_.need( sensor_channel_bit( 13 ) | sensor_channel_bit( 14 ) | sensor_channel_bit( 15 ) | sensor_channel_bit( 22 ) | sensor_channel_bit( 23 ) | sensor_channel_bit( 24 ) );
     RenderUi();
     //
     ToCtrlAxesNode();
+    // 回放烘焙动画时节点由 AnimationController 驱动
+    if ( ! playback_active_ )
+    {
+        mocap_.update();
+    }
+    flow_control_.full_rate = allan_recording || bake_recording || capture_writer.recording;
+    flow_control_.update();
 }
 void CommonApplication::HandleMouseDown( StringHash eventType, VariantMap& eventData ){
     //
@@ -114,6 +270,8 @@ void CommonApplication::CreateScene()
     //
     scene_->CreateComponent< Octree >();
     scene_->CreateComponent< DebugRenderer >();
+    // 烘焙动画的回放: 轨道按节点名绑定到场景中的节点
+    playback_ = scene_->CreateComponent< AnimationController >();
 
     // Create scene node & StaticModel component for showing a static plane
     Node* planeNode = scene_->CreateChild( "Plane" );
@@ -257,27 +415,26 @@ void CommonApplication::HandleKeyDown( StringHash /*eventType*/, VariantMap& eve
 //
 void CommonApplication::CreateSocket( eastl::string url )
 {
-    if ( ! emscripten_websocket_is_supported() )
+    // 连接在接收线程上建立, 消息解析不占用渲染线程
+    flow_control_.reset();
+    synth_local_stop();
+    replay_.stop();
+    if ( url.compare( 0, 8, "synth://" ) == 0 )
     {
-        printf( "WebSockets are not supported, cannot continue!\n" );
+        ingest_stop();
+        if ( ! synth_local_start( url.c_str() ) )
+        {
+            URHO3D_LOGERROR( "Invalid synthetic source {}", url );
+        }
+        return;
     }
-    //
-    EmscriptenWebSocketCreateAttributes attr;
-    emscripten_websocket_init_create_attributes( &attr );
-
-    // attr.url = "ws://localhost:8080";
-    attr.url = url.c_str();
-    //
-    socket = emscripten_websocket_new( &attr );
-    if ( socket <= 0 )
+    if ( url.compare( 0, 8, "relay://" ) == 0 )
     {
-        printf( "WebSocket creation failed, error code %d!\n", ( EMSCRIPTEN_RESULT )socket );
+        ingest_stop();
+        ingest_relay_start( context_, url.c_str() );
+        return;
     }
-    //
-    emscripten_websocket_set_onopen_callback( socket, ( void* )42, WebSocketOpen );
-    emscripten_websocket_set_onclose_callback( socket, ( void* )43, WebSocketClose );
-    emscripten_websocket_set_onerror_callback( socket, ( void* )44, WebSocketError );
-    emscripten_websocket_set_onmessage_callback( socket, ( void* )45, WebSocketMessage );
+    ingest_start( url.c_str() );
 };
 //
 /// @brief
@@ -322,20 +479,28 @@ void CommonApplication::RenderUi()
     WebsocketUi();
     AxesNodeAttributeUi();
     ChartUi();
+    DistributionUi();
+    CalibrationUi();
+    AllanVarianceUi();
+    MocapUi();
+    BakeUi();
     //
     // ImPlot::ShowDemoWindow();
 }
 //
 void CommonApplication::WebsocketUi()
 {
-    ui::SetNextWindowSize( ImVec2( 450, 330 ), ImGuiCond_FirstUseEver );
+    ui::SetNextWindowSize( ImVec2( 450, 400 ), ImGuiCond_FirstUseEver );
     ui::SetNextWindowPos( ImVec2( winSizeX_ - 450, 0 ), ImGuiCond_FirstUseEver );
     //
     if ( ui::Begin( "WebSocket", NULL, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoScrollbar ) )
     {
-        static eastl::string ip_str   = "192.168.254.115";
-        static eastl::string port_str = "18080";
-        static eastl::string smsg_str = "hello on the other side";
+        static eastl::string ip_str    = "192.168.254.115";
+        static eastl::string port_str  = "18080";
+        static eastl::string smsg_str  = "hello on the other side";
+        static bool          use_relay = false;
+        static int           synth_devices = 1;
+        static float         synth_rate    = 100.0f;
         // static eastl::string rmsg_str = "receive on the server";
         auto win_size       = ImGui::GetContentRegionAvail();
         int  segmentation_w = 100;
@@ -351,22 +516,121 @@ void CommonApplication::WebsocketUi()
         ui::Text( "Port" );
         ui::SameLine( segmentation_w );
         ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x );
+        ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x - 70 );
         ui::InputText( "##Port", &port_str );
+        ui::SameLine();
+        // relay 把一次解码的快照经 WebRTC 数据通道分发给多个浏览器
+        ui::Checkbox( "Relay", &use_relay );
         ui::Separator();
 
         //
-        ui::Text( websocket_staus.c_str() );
+        ui::Text( "%s", websocket_staus.load() );
         ui::SameLine( segmentation_w );
         if ( ui::Button( "Connect", ImVec2( ImGui::GetContentRegionAvail().x, 16 ) ) )
         {
-            eastl::string url = "ws://" + ip_str + ":" + port_str + "/";
+            eastl::string url = ( use_relay ? "relay://" : "ws://" ) + ip_str + ":" + port_str + "/";
 
             CreateSocket( url );
         };
         ui::Separator();
+        // 合成数据源: 没有硬件时用于演示与压测, 数据经过与设备相同的解析路径
+        ui::Text( "Synthetic" );
+        ui::SameLine( segmentation_w );
+        ui::SetNextItemWidth( 80 );
+        ui::InputInt( "##SynthDevices", &synth_devices );
+        synth_devices = Clamp( synth_devices, 1, mocap_max_sensors );
+        ui::SameLine();
+        ui::SetNextItemWidth( 80 );
+        ui::InputFloat( "Hz##SynthRate", &synth_rate, 0.0f, 0.0f, "%.0f" );
+        synth_rate = Clamp( synth_rate, 1.0f, 100000.0f / synth_devices );
+        ui::SameLine();
+        if ( ui::Button( "Generate", ImVec2( ImGui::GetContentRegionAvail().x, 16 ) ) )
+        {
+            CreateSocket( fmt::format( "synth://{}x{}", synth_devices, synth_rate ).c_str() );
+        }
+        ui::Separator();
+        // 录制到 IndexedDB: 定长校验块只追加, 页面崩溃后 Recover 重放到最后一个完整的块
+        ui::Text( "Capture" );
+        ui::SameLine( segmentation_w );
+        ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x - 150 );
+        ui::InputText( "##CapturePath", &capture_path_ );
+        ui::SameLine();
+        bool capture_recording = capture_writer.recording;
+        ui::BeginDisabled( replay_.active );
+        if ( ui::Checkbox( "Record##Capture", &capture_recording ) )
+        {
+            if ( capture_recording )
+            {
+                if ( capture_writer.open( GetSubsystem< VirtualFileSystem >(), "capture", capture_path_.c_str() ) )
+                {
+                    capture_path_ = capture_writer.name.c_str();
+                }
+            }
+            else
+            {
+                capture_writer.close();
+            }
+        }
+        ui::EndDisabled();
+        ui::SameLine();
+        ui::BeginDisabled( capture_writer.recording );
+        if ( ui::Button( replay_.active ? "Stop##Recover" : "Recover", ImVec2( ImGui::GetContentRegionAvail().x, 16 ) ) )
+        {
+            // 先断开连接与合成数据源, 重放期间只有录制文件一个数据源; 帧在 Update 中分步重放, 事件标注取文件中保存的
+            if ( replay_.active )
+            {
+                replay_.stop();
+            }
+            else
+            {
+                synth_local_stop();
+                ingest_stop();
+                if ( ! replay_.start( GetSubsystem< VirtualFileSystem >(), "capture", capture_path_.c_str() ) )
+                {
+                    URHO3D_LOGERROR( "Cannot open capture {}", capture_path_ );
+                }
+            }
+        }
+        ui::EndDisabled();
+        // 导出整个录制文件, 与录制文件同名, 扩展名按格式
+        ui::Text( "" );
+        ui::SameLine( segmentation_w );
+        ui::SetNextItemWidth( 120 );
+        ui::Combo( "##ExportFormat", &export_format_, export_format_names, IM_ARRAYSIZE( export_format_names ) );
+        ui::SameLine();
+        ui::BeginDisabled( capture_writer.recording || export_job_ != nullptr );
+        if ( ui::Button( "Export", ImVec2( 80, 16 ) ) )
+        {
+            EXPORT_OPTIONS options;
+            options.format = ( EXPORT_FORMAT )export_format_;
+            export_job_    = export_start( GetSubsystem< WorkQueue >(), GetSubsystem< VirtualFileSystem >(), "capture", capture_path_.c_str(),
+                                           ( capture_path_ + export_format_extensions[ export_format_ ] ).c_str(), options );
+        }
+        ui::EndDisabled();
+        if ( export_job_ )
+        {
+            ui::SameLine();
+            ui::Text( "%llu rows, %.1f MB", ( unsigned long long )export_job_->rows, export_job_->bytes / 1e6 );
+        }
+        if ( replay_.active )
+        {
+            ui::Text( "" );
+            ui::SameLine( segmentation_w );
+            ui::Text( "Recovering: %llu frames, %llu events, %llu blocks", ( unsigned long long )replay_.reader.result.frames,
+                      ( unsigned long long )replay_.reader.result.events, ( unsigned long long )replay_.reader.result.blocks );
+        }
+        if ( capture_writer.recording )
+        {
+            ui::Text( "" );
+            ui::SameLine( segmentation_w );
+            ui::Text( "%llu frames, %llu events, %.1f MB, %d in flight, %llu dropped%s", ( unsigned long long )capture_writer.frames.load(),
+                      ( unsigned long long )capture_writer.events.load(), capture_writer.blocks.load() * capture_block_size / 1e6, capture_writer.in_flight.load(),
+                      ( unsigned long long )capture_writer.dropped.load(), capture_writer.failed.load() > 0 ? ", write failed" : "" );
+        }
+        ui::Separator();
         //
-        ImGui::BeginChild( "ChildL", ImVec2( ImGui::GetContentRegionAvail().x, 200 ) );
-        ui::TextWrapped( websocket_receive_message.c_str() );
+        ImGui::BeginChild( "ChildL", ImVec2( ImGui::GetContentRegionAvail().x, 180 ) );
+        ui::TextWrapped( "%s", websocket_receive_view() );
         ImGui::EndChild();
         // ui::InputTextMultiline( "##RMSG", &websocket_receive_message, ImVec2( ImGui::GetContentRegionAvail().x, 200 ) );
         ui::Separator();
@@ -379,36 +643,39 @@ void CommonApplication::WebsocketUi()
         ui::SameLine();
         if ( ui::Button( "Send Message", ImVec2( btn_w, 16 ) ) )
         {
-            emscripten_websocket_send_utf8_text( socket, smsg_str.c_str() );
+            ingest_send_text( smsg_str.c_str() );
         };
         ui::Separator();
         //
         if ( ui::Button( "Send Start", ImVec2( btn_w, 16 ) ) )
         {
-            emscripten_websocket_send_utf8_text( socket, "Start" );
-            start_time = getMicrosecondTimestamp();
+            ingest_send_text( "Start" );
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            sensor_timeline.reset();
+            pose_interpolator.reset();
         };
         ui::SameLine();
         if ( ui::Button( "Send Pause", ImVec2( btn_w, 16 ) ) )
         {
-            emscripten_websocket_send_utf8_text( socket, "Pause" );
-            start_time = getMicrosecondTimestamp();
+            ingest_send_text( "Pause" );
         };
         ui::SameLine();
         if ( ui::Button( "Send Clear", ImVec2( btn_w, 16 ) ) )
         {
-            emscripten_websocket_send_utf8_text( socket, "Clear" );
+            ingest_send_text( "Clear" );
         };
         ui::SameLine();
         if ( ui::Button( "Send Reset", ImVec2( btn_w, 16 ) ) )
         {
-            emscripten_websocket_send_utf8_text( socket, "Reset" );
-            start_time = getMicrosecondTimestamp();
+            ingest_send_text( "Reset" );
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            sensor_timeline.reset();
+            pose_interpolator.reset();
         };
         ui::SameLine();
         if ( ui::Button( "Send Stop", ImVec2( btn_w, 16 ) ) )
         {
-            emscripten_websocket_send_utf8_text( socket, "Stop" );
+            ingest_send_text( "Stop" );
         };
         ui::Separator();
     }
@@ -430,13 +697,18 @@ void CommonApplication::AxesNodeAttributeUi()
         ui::Text( "Queue Size" );
         ui::SameLine( segmentation_w );
         ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x );
-        ui::Text( "%d", sensor_data_queue.size() );
+        int queue_size;
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            queue_size = sensor_data_pending;
+        }
+        ui::Text( "%d", queue_size );
         ui::Separator();
         //
         ui::Text( "Vector Size" );
         ui::SameLine( segmentation_w );
         ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x );
-        ui::Text( "%d", sensor_data_vector.size() );
+        ui::Text( "%d", ( int )( history_.head - history_.tail ) );
         ui::Separator();
         //
         ui::Text( "Position" );
@@ -450,6 +722,25 @@ void CommonApplication::AxesNodeAttributeUi()
         ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x );
         ui::Text( "%f,%f,%f", axes_node_->GetDirection().x_, axes_node_->GetDirection().y_, axes_node_->GetDirection().z_ );
         ui::Separator();
+        //
+        if ( ui::CollapsingHeader( "Flow Control" ) )
+        {
+            ui::Text( "Ingest %.0f frames/s, %.0f msgs/s", flow_control_.ingest_rate, flow_control_.message_rate );
+            ui::Text( "Render %.1f fps, depth %.1f (max %d), dropped %lld", flow_control_.render_rate, flow_control_.depth_avg, flow_control_.depth_peak, ( long long )flow_control_.dropped );
+            ui::Checkbox( "Adaptive", &flow_control_.adaptive );
+            ui::SameLine();
+            ui::Text( "depth budget %d frames", FLOW_CONTROL::depth_budget() );
+            ui::BeginDisabled( flow_control_.adaptive );
+            ui::SetNextItemWidth( 150 );
+            ui::SliderInt( "Decimate", &flow_control_.decimate, 1, FLOW_CONTROL::max_decimate );
+            ui::SameLine();
+            ui::SetNextItemWidth( 150 );
+            ui::SliderInt( "Batch", &flow_control_.batch, 1, FLOW_CONTROL::max_batch );
+            ui::EndDisabled();
+            ui::SetNextItemWidth( 150 );
+            ui::Combo( "Format", &flow_control_.format, FLOW_CONTROL::format_names, IM_ARRAYSIZE( FLOW_CONTROL::format_names ) );
+            ui::Text( "Mask %07x (acked %07x)", flow_control_.sent_mask, sensor_ingest_mask.load() );
+        }
     }
     ui::End();
 }
@@ -461,146 +752,733 @@ void CommonApplication::ChartUi()
     //
     if ( ui::Begin( "IMU Chart", NULL, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoScrollbar ) )
     {
+        int visible[ sensor_channel_count ];
+        int visible_count = 0;
+        for ( int c = 0; c < sensor_channel_count; c++ )
+        {
+            if ( chart_channels_[ c ] )
+            {
+                visible[ visible_count++ ] = c;
+                flow_control_.need( sensor_channel_bit( c ) );
+            }
+        }
         //
-        static float time[ 1024 ], eax[ 1024 ], eay[ 1024 ], eaz[ 1024 ], evx[ 1024 ], evy[ 1024 ], evz[ 1024 ], px[ 1024 ], py[ 1024 ], pz[ 1024 ];
+        if ( ui::Button( "Channels" ) )
+        {
+            ui::OpenPopup( "##ChartChannels" );
+        }
+        ui::SameLine();
+        ui::SetNextItemWidth( 120 );
+        ui::SliderInt( "Columns", &chart_columns_, 1, 6 );
+        if ( ui::BeginPopup( "##ChartChannels" ) )
+        {
+            for ( int c = 0; c < sensor_channel_count; c++ )
+            {
+                ui::Checkbox( sensor_channels[ c ].name, &chart_channels_[ c ] );
+            }
+            ui::EndPopup();
+        }
+        // 事件标注: 检测参数对所有传感器生效, 图表只显示传感器 0 的事件
+        ui::SameLine();
+        ui::Checkbox( "Events", &chart_events_ );
+        ui::SameLine();
+        if ( ui::Button( "Detectors" ) )
+        {
+            ui::OpenPopup( "##ChartDetectors" );
+        }
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            ui::SameLine();
+            ui::Text( "%zu events", sensor_events.index.size() );
+            if ( ui::BeginPopup( "##ChartDetectors" ) )
+            {
+                SENSOR_EVENT_CONFIG& config = sensor_events.config;
+                ui::Checkbox( "Detect", &sensor_events.enabled );
+                ui::SameLine();
+                if ( ui::SmallButton( "Clear" ) )
+                {
+                    sensor_events.index.clear();
+                }
+                ui::SetNextItemWidth( 120 );
+                ui::InputFloat( "Impact (g)", &config.impact_g, 0.0f, 0.0f, "%.2f" );
+                ui::SetNextItemWidth( 120 );
+                ui::InputFloat( "Still gyro sd (deg/s)", &config.still_gyro, 0.0f, 0.0f, "%.2f" );
+                ui::SetNextItemWidth( 120 );
+                ui::InputFloat( "Still min (s)", &config.still_min, 0.0f, 0.0f, "%.2f" );
+                ui::SetNextItemWidth( 120 );
+                ui::InputFloat( "Magnetic ratio", &config.magnetic_ratio, 0.0f, 0.0f, "%.2f" );
+                // 字段号 = 通道 + 1, 组合框的第一项为关闭
+                auto field_combo = []( const char* label, int& field ) {
+                    ui::SetNextItemWidth( 120 );
+                    if ( ui::BeginCombo( label, field > 0 ? sensor_channels[ field - 1 ].name : "Off" ) )
+                    {
+                        if ( ui::Selectable( "Off", field <= 0 ) )
+                        {
+                            field = -1;
+                        }
+                        for ( int c = 0; c < sensor_channel_count; c++ )
+                        {
+                            if ( ui::Selectable( sensor_channels[ c ].name, field == c + 1 ) )
+                            {
+                                field = c + 1;
+                            }
+                        }
+                        ui::EndCombo();
+                    }
+                };
+                field_combo( "Threshold", config.threshold_field );
+                ui::SameLine();
+                ui::SetNextItemWidth( 80 );
+                ui::InputFloat( "Level", &config.threshold_level, 0.0f, 0.0f, "%.3f" );
+                ui::SameLine();
+                ui::SetNextItemWidth( 80 );
+                ui::InputFloat( "Hysteresis", &config.threshold_hysteresis, 0.0f, 0.0f, "%.3f" );
+                field_combo( "Derivative", config.derivative_field );
+                ui::SameLine();
+                ui::SetNextItemWidth( 80 );
+                ui::InputFloat( "Rate (/s)", &config.derivative_rate, 0.0f, 0.0f, "%.3f" );
+                config.still_window = Max( config.still_window, 0.05f );
+                ui::EndPopup();
+            }
+        }
         //
-        int count = sensor_data_vector.size();
-        for ( int i = 0; i < count; i++ )
+        if ( visible_count > 0 )
         {
-            time[ i ] = i;
-            //
-            eax[ i ] = sensor_data_vector[ i ].eacc_x;
-            eay[ i ] = sensor_data_vector[ i ].eacc_y;
-            eaz[ i ] = sensor_data_vector[ i ].eacc_z;
-            //
-            evx[ i ] = sensor_data_vector[ i ].vel_x;
-            evy[ i ] = sensor_data_vector[ i ].vel_y;
-            evz[ i ] = sensor_data_vector[ i ].vel_z;
-            //
-            px[ i ] = sensor_data_vector[ i ].pos_x;
-            py[ i ] = sensor_data_vector[ i ].pos_y;
-            pz[ i ] = sensor_data_vector[ i ].pos_z;
+            int cols = chart_columns_ < visible_count ? chart_columns_ : visible_count;
+            int rows = ( visible_count + cols - 1 ) / cols;
+            // 横轴全部联动并随最新一帧滚动, 刻度只在最后一行绘制
+            const double x_scale  = 0.05;
+            const double x_latest = x_scale * ( double )history_.head;
+            const double x_span   = x_scale * ( double )item_count;
+            if ( ImPlot::BeginSubplots( "##IMU", rows, cols, ImGui::GetContentRegionAvail(), ImPlotSubplotFlags_NoTitle | ImPlotSubplotFlags_LinkAllX ) )
+            {
+                for ( int v = 0; v < visible_count; v++ )
+                {
+                    const SENSOR_CHANNEL& channel = sensor_channels[ visible[ v ] ];
+                    ImPlotAxisFlags       x_flags = ImPlotAxisFlags_None;
+                    if ( v + cols < visible_count )
+                    {
+                        x_flags |= ImPlotAxisFlags_NoTickLabels;
+                    }
+                    if ( ImPlot::BeginPlot( channel.name ) )
+                    {
+                        ImPlot::SetupAxes( nullptr, channel.axis, x_flags, ImPlotAxisFlags_AutoFit );
+                        ImPlot::SetupAxisScroll( ImAxis_X1, x_latest, x_span );
+                        ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
+                        // 直接读取环形历史中的字段列, 不做拷贝. 刚订阅的字段要到下一帧才有存储
+                        const float* values = history_.channel( visible[ v ] );
+                        if ( values != nullptr )
+                        {
+                            ImPlot::SetNextRingRevision( history_.revision );
+                            ImPlot::PlotStairsRing( channel.name, values, history_.capacity, history_.head, history_.tail, x_scale, 0.0 );
+                        }
+                        if ( chart_events_ )
+                        {
+                            DrawEvents( x_scale );
+                        }
+                        ImPlot::EndPlot();
+                    }
+                }
+                ImPlot::EndSubplots();
+            }
         }
+    }
+    ui::End();
+};
 
-        //  ------------------ ea
-        if ( ImPlot::BeginPlot( "X Acceleration", ImVec2( 300, 300 ) ) )
+// 在当前图表中标出可见范围内传感器 0 的事件: 区间画成半透明的竖条, 单帧事件画成横轴上的标签
+void CommonApplication::DrawEvents( double x_scale )
+{
+    static const ImVec4 colors[ sensor_event_kind_count ] = { ImVec4( 1.0f, 0.3f, 0.3f, 1.0f ), ImVec4( 0.3f, 0.8f, 1.0f, 1.0f ), ImVec4( 1.0f, 0.8f, 0.2f, 1.0f ),
+                                                              ImVec4( 0.6f, 1.0f, 0.4f, 1.0f ), ImVec4( 0.9f, 0.5f, 1.0f, 1.0f ) };
+    const ImPlotRect    limits = ImPlot::GetPlotLimits();
+    ImDrawList*         draw   = ImPlot::GetPlotDrawList();
+    int                 drawn  = 0;
+    ImPlot::PushPlotClipRect();
+    std::lock_guard< std::mutex > lock( queue_mutex );
+    sensor_events.index.query( limits.X.Min / x_scale, limits.X.Max / x_scale, [ & ]( const SENSOR_EVENT& event ) {
+        if ( event.sensor != 0 )
         {
-            ImPlot::SetupAxes( "Index", "X", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Acceleration X", eax, count, 0.05f, 0 );
-
+            return true;
+        }
+        const ImVec4& color = colors[ event.kind ];
+        if ( event.end > event.begin )
+        {
+            const ImVec2 min = ImPlot::PlotToPixels( event.begin * x_scale, limits.Y.Max );
+            const ImVec2 max = ImPlot::PlotToPixels( event.end * x_scale, limits.Y.Min );
+            draw->AddRectFilled( min, max, ImGui::GetColorU32( ImVec4( color.x, color.y, color.z, 0.15f ) ) );
+        }
+        else
+        {
+            ImPlot::TagX( event.begin * x_scale, color, "%s", sensor_event_names[ event.kind ] );
+        }
+        // 缩放到很大的范围时只画前 256 个
+        return ++drawn < 256;
+    } );
+    ImPlot::PopPlotClipRect();
+}
+//
+void CommonApplication::DistributionUi()
+{
+    ui::SetNextWindowSize( ImVec2( 450, 700 ), ImGuiCond_FirstUseEver );
+    ui::SetNextWindowPos( ImVec2( winSizeX_ - 450, 432 ), ImGuiCond_FirstUseEver );
+    //
+    if ( ui::Begin( "Distribution", NULL, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoScrollbar ) )
+    {
+        flow_control_.need( sensor_channel_bit( histogram_channel_ ) | sensor_channel_bit( 6 ) | sensor_channel_bit( 7 ) );
+        ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x );
+        if ( ui::BeginCombo( "##HistogramChannel", sensor_channels[ histogram_channel_ ].name ) )
+        {
+            for ( int c = 0; c < sensor_channel_count; c++ )
+            {
+                if ( ui::Selectable( sensor_channels[ c ].name, c == histogram_channel_ ) )
+                {
+                    histogram_channel_ = c;
+                }
+            }
+            ui::EndCombo();
+        }
+        // 直方图随环形历史增量更新, 只统计新进入和移出窗口的样本
+        const float plot_h = ( ImGui::GetContentRegionAvail().y - ImGui::GetStyle().ItemSpacing.y ) * 0.5f;
+        if ( ImPlot::BeginPlot( "##Noise", ImVec2( -1, plot_h ) ) )
+        {
+            const SENSOR_CHANNEL& channel = sensor_channels[ histogram_channel_ ];
+            ImPlot::SetupAxes( channel.axis, "Density", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
+            const float* values = history_.channel( histogram_channel_ );
+            if ( values != nullptr )
+            {
+                ImPlot::SetNextRingRevision( history_.revision );
+                ImPlot::PlotHistogramRing( channel.name, values, history_.capacity, history_.head, history_.tail, 64, 1.0, ImPlotRange(), ImPlotHistogramFlags_Density );
+            }
             ImPlot::EndPlot();
         }
-        ui::SameLine();
-        if ( ImPlot::BeginPlot( "Y Acceleration", ImVec2( 300, 300 ) ) )
+        // 磁力计 XY 平面分布, 校准良好时应为圆环
+        if ( ImPlot::BeginPlot( "##MagXY", ImVec2( -1, plot_h ), ImPlotFlags_Equal ) )
         {
-            ImPlot::SetupAxes( "Index", "Y", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Acceleration Y", eay, count, 0.05f, 0 );
-
+            ImPlot::SetupAxes( "Mag X", "Mag Y", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
+            const float* mag_x = history_.channel( 6 );
+            const float* mag_y = history_.channel( 7 );
+            if ( mag_x != nullptr && mag_y != nullptr )
+            {
+                ImPlot::SetNextRingRevision( history_.revision );
+                ImPlot::PlotHistogram2DRing( "Magnetometer", mag_x, mag_y, history_.capacity, history_.head, history_.tail, 64, 64 );
+            }
             ImPlot::EndPlot();
         }
-        ui::SameLine();
-        if ( ImPlot::BeginPlot( "Z Acceleration", ImVec2( 300, 300 ) ) )
+    }
+    ui::End();
+}
+//
+void CommonApplication::CalibrationUi()
+{
+    ui::SetNextWindowSize( ImVec2( 450, 560 ), ImGuiCond_FirstUseEver );
+    ui::SetNextWindowPos( ImVec2( winSizeX_ - 900, 432 ), ImGuiCond_FirstUseEver );
+    // 拟合质量在渲染线程重算 (点集变化时每帧至多一次), 窗口折叠时也要更新: 接收线程按 trusted 决定是否校正
+    {
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        mag_calibration.evaluate();
+    }
+    //
+    if ( ui::Begin( "Mag Calibration", NULL, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoScrollbar ) )
+    {
+        flow_control_.need( sensor_channel_bit( 6 ) | sensor_channel_bit( 7 ) | sensor_channel_bit( 8 ) );
+        // 锁内只取拟合结果, 点集变化时复制点云与方向覆盖; 绘制在锁外进行, 不阻塞数据接收
+        bool    valid, trusted;
+        int64_t samples;
+        int     points, covered;
+        float   residual, field_radius, center[ 3 ], ellipsoid[ 3 ][ 3 ];
         {
-            ImPlot::SetupAxes( "Index", "Z", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Acceleration Z", eaz, count, 0.05f, 0 );
-
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            ui::Checkbox( "Apply", &mag_calibration_apply );
+            ui::SameLine();
+            if ( ui::Button( "Reset" ) )
+            {
+                mag_calibration.reset();
+            }
+            mag_calibration.evaluate();
+            if ( mag_coverage_revision_ != mag_calibration.revision )
+            {
+                mag_coverage_revision_ = mag_calibration.revision;
+                mag_coverage_cells_    = mag_calibration.covered;
+                memcpy( mag_coverage_.data(), mag_calibration.grid, sizeof( mag_calibration.grid ) );
+                mag_points_[ 0 ]       = mag_calibration.xs;
+                mag_points_[ 1 ]       = mag_calibration.ys;
+                mag_points_[ 2 ]       = mag_calibration.zs;
+            }
+            valid        = mag_calibration.valid;
+            trusted      = mag_calibration.trusted();
+            samples      = mag_calibration.samples;
+            points       = ( int )mag_calibration.xs.size();
+            covered      = mag_calibration.covered;
+            residual     = mag_calibration.residual;
+            field_radius = mag_calibration.field_radius;
+            memcpy( center, mag_calibration.center, sizeof( center ) );
+            memcpy( ellipsoid, mag_calibration.ellipsoid, sizeof( ellipsoid ) );
+        }
+        const int coverage_cells = MAG_CALIBRATION::coverage_cols * MAG_CALIBRATION::coverage_rows;
+        ui::Text( "Points %d / %d  Samples %lld  Coverage %d / %d", points, MAG_CALIBRATION::max_points, ( long long )samples, mag_coverage_cells_, coverage_cells );
+        if ( valid )
+        {
+            ui::Text( "Offset %.3f,%.3f,%.3f  Field %.3f", center[ 0 ], center[ 1 ], center[ 2 ], field_radius );
+        }
+        if ( trusted )
+        {
+            ui::Text( "Fit residual %.1f%%%s", residual * 100.0f, mag_calibration_apply ? ", applied to incoming frames" : "" );
+        }
+        else if ( valid )
+        {
+            // 拟合未达到 MAG_CALIBRATION::trusted 的门限前不校正实时数据
+            ui::Text( "Not applied yet: coverage %d / %d, residual %.1f%% (need %.0f / %.0f%%)", covered, coverage_cells, residual * 100.0f,
+                      MAG_CALIBRATION::trusted_coverage * coverage_cells, MAG_CALIBRATION::trusted_residual * 100.0f );
+        }
+        else
+        {
+            ui::Text( "Rotate the sensor in all directions to collect samples" );
+        }
+        // 方向覆盖: 方位角 x 仰角, 重算后整体上传一次, 否则不上传
+        if ( ImPlot::BeginPlot( "##MagCoverage", ImVec2( -1, 140 ), ImPlotFlags_NoLegend | ImPlotFlags_NoMouseText ) )
+        {
+            ImPlot::SetupAxes( "Azimuth", "sin(Elevation)", ImPlotAxisFlags_Lock, ImPlotAxisFlags_Lock );
+            ImPlot::SetupAxesLimits( -180, 180, -1, 1, ImPlotCond_Always );
+            ImPlot::PlotHeatmapTexture( "Coverage", mag_coverage_.data(), MAG_CALIBRATION::coverage_rows, MAG_CALIBRATION::coverage_cols, 0, 0,
+                                        mag_coverage_uploaded_ != mag_coverage_revision_ ? -1 : 0, 0.0, 8.0, ImPlotPoint( -180, -1 ), ImPlotPoint( 180, 1 ) );
+            mag_coverage_uploaded_ = mag_coverage_revision_;
             ImPlot::EndPlot();
         }
-        //  ------------------ ev
-        if ( ImPlot::BeginPlot( "X Speed", ImVec2( 300, 300 ) ) )
+        // 原始读数点云与拟合椭球
+        if ( ImPlot3D::BeginPlot( "##MagCloud", ImGui::GetContentRegionAvail() ) )
         {
-            ImPlot::SetupAxes( "Index", "X", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Speed X", evx, count, 0.05f, 0 );
-
+            ImPlot3D::SetupAxes( "Mag X", "Mag Y", "Mag Z" );
+            ImPlot3D::SetNextMarkerStyle( ImPlot3DMarker_Circle, 2.0f );
+            ImPlot3D::PlotScatter( "Samples", mag_points_[ 0 ].data(), mag_points_[ 1 ].data(), mag_points_[ 2 ].data(), ( int )mag_points_[ 0 ].size() );
+            if ( valid )
+            {
+                static ImPlot3DPoint ellipsoid_vtx[ ImPlot3D::SPHERE_VTX_COUNT ];
+                const float( &e )[ 3 ][ 3 ] = ellipsoid;
+                for ( int i = 0; i < ImPlot3D::SPHERE_VTX_COUNT; i++ )
+                {
+                    const ImPlot3DPoint& u = ImPlot3D::sphere_vtx[ i ];
+                    ellipsoid_vtx[ i ].x   = center[ 0 ] + e[ 0 ][ 0 ] * u.x + e[ 0 ][ 1 ] * u.y + e[ 0 ][ 2 ] * u.z;
+                    ellipsoid_vtx[ i ].y   = center[ 1 ] + e[ 1 ][ 0 ] * u.x + e[ 1 ][ 1 ] * u.y + e[ 1 ][ 2 ] * u.z;
+                    ellipsoid_vtx[ i ].z   = center[ 2 ] + e[ 2 ][ 0 ] * u.x + e[ 2 ][ 1 ] * u.y + e[ 2 ][ 2 ] * u.z;
+                }
+                ImPlot3D::SetNextFillStyle( IMPLOT3D_AUTO_COL, 0.25f );
+                ImPlot3D::PlotMesh( "Ellipsoid", ellipsoid_vtx, ImPlot3D::sphere_idx, ImPlot3D::SPHERE_VTX_COUNT, ImPlot3D::SPHERE_IDX_COUNT );
+            }
+            ImPlot3D::EndPlot();
+        }
+    }
+    ui::End();
+}
+//
+void CommonApplication::AllanVarianceUi()
+{
+    ui::SetNextWindowSize( ImVec2( 600, 500 ), ImGuiCond_FirstUseEver );
+    ui::SetNextWindowPos( ImVec2( winSizeX_ - 1050, 0 ), ImGuiCond_FirstUseEver );
+    //
+    if ( ui::Begin( "Allan Variance", NULL, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoScrollbar ) )
+    {
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            ui::BeginDisabled( allan_loading_ );
+            ui::Checkbox( "Record", &allan_recording );
+            ui::EndDisabled();
+            ui::SameLine();
+            ui::SetNextItemWidth( 100 );
+            ui::InputDouble( "Rate (Hz)", &allan_sample_rate_, 0.0, 0.0, "%.1f" );
+            ui::SameLine();
+            // 以录制文件 (Capture 一栏的文件名) 代替实时录制的数据, 由 Update 分步读入
+            ui::BeginDisabled( allan_loading_ || capture_writer.recording );
+            if ( ui::Button( "Load Capture" ) )
+            {
+                allan_recording = false;
+                allan_capture.clear();
+                allan_reader_.open( GetSubsystem< VirtualFileSystem >(), "capture", capture_path_.c_str() );
+                allan_loading_ = allan_reader_.result.parts > 0;
+                if ( ! allan_loading_ )
+                {
+                    URHO3D_LOGERROR( "Failed to open capture {}", capture_path_ );
+                }
+            }
+            ui::EndDisabled();
+            ui::SameLine();
+            ui::BeginDisabled( allan_loading_ );
+            if ( ui::Button( "Analyse" ) && allan_capture.size() > 2 && allan_sample_rate_ > 0.0 )
+            {
+                if ( allan_job_ )
+                {
+                    allan_job_->cancelled = true;
+                }
+                allan_recording = false;
+                allan_job_      = allan_start( GetSubsystem< WorkQueue >(), allan_capture, 1.0 / allan_sample_rate_ );
+            }
+            ui::EndDisabled();
+            ui::SameLine();
+            ui::Text( "%lld samples, %.1f s", ( long long )allan_capture.size(), allan_sample_rate_ > 0.0 ? allan_capture.size() / allan_sample_rate_ : 0.0 );
+        }
+        // 对数坐标的 Allan 偏差曲线, 每个 tau 完成后即显示
+        if ( ImPlot::BeginPlot( "##AllanDeviation", ImGui::GetContentRegionAvail() ) )
+        {
+            ImPlot::SetupAxes( "Tau (s)", "Allan Deviation", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
+            ImPlot::SetupAxisScale( ImAxis_X1, ImPlotScale_Log10 );
+            ImPlot::SetupAxisScale( ImAxis_Y1, ImPlotScale_Log10 );
+            if ( allan_job_ )
+            {
+                const int tau_count = allan_job_->tau_count();
+                ImVector< double > taus;
+                ImVector< double > devs;
+                taus.reserve( tau_count );
+                devs.reserve( tau_count );
+                for ( int c = 0; c < allan_channel_count; c++ )
+                {
+                    taus.resize( 0 );
+                    devs.resize( 0 );
+                    for ( int t = 0; t < tau_count; t++ )
+                    {
+                        if ( allan_job_->is_ready( c, t ) )
+                        {
+                            taus.push_back( allan_job_->tau0 * ( double )allan_job_->clusters[ t ] );
+                            devs.push_back( allan_job_->adev[ c * tau_count + t ] );
+                        }
+                    }
+                    ImPlot::SetNextMarkerStyle( ImPlotMarker_Circle, 2.0f );
+                    ImPlot::PlotLine( sensor_channels[ c ].name, taus.Data, devs.Data, taus.Size );
+                }
+            }
             ImPlot::EndPlot();
         }
+    }
+    ui::End();
+}
+//
+void CommonApplication::MocapUi()
+{
+    ui::SetNextWindowSize( ImVec2( 450, 520 ), ImGuiCond_FirstUseEver );
+    ui::SetNextWindowPos( ImVec2( winSizeX_ - 1350, 0 ), ImGuiCond_FirstUseEver );
+    //
+    if ( ui::Begin( "Mocap", NULL, ImGuiWindowFlags_NoSavedSettings ) )
+    {
+        ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x - 60 );
+        ui::InputText( "##MocapModel", &mocap_.model_path );
         ui::SameLine();
-        if ( ImPlot::BeginPlot( "Y Speed", ImVec2( 300, 300 ) ) )
+        if ( ui::Button( "Load", ImVec2( ImGui::GetContentRegionAvail().x, 0 ) ) && ! mocap_.load( scene_ ) )
         {
-            ImPlot::SetupAxes( "Index", "Y", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Speed Y", evy, count, 0.05f, 0 );
-
-            ImPlot::EndPlot();
+            URHO3D_LOGERROR( "Mocap model {} not found", mocap_.model_path );
         }
+        ui::SetNextItemWidth( 150 );
+        ui::InputText( "Bone Prefix", &mocap_.prefix );
+        //
+        ui::BeginDisabled( ! mocap_.node );
+        ui::Checkbox( "Enabled", &mocap_.enabled );
+        ui::SameLine();
+        ui::Checkbox( "Foot Contact", &mocap_.foot_contact );
         ui::SameLine();
-        if ( ImPlot::BeginPlot( "Z Speed", ImVec2( 300, 300 ) ) )
+        ui::Checkbox( "Time Aligned", &mocap_.aligned );
+        ui::SameLine();
+        if ( ui::Button( "Calibrate (Bind Pose)" ) )
         {
-            ImPlot::SetupAxes( "Index", "Z", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Speed Z", evz, count, 0.05f, 0 );
-
-            ImPlot::EndPlot();
+            mocap_.calibrate();
         }
-        // --------- pos
-        if ( ImPlot::BeginPlot( "X Position", ImVec2( 300, 300 ) ) )
+        ui::EndDisabled();
+        ui::Separator();
+        // 传感器 -> 骨骼映射, 修改后需重新加载
+        if ( ui::BeginTable( "##MocapBones", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp ) )
         {
-            ImPlot::SetupAxes( "Index", "X", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Position X", px, count, 0.05f, 0 );
-
-            ImPlot::EndPlot();
+            ui::TableSetupColumn( "Sensor" );
+            ui::TableSetupColumn( "Bone" );
+            ui::TableSetupColumn( "Frames" );
+            ui::TableHeadersRow();
+            for ( int b = 0; b < ( int )mocap_.bones.size(); b++ )
+            {
+                MOCAP_BONE& bone = mocap_.bones[ b ];
+                ui::PushID( b );
+                ui::TableNextColumn();
+                ui::SetNextItemWidth( -1 );
+                ui::InputInt( "##Sensor", &bone.sensor, 0 );
+                bone.sensor = Clamp( bone.sensor, -1, mocap_max_sensors - 1 );
+                ui::TableNextColumn();
+                ui::SetNextItemWidth( -1 );
+                ui::InputText( "##Bone", &bone.bone );
+                ui::TableNextColumn();
+                if ( bone.sensor >= 0 )
+                {
+                    ui::TextColored( bone.node ? ImVec4( 1, 1, 1, 1 ) : ImVec4( 1, 0.4f, 0.4f, 1 ), "%u", mocap_.generations[ bone.sensor ] );
+                }
+                ui::PopID();
+            }
+            ui::EndTable();
         }
+        // 时间对齐: 缓冲深度与各传感器的时钟模型和到达统计
+        if ( ui::CollapsingHeader( "Timeline" ) )
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            ui::Text( "Delay %.1f ms", sensor_timeline.delay * 1000.0 );
+            ui::SameLine();
+            if ( ui::SmallButton( "Reset##Timeline" ) )
+            {
+                sensor_timeline.reset();
+                pose_interpolator.reset();
+            }
+            // 显示插值: 延迟越大越平滑, 需大于关键帧间隔 (latency / 8) 与到达抖动之和
+            ui::Checkbox( "Smooth Display", &pose_interpolator.enabled );
+            ui::SameLine();
+            float latency_ms = pose_interpolator.latency * 1000.0f;
+            ui::SetNextItemWidth( 150 );
+            if ( ui::SliderFloat( "Latency (ms)", &latency_ms, 0.0f, pose_interpolator.max_latency * 1000.0f, "%.0f" ) )
+            {
+                pose_interpolator.latency = latency_ms / 1000.0f;
+            }
+            if ( ui::BeginTable( "##Timeline", 9, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp ) )
+            {
+                ui::TableSetupColumn( "Sensor" );
+                ui::TableSetupColumn( "Frames" );
+                ui::TableSetupColumn( "Late" );
+                ui::TableSetupColumn( "Early" );
+                ui::TableSetupColumn( "Underrun" );
+                ui::TableSetupColumn( "Dropped" );
+                ui::TableSetupColumn( "Jitter" );
+                ui::TableSetupColumn( "Drift" );
+                ui::TableSetupColumn( "Hold" );
+                ui::TableHeadersRow();
+                for ( int s = 0; s < sensor_timeline_sensors; s++ )
+                {
+                    const SENSOR_TIMELINE_TRACK& track = sensor_timeline.tracks[ s ];
+                    if ( track.frames == 0 )
+                    {
+                        continue;
+                    }
+                    ui::TableNextColumn();
+                    ui::TextColored( track.clock.ready() ? ImVec4( 1, 1, 1, 1 ) : ImVec4( 1, 0.4f, 0.4f, 1 ), "%d", s );
+                    ui::TableNextColumn();
+                    ui::Text( "%llu", ( unsigned long long )track.frames );
+                    ui::TableNextColumn();
+                    ui::Text( "%llu", ( unsigned long long )track.late );
+                    ui::TableNextColumn();
+                    ui::Text( "%llu", ( unsigned long long )track.early );
+                    ui::TableNextColumn();
+                    ui::Text( "%llu", ( unsigned long long )track.underruns );
+                    ui::TableNextColumn();
+                    ui::Text( "%llu", ( unsigned long long )( track.overflows + track.duplicates ) );
+                    ui::TableNextColumn();
+                    ui::Text( "%.1f ms", track.jitter_p95 * 1000.0f );
+                    ui::TableNextColumn();
+                    ui::Text( "%.0f ppm", track.clock.drift * 1e6 );
+                    ui::TableNextColumn();
+                    ui::Text( "%llu", ( unsigned long long )pose_interpolator.holds[ s ] );
+                }
+                ui::EndTable();
+            }
+        }
+    }
+    ui::End();
+}
+//
+void CommonApplication::BakeUi()
+{
+    ui::SetNextWindowSize( ImVec2( 450, 290 ), ImGuiCond_FirstUseEver );
+    ui::SetNextWindowPos( ImVec2( winSizeX_ - 1350, 530 ), ImGuiCond_FirstUseEver );
+    //
+    if ( ui::Begin( "Animation Bake", NULL, ImGuiWindowFlags_NoSavedSettings ) )
+    {
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            ui::Checkbox( "Record", &bake_recording );
+            ui::SameLine();
+            ui::SetNextItemWidth( 100 );
+            ui::InputFloat( "Rate (Hz)", &bake_sample_rate_, 0.0f, 0.0f, "%.1f" );
+            ui::SameLine();
+            ui::Text( "%lld samples, %.1f s", ( long long )bake_capture.size(), bake_sample_rate_ > 0.0f ? bake_capture.sensors[ 0 ].size() / bake_sample_rate_ : 0.0f );
+        }
+        ui::SetNextItemWidth( 100 );
+        ui::InputFloat( "Rotation (deg)", &bake_rotation_tolerance_, 0.0f, 0.0f, "%.3f" );
         ui::SameLine();
-        if ( ImPlot::BeginPlot( "Y Position", ImVec2( 300, 300 ) ) )
+        ui::SetNextItemWidth( 100 );
+        ui::InputFloat( "Position (m)", &bake_position_tolerance_, 0.0f, 0.0f, "%.4f" );
+        bake_rotation_tolerance_ = Max( bake_rotation_tolerance_, 0.001f );
+        bake_position_tolerance_ = Max( bake_position_tolerance_, 0.00001f );
+        ui::SameLine();
+        // 3D 视图节点一条轨道, 已校准的动作捕捉模型每根骨骼一条轨道
+        ui::BeginDisabled( bake_job_ != nullptr || bake_sample_rate_ <= 0.0f );
+        if ( ui::Button( "Bake", ImVec2( ImGui::GetContentRegionAvail().x, 0 ) ) )
         {
-            ImPlot::SetupAxes( "Index", "Y", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Position Y", py, count, 0.05f, 0 );
-
-            ImPlot::EndPlot();
+            std::vector< BAKE_TRACK > tracks;
+            BAKE_TRACK                axes;
+            axes.name            = axes_node_->GetName();
+            axes.position        = true;
+            axes.position_offset = Vector3( 0.0f, 10.0f, 0.0f );
+            tracks.push_back( axes );
+            mocap_.bake_tracks( tracks );
+            //
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            if ( bake_capture.size() > 1 )
+            {
+                bake_recording = false;
+                bake_timer_.Reset();
+                bake_job_ = bake_start( GetSubsystem< WorkQueue >(), bake_capture, std::move( tracks ), bake_sample_rate_, bake_rotation_tolerance_,
+                                        bake_position_tolerance_ );
+            }
+        }
+        ui::EndDisabled();
+        // 全部轨道完成后在主线程生成资源, 替换正在回放的动画
+        if ( bake_job_ && bake_job_->finished() )
+        {
+            bake_seconds_ = bake_timer_.GetUSec( false ) / 1000000.0f;
+            bake_samples_ = bake_job_->sample_count.load();
+            bake_keys_    = bake_job_->key_count();
+            if ( baked_animation_ )
+            {
+                playback_->Stop( baked_animation_ );
+            }
+            baked_animation_ = bake_finish( context_, *bake_job_, "Animations/Session.ani" );
+            baked_segments_  = std::move( bake_job_->segments );
+            GetSubsystem< ResourceCache >()->AddManualResource( baked_animation_ );
+            bake_job_.reset();
+            playback_time_ = 0.0f;
+            if ( playback_active_ )
+            {
+                playback_->PlayExisting( AnimationParameters( baked_animation_ ).Looped().Speed( playback_paused_ ? 0.0f : 1.0f ) );
+            }
+        }
+        if ( bake_job_ )
+        {
+            ui::Text( "Baking %d tracks...", bake_job_->remaining.load() );
+        }
+        else if ( bake_keys_ > 0 )
+        {
+            ui::Text( "%lld samples -> %lld keys (%.1fx) in %.2f s", ( long long )bake_samples_, ( long long )bake_keys_, ( double )bake_samples_ / bake_keys_,
+                      bake_seconds_ );
+        }
+        ui::Separator();
+        // 回放: 插值由引擎完成, 拖动进度条只设置动画时间
+        ui::BeginDisabled( ! baked_animation_ );
+        if ( ui::Checkbox( "Playback", &playback_active_ ) )
+        {
+            if ( playback_active_ )
+            {
+                playback_->PlayExisting( AnimationParameters( baked_animation_ ).Looped().Time( playback_time_ ).Speed( playback_paused_ ? 0.0f : 1.0f ) );
+            }
+            else
+            {
+                playback_->Stop( baked_animation_ );
+            }
+            mocap_.set_solver_enabled( ! playback_active_ );
         }
         ui::SameLine();
-        if ( ImPlot::BeginPlot( "Z Position", ImVec2( 300, 300 ) ) )
+        if ( ui::Checkbox( "Pause", &playback_paused_ ) && playback_active_ )
         {
-            ImPlot::SetupAxes( "Index", "Z", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
-            ImPlot::SetNextMarkerStyle( ImPlotMarker_Cross );
-            ImPlot::SetNextFillStyle( IMPLOT_AUTO_COL, 0.25f );
-            ImPlot::PlotStairs( "Position Z", pz, count, 0.05f, 0 );
-
-            ImPlot::EndPlot();
+            playback_->UpdateAnimationSpeed( baked_animation_, playback_paused_ ? 0.0f : 1.0f );
+        }
+        if ( playback_active_ )
+        {
+            if ( const AnimationParameters* params = playback_->GetLastAnimationParameters( baked_animation_ ) )
+            {
+                playback_time_ = params->GetTime();
+            }
+        }
+        ui::SetNextItemWidth( -1 );
+        if ( ui::SliderFloat( "##Time", &playback_time_, 0.0f, baked_animation_ ? baked_animation_->GetLength() : 0.0f, "%.2f s" ) && playback_active_ )
+        {
+            playback_->UpdateAnimationTime( baked_animation_, playback_time_ );
+        }
+        // 按事件跳转: 回放时间与录制时的帧序号经烘焙时保留的分段换算
+        ui::SetNextItemWidth( 100 );
+        ui::Combo(
+            "##EventKind", &event_kind_,
+            []( void*, int i, const char** text ) {
+                *text = i == 0 ? "Any" : sensor_event_names[ i - 1 ];
+                return true;
+            },
+            nullptr, sensor_event_kind_count + 1 );
+        ui::SameLine();
+        ui::SetNextItemWidth( 80 );
+        ui::InputInt( "Sensor##Event", &event_sensor_ );
+        event_sensor_ = Clamp( event_sensor_, 0, mocap_max_sensors - 1 );
+        for ( int forward = 0; forward < 2; forward++ )
+        {
+            ui::SameLine();
+            if ( ui::Button( forward ? "Next Event" : "Prev Event" ) && bake_sample_rate_ > 0.0f )
+            {
+                std::lock_guard< std::mutex > lock( queue_mutex );
+                const double        from  = baked_segments_.index_of( event_sensor_, playback_time_ * bake_sample_rate_ );
+                const SENSOR_EVENT* event = sensor_events.index.seek( from, forward != 0, [ this ]( const SENSOR_EVENT& e ) {
+                    return e.sensor == event_sensor_ && ( event_kind_ == 0 || e.kind == event_kind_ - 1 );
+                } );
+                const double sample = event != nullptr ? baked_segments_.sample_of( event_sensor_, event->begin ) : -1.0;
+                if ( sample >= 0.0 )
+                {
+                    playback_time_ = Clamp( ( float )( sample / bake_sample_rate_ ), 0.0f, baked_animation_->GetLength() );
+                    if ( playback_active_ )
+                    {
+                        playback_->UpdateAnimationTime( baked_animation_, playback_time_ );
+                    }
+                }
+            }
+        }
+        ui::SetNextItemWidth( ImGui::GetContentRegionAvail().x - 60 );
+        ui::InputText( "##BakePath", &bake_path_ );
+        ui::SameLine();
+        if ( ui::Button( "Save", ImVec2( ImGui::GetContentRegionAvail().x, 0 ) ) )
+        {
+            GetSubsystem< FileSystem >()->CreateDirsRecursive( GetPath( bake_path_ ) );
+            File file( context_, bake_path_, FILE_WRITE );
+            if ( ! file.IsOpen() || ! baked_animation_->Save( file ) )
+            {
+                URHO3D_LOGERROR( "Failed to save animation to {}", bake_path_ );
+            }
         }
+        ui::EndDisabled();
     }
     ui::End();
-};
-
+}
 //
 void CommonApplication::ToCtrlAxesNode()
 {
-    std::lock_guard< std::mutex > lock( queue_mutex );
-    if ( ! sensor_data_queue.empty() )
+    // 只取最新一帧与上次以来到达的帧数, 接收线程不为渲染线程保留中间的帧
+    SENSOR_DB new_sensor_db;
+    int       depth;
     {
-        SENSOR_DB new_sensor_db = sensor_data_queue.front();
-        //
-        axes_node_->SetRotation( Quaternion( new_sensor_db.roll, new_sensor_db.yaw, new_sensor_db.pitch ) );
-        axes_node_->SetPosition( Vector3( new_sensor_db.pos_x, new_sensor_db.pos_y + 10.0f, new_sensor_db.pos_z ) );
-        //
-        sensor_data_queue.pop();
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        depth = sensor_data_pending;
+        if ( depth > 0 )
+        {
+            new_sensor_db       = latest_sensor_db;
+            sensor_data_pending = 0;
+        }
     }
+    flow_control_.consume( depth );
+    if ( playback_active_ )
+    {
+        return;
+    }
+    // 平滑插值在没有新数据的帧里也继续前进
+    if ( pose_interpolator.enabled && ( pose_interpolator.valid_mask & 1u ) != 0 )
+    {
+        axes_node_->SetRotation( pose_interpolator.rotation[ 0 ] );
+        axes_node_->SetPosition( pose_interpolator.position[ 0 ] + Vector3( 0.0f, 10.0f, 0.0f ) );
+        return;
+    }
+    if ( depth == 0 )
+    {
+        return;
+    }
+    //
+    axes_node_->SetRotation( sensor_orientation( new_sensor_db ) );
+    axes_node_->SetPosition( Vector3( new_sensor_db.pos_x, new_sensor_db.pos_y + 10.0f, new_sensor_db.pos_z ) );
 }
 //
 void CommonApplication::DrawPoints()
 {
     auto* debug = scene_->GetComponent< DebugRenderer >();
-    int   count = sensor_data_vector.size();
-    for ( int i = 0; i < count; i++ )
+    for ( int64_t i = history_.tail; i < history_.head; i++ )
     {
-        debug->AddSphere( Sphere( Vector3( sensor_data_vector[ i ].pos_x, sensor_data_vector[ i ].pos_y + 10.0f, sensor_data_vector[ i ].pos_z ), 0.1f ), Color( 1.0f, 1.0f, 1.0f ) );
+        // 位置字段: sensor_channels 22..24, 字段号需加 1
+        debug->AddSphere( Sphere( Vector3( history_.at( 23, i ), history_.at( 24, i ) + 10.0f, history_.at( 25, i ) ), 0.1f ), Color( 1.0f, 1.0f, 1.0f ) );
     }
 }
 void CommonApplication::HandlePostRenderUpdate( StringHash eventType, VariantMap& eventData )
 {
     DrawPoints();
+    sensor_history_release();
+    // 快照已释放, 历史存储跟随订阅掩码调整
+    sensor_history_set_mask( flow_control_.mask );
 }
\ No newline at end of file
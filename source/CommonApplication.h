@@ -9,17 +9,22 @@
     #include <Urho3D/SystemUI/DebugHud.h>
 #endif
 
-#include "websocket/wasmsocket.h"
+#include "capture/capture_export.h"
+#include "mocap/mocap_rig.h"
+#include "synthetic/synth_ingest.h"
+#include "websocket/flow_control.h"
 #include <Urho3D/Core/Profiler.h>
 #include <Urho3D/Core/Timer.h>
 #include <Urho3D/Engine/Engine.h>
 #include <Urho3D/Engine/EngineDefs.h>
 #include <Urho3D/Engine/StateManager.h>
+#include <Urho3D/Graphics/AnimationController.h>
 #include <Urho3D/Graphics/Graphics.h>
 #include <Urho3D/Graphics/Renderer.h>
 #include <Urho3D/Graphics/Texture2D.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MountedDirectory.h>
 #include <Urho3D/Input/Input.h>
 #include <Urho3D/Input/InputEvents.h>
 #include <Urho3D/Resource/ResourceCache.h>
@@ -54,7 +59,54 @@ public:
     Node*                  axes_node_;
     int                    winSizeX_;
     int                    winSizeY_;
-    EMSCRIPTEN_WEBSOCKET_T socket;
+    // 本帧使用的历史快照, Update 时取得, 渲染结束后释放
+    SENSOR_HISTORY_VIEW    history_;
+    // 图表面板: 显示的通道与列数
+    bool                   chart_channels_[ sensor_channel_count ];
+    int                    chart_columns_;
+    bool                   chart_events_;
+    // 分布面板: 直方图显示的通道
+    int                    histogram_channel_;
+    // Allan 方差面板: 采样率与当前分析任务, 以及从录制文件分步读入采集数据的读者
+    double                       allan_sample_rate_;
+    std::shared_ptr< ALLAN_JOB > allan_job_;
+    CAPTURE_READER               allan_reader_;
+    bool                         allan_loading_;
+    // 与服务端协商的降采样, 批量与字段掩码
+    FLOW_CONTROL                 flow_control_;
+    // 磁力计校准面板: 点云副本与方向覆盖热力图, 以及它们对应和已上传的校准版本
+    std::vector< float >         mag_points_[ 3 ];
+    std::vector< float >         mag_coverage_;
+    uint32_t                     mag_coverage_revision_;
+    uint32_t                     mag_coverage_uploaded_;
+    int                          mag_coverage_cells_;
+    // 多传感器动作捕捉
+    MOCAP_RIG                    mocap_;
+    // 动画烘焙: 录制参数, 当前任务与烘焙结果的回放
+    float                        bake_sample_rate_;
+    float                        bake_rotation_tolerance_;
+    float                        bake_position_tolerance_;
+    ea::string                   bake_path_;
+    std::shared_ptr< BAKE_JOB >  bake_job_;
+    HiresTimer                   bake_timer_;
+    float                        bake_seconds_;
+    int64_t                      bake_samples_;
+    int64_t                      bake_keys_;
+    SharedPtr< Animation >       baked_animation_;
+    BAKE_SEGMENTS                baked_segments_;
+    AnimationController*         playback_;
+    bool                         playback_active_;
+    bool                         playback_paused_;
+    float                        playback_time_;
+    // 回放时按事件跳转: 传感器与事件类型 (0 为任意类型, 其余为 SENSOR_EVENT_KIND + 1)
+    int                          event_sensor_;
+    int                          event_kind_;
+    // 录制: capture_path_ 相对于挂载在 capture:// 的 IndexedDB/Captures 目录
+    SharedPtr< MountPoint >      capture_mount_;
+    ea::string                   capture_path_;
+    int                          export_format_;
+    std::shared_ptr< EXPORT_JOB > export_job_;
+    SENSOR_REPLAY                replay_;  // Recover: 在 Update 中分步重放录制文件
 public:
     void CreateScene();
     void SetupViewport();
@@ -65,10 +117,16 @@ public:
     void WebsocketUi();
     void AxesNodeAttributeUi();
     void ChartUi();
+    void DistributionUi();
+    void CalibrationUi();
+    void AllanVarianceUi();
+    void MocapUi();
+    void BakeUi();
 
     //
     void ToCtrlAxesNode();
     void DrawPoints();
+    void DrawEvents( double x_scale );
 public:
     void HandleMouseDown( StringHash eventType, VariantMap& eventData );
     void HandleKeyDown( StringHash /*eventType*/, VariantMap& eventData );
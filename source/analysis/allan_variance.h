@@ -0,0 +1,181 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <Urho3D/Core/WorkQueue.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+//
+// Allan 方差分析的通道: 加速度计与陀螺仪 (sensor_channels 的前 6 个)
+static constexpr int allan_channel_count = 6;
+//
+// 静态数据采集: 每个通道连续存放, 可容纳数千万样本
+struct ALLAN_CAPTURE
+{
+    std::vector< float > channels[ allan_channel_count ];
+    //
+    void push( const SENSOR_DB& sensor_db )
+    {
+        for ( int c = 0; c < allan_channel_count; c++ )
+        {
+            channels[ c ].push_back( sensor_db.*sensor_channels[ c ].member );
+        }
+    }
+    size_t size() const
+    {
+        return channels[ 0 ].size();
+    }
+    void clear()
+    {
+        for ( int c = 0; c < allan_channel_count; c++ )
+        {
+            channels[ c ].clear();
+            channels[ c ].shrink_to_fit();
+        }
+    }
+};
+//
+// 重叠 Allan 方差. 簇长 m 按 2 的幂取值, 基于累加和 C_k = sum( y_i - mean, i < k ), k = 0..N:
+// AVAR( m ) = sum( ( C_{k+2m} - 2 C_{k+m} + C_k )^2, k = 0..N-2m ) / ( 2 m^2 ( N - 2m + 1 ) ), 每个 tau 为 O(N)
+// 每个通道先在 WorkQueue 上求累加和, 完成后再为该通道的每个 tau 各投递一个任务, 结果完成即可读取
+struct ALLAN_JOB
+{
+    double                                 tau0 = 1.0;
+    int64_t                                sample_count = 0;
+    std::vector< float >                   samples[ allan_channel_count ];
+    std::vector< double >                  cumsum[ allan_channel_count ];
+    std::vector< int64_t >                 clusters;  // 各 tau 的簇长 m
+    std::vector< double >                  adev;      // [ channel * clusters.size() + t ]
+    std::unique_ptr< std::atomic< bool >[] > ready;
+    std::atomic< int >                     remaining{ 0 };
+    std::atomic< int >                     channel_remaining[ allan_channel_count ];
+    std::atomic< bool >                    cancelled{ false };
+    //
+    int tau_count() const
+    {
+        return ( int )clusters.size();
+    }
+    bool is_ready( int channel, int t ) const
+    {
+        return ready[ channel * clusters.size() + t ].load( std::memory_order_acquire );
+    }
+    bool finished() const
+    {
+        return remaining.load( std::memory_order_acquire ) == 0;
+    }
+};
+//
+static void allan_cluster_task( const std::shared_ptr< ALLAN_JOB >& job, int channel, int t )
+{
+    const size_t slot = channel * job->clusters.size() + t;
+    if ( ! job->cancelled.load( std::memory_order_relaxed ) )
+    {
+        const double* c     = job->cumsum[ channel ].data();
+        const int64_t m     = job->clusters[ t ];
+        const int64_t terms = job->sample_count - 2 * m + 1;
+        double        sum   = 0.0;
+        for ( int64_t k = 0; k < terms; k++ )
+        {
+            const double d = c[ k + 2 * m ] - 2.0 * c[ k + m ] + c[ k ];
+            sum += d * d;
+        }
+        job->adev[ slot ] = std::sqrt( sum / ( 2.0 * ( double )m * ( double )m * ( double )terms ) );
+    }
+    job->ready[ slot ].store( true, std::memory_order_release );
+    // 该通道最后一个 tau 完成后释放其累加和
+    if ( job->channel_remaining[ channel ].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+        std::vector< double >().swap( job->cumsum[ channel ] );
+    }
+    job->remaining.fetch_sub( 1, std::memory_order_acq_rel );
+}
+//
+static void allan_channel_task( const std::shared_ptr< ALLAN_JOB >& job, int channel, Urho3D::WorkQueue* queue )
+{
+    std::vector< float >&  y = job->samples[ channel ];
+    std::vector< double >& c = job->cumsum[ channel ];
+    if ( ! job->cancelled.load( std::memory_order_relaxed ) )
+    {
+        // 先减去均值, 避免累加和过大损失精度 (二阶差分与均值无关)
+        double mean = 0.0;
+        for ( float v : y )
+        {
+            mean += v;
+        }
+        mean /= ( double )y.size();
+        c.resize( y.size() + 1 );
+        c[ 0 ] = 0.0;
+        for ( size_t i = 0; i < y.size(); i++ )
+        {
+            c[ i + 1 ] = c[ i ] + ( ( double )y[ i ] - mean );
+        }
+    }
+    std::vector< float >().swap( y );
+    for ( int t = 0; t < job->tau_count(); t++ )
+    {
+        queue->PostTask( [ job, channel, t ]( unsigned, Urho3D::WorkQueue* ) { allan_cluster_task( job, channel, t ); }, Urho3D::TaskPriority::Low );
+    }
+}
+//
+// 接管采集数据并开始分析, tau0 为采样间隔 (秒)
+static std::shared_ptr< ALLAN_JOB > allan_start( Urho3D::WorkQueue* queue, ALLAN_CAPTURE& capture, double tau0 )
+{
+    auto job          = std::make_shared< ALLAN_JOB >();
+    job->tau0         = tau0;
+    job->sample_count = ( int64_t )capture.size();
+    for ( int64_t m = 1; 2 * m < job->sample_count; m *= 2 )
+    {
+        job->clusters.push_back( m );
+    }
+    const size_t slots = job->clusters.size() * allan_channel_count;
+    job->adev.assign( slots, 0.0 );
+    job->ready.reset( new std::atomic< bool >[ slots ] );
+    for ( size_t s = 0; s < slots; s++ )
+    {
+        job->ready[ s ].store( false, std::memory_order_relaxed );
+    }
+    job->remaining.store( ( int )slots, std::memory_order_release );
+    for ( int c = 0; c < allan_channel_count; c++ )
+    {
+        job->channel_remaining[ c ].store( job->tau_count(), std::memory_order_relaxed );
+    }
+    for ( int c = 0; c < allan_channel_count; c++ )
+    {
+        job->samples[ c ].swap( capture.channels[ c ] );
+    }
+    capture.clear();
+    if ( slots == 0 )
+    {
+        return job;
+    }
+    for ( int c = 0; c < allan_channel_count; c++ )
+    {
+        queue->PostTask( [ job, c ]( unsigned, Urho3D::WorkQueue* work_queue ) { allan_channel_task( job, c, work_queue ); }, Urho3D::TaskPriority::Low );
+    }
+    return job;
+}
+// 从录制文件 (capture/capture_writer.h 的 CAPTURE_READER) 分步读入采集数据: 与实时录制相同, 只取传感器 0 且带加速度计与陀螺仪字段的记录.
+// 每次调用读若干个块, 最多用 budget 秒, 读完 (或文件损坏处) 返回 true
+template < typename READER > static bool allan_capture_read( READER& reader, ALLAN_CAPTURE& capture, double budget )
+{
+    using clock      = std::chrono::steady_clock;
+    const auto start = clock::now();
+    while ( reader.next( [ & ]( int sensor, const std::vector< SENSOR_DB >& frames, uint32_t mask ) {
+        if ( sensor == 0 && sensor_mask_has( mask, 0, allan_channel_count ) )
+        {
+            for ( const SENSOR_DB& frame : frames )
+            {
+                capture.push( frame );
+            }
+        }
+    } ) )
+    {
+        if ( std::chrono::duration< double >( clock::now() - start ).count() >= budget )
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,805 @@
+#include "synthetic/imu_synth.h"  // 先于引擎头文件: 引擎的 MathDefs.h 会 #undef M_PI
+#include "analysis/imu_fusion.h"
+#include "calibration/mag_calibration.h"
+#include "capture/capture_writer.h"
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/MountedDirectory.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <new>
+//
+// 姿态误差与漂移的基准: 融合与航位推算在带真值的数据集上的角度 RMS 误差, 每分钟漂移, 位置误差, 以及单核吞吐与内存分配次数
+//   fusion_bench                                                          两组合成数据 (有 / 无磁场干扰), 4 个设备各 60 秒
+//   fusion_bench --duration 600 --devices 16 --json result.json            结果另写成 JSON, 供回归比较
+//   fusion_bench --filter "fast:kp=5,ki=0.1,mag=1,gate=0.15"               增加一组融合参数, 与预设同名时在预设上修改
+//   fusion_bench --capture /tmp/capture/Session.fmc --truth 15             录制数据, 以传感器 15 (例如光学动捕) 的 quate_* 与 pos_* 为真值
+//   fusion_bench --capture /tmp/capture/bench.fmc --truth self --no-synthetic  录制数据自带真值 (例如 capture 工具写入的合成数据)
+//   fusion_bench --gate "marg_gated:rms=1,drift=0.5,pos=20,speed=1e6,allocs=0"  超出阈值时输出 FAIL 并返回 1, 可给多个
+// 参与比较的流程: 服务端的 quate_*, 欧拉角 (应用显示所用), pos_*, 对 eacc_* 的两次积分, 以及各组客户端融合 (analysis/imu_fusion.h)
+// 客户端融合从真值的初始姿态, 位置与速度出发, 磁力计读数先经椭球拟合 (calibration/mag_calibration.h) 校正:
+// 合成设备另做一段翻转动作来拟合, 录制数据用自身的读数拟合
+// 合成数据中 quate_* 与 pos_* 就是真值, 服务端的误差只体现在欧拉角上 (见 SYNTH_NOISE::attitude_noise)
+struct BENCH_OPTIONS
+{
+    double                     duration  = 60.0;  // 合成数据, 秒
+    double                     rate      = 200.0;
+    int                        devices   = 4;
+    uint64_t                   seed      = 1;
+    double                     warmup    = 1.0;  // 开头不计入误差的秒数
+    bool                       synthetic = true;
+    std::string                script;
+    std::string                capture;
+    std::string                truth = "self";  // self 或真值的传感器编号
+    std::string                json;            // 路径, "-" 为标准输出
+    std::vector< std::string > filters;
+    std::vector< std::string > gates;
+};
+//
+static bool bench_parse( int argc, char** argv, BENCH_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg = argv[ i ];
+        if ( strcmp( arg, "--no-synthetic" ) == 0 )
+        {
+            options.synthetic = false;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--duration" ) == 0 )
+            options.duration = atof( value );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--devices" ) == 0 )
+            options.devices = std::max( 1, std::min( atoi( value ), synth_max_devices ) );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else if ( strcmp( arg, "--warmup" ) == 0 )
+            options.warmup = std::max( 0.0, atof( value ) );
+        else if ( strcmp( arg, "--script" ) == 0 )
+            options.script = value;
+        else if ( strcmp( arg, "--capture" ) == 0 )
+            options.capture = value;
+        else if ( strcmp( arg, "--truth" ) == 0 )
+            options.truth = value;
+        else if ( strcmp( arg, "--json" ) == 0 )
+            options.json = value;
+        else if ( strcmp( arg, "--filter" ) == 0 )
+            options.filters.push_back( value );
+        else if ( strcmp( arg, "--gate" ) == 0 )
+            options.gates.push_back( value );
+        else
+            return false;
+        i++;
+    }
+    return options.rate > 0.0 && options.duration > options.warmup && ( options.synthetic || ! options.capture.empty() );
+}
+// "key=value" 列表中取一项, 只认逗号之后的键
+static bool bench_value( const std::string& text, const char* key, double& out )
+{
+    for ( size_t at = text.find( key ); at != std::string::npos; at = text.find( key, at + 1 ) )
+    {
+        if ( at == 0 || text[ at - 1 ] == ',' || text[ at - 1 ] == ':' )
+        {
+            out = atof( text.c_str() + at + strlen( key ) );
+            return true;
+        }
+    }
+    return false;
+}
+//
+// 统计内存分配: 估计流程的主循环里不应有分配
+static std::atomic< uint64_t > bench_allocations{ 0 };
+static std::atomic< uint64_t > bench_allocated{ 0 };
+//
+// 替换全部可替换的 operator new / delete (数组, 对齐与 nothrow 版本), 否则经由它们的分配不被计数, 或在释放时与 malloc 不配对
+static void* bench_allocate( size_t size, size_t alignment ) noexcept
+{
+    bench_allocations.fetch_add( 1, std::memory_order_relaxed );
+    bench_allocated.fetch_add( size, std::memory_order_relaxed );
+    size = size > 0 ? size : 1;
+    if ( alignment <= alignof( std::max_align_t ) )
+    {
+        return malloc( size );
+    }
+    return aligned_alloc( alignment, ( size + alignment - 1 ) / alignment * alignment );
+}
+static void* bench_allocate_or_throw( size_t size, size_t alignment )
+{
+    if ( void* p = bench_allocate( size, alignment ) )
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+// GCC 把替换版本内的 free 当作与 new 不配对 (-Wmismatched-new-delete), 这里的分配都来自 malloc / aligned_alloc
+#if defined( __GNUC__ ) && ! defined( __clang__ )
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new( size_t size )
+{
+    return bench_allocate_or_throw( size, 0 );
+}
+void* operator new[]( size_t size )
+{
+    return bench_allocate_or_throw( size, 0 );
+}
+void* operator new( size_t size, std::align_val_t alignment )
+{
+    return bench_allocate_or_throw( size, ( size_t )alignment );
+}
+void* operator new[]( size_t size, std::align_val_t alignment )
+{
+    return bench_allocate_or_throw( size, ( size_t )alignment );
+}
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+    return bench_allocate( size, 0 );
+}
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+    return bench_allocate( size, 0 );
+}
+void* operator new( size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+    return bench_allocate( size, ( size_t )alignment );
+}
+void* operator new[]( size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept
+{
+    return bench_allocate( size, ( size_t )alignment );
+}
+void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+void operator delete[]( void* p ) noexcept
+{
+    free( p );
+}
+void operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
+void operator delete[]( void* p, size_t ) noexcept
+{
+    free( p );
+}
+void operator delete( void* p, std::align_val_t ) noexcept
+{
+    free( p );
+}
+void operator delete[]( void* p, std::align_val_t ) noexcept
+{
+    free( p );
+}
+void operator delete( void* p, size_t, std::align_val_t ) noexcept
+{
+    free( p );
+}
+void operator delete[]( void* p, size_t, std::align_val_t ) noexcept
+{
+    free( p );
+}
+void operator delete( void* p, const std::nothrow_t& ) noexcept
+{
+    free( p );
+}
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept
+{
+    free( p );
+}
+void operator delete( void* p, std::align_val_t, const std::nothrow_t& ) noexcept
+{
+    free( p );
+}
+void operator delete[]( void* p, std::align_val_t, const std::nothrow_t& ) noexcept
+{
+    free( p );
+}
+#if defined( __GNUC__ ) && ! defined( __clang__ )
+    #pragma GCC diagnostic pop
+#endif
+// 本线程占用的 CPU 时间, 吞吐按此折算为单核
+static double bench_cpu_seconds()
+{
+    timespec now;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+//
+// 一个设备的数据与逐帧真值, mags 为校正后的磁力计读数
+struct BENCH_SEQUENCE
+{
+    std::vector< SENSOR_DB >   frames;
+    std::vector< FUSION_QUAT > truth;
+    std::vector< FUSION_VEC3 > truth_position;
+    std::vector< FUSION_VEC3 > mags;
+    FUSION_VEC3                initial_velocity;
+    bool                       calibrated = false;
+};
+//
+struct BENCH_DATASET
+{
+    std::string                   name;
+    std::string                   source;
+    std::vector< BENCH_SEQUENCE > sequences;
+    uint64_t                      samples = 0;
+    double                        seconds = 0.0;
+    int                           calibrated = 0;
+};
+// 磁力计校正: calibration 没有样本时用序列自身的读数拟合 (姿态覆盖不够时会失败), 拟合不可信 (MAG_CALIBRATION::trusted) 时保留原始读数
+static void bench_calibrate( BENCH_SEQUENCE& sequence, MAG_CALIBRATION& calibration )
+{
+    if ( calibration.samples == 0 )
+    {
+        for ( const SENSOR_DB& frame : sequence.frames )
+        {
+            calibration.add_sample( frame.mag_x, frame.mag_y, frame.mag_z );
+        }
+    }
+    calibration.evaluate();
+    sequence.calibrated = calibration.trusted();
+    sequence.mags.resize( sequence.frames.size() );
+    for ( size_t i = 0; i < sequence.frames.size(); i++ )
+    {
+        float x = sequence.frames[ i ].mag_x, y = sequence.frames[ i ].mag_y, z = sequence.frames[ i ].mag_z;
+        if ( sequence.calibrated )
+        {
+            calibration.apply( x, y, z );
+        }
+        sequence.mags[ i ] = { x, y, z };
+    }
+}
+//
+static void bench_finish( BENCH_DATASET& dataset )
+{
+    for ( BENCH_SEQUENCE& sequence : dataset.sequences )
+    {
+        dataset.samples += sequence.frames.size();
+        dataset.seconds += sequence.frames.size() > 1 ? sequence.frames.back().time - sequence.frames.front().time : 0.0;
+        dataset.calibrated += sequence.calibrated ? 1 : 0;
+    }
+}
+// 合成设备的磁力计校正: 同一设备 (硬铁偏移相同) 先做 12 秒大角度翻转, 相当于使用前的校准动作
+static const char* bench_tumble = "0   0 0 0     0    0    0\n"
+                                  "2   0 0 0    80   30   90\n"
+                                  "4   0 0 0   -60  -70  200\n"
+                                  "6   0 0 0   170   60  300\n"
+                                  "8   0 0 0  -120  -20  420\n"
+                                  "10  0 0 0    30   85  500\n"
+                                  "12  0 0 0     0    0  720\n";
+//
+// 合成数据: 每个设备一条序列, 帧中的 quate_* 与 pos_* 即真值
+static void bench_synthetic( const BENCH_OPTIONS& options, const char* name, const SYNTH_NOISE& noise, BENCH_DATASET& dataset )
+{
+    SYNTH_SOURCE source;
+    source.seed  = options.seed;
+    source.noise = noise;
+    if ( ! options.script.empty() )
+    {
+        std::ifstream      file( options.script );
+        std::ostringstream text;
+        text << file.rdbuf();
+        source.trajectory.parse( text.str() );
+    }
+    source.reset( options.devices, options.rate );
+    SYNTH_TRAJECTORY tumble;
+    tumble.parse( bench_tumble );
+    dataset.name   = name;
+    dataset.source = "synthetic";
+    dataset.sequences.resize( source.devices.size() );
+    const int64_t count = ( int64_t )( options.duration * options.rate );
+    for ( size_t d = 0; d < source.devices.size(); d++ )
+    {
+        BENCH_SEQUENCE& sequence = dataset.sequences[ d ];
+        MAG_CALIBRATION calibration;
+        SYNTH_DEVICE    device      = source.devices[ d ];  // 副本, 不影响正式数据的随机序列
+        device.noise.disturb_period = 0.0;
+        for ( int64_t i = 0, n = ( int64_t )( tumble.duration() * options.rate ); i < n; i++ )
+        {
+            const SENSOR_DB frame = device.frame( tumble, i );
+            calibration.add_sample( frame.mag_x, frame.mag_y, frame.mag_z );
+        }
+        sequence.frames.reserve( count );
+        for ( int64_t i = 0; i < count; i++ )
+        {
+            const SENSOR_DB frame = source.devices[ d ].frame( source.trajectory, i );
+            sequence.frames.push_back( frame );
+            sequence.truth.push_back( fusion_sensor_quate( frame ) );
+            sequence.truth_position.push_back( { frame.pos_x, frame.pos_y, frame.pos_z } );
+        }
+        sequence.initial_velocity = { sequence.frames[ 0 ].vel_x, sequence.frames[ 0 ].vel_y, sequence.frames[ 0 ].vel_z };
+        bench_calibrate( sequence, calibration );
+    }
+    bench_finish( dataset );
+}
+// 录制数据: truth 为 "self" 时每个传感器以自身的 quate_* / pos_* 为真值, 否则以该编号传感器的输出按时间插值为真值
+static bool bench_recorded( const BENCH_OPTIONS& options, BENCH_DATASET& dataset )
+{
+    using namespace Urho3D;
+    SharedPtr< Context > context( new Context() );
+    context->RegisterSubsystem< FileSystem >();
+    VirtualFileSystem* vfs  = context->RegisterSubsystem< VirtualFileSystem >();
+    const ea::string   path = options.capture.c_str();
+    vfs->Mount( MakeShared< MountedDirectory >( context, GetPath( path ), "capture" ) );
+    //
+    std::vector< SENSOR_DB > streams[ 32 ];
+    uint32_t                 masks[ 32 ] = {};
+    auto                     record      = [ & ]( int sensor, const std::vector< SENSOR_DB >& frames, uint32_t mask ) {
+        if ( sensor < 32 )
+        {
+            streams[ sensor ].insert( streams[ sensor ].end(), frames.begin(), frames.end() );
+            masks[ sensor ] |= mask;
+        }
+    };
+    const CAPTURE_RECOVERY recovery = capture_recover( vfs, "capture", GetFileNameAndExtension( path ).c_str(), record );
+    if ( recovery.blocks == 0 )
+    {
+        printf( "Cannot read capture %s\n", options.capture.c_str() );
+        return false;
+    }
+    const bool     self      = options.truth == "self";
+    const int      reference = self ? -1 : atoi( options.truth.c_str() );
+    const uint32_t imu       = 0x3ffu;      // time, acc, gyro, mag
+    const uint32_t attitude  = 0xfu << 10;  // quate_*
+    const uint32_t position  = 0x7u << 23;  // pos_*
+    if ( ! self && ( reference < 0 || reference >= 32 || streams[ reference ].empty() || ( masks[ reference ] & attitude ) != attitude ) )
+    {
+        printf( "Truth sensor %s has no quate_* in %s\n", options.truth.c_str(), options.capture.c_str() );
+        return false;
+    }
+    dataset.name   = GetFileName( path ).c_str();
+    dataset.source = "recorded";
+    for ( int s = 0; s < 32; s++ )
+    {
+        const uint32_t truth_mask = self ? masks[ s ] : masks[ reference ];
+        if ( s == reference || streams[ s ].size() < 2 || ( masks[ s ] & imu ) != imu || ( truth_mask & attitude ) != attitude )
+        {
+            continue;
+        }
+        // 真值没有 pos_* 时不统计位置误差
+        const bool                      has_position = ( truth_mask & position ) == position;
+        const std::vector< SENSOR_DB >& truth        = self ? streams[ s ] : streams[ reference ];
+        BENCH_SEQUENCE                  sequence;
+        size_t                          cursor = 0;
+        for ( const SENSOR_DB& frame : streams[ s ] )
+        {
+            while ( cursor + 2 < truth.size() && truth[ cursor + 1 ].time <= frame.time )
+            {
+                cursor++;
+            }
+            const SENSOR_DB& a = truth[ cursor ];
+            const SENSOR_DB& b = truth[ std::min( cursor + 1, truth.size() - 1 ) ];
+            if ( frame.time < a.time || frame.time > b.time )
+            {
+                continue;
+            }
+            const float span = b.time - a.time, k = span > 0.0f ? ( frame.time - a.time ) / span : 0.0f;
+            FUSION_QUAT qa = fusion_sensor_quate( a ), qb = fusion_sensor_quate( b );
+            const float sign = qa.w * qb.w + qa.x * qb.x + qa.y * qb.y + qa.z * qb.z < 0.0f ? -1.0f : 1.0f;
+            sequence.frames.push_back( frame );
+            sequence.truth.push_back( fusion_normalize( { qa.w + ( sign * qb.w - qa.w ) * k, qa.x + ( sign * qb.x - qa.x ) * k, qa.y + ( sign * qb.y - qa.y ) * k,
+                                                          qa.z + ( sign * qb.z - qa.z ) * k } ) );
+            sequence.truth_position.push_back( has_position ? FUSION_VEC3{ a.pos_x + ( b.pos_x - a.pos_x ) * k, a.pos_y + ( b.pos_y - a.pos_y ) * k,
+                                                                           a.pos_z + ( b.pos_z - a.pos_z ) * k }
+                                                            : FUSION_VEC3{ NAN, NAN, NAN } );
+            if ( sequence.frames.size() == 1 )
+            {
+                sequence.initial_velocity = { a.vel_x, a.vel_y, a.vel_z };
+            }
+        }
+        if ( sequence.frames.size() >= 2 )
+        {
+            MAG_CALIBRATION calibration;
+            bench_calibrate( sequence, calibration );
+            dataset.sequences.push_back( std::move( sequence ) );
+        }
+    }
+    bench_finish( dataset );
+    return ! dataset.sequences.empty();
+}
+//
+// 误差序列的统计: RMS, 最大值, 末值, 以及误差对时间的最小二乘斜率 (漂移)
+struct BENCH_ERROR
+{
+    uint64_t count = 0;
+    double   sum_sq = 0.0, max = 0.0, last = 0.0;
+    double   st = 0.0, se = 0.0, stt = 0.0, ste = 0.0;
+    //
+    void add( double t, double e )
+    {
+        count++;
+        sum_sq += e * e;
+        max  = std::max( max, e );
+        last = e;
+        st += t;
+        se += e;
+        stt += t * t;
+        ste += t * e;
+    }
+    double slope() const
+    {
+        const double n = ( double )count, d = n * stt - st * st;
+        return count >= 2 && d > 0.0 ? ( n * ste - st * se ) / d : 0.0;
+    }
+};
+// 多个序列汇总: RMS 与最大值按全部样本, 末值与漂移取各序列的平均
+struct BENCH_SUMMARY
+{
+    uint64_t count = 0;
+    double   sum_sq = 0.0, max = 0.0, last = 0.0, drift = 0.0;
+    int      sequences = 0;
+    //
+    void merge( const BENCH_ERROR& error )
+    {
+        if ( error.count == 0 )
+        {
+            return;
+        }
+        count += error.count;
+        sum_sq += error.sum_sq;
+        max = std::max( max, error.max );
+        last += error.last;
+        drift += error.slope() * 60.0;
+        sequences++;
+    }
+    double rms() const
+    {
+        return count > 0 ? sqrt( sum_sq / count ) : NAN;
+    }
+    double final_error() const
+    {
+        return sequences > 0 ? last / sequences : NAN;
+    }
+    double drift_per_minute() const
+    {
+        return sequences > 0 ? drift / sequences : NAN;
+    }
+};
+//
+enum BENCH_KIND
+{
+    bench_server_quate,  // 姿态: quate_*
+    bench_server_euler,  // 姿态: 欧拉角, 同 sensor_orientation
+    bench_server_pos,    // 位置: pos_*
+    bench_server_eacc,   // 位置: eacc_* 两次积分
+    bench_client,        // 姿态与位置: FUSION_FILTER + FUSION_DEAD_RECKONING
+};
+//
+struct BENCH_PIPELINE
+{
+    std::string     name;
+    BENCH_KIND      kind     = bench_client;
+    FUSION_SETTINGS settings = {};
+    // 单个数据集上的结果
+    BENCH_SUMMARY orientation = {}, position = {};
+    uint64_t      samples = 0, allocations = 0, allocated = 0;
+    double        cpu     = 0.0;
+    //
+    bool has_orientation() const
+    {
+        return kind == bench_server_quate || kind == bench_server_euler || kind == bench_client;
+    }
+    bool has_position() const
+    {
+        return kind != bench_server_quate && kind != bench_server_euler;
+    }
+    double samples_per_second() const
+    {
+        return samples / std::max( cpu, 1e-9 );
+    }
+};
+//
+static std::vector< BENCH_PIPELINE > bench_pipelines( const BENCH_OPTIONS& options )
+{
+    std::vector< BENCH_PIPELINE > pipelines = {
+        { "server_quate", bench_server_quate }, { "server_euler", bench_server_euler }, { "server_pos", bench_server_pos }, { "server_eacc", bench_server_eacc },
+    };
+    // 预设: 纯陀螺积分, 六轴, 九轴, 九轴 + 磁场模长门限, 再加静止置零速度
+    const char* presets[][ 2 ] = {
+        { "gyro", "kp=0,ki=0" }, { "imu", "" }, { "marg", "mag=1" }, { "marg_gated", "mag=1,gate=0.15" }, { "marg_zupt", "mag=1,gate=0.15,zupt=1" },
+    };
+    for ( const auto& preset : presets )
+    {
+        BENCH_PIPELINE pipeline{ preset[ 0 ], bench_client };
+        pipeline.settings.parse( preset[ 1 ] );
+        pipelines.push_back( pipeline );
+    }
+    for ( const std::string& filter : options.filters )
+    {
+        const size_t      colon = filter.find( ':' );
+        const std::string name  = filter.substr( 0, colon );
+        auto              found = std::find_if( pipelines.begin(), pipelines.end(), [ & ]( const BENCH_PIPELINE& p ) { return p.name == name; } );
+        if ( found == pipelines.end() )
+        {
+            pipelines.push_back( { name, bench_client } );
+            found = pipelines.end() - 1;
+        }
+        if ( found->kind == bench_client && colon != std::string::npos )
+        {
+            found->settings.parse( filter.substr( colon + 1 ) );
+        }
+    }
+    return pipelines;
+}
+// 在一个数据集上运行: 估计结果先写入预分配的缓冲, 计时与分配计数只覆盖估计本身, 之后再与真值比较
+static void bench_run( const BENCH_DATASET& dataset, double warmup, BENCH_PIPELINE& pipeline, std::vector< FUSION_QUAT >& orientations,
+                       std::vector< FUSION_VEC3 >& positions )
+{
+    pipeline.orientation = BENCH_SUMMARY();
+    pipeline.position    = BENCH_SUMMARY();
+    pipeline.samples = pipeline.allocations = pipeline.allocated = 0;
+    pipeline.cpu                                                 = 0.0;
+    for ( const BENCH_SEQUENCE& sequence : dataset.sequences )
+    {
+        const size_t n = sequence.frames.size();
+        orientations.resize( n );
+        positions.resize( n );
+        FUSION_FILTER filter;
+        filter.settings = pipeline.settings;
+        filter.reset( sequence.truth[ 0 ], sequence.mags[ 0 ] );
+        FUSION_DEAD_RECKONING dead_reckoning;
+        dead_reckoning.zupt = pipeline.settings.zupt;
+        dead_reckoning.reset( sequence.truth_position[ 0 ], sequence.initial_velocity );
+        //
+        const uint64_t allocations = bench_allocations, allocated = bench_allocated;
+        const double   begin       = bench_cpu_seconds();
+        for ( size_t i = 0; i < n; i++ )
+        {
+            const SENSOR_DB& frame = sequence.frames[ i ];
+            float            dt    = i > 0 ? frame.time - sequence.frames[ i - 1 ].time : 0.0f;
+            dt                     = dt > 0.0f && dt < 0.5f ? dt : 0.0f;  // 重复帧与断档不积分
+            switch ( pipeline.kind )
+            {
+            case bench_server_quate:
+                orientations[ i ] = fusion_sensor_quate( frame );
+                break;
+            case bench_server_euler:
+                orientations[ i ] = fusion_sensor_euler( frame );
+                break;
+            case bench_server_pos:
+                positions[ i ] = { frame.pos_x, frame.pos_y, frame.pos_z };
+                break;
+            case bench_server_eacc:
+                dead_reckoning.integrate( { frame.eacc_x, frame.eacc_y, frame.eacc_z }, dt );
+                positions[ i ] = dead_reckoning.position;
+                break;
+            case bench_client:
+            {
+                const FUSION_VEC3 gyro{ frame.gyro_x, frame.gyro_y, frame.gyro_z };
+                const FUSION_VEC3 acc{ frame.acc_x, frame.acc_y, frame.acc_z };
+                if ( dt > 0.0f )
+                {
+                    filter.update( gyro, acc, sequence.mags[ i ], dt );
+                    dead_reckoning.update( filter.q, acc, gyro, dt );
+                }
+                orientations[ i ] = filter.q;
+                positions[ i ]    = dead_reckoning.position;
+                break;
+            }
+            }
+        }
+        pipeline.cpu += bench_cpu_seconds() - begin;
+        pipeline.allocations += bench_allocations - allocations;
+        pipeline.allocated += bench_allocated - allocated;
+        pipeline.samples += n;
+        //
+        BENCH_ERROR angle, distance;
+        for ( size_t i = 0; i < n; i++ )
+        {
+            const double t = sequence.frames[ i ].time - sequence.frames[ 0 ].time;
+            if ( t < warmup )
+            {
+                continue;
+            }
+            if ( pipeline.has_orientation() )
+            {
+                angle.add( t, fusion_angle( orientations[ i ], sequence.truth[ i ] ) );
+            }
+            if ( pipeline.has_position() && std::isfinite( sequence.truth_position[ i ].x ) )
+            {
+                distance.add( t, fusion_length( positions[ i ] - sequence.truth_position[ i ] ) );
+            }
+        }
+        pipeline.orientation.merge( angle );
+        pipeline.position.merge( distance );
+    }
+}
+//
+// JSON 不能表示 NaN, 写为 null
+static std::string bench_number( double value )
+{
+    return std::isfinite( value ) ? fmt::format( "{:.6g}", value ) : "null";
+}
+// 字符串加引号并转义: 数据集名来自录制文件名, 估计器名与门限来自命令行, 可能含引号, 反斜杠或控制字符
+static std::string bench_string( const std::string& value )
+{
+    std::string out = "\"";
+    for ( unsigned char c : value )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            out += '\\';
+            out += ( char )c;
+        }
+        else if ( c < 0x20 )
+        {
+            out += fmt::format( "\\u{:04x}", c );
+        }
+        else
+        {
+            out += ( char )c;
+        }
+    }
+    return out + '"';
+}
+//
+static void bench_json( std::string& out, const BENCH_DATASET& dataset, const std::vector< BENCH_PIPELINE >& pipelines, bool first )
+{
+    auto append = [ & ]( auto&&... args ) { fmt::format_to( std::back_inserter( out ), args... ); };
+    append( "{}\n    {{\n      \"name\": {},\n      \"source\": {},\n      \"sequences\": {},\n      \"samples\": {},\n      \"seconds\": {},\n"
+            "      \"mag_calibrated\": {},\n",
+            first ? "" : ",", bench_string( dataset.name ), bench_string( dataset.source ), dataset.sequences.size(), dataset.samples, bench_number( dataset.seconds ), dataset.calibrated );
+    for ( int part = 0; part < 2; part++ )
+    {
+        append( "      \"{}\": [", part == 0 ? "orientation" : "position" );
+        bool separator = false;
+        for ( const BENCH_PIPELINE& pipeline : pipelines )
+        {
+            if ( ! ( part == 0 ? pipeline.has_orientation() : pipeline.has_position() ) )
+            {
+                continue;
+            }
+            const BENCH_SUMMARY& summary = part == 0 ? pipeline.orientation : pipeline.position;
+            append( "{}\n        {{ \"estimator\": {}, \"settings\": {}, \"{}\": {}, \"{}\": {}, \"{}\": {}, \"{}\": {}, \"samples_per_second\": {}, "
+                    "\"allocations\": {}, \"allocated_bytes\": {} }}",
+                    separator ? "," : "", bench_string( pipeline.name ), bench_string( pipeline.kind == bench_client ? pipeline.settings.to_string() : "" ), part == 0 ? "rms_deg" : "rms_m",
+                    bench_number( summary.rms() ), part == 0 ? "max_deg" : "max_m", bench_number( summary.count > 0 ? summary.max : NAN ),
+                    part == 0 ? "final_deg" : "final_m", bench_number( summary.final_error() ), part == 0 ? "drift_deg_per_min" : "drift_m_per_min",
+                    bench_number( summary.drift_per_minute() ), bench_number( pipeline.samples_per_second() ), pipeline.allocations, pipeline.allocated );
+            separator = true;
+        }
+        append( "\n      ]{}\n", part == 0 ? "," : "" );
+    }
+    append( "    }}" );
+}
+// 门限 "name:rms=..,drift=..,pos=..,pos_drift=..,speed=..,allocs=..", 不满足的项记入 failures
+static void bench_gate( const std::string& gate, const BENCH_DATASET& dataset, const std::vector< BENCH_PIPELINE >& pipelines, std::vector< std::string >& failures )
+{
+    const std::string name  = gate.substr( 0, gate.find( ':' ) );
+    auto              found = std::find_if( pipelines.begin(), pipelines.end(), [ & ]( const BENCH_PIPELINE& p ) { return p.name == name; } );
+    if ( found == pipelines.end() )
+    {
+        failures.push_back( fmt::format( "{}: unknown estimator {}", dataset.name, name ) );
+        return;
+    }
+    auto check = [ & ]( const char* key, double value, bool upper ) {
+        double limit = 0.0;
+        if ( bench_value( gate, key, limit ) && std::isfinite( value ) && ( upper ? value > limit : value < limit ) )
+        {
+            failures.push_back( fmt::format( "{} {}: {}{} {} {}", dataset.name, name, key, bench_number( value ), upper ? ">" : "<", bench_number( limit ) ) );
+        }
+    };
+    if ( found->has_orientation() )
+    {
+        check( "rms=", found->orientation.rms(), true );
+        check( "drift=", fabs( found->orientation.drift_per_minute() ), true );
+    }
+    if ( found->has_position() )
+    {
+        check( "pos=", found->position.rms(), true );
+        check( "pos_drift=", fabs( found->position.drift_per_minute() ), true );
+    }
+    check( "speed=", found->samples_per_second(), false );
+    check( "allocs=", ( double )found->allocations, true );
+}
+//
+int main( int argc, char** argv )
+{
+    BENCH_OPTIONS options;
+    if ( ! bench_parse( argc, argv, options ) )
+    {
+        printf( "usage: fusion_bench [--duration s] [--rate hz] [--devices n] [--seed n] [--warmup s] [--script file] [--no-synthetic]\n"
+                "                    [--capture dir/name.fmc] [--truth self|sensor] [--filter name:kp=,ki=,mag=,gate=,acc_gate=,zupt=] [--gate name:rms=,drift=,pos=,pos_drift=,speed=,allocs=]\n"
+                "                    [--json path|-]\n" );
+        return 1;
+    }
+    std::vector< BENCH_DATASET > datasets;
+    if ( options.synthetic )
+    {
+        SYNTH_NOISE noise;
+        datasets.emplace_back();
+        bench_synthetic( options, "synthetic", noise, datasets.back() );
+        noise.disturb_period = 0.0;
+        datasets.emplace_back();
+        bench_synthetic( options, "synthetic_clean_mag", noise, datasets.back() );
+    }
+    if ( ! options.capture.empty() )
+    {
+        datasets.emplace_back();
+        if ( ! bench_recorded( options, datasets.back() ) )
+        {
+            return 1;
+        }
+    }
+    //
+    // JSON 写到标准输出时, 文字报告改到标准错误
+    FILE*                         report    = options.json == "-" ? stderr : stdout;
+    std::vector< BENCH_PIPELINE > pipelines = bench_pipelines( options );
+    std::vector< FUSION_QUAT >    orientations;
+    std::vector< FUSION_VEC3 >    positions;
+    std::vector< std::string >    failures;
+    std::string                   json = fmt::format( "{{\n  \"version\": 1,\n  \"seed\": {},\n  \"warmup\": {},\n  \"datasets\": [", options.seed, options.warmup );
+    for ( size_t d = 0; d < datasets.size(); d++ )
+    {
+        const BENCH_DATASET& dataset = datasets[ d ];
+        fprintf( report, "%s: %zu sequences, %llu samples, %.0f s, %d/%zu mag calibrated\n", dataset.name.c_str(), dataset.sequences.size(), ( unsigned long long )dataset.samples,
+                dataset.seconds, dataset.calibrated, dataset.sequences.size() );
+        for ( BENCH_PIPELINE& pipeline : pipelines )
+        {
+            bench_run( dataset, options.warmup, pipeline, orientations, positions );
+            fprintf( report, "  %-14s", pipeline.name.c_str() );
+            if ( pipeline.has_orientation() )
+            {
+                fprintf( report, " | rms %7.3f max %7.3f final %7.3f deg, drift %+8.3f deg/min", pipeline.orientation.rms(), pipeline.orientation.max,
+                        pipeline.orientation.final_error(), pipeline.orientation.drift_per_minute() );
+            }
+            if ( pipeline.has_position() )
+            {
+                fprintf( report, " | pos rms %8.3f final %8.3f m, drift %+8.3f m/min", pipeline.position.rms(), pipeline.position.final_error(),
+                        pipeline.position.drift_per_minute() );
+            }
+            fprintf( report, " | %.2f M samples/s, %llu allocs\n", pipeline.samples_per_second() / 1e6, ( unsigned long long )pipeline.allocations );
+        }
+        for ( const std::string& gate : options.gates )
+        {
+            bench_gate( gate, dataset, pipelines, failures );
+        }
+        bench_json( json, dataset, pipelines, d == 0 );
+    }
+    json += fmt::format( "\n  ],\n  \"gate\": {{ \"passed\": {}, \"failures\": [", failures.empty() ? "true" : "false" );
+    for ( size_t i = 0; i < failures.size(); i++ )
+    {
+        json += fmt::format( "{}{}", i > 0 ? ", " : "", bench_string( failures[ i ] ) );
+    }
+    json += "] }\n}\n";
+    //
+    if ( options.json == "-" )
+    {
+        fwrite( json.data(), 1, json.size(), stdout );
+    }
+    else if ( ! options.json.empty() )
+    {
+        FILE* file = fopen( options.json.c_str(), "wb" );
+        if ( file == nullptr || fwrite( json.data(), 1, json.size(), file ) != json.size() )
+        {
+            fprintf( report, "Cannot write %s\n", options.json.c_str() );
+            failures.push_back( "json" );
+        }
+        if ( file != nullptr )
+        {
+            fclose( file );
+        }
+    }
+    for ( const std::string& failure : failures )
+    {
+        fprintf( report, "FAIL %s\n", failure.c_str() );
+    }
+    if ( ! options.gates.empty() )
+    {
+        fprintf( report, "%s\n", failures.empty() ? "PASS" : "FAIL" );
+    }
+    return failures.empty() ? 0 : 1;
+}
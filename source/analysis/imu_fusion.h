@@ -0,0 +1,241 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <cmath>
+#include <cstring>
+#include <string>
+//
+// 客户端姿态融合 (Mahony 互补滤波) 与航位推算, 用于和服务端输出的 quate_* / pos_* 对照 (见 analysis/fusion_bench.cxx)
+// 坐标与 sensor_orientation 一致: Y 轴向上, 姿态 q 把机体系转到世界系. 单位同 SENSOR_DB: acc 为 g, gyro 为 deg/s, mag 为 uT
+static constexpr float fusion_gravity    = 9.80665f;
+static constexpr float fusion_deg_to_rad = 0.017453292519943295f;
+//
+struct FUSION_VEC3
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+};
+static inline FUSION_VEC3 operator+( const FUSION_VEC3& a, const FUSION_VEC3& b )
+{
+    return { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+static inline FUSION_VEC3 operator-( const FUSION_VEC3& a, const FUSION_VEC3& b )
+{
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+static inline FUSION_VEC3 operator*( const FUSION_VEC3& a, float s )
+{
+    return { a.x * s, a.y * s, a.z * s };
+}
+static inline float fusion_dot( const FUSION_VEC3& a, const FUSION_VEC3& b )
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+static inline FUSION_VEC3 fusion_cross( const FUSION_VEC3& a, const FUSION_VEC3& b )
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+static inline float fusion_length( const FUSION_VEC3& a )
+{
+    return sqrtf( fusion_dot( a, a ) );
+}
+//
+struct FUSION_QUAT
+{
+    float w = 1.0f, x = 0.0f, y = 0.0f, z = 0.0f;
+};
+static inline FUSION_QUAT operator*( const FUSION_QUAT& a, const FUSION_QUAT& b )
+{
+    return { a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+             a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w };
+}
+static inline FUSION_QUAT fusion_conjugate( const FUSION_QUAT& q )
+{
+    return { q.w, -q.x, -q.y, -q.z };
+}
+static inline FUSION_QUAT fusion_normalize( const FUSION_QUAT& q )
+{
+    const float n = sqrtf( q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z );
+    return n > 0.0f ? FUSION_QUAT{ q.w / n, q.x / n, q.y / n, q.z / n } : FUSION_QUAT();
+}
+// 机体系 -> 世界系: q * v * q^-1
+static inline FUSION_VEC3 fusion_rotate( const FUSION_QUAT& q, const FUSION_VEC3& v )
+{
+    const FUSION_VEC3 u{ q.x, q.y, q.z };
+    const FUSION_VEC3 t = fusion_cross( u, v ) * 2.0f;
+    return v + t * q.w + fusion_cross( u, t );
+}
+// 世界系 -> 机体系: q^-1 * v * q
+static inline FUSION_VEC3 fusion_rotate_inverse( const FUSION_QUAT& q, const FUSION_VEC3& v )
+{
+    return fusion_rotate( fusion_conjugate( q ), v );
+}
+// 两个姿态之间的夹角, 度. 用 atan2 避免小角度时 acos 的精度损失
+static inline float fusion_angle( const FUSION_QUAT& a, const FUSION_QUAT& b )
+{
+    const FUSION_QUAT d = fusion_conjugate( a ) * b;
+    return 2.0f * atan2f( sqrtf( d.x * d.x + d.y * d.y + d.z * d.z ), fabsf( d.w ) ) / fusion_deg_to_rad;
+}
+// 航向误差 (绕世界系 Y 轴), 度, 带符号: 用于统计航向漂移
+static inline float fusion_heading_error( const FUSION_QUAT& estimate, const FUSION_QUAT& truth )
+{
+    const FUSION_VEC3 e = fusion_rotate( estimate, FUSION_VEC3{ 0.0f, 0.0f, 1.0f } );
+    const FUSION_VEC3 t = fusion_rotate( truth, FUSION_VEC3{ 0.0f, 0.0f, 1.0f } );
+    return atan2f( e.z * t.x - e.x * t.z, e.x * t.x + e.z * t.z ) / fusion_deg_to_rad;
+}
+// 与 Urho3D::Quaternion( x, y, z ) 相同: Ry( y ) * Rx( x ) * Rz( z ), 角度为度
+static FUSION_QUAT fusion_euler( float x, float y, float z )
+{
+    const float d  = fusion_deg_to_rad * 0.5f;
+    const float sx = sinf( x * d ), cx = cosf( x * d ), sy = sinf( y * d ), cy = cosf( y * d ), sz = sinf( z * d ), cz = cosf( z * d );
+    return { cy * cx * cz + sy * sx * sz, cy * sx * cz + sy * cx * sz, sy * cx * cz - cy * sx * sz, cy * cx * sz - sy * sx * cz };
+}
+// 服务端输出的两种姿态: quate_* 与应用显示用的欧拉角 (同 sensor_orientation)
+static inline FUSION_QUAT fusion_sensor_quate( const SENSOR_DB& sensor_db )
+{
+    return fusion_normalize( { sensor_db.quate_w, sensor_db.quate_x, sensor_db.quate_y, sensor_db.quate_z } );
+}
+static inline FUSION_QUAT fusion_sensor_euler( const SENSOR_DB& sensor_db )
+{
+    return fusion_euler( sensor_db.roll, sensor_db.yaw, sensor_db.pitch );
+}
+//
+// 融合参数. 文本形式 "kp=1,ki=0.02,mag=1,gate=0.15,zupt=1", 缺省的项保持不变
+struct FUSION_SETTINGS
+{
+    float kp       = 1.0f;   // 比例增益, 0 为纯陀螺积分
+    float ki       = 0.02f;  // 积分增益, 估计陀螺零偏
+    bool  mag      = false;  // 用磁力计修正航向 (只修正绕 Y 轴的分量, 不影响倾角)
+    float mag_gate = 0.0f;   // 磁场模长偏离参考值超过此比例时不用磁力计, 0 为不限
+    float acc_gate = 0.1f;   // 加速度模长偏离 1g 超过此值时不用加速度计, 0 为不限
+    bool  zupt     = false;  // 航位推算在静止时把速度置零
+    //
+    void parse( const std::string& text )
+    {
+        auto value = [ & ]( const char* key, float& out ) {
+            // 只认逗号之后的键, "gate=" 不会匹配到 "acc_gate="
+            for ( size_t at = text.find( key ); at != std::string::npos; at = text.find( key, at + 1 ) )
+            {
+                if ( at == 0 || text[ at - 1 ] == ',' )
+                {
+                    out = ( float )atof( text.c_str() + at + strlen( key ) );
+                    return;
+                }
+            }
+        };
+        float use_mag = mag ? 1.0f : 0.0f, use_zupt = zupt ? 1.0f : 0.0f;
+        value( "kp=", kp );
+        value( "ki=", ki );
+        value( "mag=", use_mag );
+        value( "gate=", mag_gate );
+        value( "acc_gate=", acc_gate );
+        value( "zupt=", use_zupt );
+        mag  = use_mag != 0.0f;
+        zupt = use_zupt != 0.0f;
+    }
+    std::string to_string() const
+    {
+        return fmt::format( "kp={},ki={},mag={},gate={},acc_gate={},zupt={}", kp, ki, mag ? 1 : 0, mag_gate, acc_gate, zupt ? 1 : 0 );
+    }
+};
+//
+// Mahony 互补滤波: 误差为测量方向与估计方向的叉积 (机体系), 比例项直接修正角速度, 积分项累积为零偏
+// 磁力计只取水平分量与初始化时记录的水平参考方向比较, 参考方向由 reset 时的姿态与读数决定
+struct FUSION_FILTER
+{
+    FUSION_SETTINGS settings;
+    FUSION_QUAT     q;
+    FUSION_VEC3     integral;   // rad/s
+    FUSION_VEC3     reference;  // 世界系的水平磁场方向 (单位向量)
+    float           field      = 0.0f;  // 参考磁场模长
+    bool            referenced = false;
+    //
+    void reset( const FUSION_QUAT& initial, const FUSION_VEC3& mag )
+    {
+        q           = fusion_normalize( initial );
+        integral    = {};
+        field       = fusion_length( mag );
+        reference   = fusion_rotate( q, mag );
+        reference.y = 0.0f;
+        const float horizontal = fusion_length( reference );
+        referenced             = horizontal > 1e-6f;
+        reference              = referenced ? reference * ( 1.0f / horizontal ) : FUSION_VEC3();
+    }
+    //
+    void update( const FUSION_VEC3& gyro, const FUSION_VEC3& acc, const FUSION_VEC3& mag, float dt )
+    {
+        FUSION_VEC3 omega = gyro * fusion_deg_to_rad;
+        FUSION_VEC3 error;
+        const float acc_norm = fusion_length( acc );
+        if ( acc_norm > 0.0f && ( settings.acc_gate <= 0.0f || fabsf( acc_norm - 1.0f ) < settings.acc_gate ) )
+        {
+            error = error + fusion_cross( acc * ( 1.0f / acc_norm ), fusion_rotate_inverse( q, FUSION_VEC3{ 0.0f, 1.0f, 0.0f } ) );
+        }
+        const float mag_norm = fusion_length( mag );
+        if ( settings.mag && referenced && mag_norm > 0.0f && ( settings.mag_gate <= 0.0f || fabsf( mag_norm - field ) < settings.mag_gate * field ) )
+        {
+            FUSION_VEC3 horizontal = fusion_rotate( q, mag );
+            horizontal.y           = 0.0f;
+            const float length     = fusion_length( horizontal );
+            if ( length > 1e-6f )
+            {
+                error = error + fusion_cross( fusion_rotate_inverse( q, horizontal * ( 1.0f / length ) ), fusion_rotate_inverse( q, reference ) );
+            }
+        }
+        if ( settings.ki > 0.0f )
+        {
+            integral = integral + error * ( settings.ki * dt );
+        }
+        omega = omega + error * settings.kp + integral;
+        // 按角速度精确旋转 dt
+        const float angle = fusion_length( omega ) * dt;
+        if ( angle > 0.0f )
+        {
+            const FUSION_VEC3 axis = omega * ( sinf( angle * 0.5f ) / fusion_length( omega ) );
+            q                      = fusion_normalize( q * FUSION_QUAT{ cosf( angle * 0.5f ), axis.x, axis.y, axis.z } );
+        }
+    }
+};
+//
+// 航位推算: 比力转到世界系减去重力, 按梯形两次积分. 静止检测 (加速度模长接近 1g 且角速度小) 持续 still_time 后速度置零
+struct FUSION_DEAD_RECKONING
+{
+    FUSION_VEC3 position, velocity;
+    FUSION_VEC3 last;  // 上一个样本的线加速度
+    bool        primed     = false;
+    bool        zupt       = false;
+    float       still_acc  = 0.02f;  // g
+    float       still_gyro = 2.0f;   // deg/s
+    float       still_time = 0.1f;   // 秒
+    float       still      = 0.0f;
+    //
+    void reset( const FUSION_VEC3& initial_position, const FUSION_VEC3& initial_velocity )
+    {
+        position = initial_position;
+        velocity = initial_velocity;
+        primed   = false;
+        still    = 0.0f;
+    }
+    // 世界系线加速度, m/s^2 (服务端的 eacc_* 也由此积分)
+    void integrate( const FUSION_VEC3& accel, float dt )
+    {
+        const FUSION_VEC3 previous = primed ? last : accel;
+        const FUSION_VEC3 start    = velocity;
+        velocity                   = velocity + ( previous + accel ) * ( 0.5f * dt );
+        position                   = position + ( start + velocity ) * ( 0.5f * dt );
+        last                       = accel;
+        primed                     = true;
+    }
+    //
+    void update( const FUSION_QUAT& q, const FUSION_VEC3& acc, const FUSION_VEC3& gyro, float dt )
+    {
+        integrate( fusion_rotate( q, acc ) * fusion_gravity - FUSION_VEC3{ 0.0f, fusion_gravity, 0.0f }, dt );
+        if ( zupt )
+        {
+            still = fabsf( fusion_length( acc ) - 1.0f ) < still_acc && fusion_length( gyro ) < still_gyro ? still + dt : 0.0f;
+            if ( still >= still_time )
+            {
+                velocity = {};
+            }
+        }
+    }
+};
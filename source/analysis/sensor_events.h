@@ -0,0 +1,450 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+//
+// 事件标注: 冲击, 静止, 磁场干扰与阈值穿越. 检测器在接收线程上逐帧增量运行, 事件写入按区间索引的列表
+// 事件的时间以该传感器数据流的帧序号计: 传感器 0 即历史环的序号 (与图表横轴一致), 其他传感器各自计数
+// 录制的烘焙数据记下首帧的序号, 回放时间 = ( 序号 - 首帧序号 ) / 采样率
+enum SENSOR_EVENT_KIND : uint8_t
+{
+    sensor_event_impact = 0,  // 加速度模长超过阈值
+    sensor_event_still,       // 陀螺仪滑动窗口标准差低于阈值并持续一段时间
+    sensor_event_magnetic,    // 磁场模长偏离长期均值
+    sensor_event_threshold,   // 指定字段超过阈值 (带回差)
+    sensor_event_derivative,  // 指定字段的变化率超过阈值
+    sensor_event_kind_count
+};
+static const char* const sensor_event_names[ sensor_event_kind_count ] = { "Impact", "Still", "Magnetic", "Threshold", "Derivative" };
+static constexpr int     sensor_event_sensors = 16;  // 与 mocap_max_sensors 相同
+//
+struct SENSOR_EVENT
+{
+    double  begin;  // 帧序号, 闭区间; 单帧事件 begin == end
+    double  end;
+    float   peak;  // 区间内检测量的极值
+    uint8_t kind;
+    uint8_t sensor;
+};
+//
+// 隐式区间树 (与 cgranges 相同的做法): 事件按 begin 排序存放, 下标 i 的层数为其二进制末尾 1 的个数,
+// 每个节点记录子树内的最大 end. 查询 O( log n + k ), 建树 O( n ), 不需要额外的指针
+struct SENSOR_EVENT_RUN
+{
+    std::vector< SENSOR_EVENT > events;  // 按 begin 排序
+    std::vector< double >       max_end;
+    int                         root = -1;  // 根节点的层数, -1 表示空树
+    //
+    void build()
+    {
+        const int64_t n = ( int64_t )events.size();
+        max_end.resize( events.size() );
+        root = -1;
+        if ( n == 0 )
+        {
+            return;
+        }
+        int64_t last_i = 0;
+        double  last   = 0.0;
+        for ( int64_t i = 0; i < n; i += 2 )
+        {
+            last_i = i;
+            last = max_end[ i ] = events[ i ].end;
+        }
+        int k = 1;
+        for ( ; ( int64_t )1 << k <= n; k++ )
+        {
+            const int64_t x = ( int64_t )1 << ( k - 1 ), i0 = ( x << 1 ) - 1, step = x << 2;
+            for ( int64_t i = i0; i < n; i += step )
+            {
+                const double left  = max_end[ i - x ];
+                const double right = i + x < n ? max_end[ i + x ] : last;
+                max_end[ i ]       = std::max( events[ i ].end, std::max( left, right ) );
+            }
+            last_i = ( last_i >> k & 1 ) ? last_i - x : last_i + x;
+            if ( last_i < n && max_end[ last_i ] > last )
+            {
+                last = max_end[ last_i ];
+            }
+        }
+        root = k - 1;
+    }
+    // 与 [ begin, end ] 相交的事件按 begin 升序回调 visit, 返回 false 表示停止
+    template < typename VISIT > bool query( double begin, double end, VISIT& visit ) const
+    {
+        struct NODE
+        {
+            int64_t x;
+            int     k;
+            bool    left_done;
+        };
+        const int64_t n = ( int64_t )events.size();
+        NODE          stack[ 64 ];
+        int           t = 0;
+        if ( root >= 0 )
+        {
+            stack[ t++ ] = { ( ( int64_t )1 << root ) - 1, root, false };
+        }
+        while ( t > 0 )
+        {
+            const NODE z = stack[ --t ];
+            if ( z.k <= 3 )
+            {
+                // 小子树直接顺序扫描
+                const int64_t i0 = z.x >> z.k << z.k, i1 = std::min( i0 + ( ( int64_t )1 << ( z.k + 1 ) ) - 1, n );
+                for ( int64_t i = i0; i < i1 && events[ i ].begin <= end; i++ )
+                {
+                    if ( events[ i ].end >= begin && ! visit( events[ i ] ) )
+                    {
+                        return false;
+                    }
+                }
+            }
+            else if ( ! z.left_done )
+            {
+                const int64_t y = z.x - ( ( int64_t )1 << ( z.k - 1 ) );
+                stack[ t++ ]    = { z.x, z.k, true };
+                if ( y >= n || max_end[ y ] >= begin )
+                {
+                    stack[ t++ ] = { y, z.k - 1, false };
+                }
+            }
+            else if ( z.x < n && events[ z.x ].begin <= end )
+            {
+                if ( events[ z.x ].end >= begin && ! visit( events[ z.x ] ) )
+                {
+                    return false;
+                }
+                stack[ t++ ] = { z.x + ( ( int64_t )1 << ( z.k - 1 ) ), z.k - 1, false };
+            }
+        }
+        return true;
+    }
+    // 起点在 from 之后 (forward) 或之前最近的一个满足 accept 的事件
+    template < typename ACCEPT > const SENSOR_EVENT* seek( double from, bool forward, ACCEPT& accept ) const
+    {
+        if ( forward )
+        {
+            auto it = std::upper_bound( events.begin(), events.end(), from, []( double value, const SENSOR_EVENT& event ) { return value < event.begin; } );
+            for ( ; it != events.end(); ++it )
+            {
+                if ( accept( *it ) )
+                {
+                    return &*it;
+                }
+            }
+        }
+        else
+        {
+            auto it = std::lower_bound( events.begin(), events.end(), from, []( const SENSOR_EVENT& event, double value ) { return event.begin < value; } );
+            while ( it != events.begin() )
+            {
+                --it;
+                if ( accept( *it ) )
+                {
+                    return &*it;
+                }
+            }
+        }
+        return nullptr;
+    }
+};
+//
+// 事件索引: 几段大小依次减半的有序区间树, 加上一个未索引的尾部 (不超过 256 个, 线性扫描)
+// 尾部满后排序成新的一段, 与不大于它的末段合并, 每个事件平均只被合并 O( log n ) 次; 查询逐段进行, O( log^2 n + k )
+struct SENSOR_EVENT_INDEX
+{
+    static constexpr size_t pending_limit = 256;
+    //
+    std::vector< SENSOR_EVENT_RUN > runs;
+    std::vector< SENSOR_EVENT >     pending;
+    size_t                          count = 0;
+    //
+    size_t size() const
+    {
+        return count;
+    }
+    void clear()
+    {
+        runs.clear();
+        pending.clear();
+        count = 0;
+    }
+    void add( const SENSOR_EVENT& event )
+    {
+        pending.push_back( event );
+        count++;
+        if ( pending.size() < pending_limit )
+        {
+            return;
+        }
+        auto by_begin = []( const SENSOR_EVENT& a, const SENSOR_EVENT& b ) { return a.begin < b.begin; };
+        std::sort( pending.begin(), pending.end(), by_begin );
+        SENSOR_EVENT_RUN run;
+        run.events.swap( pending );
+        while ( ! runs.empty() && runs.back().events.size() <= run.events.size() )
+        {
+            std::vector< SENSOR_EVENT > merged( runs.back().events.size() + run.events.size() );
+            std::merge( runs.back().events.begin(), runs.back().events.end(), run.events.begin(), run.events.end(), merged.begin(), by_begin );
+            run.events.swap( merged );
+            runs.pop_back();
+        }
+        run.build();
+        runs.push_back( std::move( run ) );
+    }
+    // 与 [ begin, end ] 相交的事件依次回调 visit( const SENSOR_EVENT& ), 段内按 begin 升序; 返回 false 停止
+    template < typename VISIT > void query( double begin, double end, VISIT&& visit ) const
+    {
+        for ( const SENSOR_EVENT_RUN& run : runs )
+        {
+            if ( ! run.query( begin, end, visit ) )
+            {
+                return;
+            }
+        }
+        for ( const SENSOR_EVENT& event : pending )
+        {
+            if ( event.begin <= end && event.end >= begin && ! visit( event ) )
+            {
+                return;
+            }
+        }
+    }
+    // 起点在 from 之后 (forward) 或之前最近的一个满足 accept 的事件, 没有时返回 nullptr
+    template < typename ACCEPT > const SENSOR_EVENT* seek( double from, bool forward, ACCEPT&& accept ) const
+    {
+        const SENSOR_EVENT* best   = nullptr;
+        auto                better = [ & ]( const SENSOR_EVENT* event ) {
+            return event != nullptr && ( best == nullptr || ( forward ? event->begin < best->begin : event->begin > best->begin ) );
+        };
+        for ( const SENSOR_EVENT_RUN& run : runs )
+        {
+            const SENSOR_EVENT* event = run.seek( from, forward, accept );
+            best                      = better( event ) ? event : best;
+        }
+        for ( const SENSOR_EVENT& event : pending )
+        {
+            if ( ( forward ? event.begin > from : event.begin < from ) && accept( event ) && better( &event ) )
+            {
+                best = &event;
+            }
+        }
+        return best;
+    }
+    template < typename VISIT > void for_each( VISIT&& visit ) const
+    {
+        for ( const SENSOR_EVENT_RUN& run : runs )
+        {
+            for ( const SENSOR_EVENT& event : run.events )
+            {
+                visit( event );
+            }
+        }
+        for ( const SENSOR_EVENT& event : pending )
+        {
+            visit( event );
+        }
+    }
+};
+//
+// 检测参数, 所有传感器共用
+struct SENSOR_EVENT_CONFIG
+{
+    float impact_g             = 3.0f;   // 加速度模长阈值, g
+    float still_gyro           = 0.5f;   // 陀螺仪窗口标准差阈值, deg/s
+    float still_window         = 0.5f;   // 秒
+    float still_min            = 1.0f;   // 秒, 更短的静止不记录
+    float magnetic_ratio       = 0.15f;  // 磁场模长偏离长期均值的比例
+    int   threshold_field      = -1;     // 字段号, -1 关闭
+    float threshold_level      = 0.0f;
+    float threshold_hysteresis = 0.0f;
+    int   derivative_field     = -1;     // 字段号, -1 关闭
+    float derivative_rate      = 0.0f;   // 每秒的变化量
+};
+//
+// 单个传感器的增量检测. 区间类事件在结束时写入; 采样间隔由调用方给出 (秒)
+struct SENSOR_EVENT_DETECTOR
+{
+    static constexpr int window_capacity = 1024;
+    // 一个正在进行的区间
+    struct OPEN
+    {
+        bool   active = false;
+        double begin  = 0.0;
+        double last   = 0.0;
+        float  peak   = 0.0f;
+    };
+    OPEN   open[ sensor_event_kind_count ];
+    // 静止: 陀螺仪模长的滑动窗口和与平方和
+    float  gyro[ window_capacity ];
+    int    gyro_count = 0, gyro_next = 0;
+    double gyro_sum = 0.0, gyro_sum2 = 0.0;
+    // 磁场: 模长的长期均值
+    double mag_mean = 0.0;
+    // 变化率: 上一帧的值
+    bool   has_previous = false;
+    float  previous     = 0.0f;
+    //
+    void reset()
+    {
+        *this = SENSOR_EVENT_DETECTOR();
+    }
+    // 区间 kind 在本帧是否成立; 结束时满足最短长度则交给 emit. lead 为检测量本身的滞后 (滑动窗口), 区间起点前移
+    template < typename EMIT > void track( int kind, bool on, float value, double index, double min_length, int sensor, EMIT& emit, double lead = 0.0 )
+    {
+        OPEN& o = open[ kind ];
+        if ( on )
+        {
+            if ( ! o.active )
+            {
+                o = { true, index - lead, index, value };
+            }
+            o.last = index;
+            o.peak = fabsf( value ) > fabsf( o.peak ) ? value : o.peak;
+        }
+        else
+        {
+            close( kind, min_length, sensor, emit );
+        }
+    }
+    template < typename EMIT > void close( int kind, double min_length, int sensor, EMIT& emit )
+    {
+        OPEN& o = open[ kind ];
+        if ( o.active && o.last - o.begin >= min_length )
+        {
+            emit( SENSOR_EVENT{ o.begin, o.last, o.peak, ( uint8_t )kind, ( uint8_t )sensor } );
+        }
+        o.active = false;
+    }
+    // 逐帧调用; mask 为本帧实际包含的字段, 缺少字段的检测器跳过 (正在进行的区间保持)
+    template < typename EMIT > void push( const SENSOR_DB& frame, uint32_t mask, double index, double period, const SENSOR_EVENT_CONFIG& config, int sensor, EMIT&& emit )
+    {
+        period = period > 0.0 ? period : 0.01;
+        if ( sensor_mask_has( mask, 0, 3 ) )
+        {
+            const float acc = sqrtf( frame.acc_x * frame.acc_x + frame.acc_y * frame.acc_y + frame.acc_z * frame.acc_z );
+            track( sensor_event_impact, acc > config.impact_g, acc, index, 0.0, sensor, emit );
+        }
+        if ( sensor_mask_has( mask, 3, 3 ) )
+        {
+            const int   window = std::max( 2, std::min( ( int )( config.still_window / period ), window_capacity ) );
+            const float g      = sqrtf( frame.gyro_x * frame.gyro_x + frame.gyro_y * frame.gyro_y + frame.gyro_z * frame.gyro_z );
+            // 窗口长度随采样率变化时从头累积
+            if ( gyro_count > window )
+            {
+                gyro_count = gyro_next = 0;
+                gyro_sum = gyro_sum2 = 0.0;
+            }
+            if ( gyro_count == window )
+            {
+                const float old = gyro[ ( gyro_next - window + window_capacity ) % window_capacity ];
+                gyro_sum -= old;
+                gyro_sum2 -= ( double )old * old;
+                gyro_count--;
+            }
+            gyro[ gyro_next ] = g;
+            gyro_next         = ( gyro_next + 1 ) % window_capacity;
+            gyro_sum += g;
+            gyro_sum2 += ( double )g * g;
+            gyro_count++;
+            if ( gyro_next == 0 )
+            {
+                // 每绕一圈重新求和, 长时间运行时消除累加误差
+                gyro_sum = gyro_sum2 = 0.0;
+                for ( int i = 1; i <= gyro_count; i++ )
+                {
+                    const float v = gyro[ window_capacity - i ];
+                    gyro_sum += v;
+                    gyro_sum2 += ( double )v * v;
+                }
+            }
+            const double mean      = gyro_sum / gyro_count;
+            const float  deviation = ( float )sqrt( std::max( 0.0, gyro_sum2 / gyro_count - mean * mean ) );
+            track( sensor_event_still, gyro_count == window && deviation < config.still_gyro, deviation, index, config.still_min / period, sensor, emit, window - 1 );
+        }
+        if ( sensor_mask_has( mask, 6, 3 ) )
+        {
+            const double mag = sqrt( frame.mag_x * frame.mag_x + frame.mag_y * frame.mag_y + frame.mag_z * frame.mag_z );
+            // 回差: 进入干扰后偏离降到阈值的 70% 以下才结束
+            const double limit = config.magnetic_ratio * mag_mean * ( open[ sensor_event_magnetic ].active ? 0.7 : 1.0 );
+            const bool   off   = mag_mean > 0.0 && fabs( mag - mag_mean ) > limit;
+            // 长期均值约 10 秒, 干扰期间不更新
+            mag_mean = mag_mean > 0.0 ? ( off ? mag_mean : mag_mean + ( mag - mag_mean ) * std::min( 1.0, period / 10.0 ) ) : mag;
+            track( sensor_event_magnetic, off, ( float )( mag / std::max( mag_mean, 1e-6 ) ), index, 0.0, sensor, emit );
+        }
+        const int tf = config.threshold_field;
+        if ( tf > 0 && tf < sensor_field_count && ( mask >> tf & 1 ) )
+        {
+            const float value = sensor_field( frame, tf );
+            const bool  above = open[ sensor_event_threshold ].active ? value > config.threshold_level - config.threshold_hysteresis : value > config.threshold_level;
+            track( sensor_event_threshold, above, value, index, 0.0, sensor, emit );
+        }
+        const int df = config.derivative_field;
+        if ( df > 0 && df < sensor_field_count && ( mask >> df & 1 ) )
+        {
+            const float value = sensor_field( frame, df );
+            const float rate  = has_previous ? ( float )( ( value - previous ) / period ) : 0.0f;
+            track( sensor_event_derivative, fabsf( rate ) > config.derivative_rate, rate, index, 0.0, sensor, emit );
+            previous     = value;
+            has_previous = true;
+        }
+    }
+};
+//
+// 全部传感器的检测器与事件索引. 接收线程写入, 渲染线程查询, 都在 queue_mutex 内
+struct SENSOR_EVENTS
+{
+    bool                  enabled = true;
+    SENSOR_EVENT_CONFIG   config;
+    SENSOR_EVENT_DETECTOR detectors[ sensor_event_sensors ];
+    int64_t               frames[ sensor_event_sensors ] = {};  // 传感器 0 以外的帧序号
+    SENSOR_EVENT_INDEX    index;
+    //
+    // 新连接: 检测器从头开始, 已有的事件与帧序号保留
+    void restart()
+    {
+        for ( SENSOR_EVENT_DETECTOR& detector : detectors )
+        {
+            detector.reset();
+        }
+    }
+    void reset()
+    {
+        restart();
+        std::fill_n( frames, sensor_event_sensors, 0 );
+        index.clear();
+    }
+    // 新事件加入索引后另外交给 sink( const SENSOR_EVENT& ) (录制时写入录制文件)
+    template < typename SINK > void push( int sensor, const SENSOR_DB& frame, uint32_t mask, double frame_index, double period, SINK&& sink )
+    {
+        if ( enabled )
+        {
+            detectors[ sensor ].push( frame, mask, frame_index, period, config, sensor, [ & ]( const SENSOR_EVENT& event ) {
+                index.add( event );
+                sink( event );
+            } );
+        }
+    }
+    void push( int sensor, const SENSOR_DB& frame, uint32_t mask, double frame_index, double period )
+    {
+        push( sensor, frame, mask, frame_index, period, []( const SENSOR_EVENT& ) {} );
+    }
+    // 每行: kind,sensor,begin,end,peak
+    bool save_csv( const char* path ) const
+    {
+        FILE* file = fopen( path, "w" );
+        if ( file == nullptr )
+        {
+            return false;
+        }
+        fprintf( file, "kind,sensor,begin,end,peak\n" );
+        index.for_each( [ file ]( const SENSOR_EVENT& event ) {
+            fprintf( file, "%s,%d,%.0f,%.0f,%g\n", sensor_event_names[ event.kind ], event.sensor, event.begin, event.end, event.peak );
+        } );
+        fclose( file );
+        return true;
+    }
+};
@@ -0,0 +1,415 @@
+#pragma once
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+//
+// 对称 3x3 矩阵的 Jacobi 特征分解: m = v * diag( w ) * v^T
+static void mag_jacobi_eigen( const double m_in[ 3 ][ 3 ], double w[ 3 ], double v[ 3 ][ 3 ] )
+{
+    double m[ 3 ][ 3 ];
+    memcpy( m, m_in, sizeof( m ) );
+    for ( int i = 0; i < 3; i++ )
+    {
+        for ( int j = 0; j < 3; j++ )
+        {
+            v[ i ][ j ] = ( i == j ) ? 1.0 : 0.0;
+        }
+    }
+    for ( int sweep = 0; sweep < 32; sweep++ )
+    {
+        double off = fabs( m[ 0 ][ 1 ] ) + fabs( m[ 0 ][ 2 ] ) + fabs( m[ 1 ][ 2 ] );
+        if ( off < 1e-30 )
+        {
+            break;
+        }
+        for ( int p = 0; p < 2; p++ )
+        {
+            for ( int q = p + 1; q < 3; q++ )
+            {
+                if ( fabs( m[ p ][ q ] ) < 1e-300 )
+                {
+                    continue;
+                }
+                double theta = ( m[ q ][ q ] - m[ p ][ p ] ) / ( 2.0 * m[ p ][ q ] );
+                double t     = ( theta >= 0 ? 1.0 : -1.0 ) / ( fabs( theta ) + sqrt( theta * theta + 1.0 ) );
+                double c     = 1.0 / sqrt( t * t + 1.0 );
+                double s     = t * c;
+                for ( int k = 0; k < 3; k++ )
+                {
+                    double mkp = m[ k ][ p ];
+                    double mkq = m[ k ][ q ];
+                    m[ k ][ p ] = c * mkp - s * mkq;
+                    m[ k ][ q ] = s * mkp + c * mkq;
+                }
+                for ( int k = 0; k < 3; k++ )
+                {
+                    double mpk = m[ p ][ k ];
+                    double mqk = m[ q ][ k ];
+                    m[ p ][ k ] = c * mpk - s * mqk;
+                    m[ q ][ k ] = s * mpk + c * mqk;
+                }
+                for ( int k = 0; k < 3; k++ )
+                {
+                    double vkp = v[ k ][ p ];
+                    double vkq = v[ k ][ q ];
+                    v[ k ][ p ] = c * vkp - s * vkq;
+                    v[ k ][ q ] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for ( int i = 0; i < 3; i++ )
+    {
+        w[ i ] = m[ i ][ i ];
+    }
+}
+//
+// 磁力计硬铁/软铁校准
+// 样本按空间网格分桶, 每个桶只保留第一个点, 使覆盖均匀且内存有界;
+// 椭球面 a x^2 + b y^2 + c z^2 + 2d xy + 2e xz + 2f yz + 2g x + 2h y + 2i z = 1 的最小二乘法方程随样本累加,
+// 每个新样本 O(1) 更新并重新求解 9x9 方程, 与累计样本数无关. 拟合质量 (方向覆盖与残差) 要遍历保留的点, 由读者调用 evaluate 计算
+struct MAG_CALIBRATION
+{
+    static constexpr int max_points    = 2048;
+    static constexpr int coverage_cols = 12;  // 方向覆盖: 方位角分格, 每格 30 度
+    static constexpr int coverage_rows = 6;   // 方向覆盖: 仰角分格 (按 sin 等分, 每格面积相同)
+    // 拟合可信才用于校正: 方向覆盖超过半个球面, 且校正后模长相对 field_radius 的均方根偏差不超过 5%.
+    // 只覆盖半球时椭球中心沿缺失方向的误差已达磁场模长的数个百分点
+    static constexpr float trusted_coverage = 0.55f;
+    static constexpr float trusted_residual = 0.05f;
+    //
+    float                               cell_size = 1e-3f;  // 分桶边长, 桶数超过 max_points 时加倍并重新分桶
+    std::vector< float >                xs, ys, zs;         // 每个桶的代表点 (原始读数)
+    std::unordered_map< uint64_t, int > cells;
+    double                              ata[ 9 ][ 9 ];  // D^T D
+    double                              atb[ 9 ];       // D^T 1
+    int64_t                             samples  = 0;
+    uint32_t                            revision = 0;  // 保留的点集变化时递增
+    //
+    bool  valid = false;
+    float center[ 3 ];           // 硬铁偏移
+    float soft_iron[ 3 ][ 3 ];   // 校正: corrected = soft_iron * ( raw - center )
+    float ellipsoid[ 3 ][ 3 ];   // 单位球 -> 拟合椭球 (相对 center)
+    float field_radius = 0.0f;   // 校正后的磁场模长
+    // 拟合质量, 由 evaluate 在点集变化后更新, 可能落后于最新的拟合
+    int      covered   = 0;      // 方向覆盖的格数 (见 coverage)
+    float    residual  = 0.0f;   // 保留点校正后模长 / field_radius - 1 的均方根
+    float    grid[ coverage_cols * coverage_rows ];  // 方向覆盖的计数 (见 coverage)
+    uint32_t evaluated = 0;      // 上次 evaluate 时的 revision
+    //
+    MAG_CALIBRATION()
+    {
+        reset();
+    }
+    //
+    void reset()
+    {
+        cell_size = 1e-3f;
+        xs.clear();
+        ys.clear();
+        zs.clear();
+        cells.clear();
+        memset( ata, 0, sizeof( ata ) );
+        memset( atb, 0, sizeof( atb ) );
+        samples      = 0;
+        valid        = false;
+        field_radius = 0.0f;
+        covered      = 0;
+        residual     = 0.0f;
+        revision++;
+        memset( center, 0, sizeof( center ) );
+        memset( soft_iron, 0, sizeof( soft_iron ) );
+        memset( ellipsoid, 0, sizeof( ellipsoid ) );
+        memset( grid, 0, sizeof( grid ) );
+    }
+    //
+    uint64_t cell_key( float x, float y, float z ) const
+    {
+        const uint64_t mask = ( 1u << 21 ) - 1;
+        uint64_t       kx   = ( uint64_t )( ( int64_t )floorf( x / cell_size ) & mask );
+        uint64_t       ky   = ( uint64_t )( ( int64_t )floorf( y / cell_size ) & mask );
+        uint64_t       kz   = ( uint64_t )( ( int64_t )floorf( z / cell_size ) & mask );
+        return ( kx << 42 ) | ( ky << 21 ) | kz;
+    }
+    //
+    void accumulate( float x, float y, float z )
+    {
+        const double d[ 9 ] = { ( double )x * x, ( double )y * y, ( double )z * z, 2.0 * x * y, 2.0 * x * z, 2.0 * y * z, 2.0 * x, 2.0 * y, 2.0 * z };
+        for ( int i = 0; i < 9; i++ )
+        {
+            for ( int j = i; j < 9; j++ )
+            {
+                ata[ i ][ j ] += d[ i ] * d[ j ];
+            }
+            atb[ i ] += d[ i ];
+        }
+    }
+    // 桶数超限: 网格加倍, 每个新桶保留第一个点, 并从保留的点重建法方程 (代价受 max_points 约束)
+    void coarsen()
+    {
+        cell_size *= 2.0f;
+        cells.clear();
+        memset( ata, 0, sizeof( ata ) );
+        memset( atb, 0, sizeof( atb ) );
+        size_t kept = 0;
+        for ( size_t i = 0; i < xs.size(); i++ )
+        {
+            if ( cells.emplace( cell_key( xs[ i ], ys[ i ], zs[ i ] ), ( int )kept ).second )
+            {
+                xs[ kept ] = xs[ i ];
+                ys[ kept ] = ys[ i ];
+                zs[ kept ] = zs[ i ];
+                accumulate( xs[ kept ], ys[ kept ], zs[ kept ] );
+                kept++;
+            }
+        }
+        xs.resize( kept );
+        ys.resize( kept );
+        zs.resize( kept );
+        revision++;
+    }
+    // 加入一个原始读数, 落在新桶时更新拟合. 返回是否被保留
+    bool add_sample( float x, float y, float z )
+    {
+        if ( ! std::isfinite( x ) || ! std::isfinite( y ) || ! std::isfinite( z ) )
+        {
+            return false;
+        }
+        samples++;
+        if ( cells.count( cell_key( x, y, z ) ) )
+        {
+            return false;
+        }
+        while ( ( int )xs.size() >= max_points )
+        {
+            coarsen();
+            if ( cells.count( cell_key( x, y, z ) ) )
+            {
+                return false;
+            }
+        }
+        cells.emplace( cell_key( x, y, z ), ( int )xs.size() );
+        xs.push_back( x );
+        ys.push_back( y );
+        zs.push_back( z );
+        accumulate( x, y, z );
+        revision++;
+        fit();
+        return true;
+    }
+    // 解法方程并分解为中心, 校正矩阵与椭球形状
+    void fit()
+    {
+        valid = false;
+        if ( xs.size() < 32 )
+        {
+            return;
+        }
+        // 高斯消元 (列主元)
+        double a[ 9 ][ 10 ];
+        for ( int i = 0; i < 9; i++ )
+        {
+            for ( int j = 0; j < 9; j++ )
+            {
+                a[ i ][ j ] = ( j >= i ) ? ata[ i ][ j ] : ata[ j ][ i ];
+            }
+            a[ i ][ 9 ] = atb[ i ];
+        }
+        for ( int col = 0; col < 9; col++ )
+        {
+            int pivot = col;
+            for ( int r = col + 1; r < 9; r++ )
+            {
+                if ( fabs( a[ r ][ col ] ) > fabs( a[ pivot ][ col ] ) )
+                {
+                    pivot = r;
+                }
+            }
+            if ( fabs( a[ pivot ][ col ] ) < 1e-300 )
+            {
+                return;
+            }
+            if ( pivot != col )
+            {
+                for ( int j = 0; j < 10; j++ )
+                {
+                    double t      = a[ col ][ j ];
+                    a[ col ][ j ]   = a[ pivot ][ j ];
+                    a[ pivot ][ j ] = t;
+                }
+            }
+            for ( int r = col + 1; r < 9; r++ )
+            {
+                double f = a[ r ][ col ] / a[ col ][ col ];
+                for ( int j = col; j < 10; j++ )
+                {
+                    a[ r ][ j ] -= f * a[ col ][ j ];
+                }
+            }
+        }
+        double p[ 9 ];
+        for ( int i = 8; i >= 0; i-- )
+        {
+            double s = a[ i ][ 9 ];
+            for ( int j = i + 1; j < 9; j++ )
+            {
+                s -= a[ i ][ j ] * p[ j ];
+            }
+            p[ i ] = s / a[ i ][ i ];
+        }
+        // x^T A x + 2 b^T x = 1
+        const double A[ 3 ][ 3 ] = { { p[ 0 ], p[ 3 ], p[ 4 ] }, { p[ 3 ], p[ 1 ], p[ 5 ] }, { p[ 4 ], p[ 5 ], p[ 2 ] } };
+        const double b[ 3 ]      = { p[ 6 ], p[ 7 ], p[ 8 ] };
+        double       det         = A[ 0 ][ 0 ] * ( A[ 1 ][ 1 ] * A[ 2 ][ 2 ] - A[ 1 ][ 2 ] * A[ 2 ][ 1 ] ) - A[ 0 ][ 1 ] * ( A[ 1 ][ 0 ] * A[ 2 ][ 2 ] - A[ 1 ][ 2 ] * A[ 2 ][ 0 ] )
+                   + A[ 0 ][ 2 ] * ( A[ 1 ][ 0 ] * A[ 2 ][ 1 ] - A[ 1 ][ 1 ] * A[ 2 ][ 0 ] );
+        if ( fabs( det ) < 1e-300 )
+        {
+            return;
+        }
+        double inv[ 3 ][ 3 ];
+        inv[ 0 ][ 0 ] = ( A[ 1 ][ 1 ] * A[ 2 ][ 2 ] - A[ 1 ][ 2 ] * A[ 2 ][ 1 ] ) / det;
+        inv[ 0 ][ 1 ] = ( A[ 0 ][ 2 ] * A[ 2 ][ 1 ] - A[ 0 ][ 1 ] * A[ 2 ][ 2 ] ) / det;
+        inv[ 0 ][ 2 ] = ( A[ 0 ][ 1 ] * A[ 1 ][ 2 ] - A[ 0 ][ 2 ] * A[ 1 ][ 1 ] ) / det;
+        inv[ 1 ][ 0 ] = inv[ 0 ][ 1 ];
+        inv[ 1 ][ 1 ] = ( A[ 0 ][ 0 ] * A[ 2 ][ 2 ] - A[ 0 ][ 2 ] * A[ 2 ][ 0 ] ) / det;
+        inv[ 1 ][ 2 ] = ( A[ 0 ][ 2 ] * A[ 1 ][ 0 ] - A[ 0 ][ 0 ] * A[ 1 ][ 2 ] ) / det;
+        inv[ 2 ][ 0 ] = inv[ 0 ][ 2 ];
+        inv[ 2 ][ 1 ] = inv[ 1 ][ 2 ];
+        inv[ 2 ][ 2 ] = ( A[ 0 ][ 0 ] * A[ 1 ][ 1 ] - A[ 0 ][ 1 ] * A[ 1 ][ 0 ] ) / det;
+        double c[ 3 ];
+        for ( int i = 0; i < 3; i++ )
+        {
+            c[ i ] = -( inv[ i ][ 0 ] * b[ 0 ] + inv[ i ][ 1 ] * b[ 1 ] + inv[ i ][ 2 ] * b[ 2 ] );
+        }
+        // ( x - c )^T A ( x - c ) = 1 + c^T A c
+        double k = 1.0;
+        for ( int i = 0; i < 3; i++ )
+        {
+            for ( int j = 0; j < 3; j++ )
+            {
+                k += c[ i ] * A[ i ][ j ] * c[ j ];
+            }
+        }
+        double m[ 3 ][ 3 ];
+        for ( int i = 0; i < 3; i++ )
+        {
+            for ( int j = 0; j < 3; j++ )
+            {
+                m[ i ][ j ] = A[ i ][ j ] / k;
+            }
+        }
+        double w[ 3 ], v[ 3 ][ 3 ];
+        mag_jacobi_eigen( m, w, v );
+        if ( ! ( w[ 0 ] > 0.0 && w[ 1 ] > 0.0 && w[ 2 ] > 0.0 ) )
+        {
+            return;
+        }
+        // 半轴 1/sqrt(w), 校正后模长取半轴的几何平均
+        const double radius = pow( w[ 0 ] * w[ 1 ] * w[ 2 ], -1.0 / 6.0 );
+        for ( int i = 0; i < 3; i++ )
+        {
+            for ( int j = 0; j < 3; j++ )
+            {
+                double si = 0.0;
+                double el = 0.0;
+                for ( int e = 0; e < 3; e++ )
+                {
+                    si += v[ i ][ e ] * sqrt( w[ e ] ) * v[ j ][ e ];
+                    el += v[ i ][ e ] / sqrt( w[ e ] ) * v[ j ][ e ];
+                }
+                soft_iron[ i ][ j ] = ( float )( radius * si );
+                ellipsoid[ i ][ j ] = ( float )el;
+            }
+            center[ i ] = ( float )c[ i ];
+        }
+        field_radius = ( float )radius;
+        valid        = true;
+    }
+    // 按当前拟合重算方向覆盖与残差, 点集未变化时直接返回. 代价 O(max_points), 不放在 add_sample 里,
+    // 由读者 (渲染线程, 每帧至多一次) 在 queue_mutex 内调用, 接收路径保持每个样本 O(1)
+    void evaluate()
+    {
+        if ( evaluated == revision )
+        {
+            return;
+        }
+        evaluated = revision;
+        covered   = coverage( grid );
+        residual  = 0.0f;
+        if ( valid )
+        {
+            double sum = 0.0;
+            for ( size_t i = 0; i < xs.size(); i++ )
+            {
+                float x = xs[ i ], y = ys[ i ], z = zs[ i ];
+                apply( x, y, z );
+                const double e = sqrt( ( double )x * x + ( double )y * y + ( double )z * z ) / field_radius - 1.0;
+                sum += e * e;
+            }
+            residual = ( float )sqrt( sum / xs.size() );
+        }
+    }
+    // 拟合是否足以校正实时数据: 点集只覆盖一小片方向时椭球外推不可靠. 以最近一次 evaluate 的结果为准
+    bool trusted() const
+    {
+        return valid && covered >= trusted_coverage * coverage_cols * coverage_rows && residual <= trusted_residual;
+    }
+    // 对一帧原始读数做硬铁/软铁校正
+    void apply( float& x, float& y, float& z ) const
+    {
+        if ( ! valid )
+        {
+            return;
+        }
+        const float dx = x - center[ 0 ];
+        const float dy = y - center[ 1 ];
+        const float dz = z - center[ 2 ];
+        x              = soft_iron[ 0 ][ 0 ] * dx + soft_iron[ 0 ][ 1 ] * dy + soft_iron[ 0 ][ 2 ] * dz;
+        y              = soft_iron[ 1 ][ 0 ] * dx + soft_iron[ 1 ][ 1 ] * dy + soft_iron[ 1 ][ 2 ] * dz;
+        z              = soft_iron[ 2 ][ 0 ] * dx + soft_iron[ 2 ][ 1 ] * dy + soft_iron[ 2 ][ 2 ] * dz;
+    }
+    // 各点相对拟合中心 (未拟合时取点云均值) 的方向按方位角 x 仰角计数. grid 按列存放 coverage_cols 列, 每列 coverage_rows 个,
+    // 列内第 0 行为仰角最高处. 返回有点落入的格数
+    int coverage( float* grid ) const
+    {
+        memset( grid, 0, sizeof( float ) * coverage_cols * coverage_rows );
+        const size_t count = xs.size();
+        if ( count == 0 )
+        {
+            return 0;
+        }
+        double c[ 3 ] = { center[ 0 ], center[ 1 ], center[ 2 ] };
+        if ( ! valid )
+        {
+            c[ 0 ] = c[ 1 ] = c[ 2 ] = 0.0;
+            for ( size_t i = 0; i < count; i++ )
+            {
+                c[ 0 ] += xs[ i ] / ( double )count;
+                c[ 1 ] += ys[ i ] / ( double )count;
+                c[ 2 ] += zs[ i ] / ( double )count;
+            }
+        }
+        int occupied = 0;
+        for ( size_t i = 0; i < count; i++ )
+        {
+            const double dx = xs[ i ] - c[ 0 ];
+            const double dy = ys[ i ] - c[ 1 ];
+            const double dz = zs[ i ] - c[ 2 ];
+            const double r  = sqrt( dx * dx + dy * dy + dz * dz );
+            if ( ! ( r > 0.0 ) )
+            {
+                continue;
+            }
+            const int col = std::min( coverage_cols - 1, ( int )( ( atan2( dy, dx ) / 6.283185307179586 + 0.5 ) * coverage_cols ) );
+            const int row = std::min( coverage_rows - 1, std::max( 0, ( int )( ( 1.0 - dz / r ) * 0.5 * coverage_rows ) ) );
+            float&    n   = grid[ col * coverage_rows + row ];
+            occupied += n == 0.0f;
+            n += 1.0f;
+        }
+        return occupied;
+    }
+};
@@ -0,0 +1,215 @@
+#include "synthetic/imu_synth.h"  // 先于引擎头文件: 引擎的 MathDefs.h 会 #undef M_PI
+#include "capture/capture_export.h"
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/MountedDirectory.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+//
+// 录制写入的吞吐与恢复测试, 经普通目录挂载点走与浏览器相同的 VirtualFileSystem 路径:
+//   capture --dir /tmp/capture --devices 16 --rate 1000 --duration 60             全速写入 60 秒的数据, 输出吞吐与丢帧
+//   capture --dir /tmp/capture --devices 16 --rate 1000 --duration 10 --realtime  按实时速率写入, 不应丢帧
+//   capture --dir /tmp/capture --duration 3600 --export --threads 8                 另外导出列式与 CSV, 输出耗时, 检查行数与列式文件的回读
+//   capture --dir /tmp/capture --duration 60 --delta                                以差分记录写入 (有损, 见 codec/codec_bench.cxx), 恢复检查相同
+// 每 64 批帧另写一条事件标注 (区间为这一批帧), 恢复与导出时核对事件数.
+// 写完后逐项检查恢复: 完整文件, 截断在块中间 (模拟崩溃), 某个块内的一个字节损坏. 任一项不符时返回 1
+struct CAPTURE_OPTIONS
+{
+    std::string dir      = "/tmp/capture";
+    int         devices  = 16;
+    double      rate     = 1000.0;
+    double      duration = 10.0;
+    bool        realtime = false;
+    bool        exports  = false;
+    bool        delta    = false;
+    int         threads  = 0;  // 导出用的 WorkQueue 线程数, 0 为 CPU 核数
+    uint64_t    seed     = 1;
+};
+//
+static bool capture_parse( int argc, char** argv, CAPTURE_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg = argv[ i ];
+        if ( strcmp( arg, "--realtime" ) == 0 )
+        {
+            options.realtime = true;
+            continue;
+        }
+        if ( strcmp( arg, "--export" ) == 0 )
+        {
+            options.exports = true;
+            continue;
+        }
+        if ( strcmp( arg, "--delta" ) == 0 )
+        {
+            options.delta = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--dir" ) == 0 )
+            options.dir = value;
+        else if ( strcmp( arg, "--devices" ) == 0 )
+            options.devices = std::max( 1, std::min( atoi( value ), synth_max_devices ) );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--duration" ) == 0 )
+            options.duration = atof( value );
+        else if ( strcmp( arg, "--threads" ) == 0 )
+            options.threads = std::max( 0, atoi( value ) );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else
+            return false;
+        i++;
+    }
+    return options.rate > 0.0 && options.duration > 0.0;
+}
+// 恢复并与写入时的统计对照, 只计数不保存帧
+static CAPTURE_RECOVERY capture_check( Urho3D::VirtualFileSystem* vfs, const std::string& name, double& seconds )
+{
+    const auto             begin  = std::chrono::steady_clock::now();
+    const CAPTURE_RECOVERY result = capture_recover( vfs, "capture", name, []( int, const std::vector< SENSOR_DB >&, uint32_t ) {} );
+    seconds                       = std::chrono::duration< double >( std::chrono::steady_clock::now() - begin ).count();
+    return result;
+}
+//
+int main( int argc, char** argv )
+{
+    using namespace Urho3D;
+    using clock = std::chrono::steady_clock;
+    CAPTURE_OPTIONS options;
+    if ( ! capture_parse( argc, argv, options ) )
+    {
+        printf( "usage: capture [--dir path] [--devices n] [--rate hz] [--duration s] [--realtime] [--export] [--delta] [--threads n] [--seed n]\n" );
+        return 1;
+    }
+    SharedPtr< Context > context( new Context() );
+    FileSystem*          file_system = context->RegisterSubsystem< FileSystem >();
+    VirtualFileSystem*   vfs         = context->RegisterSubsystem< VirtualFileSystem >();
+    const ea::string     dir         = AddTrailingSlash( options.dir.c_str() );
+    file_system->CreateDirsRecursive( dir );
+    vfs->Mount( MakeShared< MountedDirectory >( context, dir, "capture" ) );
+    //
+    SYNTH_SOURCE source;
+    source.seed = options.seed;
+    source.reset( options.devices, options.rate );
+    CAPTURE_WRITER writer;
+    writer.delta = options.delta;
+    if ( ! writer.open( vfs, "capture", "bench.fmc" ) )
+    {
+        printf( "Cannot open capture in %s\n", dir.c_str() );
+        return 1;
+    }
+    // 全速模式按 10 ms 的步长产生数据, 实时模式按墙钟
+    const double step    = 0.01;
+    uint64_t     pushed  = 0;
+    uint64_t     batches = 0;
+    const auto   begin   = clock::now();
+    double       elapsed = 0.0;
+    while ( elapsed < options.duration )
+    {
+        if ( options.realtime )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            elapsed = std::min( options.duration, std::chrono::duration< double >( clock::now() - begin ).count() );
+        }
+        else
+        {
+            elapsed = std::min( options.duration, elapsed + step );
+        }
+        source.pump( elapsed, [ & ]( int device, const std::vector< SENSOR_DB >& frames ) {
+            const int64_t ordinal = writer.push( device, frames.data(), ( int )frames.size(), sensor_mask_all );
+            if ( ++batches % 64 == 0 )
+            {
+                writer.push_event( { capture_record_event, ( uint8_t )device, sensor_event_impact, 0, frames.back().acc_x, ( double )ordinal,
+                                     ( double )( ordinal + ( int64_t )frames.size() - 1 ) } );
+            }
+            pushed += frames.size();
+        } );
+        writer.tick();
+    }
+    const double generate = std::chrono::duration< double >( clock::now() - begin ).count();
+    writer.close();
+    const double   seconds = std::chrono::duration< double >( clock::now() - begin ).count();
+    const uint64_t blocks = writer.blocks, frames = writer.frames, dropped = writer.dropped, events = writer.events;
+    printf( "write: %llu frames pushed in %.2f s | %llu written, %llu dropped | %llu blocks, %.1f MB, %.1f MB/s | pool %.0f KiB\n", ( unsigned long long )pushed,
+            generate, ( unsigned long long )frames, ( unsigned long long )dropped, ( unsigned long long )blocks, blocks * capture_block_size / 1e6,
+            blocks * capture_block_size / seconds / 1e6, capture_pool_blocks * sizeof( CAPTURE_BLOCK ) / 1024.0 );
+    bool ok = frames + dropped == pushed && writer.failed == 0 && ( ! options.realtime || dropped == 0 );
+    // 完整文件
+    double           recover_seconds = 0.0;
+    CAPTURE_RECOVERY recovery        = capture_check( vfs, writer.name, recover_seconds );
+    printf( "recover: %u parts, %llu blocks, %llu frames, %llu of %llu events, %.1f MB/s\n", recovery.parts, ( unsigned long long )recovery.blocks,
+            ( unsigned long long )recovery.frames, ( unsigned long long )recovery.events, ( unsigned long long )events,
+            recovery.blocks * capture_block_size / std::max( recover_seconds, 1e-9 ) / 1e6 );
+    ok = ok && recovery.blocks == blocks && recovery.frames == frames && recovery.events == events && ! recovery.truncated;
+    // 导出: 行数与录制一致, 列式文件能完整读回
+    if ( options.exports )
+    {
+        WorkQueue* queue = context->RegisterSubsystem< WorkQueue >();
+        queue->Initialize( options.threads > 0 ? options.threads : std::max( 1u, std::thread::hardware_concurrency() ) );
+        for ( int format = 0; format < 2; format++ )
+        {
+            EXPORT_OPTIONS export_options;
+            export_options.format    = ( EXPORT_FORMAT )format;
+            const std::string output = writer.name + export_format_extensions[ format ];
+            auto              job    = export_start( queue, vfs, "capture", writer.name, output, export_options );
+            while ( ! export_pump( job, 0.01 ) )
+            {
+            }
+            uint64_t read_rows = job->rows;
+            if ( format == export_format_columnar )
+            {
+                read_rows               = 0;
+                AbstractFilePtr file    = vfs->OpenFile( FileIdentifier( "capture", output.c_str() ), FILE_READ );
+                const bool      read_ok = file && export_columnar_read( *file, [ & ]( const EXPORT_GROUP_HEADER& header, const std::vector< uint8_t >&,
+                                                                                 const std::vector< float >* ) { read_rows += header.rows; } );
+                ok                      = ok && read_ok;
+            }
+            printf( "export %s: %llu rows, %zu events, %.1f MB in %.2f s, %.0f rows/s, %.1f MB/s\n", export_format_names[ format ], ( unsigned long long )job->rows,
+                    job->events.size(), job->bytes / 1e6, job->seconds, job->rows / std::max( job->seconds, 1e-9 ), job->bytes / std::max( job->seconds, 1e-9 ) / 1e6 );
+            ok = ok && ! job->failed && job->rows == frames && read_rows == frames && job->events.size() == events;
+        }
+    }
+    // 以下只改动第一个分段
+    const std::string path  = ( dir + writer.name.c_str() ).c_str();
+    const uint64_t    first = std::min< uint64_t >( blocks, capture_part_blocks );
+    if ( first >= 2 )
+    {
+        std::mt19937_64 random( options.seed );
+        // 截断在某个块的中间: 恢复到它之前的块
+        const uint64_t keep  = random() % ( first - 1 ) + 1;
+        const uint64_t extra = random() % ( capture_block_size - 1 ) + 1;
+        ok                   = ok && truncate( path.c_str(), ( off_t )( keep * capture_block_size + extra ) ) == 0;
+        recovery             = capture_check( vfs, writer.name, recover_seconds );
+        printf( "truncate at block %llu + %llu bytes: %llu blocks recovered, %llu bytes discarded\n", ( unsigned long long )keep, ( unsigned long long )extra,
+                ( unsigned long long )recovery.blocks, ( unsigned long long )recovery.discarded );
+        ok = ok && recovery.blocks == keep && recovery.truncated && recovery.discarded == extra;
+        // 翻转一个字节: 恢复到损坏块之前
+        const uint64_t bad    = random() % keep;
+        const uint64_t offset = bad * capture_block_size + random() % capture_block_size;
+        FILE*          file   = fopen( path.c_str(), "r+b" );
+        if ( file != nullptr )
+        {
+            fseek( file, ( long )offset, SEEK_SET );
+            const int byte = fgetc( file );
+            fseek( file, ( long )offset, SEEK_SET );
+            fputc( byte ^ 0xff, file );
+            fclose( file );
+        }
+        recovery = capture_check( vfs, writer.name, recover_seconds );
+        printf( "corrupt byte %llu (block %llu): %llu blocks recovered\n", ( unsigned long long )offset, ( unsigned long long )bad, ( unsigned long long )recovery.blocks );
+        ok = ok && file != nullptr && recovery.blocks == bad && recovery.truncated;
+    }
+    printf( "%s\n", ok ? "PASS" : "FAIL" );
+    return ok ? 0 : 1;
+}
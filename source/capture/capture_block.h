@@ -0,0 +1,267 @@
+#pragma once
+//
+#include "codec/sensor_binary.h"
+#include "codec/sensor_delta.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+//
+// 录制文件: 由定长的块顺序组成, 只追加. 块 = 头 + 记录 + 补零, 每块独立校验
+//   uint32 magic      'FMCB'
+//   uint16 version
+//   uint16 header     头的字节数
+//   uint32 sequence   块序号, 从 0 开始连续
+//   uint32 payload    记录的总字节数
+//   uint32 frames     块内的帧数
+//   uint32 crc        CRC-32 (IEEE), 计算时本字段为 0, 覆盖整个块 (含补零)
+// 记录即二进制数据帧 (codec/sensor_binary.h 的 sensor_binary_raw 消息) 或差分帧 (codec/sensor_delta.h 的 sensor_binary_delta 消息,
+// 版本 2 起), 或事件标注 (CAPTURE_EVENT_RECORD, 版本 3 起), 一条记录不跨块. 差分记录的编码状态在每块开始时重置,
+// 块内每个传感器的第一条差分记录为关键帧, 因此每块仍可单独解码. 事件在检测到时追加, 位于它引用的帧之后
+// 崩溃或断电后文件可能截断在块的中间, 或最后一块只写了一部分: 从头逐块校验, 停在第一个损坏的块
+static constexpr uint32_t capture_magic      = 0x42434d46;  // "FMCB"
+static constexpr uint16_t capture_version    = 3;  // 1 只有原始记录, 2 加入差分记录; 读取时都接受
+static constexpr size_t   capture_block_size = 16384;
+static constexpr uint32_t capture_part_blocks = 65536;  // 1 GiB, 单个文件的块数上限 (见 capture/capture_writer.h)
+//
+static std::string capture_part_name( const std::string& name, uint32_t part )
+{
+    return part == 0 ? name : name + "." + std::to_string( part );
+}
+//
+struct CAPTURE_BLOCK_HEADER
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header;
+    uint32_t sequence;
+    uint32_t payload;
+    uint32_t frames;
+    uint32_t crc;
+};
+static_assert( sizeof( CAPTURE_BLOCK_HEADER ) == 24, "capture block header must be packed" );
+static constexpr size_t capture_payload_size = capture_block_size - sizeof( CAPTURE_BLOCK_HEADER );
+//
+// 事件标注 (analysis/sensor_events.h 的 SENSOR_EVENT). 帧序号为该传感器在本录制内的帧序号, 从 0 起, 与数据流的序号无关
+static constexpr uint8_t capture_record_event = 0x10;
+struct CAPTURE_EVENT_RECORD
+{
+    uint8_t type;  // capture_record_event
+    uint8_t sensor;
+    uint8_t kind;
+    uint8_t reserved;
+    float   peak;
+    double  begin;  // 闭区间
+    double  end;
+};
+static_assert( sizeof( CAPTURE_EVENT_RECORD ) == 24, "capture event record must be packed" );
+//
+static uint32_t capture_crc32( const uint8_t* data, size_t size, uint32_t crc = 0 )
+{
+    static uint32_t table[ 256 ];
+    static bool     ready = [] {
+        for ( uint32_t i = 0; i < 256; i++ )
+        {
+            uint32_t c = i;
+            for ( int k = 0; k < 8; k++ )
+            {
+                c = c & 1 ? 0xedb88320u ^ ( c >> 1 ) : c >> 1;
+            }
+            table[ i ] = c;
+        }
+        return true;
+    }();
+    ( void )ready;
+    crc = ~crc;
+    for ( size_t i = 0; i < size; i++ )
+    {
+        crc = table[ ( crc ^ data[ i ] ) & 0xff ] ^ ( crc >> 8 );
+    }
+    return ~crc;
+}
+//
+// 写入差分记录的编码状态, 按传感器编号. 每开始一个新块调用 restart
+struct CAPTURE_DELTA_STATE
+{
+    std::vector< SENSOR_DELTA_ENCODER > encoders;
+    std::vector< uint8_t >              scratch;
+    //
+    void restart()
+    {
+        for ( SENSOR_DELTA_ENCODER& encoder : encoders )
+        {
+            encoder.restart();
+        }
+    }
+    SENSOR_DELTA_ENCODER& encoder( uint8_t sensor, uint32_t mask )
+    {
+        while ( encoders.size() <= sensor )
+        {
+            encoders.emplace_back();
+            encoders.back().sensor            = ( uint8_t )( encoders.size() - 1 );
+            encoders.back().keyframe_interval = 0x7fffffff;  // 关键帧只在块首
+        }
+        SENSOR_DELTA_ENCODER& result = encoders[ sensor ];
+        if ( result.mask != mask )
+        {
+            result.mask = mask;
+            result.restart();
+        }
+        return result;
+    }
+};
+//
+struct CAPTURE_BLOCK
+{
+    uint8_t  data[ capture_block_size ];
+    size_t   used   = 0;  // 记录的字节数
+    uint32_t frames = 0;
+    double   opened = 0.0;  // 写入第一条记录的时刻, 用于定时刷新未写满的块
+    //
+    void clear()
+    {
+        used   = 0;
+        frames = 0;
+    }
+    // 追加一条记录, 返回实际写入的帧数 (块内剩余空间不足时只写一部分, 0 表示需要换块). delta 非空时写入差分记录
+    int append( const SENSOR_DB* source, int count, uint32_t mask, uint8_t sensor, CAPTURE_DELTA_STATE* delta = nullptr )
+    {
+        if ( delta != nullptr )
+        {
+            return append_delta( source, count, mask, sensor, *delta );
+        }
+        size_t       offsets[ sensor_field_count ];
+        const int    fields = sensor_mask_offsets( mask, offsets );
+        const size_t stride = ( size_t )fields * sizeof( float );
+        const size_t space  = capture_payload_size - used;
+        if ( space < sizeof( SENSOR_BINARY_HEADER ) + stride )
+        {
+            return 0;
+        }
+        const int fit = ( int )std::min< size_t >( { ( size_t )count, stride > 0 ? ( space - sizeof( SENSOR_BINARY_HEADER ) ) / stride : ( size_t )count, 65535 } );
+        SENSOR_BINARY_HEADER header = { sensor_binary_raw, sensor, ( uint16_t )fit, mask & sensor_mask_all };
+        uint8_t*             p      = data + sizeof( CAPTURE_BLOCK_HEADER ) + used;
+        memcpy( p, &header, sizeof( header ) );
+        sensor_binary_pack( source, fit, offsets, fields, p + sizeof( header ) );
+        used += sizeof( header ) + fit * stride;
+        frames += fit;
+        return fit;
+    }
+    // 差分记录的长度要编码后才知道, 按最坏情况 (每个差分 32 位) 决定本块放得下的帧数, 编码后的实际长度不会超过它
+    int append_delta( const SENSOR_DB* source, int count, uint32_t mask, uint8_t sensor, CAPTURE_DELTA_STATE& delta )
+    {
+        mask &= sensor_mask_all;
+        const size_t fields = ( size_t )__builtin_popcount( mask );
+        const size_t fixed  = sizeof( SENSOR_DELTA_HEADER ) + fields * ( sizeof( float ) + sizeof( int32_t ) + 1 ) + sensor_delta_padding;
+        const size_t space  = capture_payload_size - used;
+        if ( space < fixed + fields * sizeof( uint32_t ) )
+        {
+            return 0;
+        }
+        const int fit = ( int )std::min< size_t >( { ( size_t )count, fields > 0 ? ( space - fixed ) / ( fields * sizeof( uint32_t ) ) : ( size_t )count, 65535 } );
+        delta.scratch.clear();
+        delta.encoder( sensor, mask ).encode( source, fit, delta.scratch );
+        memcpy( data + sizeof( CAPTURE_BLOCK_HEADER ) + used, delta.scratch.data(), delta.scratch.size() );
+        used += delta.scratch.size();
+        frames += fit;
+        return fit;
+    }
+    // 追加一条事件记录, 块内放不下时返回 false
+    bool append_event( const CAPTURE_EVENT_RECORD& event )
+    {
+        if ( capture_payload_size - used < sizeof( event ) )
+        {
+            return false;
+        }
+        memcpy( data + sizeof( CAPTURE_BLOCK_HEADER ) + used, &event, sizeof( event ) );
+        used += sizeof( event );
+        return true;
+    }
+    // 写入块头与校验, 之后 data 即可原样写入文件
+    void seal( uint32_t sequence )
+    {
+        memset( data + sizeof( CAPTURE_BLOCK_HEADER ) + used, 0, capture_payload_size - used );
+        CAPTURE_BLOCK_HEADER header = { capture_magic, capture_version, ( uint16_t )sizeof( CAPTURE_BLOCK_HEADER ), sequence, ( uint32_t )used, frames, 0 };
+        memcpy( data, &header, sizeof( header ) );
+        header.crc = capture_crc32( data, capture_block_size );
+        memcpy( data, &header, sizeof( header ) );
+    }
+};
+// 校验一个块并逐条回调 record( sensor, frames, mask ) 与 event( const CAPTURE_EVENT_RECORD& ), frames 为复用的缓冲,
+// decoders 为差分记录的解码状态 (按传感器编号, 每块重置). 块损坏或序号不符时返回 false
+template < typename RECORD, typename EVENT >
+static bool capture_block_read( const uint8_t* data, uint32_t sequence, std::vector< SENSOR_DB >& frames, std::vector< SENSOR_DELTA_DECODER >& decoders, RECORD&& record,
+                                EVENT&& event )
+{
+    CAPTURE_BLOCK_HEADER header;
+    memcpy( &header, data, sizeof( header ) );
+    if ( header.magic != capture_magic || header.version < 1 || header.version > capture_version || header.header != sizeof( header ) || header.sequence != sequence ||
+         header.payload > capture_payload_size )
+    {
+        return false;
+    }
+    const uint32_t crc = header.crc;
+    header.crc         = 0;
+    uint32_t check     = capture_crc32( ( const uint8_t* )&header, sizeof( header ) );
+    check              = capture_crc32( data + sizeof( header ), capture_block_size - sizeof( header ), check );
+    if ( check != crc )
+    {
+        return false;
+    }
+    for ( SENSOR_DELTA_DECODER& decoder : decoders )
+    {
+        decoder.reset();
+    }
+    const uint8_t* p   = data + sizeof( header );
+    const uint8_t* end = p + header.payload;
+    while ( p < end )
+    {
+        uint32_t mask = 0;
+        frames.clear();
+        if ( *p == capture_record_event && header.version >= 3 )
+        {
+            CAPTURE_EVENT_RECORD event_record;
+            if ( ( size_t )( end - p ) < sizeof( event_record ) )
+            {
+                return false;
+            }
+            memcpy( &event_record, p, sizeof( event_record ) );
+            p += sizeof( event_record );
+            event( event_record );
+            continue;
+        }
+        if ( *p == sensor_binary_delta && header.version >= 2 )
+        {
+            const int sensor = end - p >= 2 ? sensor_delta_sensor( p ) : 0;
+            if ( decoders.size() <= ( size_t )sensor )
+            {
+                decoders.resize( sensor + 1 );
+            }
+            size_t consumed = 0;
+            if ( ! decoders[ sensor ].decode( p, end - p, frames, mask, &consumed ) )
+            {
+                return false;
+            }
+            p += consumed;
+            record( sensor, frames, mask );
+            continue;
+        }
+        SENSOR_BINARY_HEADER record_header;
+        if ( ! sensor_binary_decode( p, end - p, frames, mask ) )
+        {
+            return false;
+        }
+        memcpy( &record_header, p, sizeof( record_header ) );
+        size_t offsets[ sensor_field_count ];
+        p += sizeof( record_header ) + ( size_t )record_header.count * sensor_mask_offsets( mask, offsets ) * sizeof( float );
+        record( ( int )record_header.sensor, frames, mask );
+    }
+    return true;
+}
+// 不关心事件标注的读取
+template < typename RECORD >
+static bool capture_block_read( const uint8_t* data, uint32_t sequence, std::vector< SENSOR_DB >& frames, std::vector< SENSOR_DELTA_DECODER >& decoders, RECORD&& record )
+{
+    return capture_block_read( data, sequence, frames, decoders, record, []( const CAPTURE_EVENT_RECORD& ) {} );
+}
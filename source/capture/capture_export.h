@@ -0,0 +1,515 @@
+#pragma once
+//
+#include "analysis/sensor_events.h"
+#include "capture/capture_writer.h"
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/Compression.h>
+#include <fmt/compile.h>
+#include <limits>
+//
+// 导出: 录制文件 (或其中一段时间与部分传感器) -> 列式二进制或 CSV
+// 调用方线程分步读取 (export_pump), 每 export_group_rows 行组成一个行组; 行组的编码拆成多个任务在 WorkQueue 上并行
+// (列式每列一个任务, CSV 每段行一个任务), 完成后按顺序写出. 在途的行组最多 export_groups_in_flight 个, 写出跟不上时暂停读取,
+// 内存只有这些行组的缓冲 (约 20 MB), 与录制时长无关. 输出只顺序写入, 偏移自行按 64 位计数
+//
+// 列式文件 (小端), 结构类似 Parquet:
+//   uint32 magic "FMCC", uint32 version
+//   行组 * N:  EXPORT_GROUP_HEADER, 之后 columns 个列块, 每块为 EXPORT_CHUNK_HEADER + stored 字节
+//   结束标记:  rows 为 0 的 EXPORT_GROUP_HEADER (顺序读取时无需定位到尾部)
+//   尾部:      EXPORT_FOOTER_ENTRY * N, uint32 N, uint64 尾部的偏移, uint32 magic
+// 列: 第一列为传感器编号 (uint8), 之后为字段掩码内的各字段 (float32), 顺序同 SENSOR_DB
+// 列块编码: export_split 先写所有值的第 0 字节, 再第 1 字节 ... (相邻的浮点数高位字节相近, 便于压缩);
+//           export_lz4 为引擎的 LZ4 (CompressData), 只在变小时使用
+// 录制中保存的事件标注另写到同名的 .events.csv (两种格式相同, 没有事件时不写): kind,sensor,begin,end,peak,
+// begin 与 end 为该传感器在录制内的帧序号 (从 0 起, 含未导出的帧). 只保留所选传感器上与导出的帧相交的事件
+enum EXPORT_FORMAT
+{
+    export_format_columnar,
+    export_format_csv,
+};
+static constexpr const char* export_format_names[]      = { "Columnar", "CSV" };
+static constexpr const char* export_format_extensions[] = { ".fmcc", ".csv" };
+//
+static constexpr uint32_t export_magic            = 0x43434d46;  // "FMCC"
+static constexpr uint32_t export_version          = 1;
+static constexpr int      export_group_rows       = 16384;
+static constexpr int      export_group_capacity   = export_group_rows + ( int )( capture_payload_size / sizeof( float ) );  // 一个块的帧不拆到两个行组
+static constexpr int      export_groups_in_flight = 4;
+static constexpr int      export_csv_slices       = 8;
+static constexpr int      export_max_tasks        = 1 + sensor_field_count;
+static constexpr uint8_t  export_sensor_column    = 0xff;
+//
+enum EXPORT_ENCODING : uint8_t
+{
+    export_split = 1,
+    export_lz4   = 2,
+};
+//
+struct EXPORT_GROUP_HEADER
+{
+    uint32_t rows;
+    uint32_t columns;
+    uint32_t mask;
+    uint32_t sensors;  // 行组内出现的传感器, 按位
+};
+struct EXPORT_CHUNK_HEADER
+{
+    uint8_t  field;  // 字段序号, export_sensor_column 为传感器编号列
+    uint8_t  width;  // 每个值的字节数
+    uint8_t  encoding;
+    uint8_t  reserved;
+    uint32_t raw;     // 解码后的字节数
+    uint32_t stored;  // 文件中的字节数
+    float    min;     // 不含 NaN
+    float    max;
+};
+struct EXPORT_FOOTER_ENTRY
+{
+    uint64_t offset;
+    uint32_t rows;
+    uint32_t sensors;
+    float    time_min;
+    float    time_max;
+};
+static_assert( sizeof( EXPORT_GROUP_HEADER ) == 16 && sizeof( EXPORT_CHUNK_HEADER ) == 20 && sizeof( EXPORT_FOOTER_ENTRY ) == 24, "export headers must be packed" );
+//
+struct EXPORT_OPTIONS
+{
+    EXPORT_FORMAT format     = export_format_columnar;
+    uint32_t      mask       = sensor_mask_all;  // 导出的字段
+    uint32_t      sensors    = 0xffff;           // 导出的传感器, 按位
+    float         time_begin = -std::numeric_limits< float >::infinity();  // 按帧的 time 字段选取 [ time_begin, time_end )
+    float         time_end   = std::numeric_limits< float >::infinity();
+    bool          compress   = true;
+};
+//
+struct EXPORT_GROUP
+{
+    int                    rows    = 0;
+    uint32_t               sensors = 0;
+    std::vector< uint8_t > sensor;
+    std::vector< float >   columns[ sensor_field_count ];
+    fmt::memory_buffer     chunks[ export_max_tasks ];  // 各任务的输出, 按任务顺序写出
+    std::vector< uint8_t > scratch[ export_max_tasks ];
+    float                  min[ export_max_tasks ];
+    float                  max[ export_max_tasks ];
+    std::atomic< int >     remaining{ 0 };
+};
+//
+struct EXPORT_JOB
+{
+    EXPORT_OPTIONS                        options;
+    CAPTURE_READER                        reader;
+    Urho3D::AbstractFilePtr               out;
+    Urho3D::WorkQueue*                    queue = nullptr;
+    int                                   fields[ sensor_field_count ];
+    int                                   field_count = 0;
+    EXPORT_GROUP                          groups[ export_groups_in_flight ];
+    uint32_t                              submitted = 0;  // 已提交编码的行组数, 正在填充的是 groups[ submitted % n ]
+    uint32_t                              written   = 0;  // 已写出的行组数
+    uint64_t                              rows      = 0;
+    uint64_t                              bytes     = 0;
+    std::vector< EXPORT_FOOTER_ENTRY >    footer;  // 每个行组 24 字节, 一小时 16 x 1000 Hz 约 80 KB
+    std::string                           events_name;
+    std::vector< CAPTURE_EVENT_RECORD >   events;
+    int64_t                               ordinals[ 256 ] = {};  // 各传感器已读的帧数
+    int64_t                               selected[ 256 ][ 2 ];  // 各传感器导出的帧序号范围, 没有时为 -1
+    std::atomic< bool >                   cancelled{ false };
+    bool                                  finished = false;
+    bool                                  failed   = false;
+    std::chrono::steady_clock::time_point begin;
+    double                                seconds = 0.0;
+    //
+    int task_count() const
+    {
+        return options.format == export_format_csv ? export_csv_slices : 1 + field_count;
+    }
+    //
+    void write( const void* data, size_t size )
+    {
+        failed = failed || out->Write( data, ( unsigned )size ) != ( unsigned )size;
+        bytes += size;
+    }
+};
+//
+static void export_minmax( const float* values, int count, float& min, float& max )
+{
+    min = std::numeric_limits< float >::infinity();
+    max = -std::numeric_limits< float >::infinity();
+    for ( int i = 0; i < count; i++ )
+    {
+        min = values[ i ] < min ? values[ i ] : min;
+        max = values[ i ] > max ? values[ i ] : max;
+    }
+}
+// 列块: 统计, 字节拆分与压缩, 结果为 EXPORT_CHUNK_HEADER + 数据
+static void export_column_task( EXPORT_JOB& job, EXPORT_GROUP& group, int task )
+{
+    const int      rows   = group.rows;
+    const int      field  = task == 0 ? -1 : job.fields[ task - 1 ];
+    const uint8_t* raw    = field < 0 ? group.sensor.data() : ( const uint8_t* )group.columns[ field ].data();
+    const uint8_t  width  = field < 0 ? 1 : ( uint8_t )sizeof( float );
+    const uint32_t size   = ( uint32_t )rows * width;
+    EXPORT_CHUNK_HEADER header = { field < 0 ? export_sensor_column : ( uint8_t )field, width, 0, 0, size, size, 0.0f, 0.0f };
+    if ( field < 0 )
+    {
+        header.min = 255.0f;
+        header.max = 0.0f;
+        for ( int s = 0; s < 32; s++ )
+        {
+            header.min = ( group.sensors >> s ) & 1 ? std::min( header.min, ( float )s ) : header.min;
+            header.max = ( group.sensors >> s ) & 1 ? std::max( header.max, ( float )s ) : header.max;
+        }
+    }
+    else
+    {
+        export_minmax( group.columns[ field ].data(), rows, header.min, header.max );
+    }
+    group.min[ task ] = header.min;
+    group.max[ task ] = header.max;
+    //
+    const uint8_t*          data    = raw;
+    std::vector< uint8_t >& scratch = group.scratch[ task ];
+    if ( job.options.compress && size > 0 )
+    {
+        const unsigned bound = Urho3D::EstimateCompressBound( size );
+        scratch.resize( size + bound );
+        uint8_t* split = scratch.data();
+        for ( int b = 0; b < width; b++ )
+        {
+            for ( int i = 0; i < rows; i++ )
+            {
+                split[ b * rows + i ] = raw[ i * width + b ];
+            }
+        }
+        const unsigned compressed = Urho3D::CompressData( split + size, split, size );
+        if ( compressed > 0 && compressed < size )
+        {
+            header.encoding = ( width > 1 ? export_split : 0 ) | export_lz4;
+            header.stored   = compressed;
+            data            = split + size;
+        }
+    }
+    fmt::memory_buffer& chunk = group.chunks[ task ];
+    chunk.clear();
+    chunk.append( ( const char* )&header, ( const char* )&header + sizeof( header ) );
+    chunk.append( ( const char* )data, ( const char* )data + header.stored );
+}
+// CSV 的一段行. 浮点数为最短的可往返表示, NaN 写为 0 (同 transaction_to_value)
+static void export_csv_task( EXPORT_JOB& job, EXPORT_GROUP& group, int task )
+{
+    const int           begin = ( int )( ( int64_t )group.rows * task / export_csv_slices );
+    const int           end   = ( int )( ( int64_t )group.rows * ( task + 1 ) / export_csv_slices );
+    fmt::memory_buffer& out   = group.chunks[ task ];
+    auto                it    = std::back_inserter( out );
+    out.clear();
+    for ( int i = begin; i < end; i++ )
+    {
+        fmt::format_to( it, FMT_COMPILE( "{}" ), group.sensor[ i ] );
+        for ( int k = 0; k < job.field_count; k++ )
+        {
+            out.push_back( ',' );
+            fmt::format_to( it, FMT_COMPILE( "{}" ), transaction_to_value( group.columns[ job.fields[ k ] ][ i ] ) );
+        }
+        out.push_back( '\n' );
+    }
+}
+//
+static void export_task( const std::shared_ptr< EXPORT_JOB >& job, int slot, int task )
+{
+    EXPORT_GROUP& group = job->groups[ slot ];
+    if ( ! job->cancelled.load( std::memory_order_relaxed ) )
+    {
+        if ( job->options.format == export_format_csv )
+        {
+            export_csv_task( *job, group, task );
+        }
+        else
+        {
+            export_column_task( *job, group, task );
+        }
+    }
+    group.remaining.fetch_sub( 1, std::memory_order_acq_rel );
+}
+// 当前行组交给 WorkQueue 编码
+static void export_submit( const std::shared_ptr< EXPORT_JOB >& job )
+{
+    const int     slot  = ( int )( job->submitted % export_groups_in_flight );
+    EXPORT_GROUP& group = job->groups[ slot ];
+    const int     tasks = job->task_count();
+    job->submitted++;
+    group.remaining.store( tasks, std::memory_order_release );
+    for ( int t = 0; t < tasks; t++ )
+    {
+        job->queue->PostTask( [ job, slot, t ]( unsigned, Urho3D::WorkQueue* ) { export_task( job, slot, t ); }, Urho3D::TaskPriority::Low );
+    }
+}
+// 在调用方线程: 按顺序写出已编码的行组
+static void export_write( EXPORT_JOB& job, EXPORT_GROUP& group )
+{
+    const int tasks = job.task_count();
+    if ( job.options.format == export_format_columnar )
+    {
+        const int time_task = ( job.options.mask & 1 ) != 0 ? 1 : -1;  // 字段 0 (time) 在掩码内时总是第一个字段列
+        job.footer.push_back( { job.bytes, ( uint32_t )group.rows, group.sensors, time_task > 0 ? group.min[ time_task ] : 0.0f,
+                                time_task > 0 ? group.max[ time_task ] : 0.0f } );
+        const EXPORT_GROUP_HEADER header = { ( uint32_t )group.rows, ( uint32_t )tasks, job.options.mask, group.sensors };
+        job.write( &header, sizeof( header ) );
+    }
+    for ( int t = 0; t < tasks; t++ )
+    {
+        job.write( group.chunks[ t ].data(), group.chunks[ t ].size() );
+    }
+    job.rows += group.rows;
+    group.rows    = 0;
+    group.sensors = 0;
+}
+//
+static void export_finish( EXPORT_JOB& job )
+{
+    if ( job.options.format == export_format_columnar )
+    {
+        const EXPORT_GROUP_HEADER end = { 0, 0, job.options.mask, 0 };
+        job.write( &end, sizeof( end ) );
+        const uint64_t offset = job.bytes;
+        const uint32_t count  = ( uint32_t )job.footer.size();
+        job.write( job.footer.data(), job.footer.size() * sizeof( EXPORT_FOOTER_ENTRY ) );
+        job.write( &count, sizeof( count ) );
+        job.write( &offset, sizeof( offset ) );
+        job.write( &export_magic, sizeof( export_magic ) );
+    }
+    job.out->Close();
+    job.out = nullptr;
+    if ( ! job.events.empty() )
+    {
+        fmt::memory_buffer text;
+        auto               it = std::back_inserter( text );
+        fmt::format_to( it, "kind,sensor,begin,end,peak\n" );
+        for ( const CAPTURE_EVENT_RECORD& event : job.events )
+        {
+            fmt::format_to( it, "{},{},{:.0f},{:.0f},{}\n", sensor_event_names[ event.kind ], event.sensor, event.begin, event.end, event.peak );
+        }
+        Urho3D::AbstractFilePtr file = job.reader.vfs->OpenFile( Urho3D::FileIdentifier( job.reader.scheme.c_str(), job.events_name.c_str() ), Urho3D::FILE_WRITE );
+        job.failed                   = job.failed || ! file || file->Write( text.data(), ( unsigned )text.size() ) != ( unsigned )text.size();
+        if ( file )
+        {
+            file->Close();
+        }
+    }
+    job.finished = true;
+    job.seconds  = std::chrono::duration< double >( std::chrono::steady_clock::now() - job.begin ).count();
+}
+// 打开录制与输出文件, 写入文件头. 输出已存在时覆盖
+static std::shared_ptr< EXPORT_JOB > export_start( Urho3D::WorkQueue* queue, Urho3D::VirtualFileSystem* vfs, const std::string& scheme, const std::string& capture,
+                                                   const std::string& output, const EXPORT_OPTIONS& options )
+{
+    using namespace Urho3D;
+    auto job     = std::make_shared< EXPORT_JOB >();
+    job->options = options;
+    job->queue   = queue;
+    job->begin   = std::chrono::steady_clock::now();
+    for ( int f = 0; f < sensor_field_count; f++ )
+    {
+        if ( ( options.mask >> f ) & 1 )
+        {
+            job->fields[ job->field_count++ ] = f;
+        }
+    }
+    const size_t slash = output.find_last_of( '/' );
+    const size_t dot   = output.find_last_of( '.' );
+    job->events_name   = output.substr( 0, dot != std::string::npos && ( slash == std::string::npos || dot > slash ) ? dot : output.size() ) + ".events.csv";
+    std::fill_n( &job->selected[ 0 ][ 0 ], 256 * 2, -1 );
+    job->reader.open( vfs, scheme, capture );
+    job->out = vfs->OpenFile( FileIdentifier( scheme.c_str(), output.c_str() ), FILE_WRITE );
+    if ( ! job->out || job->reader.result.parts == 0 )
+    {
+        URHO3D_LOGERROR( "Failed to export {} to {}", capture.c_str(), output.c_str() );
+        job->failed   = true;
+        job->finished = true;
+        job->out      = nullptr;
+        return job;
+    }
+    for ( EXPORT_GROUP& group : job->groups )
+    {
+        group.sensor.resize( export_group_capacity );
+        for ( int k = 0; k < job->field_count; k++ )
+        {
+            group.columns[ job->fields[ k ] ].resize( export_group_capacity );
+        }
+    }
+    if ( options.format == export_format_columnar )
+    {
+        const uint32_t header[ 2 ] = { export_magic, export_version };
+        job->write( header, sizeof( header ) );
+    }
+    else
+    {
+        fmt::memory_buffer line;
+        fmt::format_to( std::back_inserter( line ), "sensor" );
+        for ( int k = 0; k < job->field_count; k++ )
+        {
+            fmt::format_to( std::back_inserter( line ), ",{}", sensor_field_keys[ job->fields[ k ] ] );
+        }
+        line.push_back( '\n' );
+        job->write( line.data(), line.size() );
+    }
+    return job;
+}
+// 推进导出, 最多用 budget 秒. 完成 (或失败) 时返回 true
+static bool export_pump( const std::shared_ptr< EXPORT_JOB >& job, double budget )
+{
+    using clock       = std::chrono::steady_clock;
+    const auto  start = clock::now();
+    EXPORT_JOB& state = *job;
+    while ( ! state.finished )
+    {
+        while ( state.written < state.submitted && state.groups[ state.written % export_groups_in_flight ].remaining.load( std::memory_order_acquire ) == 0 )
+        {
+            export_write( state, state.groups[ state.written % export_groups_in_flight ] );
+            state.written++;
+        }
+        // 正在填充的行组; 没有空闲的槽位时等待最早的行组编码完成
+        EXPORT_GROUP& group = state.groups[ state.submitted % export_groups_in_flight ];
+        const bool    slot  = state.submitted - state.written < ( uint32_t )export_groups_in_flight;
+        const bool    stop  = state.failed || state.cancelled.load( std::memory_order_relaxed );
+        if ( ( stop || ( state.reader.done && ( ! slot || group.rows == 0 ) ) ) && state.written == state.submitted )
+        {
+            export_finish( state );
+            break;
+        }
+        if ( ! stop && slot && ( group.rows >= export_group_rows || ( state.reader.done && group.rows > 0 ) ) )
+        {
+            export_submit( job );
+        }
+        else if ( ! stop && slot && ! state.reader.done )
+        {
+            // 读一个块, 按时间与传感器筛选后追加到行组; 事件标注在它引用的帧之后, 按已导出的帧序号范围筛选
+            const EXPORT_OPTIONS& options = state.options;
+            state.reader.next(
+                [ & ]( int sensor, const std::vector< SENSOR_DB >& frames, uint32_t ) {
+                    const int64_t first = state.ordinals[ sensor ];
+                    state.ordinals[ sensor ] += ( int64_t )frames.size();
+                    if ( ( ( options.sensors >> sensor ) & 1 ) == 0 )
+                    {
+                        return;
+                    }
+                    for ( size_t i = 0; i < frames.size(); i++ )
+                    {
+                        const SENSOR_DB& frame = frames[ i ];
+                        if ( ! ( frame.time >= options.time_begin && frame.time < options.time_end ) )
+                        {
+                            continue;
+                        }
+                        const int row       = group.rows++;
+                        group.sensor[ row ] = ( uint8_t )sensor;
+                        for ( int k = 0; k < state.field_count; k++ )
+                        {
+                            group.columns[ state.fields[ k ] ][ row ] = sensor_field( frame, state.fields[ k ] );
+                        }
+                        group.sensors |= 1u << sensor;
+                        int64_t* range = state.selected[ sensor ];
+                        range[ 0 ]     = range[ 0 ] < 0 ? first + ( int64_t )i : range[ 0 ];
+                        range[ 1 ]     = first + ( int64_t )i;
+                    }
+                },
+                [ & ]( const CAPTURE_EVENT_RECORD& event ) {
+                    const int64_t* range = state.selected[ event.sensor ];
+                    if ( event.kind < sensor_event_kind_count && range[ 0 ] >= 0 && event.end >= range[ 0 ] && event.begin <= range[ 1 ] )
+                    {
+                        state.events.push_back( event );
+                    }
+                } );
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+        if ( std::chrono::duration< double >( clock::now() - start ).count() >= budget )
+        {
+            break;
+        }
+    }
+    return state.finished;
+}
+//
+// 读取列式文件: 逐个行组解码, group( const EXPORT_GROUP_HEADER&, const std::vector< uint8_t >& sensor, const std::vector< float >* columns ) 回调一次,
+// columns 按字段序号索引, 只有行组掩码内的字段有数据. 格式不符时返回 false
+template < typename GROUP > static bool export_columnar_read( Urho3D::AbstractFile& file, GROUP&& group )
+{
+    uint32_t header[ 2 ];
+    if ( file.Read( header, sizeof( header ) ) != sizeof( header ) || header[ 0 ] != export_magic || header[ 1 ] != export_version )
+    {
+        return false;
+    }
+    std::vector< uint8_t > sensor, stored, split;
+    std::vector< float >   columns[ sensor_field_count ];
+    while ( true )
+    {
+        EXPORT_GROUP_HEADER group_header;
+        if ( file.Read( &group_header, sizeof( group_header ) ) != sizeof( group_header ) )
+        {
+            return false;
+        }
+        if ( group_header.rows == 0 )
+        {
+            return true;
+        }
+        if ( group_header.columns > export_max_tasks )
+        {
+            return false;
+        }
+        for ( uint32_t c = 0; c < group_header.columns; c++ )
+        {
+            EXPORT_CHUNK_HEADER chunk;
+            if ( file.Read( &chunk, sizeof( chunk ) ) != sizeof( chunk ) || chunk.raw != group_header.rows * chunk.width )
+            {
+                return false;
+            }
+            stored.resize( chunk.stored );
+            if ( file.Read( stored.data(), chunk.stored ) != chunk.stored )
+            {
+                return false;
+            }
+            uint8_t* out;
+            if ( chunk.field == export_sensor_column )
+            {
+                sensor.resize( chunk.raw );
+                out = sensor.data();
+            }
+            else if ( chunk.field < sensor_field_count && chunk.width == sizeof( float ) )
+            {
+                columns[ chunk.field ].resize( group_header.rows );
+                out = ( uint8_t* )columns[ chunk.field ].data();
+            }
+            else
+            {
+                return false;
+            }
+            const uint8_t* raw = stored.data();
+            if ( chunk.encoding & export_lz4 )
+            {
+                split.resize( chunk.raw );
+                if ( Urho3D::DecompressData( split.data(), stored.data(), chunk.raw ) != chunk.stored )
+                {
+                    return false;
+                }
+                raw = split.data();
+            }
+            if ( chunk.encoding & export_split )
+            {
+                for ( uint32_t b = 0; b < chunk.width; b++ )
+                {
+                    for ( uint32_t i = 0; i < group_header.rows; i++ )
+                    {
+                        out[ i * chunk.width + b ] = raw[ b * group_header.rows + i ];
+                    }
+                }
+            }
+            else
+            {
+                memcpy( out, raw, chunk.raw );
+            }
+        }
+        group( group_header, sensor, columns );
+    }
+}
@@ -0,0 +1,493 @@
+#pragma once
+//
+#include "capture/capture_block.h"
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/VirtualFileSystem.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#ifdef __EMSCRIPTEN__
+    #include <emscripten/emscripten.h>
+#endif
+//
+// 录制写入: 接收线程把帧追加到当前块, 写满 (或超过 flush_interval 未写满) 的块交给写入线程, 写入后立即 Flush
+// 块池在 open 时一次分配, 之后内存不随录制时长增长; 没有空闲块 (存储跟不上) 时丢弃新帧并计数, 不阻塞接收线程
+// 文件经 VirtualFileSystem 打开, 挂载点决定存放位置: 浏览器为 IndexedDB 目录 (IDBFS, 由 tick 定时同步), 原生为普通目录
+// 引擎的文件偏移是 32 位, 单个文件写到 capture_part_blocks 块后换到下一个分段: name, name.1, name.2, ...
+#if ! defined( __EMSCRIPTEN__ ) || defined( __EMSCRIPTEN_PTHREADS__ )
+    #define CAPTURE_THREADED 1
+#else
+    #define CAPTURE_THREADED 0  // 无 pthread 的 WASM 构建: 由 tick 在主线程写入
+#endif
+static constexpr int capture_pool_blocks = 8;
+//
+struct CAPTURE_WRITER
+{
+    double flush_interval = 1.0;    // 秒, 未写满的块最长在内存中停留的时间
+    double sync_interval  = 2.0;    // 秒, IDBFS 同步到 IndexedDB 的间隔
+    bool   delta          = false;  // 以差分记录写入 (按 codec/sensor_delta.h 的分辨率量化, 有损), open 之前设置
+    // 统计 (写入线程更新, UI 读取)
+    std::atomic< uint64_t > blocks{ 0 };
+    std::atomic< uint64_t > frames{ 0 };
+    std::atomic< uint64_t > dropped{ 0 };
+    std::atomic< uint64_t > events{ 0 };  // 写入的事件标注, 没有空闲块时丢弃的不计
+    std::atomic< uint64_t > failed{ 0 };
+    std::atomic< int >      in_flight{ 0 };
+    std::atomic< bool >     recording{ false };
+    //
+    Urho3D::VirtualFileSystem* vfs = nullptr;
+    std::string                scheme;
+    std::string                name;  // 实际打开的文件名 (同名文件已存在时加序号)
+    //
+    std::unique_ptr< CAPTURE_BLOCK[] > pool;
+    int                                free_list[ capture_pool_blocks ];
+    int                                free_count = 0;
+    int                                queue[ capture_pool_blocks ];  // 待写入的块, 环形
+    int                                queue_head = 0, queue_count = 0;
+    int                                current    = -1;
+    uint32_t                           sequence   = 0;   // 下一个入队块的序号
+    CAPTURE_DELTA_STATE                delta_state;      // 当前块的差分编码状态
+    uint64_t                           ordinals[ 256 ];  // 各传感器已追加的帧数, 即下一帧在本录制内的帧序号
+    std::mutex                         mutex;
+    std::condition_variable            wake;
+    bool                               stopping = false;
+#if CAPTURE_THREADED
+    std::thread thread;
+#endif
+    // 写入线程独占
+    Urho3D::AbstractFilePtr file;
+    uint32_t                part         = 0;
+    uint32_t                part_written = 0;
+    bool                    dirty        = false;  // 有未同步到 IndexedDB 的写入
+    double                  last_sync    = 0.0;
+    //
+    ~CAPTURE_WRITER()
+    {
+        close();
+    }
+    //
+    static double now()
+    {
+        return std::chrono::duration< double >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+    // 开始录制. 不覆盖已有文件: name 已存在时依次尝试 name-1, name-2, ...
+    bool open( Urho3D::VirtualFileSystem* file_system, const std::string& file_scheme, const std::string& file_name )
+    {
+        using namespace Urho3D;
+        close();
+        vfs    = file_system;
+        scheme = file_scheme;
+        name   = file_name;
+        const size_t slash = file_name.find_last_of( '/' );
+        const size_t dot   = file_name.find_last_of( '.' );
+        const size_t stem  = dot != std::string::npos && ( slash == std::string::npos || dot > slash + 1 ) ? dot : file_name.size();
+        for ( int n = 1; vfs->Exists( FileIdentifier( scheme.c_str(), name.c_str() ) ); n++ )
+        {
+            name = file_name.substr( 0, stem ) + "-" + std::to_string( n ) + file_name.substr( stem );
+        }
+        part         = 0;
+        part_written = 0;
+        file         = vfs->OpenFile( FileIdentifier( scheme.c_str(), name.c_str() ), FILE_WRITE );
+        if ( ! file )
+        {
+            URHO3D_LOGERROR( "Failed to open capture {}", name.c_str() );
+            return false;
+        }
+        if ( ! pool )
+        {
+            pool.reset( new CAPTURE_BLOCK[ capture_pool_blocks ] );
+        }
+        for ( int i = 0; i < capture_pool_blocks; i++ )
+        {
+            free_list[ i ] = i;
+        }
+        free_count  = capture_pool_blocks;
+        queue_head  = 0;
+        queue_count = 0;
+        current     = -1;
+        sequence    = 0;
+        stopping    = false;
+        dirty       = false;
+        last_sync   = now();
+        blocks      = 0;
+        frames      = 0;
+        dropped     = 0;
+        events      = 0;
+        failed      = 0;
+        in_flight   = 0;
+        std::fill_n( ordinals, 256, 0 );
+#if CAPTURE_THREADED
+        thread = std::thread( [ this ] { run(); } );
+#endif
+        recording = true;
+        return true;
+    }
+    // 停止录制: 未写满的块也写入, 等待队列写完后关闭文件
+    void close()
+    {
+        if ( ! recording.exchange( false ) )
+        {
+            return;
+        }
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            submit();
+            stopping = true;
+        }
+        wake.notify_one();
+#if CAPTURE_THREADED
+        thread.join();
+#else
+        drain();
+#endif
+        if ( file )
+        {
+            file->Close();
+            file = nullptr;
+        }
+        sync( true );
+    }
+    // 接收线程: 追加一批帧, 一批放不下时跨块拆分. 返回第一帧在本录制内的帧序号 (丢弃的帧不占序号), 未在录制时返回 -1
+    int64_t push( int sensor, const SENSOR_DB* source, int count, uint32_t mask )
+    {
+        if ( ! recording.load( std::memory_order_relaxed ) )
+        {
+            return -1;
+        }
+        bool    submitted = false;
+        int64_t ordinal;
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            ordinal = ( int64_t )ordinals[ ( uint8_t )sensor ];
+            while ( count > 0 )
+            {
+                if ( ! acquire() )
+                {
+                    dropped.fetch_add( count, std::memory_order_relaxed );
+                    break;
+                }
+                const int written = pool[ current ].append( source, count, mask, ( uint8_t )sensor, delta ? &delta_state : nullptr );
+                if ( written == 0 )
+                {
+                    submit();
+                    submitted = true;
+                    continue;
+                }
+                source += written;
+                count -= written;
+                ordinals[ ( uint8_t )sensor ] += written;
+            }
+        }
+        if ( submitted )
+        {
+            wake.notify_one();
+        }
+        return ordinal;
+    }
+    // 接收线程: 追加一条事件标注, 帧序号为本录制内的帧序号 (见 push 的返回值)
+    void push_event( const CAPTURE_EVENT_RECORD& event )
+    {
+        if ( ! recording.load( std::memory_order_relaxed ) )
+        {
+            return;
+        }
+        bool submitted = false;
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            while ( acquire() )
+            {
+                if ( pool[ current ].append_event( event ) )
+                {
+                    events.fetch_add( 1, std::memory_order_relaxed );
+                    break;
+                }
+                submit();
+                submitted = true;
+            }
+        }
+        if ( submitted )
+        {
+            wake.notify_one();
+        }
+    }
+    // 调用方持有 mutex: 没有当前块时取一个空闲块, 没有空闲块时返回 false
+    bool acquire()
+    {
+        if ( current >= 0 )
+        {
+            return true;
+        }
+        if ( free_count == 0 )
+        {
+            return false;
+        }
+        current = free_list[ --free_count ];
+        pool[ current ].clear();
+        pool[ current ].opened = now();
+        delta_state.restart();
+        return true;
+    }
+    // 主线程每帧调用: 超时的未写满块入队, 无 pthread 时在此写入, 浏览器中定时同步 IDBFS
+    void tick()
+    {
+        if ( ! recording.load( std::memory_order_relaxed ) )
+        {
+            return;
+        }
+        bool submitted = false;
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            if ( current >= 0 && pool[ current ].used > 0 && now() - pool[ current ].opened >= flush_interval )
+            {
+                submit();
+                submitted = true;
+            }
+        }
+        if ( submitted )
+        {
+            wake.notify_one();
+        }
+#if ! CAPTURE_THREADED
+        drain();
+#endif
+        sync( false );
+    }
+    // 调用方持有 mutex: 当前块交给写入线程
+    void submit()
+    {
+        if ( current < 0 )
+        {
+            return;
+        }
+        if ( pool[ current ].used == 0 )
+        {
+            free_list[ free_count++ ] = current;
+            current                   = -1;
+            return;
+        }
+        queue[ ( queue_head + queue_count ) % capture_pool_blocks ] = current;
+        queue_count++;
+        in_flight.store( queue_count, std::memory_order_relaxed );
+        current = -1;
+    }
+    // 写入线程: 取出已满的块, 计算校验并写入; 写入时不持有 mutex, 接收线程可继续填充其他块
+    bool write_next( std::unique_lock< std::mutex >& lock )
+    {
+        using namespace Urho3D;
+        if ( queue_count == 0 )
+        {
+            return false;
+        }
+        const int      index       = queue[ queue_head ];
+        const uint32_t block_index = sequence++;
+        lock.unlock();
+        CAPTURE_BLOCK& block = pool[ index ];
+        block.seal( block_index );
+        if ( file && part_written == capture_part_blocks )
+        {
+            file->Close();
+            part++;
+            part_written = 0;
+            file         = vfs->OpenFile( FileIdentifier( scheme.c_str(), capture_part_name( name, part ).c_str() ), FILE_WRITE );
+        }
+        bool ok = file && file->Write( block.data, capture_block_size ) == capture_block_size;
+        if ( ok )
+        {
+            if ( File* native = dynamic_cast< File* >( file.Get() ) )
+            {
+                native->Flush();
+            }
+            part_written++;
+            blocks.fetch_add( 1, std::memory_order_relaxed );
+            frames.fetch_add( block.frames, std::memory_order_relaxed );
+        }
+        else
+        {
+            failed.fetch_add( 1, std::memory_order_relaxed );
+            dropped.fetch_add( block.frames, std::memory_order_relaxed );
+        }
+        lock.lock();
+        dirty      = true;
+        queue_head = ( queue_head + 1 ) % capture_pool_blocks;
+        queue_count--;
+        in_flight.store( queue_count, std::memory_order_relaxed );
+        free_list[ free_count++ ] = index;
+        return true;
+    }
+    //
+    void drain()
+    {
+        std::unique_lock< std::mutex > lock( mutex );
+        while ( write_next( lock ) )
+        {
+        }
+    }
+    //
+    void run()
+    {
+        std::unique_lock< std::mutex > lock( mutex );
+        while ( true )
+        {
+            wake.wait( lock, [ this ] { return queue_count > 0 || stopping; } );
+            while ( write_next( lock ) )
+            {
+            }
+            if ( stopping )
+            {
+                return;
+            }
+        }
+    }
+    // IDBFS 只在 FS.syncfs 时写入 IndexedDB, 必须在主线程调用. 原生构建无需同步
+    void sync( bool force )
+    {
+#ifdef __EMSCRIPTEN__
+        bool pending;
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            pending = dirty && ( force || now() - last_sync >= sync_interval );
+            if ( pending )
+            {
+                dirty     = false;
+                last_sync = now();
+            }
+        }
+        if ( pending )
+        {
+            EM_ASM( FS.syncfs( false, function( err ) {
+                if ( err ) console.warn( 'capture sync failed', err );
+            } ); );
+        }
+#else
+        ( void )force;
+#endif
+    }
+};
+//
+// 恢复: 按序读取各分段, 逐块校验, 停在第一个损坏或不完整的块. 内存只需一个块
+struct CAPTURE_RECOVERY
+{
+    uint32_t parts     = 0;
+    uint64_t blocks    = 0;
+    uint64_t frames    = 0;
+    uint64_t events    = 0;
+    uint64_t discarded = 0;  // 第一个损坏块及之后的字节数 (不再读取)
+    bool     truncated = false;
+};
+// 逐块读取, 调用方可以分多次读完 (导出时每帧只读一部分)
+struct CAPTURE_READER
+{
+    Urho3D::VirtualFileSystem*          vfs = nullptr;
+    std::string                         scheme;
+    std::string                         name;
+    Urho3D::AbstractFilePtr             file;
+    unsigned                            size = 0, read = 0;  // 当前分段
+    uint32_t                            part     = 0;
+    uint32_t                            sequence = 0;
+    bool                                done     = false;
+    CAPTURE_RECOVERY                    result;
+    std::unique_ptr< uint8_t[] >        data;
+    std::vector< SENSOR_DB >            frames;
+    std::vector< SENSOR_DELTA_DECODER > decoders;  // 差分记录的解码状态, 按传感器编号
+    //
+    void open( Urho3D::VirtualFileSystem* file_system, const std::string& file_scheme, const std::string& file_name )
+    {
+        vfs      = file_system;
+        scheme   = file_scheme;
+        name     = file_name;
+        file     = nullptr;
+        part     = 0;
+        sequence = 0;
+        done     = false;
+        result   = CAPTURE_RECOVERY();
+        if ( ! data )
+        {
+            data.reset( new uint8_t[ capture_block_size ] );
+        }
+        open_part();
+    }
+    // 打开第 part 个分段, 不存在时结束
+    void open_part()
+    {
+        using namespace Urho3D;
+        const FileIdentifier identifier( scheme.c_str(), capture_part_name( name, part ).c_str() );
+        file = vfs->Exists( identifier ) ? vfs->OpenFile( identifier, FILE_READ ) : nullptr;
+        if ( ! file )
+        {
+            done = true;
+            return;
+        }
+        result.parts++;
+        size = file->GetSize();
+        read = 0;
+    }
+    // 读取并校验下一个块, 对其中每条记录回调 record( int sensor, const std::vector< SENSOR_DB >& frames, uint32_t mask ),
+    // 每条事件标注回调 event( const CAPTURE_EVENT_RECORD& ). 没有更多完整的块时返回 false
+    template < typename RECORD, typename EVENT > bool next( RECORD&& record, EVENT&& event )
+    {
+        while ( ! done )
+        {
+            if ( read + capture_block_size <= size && file->Read( data.get(), capture_block_size ) == capture_block_size )
+            {
+                uint64_t   block_frames = 0, block_events = 0;
+                const bool ok           = capture_block_read(
+                    data.get(), sequence, frames, decoders,
+                    [ & ]( int sensor, const std::vector< SENSOR_DB >& records, uint32_t mask ) {
+                        block_frames += records.size();
+                        record( sensor, records, mask );
+                    },
+                    [ & ]( const CAPTURE_EVENT_RECORD& event_record ) {
+                        block_events++;
+                        event( event_record );
+                    } );
+                if ( ok )
+                {
+                    read += capture_block_size;
+                    sequence++;
+                    result.blocks++;
+                    result.frames += block_frames;
+                    result.events += block_events;
+                    return true;
+                }
+            }
+            file->Close();
+            file = nullptr;
+            // 分段只在写满时切换, 未写满的分段之后不应再有数据
+            if ( read < size || read / capture_block_size < capture_part_blocks )
+            {
+                result.discarded += size - read;
+                result.truncated = read < size;
+                done             = true;
+                break;
+            }
+            part++;
+            open_part();
+        }
+        return false;
+    }
+    template < typename RECORD > bool next( RECORD&& record )
+    {
+        return next( record, []( const CAPTURE_EVENT_RECORD& ) {} );
+    }
+};
+//
+template < typename RECORD, typename EVENT >
+static CAPTURE_RECOVERY capture_recover( Urho3D::VirtualFileSystem* vfs, const std::string& scheme, const std::string& name, RECORD&& record, EVENT&& event )
+{
+    CAPTURE_READER reader;
+    reader.open( vfs, scheme, name );
+    while ( reader.next( record, event ) )
+    {
+    }
+    return reader.result;
+}
+template < typename RECORD >
+static CAPTURE_RECOVERY capture_recover( Urho3D::VirtualFileSystem* vfs, const std::string& scheme, const std::string& name, RECORD&& record )
+{
+    return capture_recover( vfs, scheme, name, record, []( const CAPTURE_EVENT_RECORD& ) {} );
+}
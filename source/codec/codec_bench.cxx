@@ -0,0 +1,241 @@
+#include "synthetic/imu_synth.h"
+#include "capture/capture_block.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+//
+// 录制块的差分记录 (codec/sensor_delta.h) 对原始记录的压缩比与编解码速度, 不依赖引擎:
+//   codec_bench                                        合成数据, 16 个传感器, 1000 Hz, 60 秒, 每 10 ms 一条记录 (同 capture 工具)
+//   codec_bench --file /tmp/capture/bench.fmc          读取录制文件 (含 .1, .2 ... 分段), 按文件中的记录重新编码
+// 记录按写入顺序分别以原始与差分方式装入块 (差分的编码状态每块重置), 统计块数与速度, 再逐块解码差分块,
+// 与原始帧逐字段比较: 误差应不超过分辨率的一半 (另加原值的 float 舍入). 帧数不符或误差超出时返回 1
+struct CODEC_BENCH_OPTIONS
+{
+    std::vector< std::string > files;
+    int                        devices = 16;
+    double                     rate    = 1000.0;
+    double                     seconds = 60.0;
+    uint64_t                   seed    = 1;
+};
+//
+static bool codec_bench_parse( int argc, char** argv, CODEC_BENCH_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg   = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--file" ) == 0 )
+            options.files.push_back( value );
+        else if ( strcmp( arg, "--devices" ) == 0 )
+            options.devices = std::max( 1, std::min( atoi( value ), synth_max_devices ) );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--seconds" ) == 0 )
+            options.seconds = atof( value );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else
+            return false;
+        i++;
+    }
+    return options.rate > 0.0 && options.seconds > 0.0;
+}
+// 一条记录: 写入时的一批帧
+struct CODEC_BENCH_RECORD
+{
+    int      sensor;
+    uint32_t mask;
+    size_t   first;  // 在 frames 中的起点
+    int      count;
+};
+// 读取录制文件的全部分段, 停在第一个损坏的块. 返回读到的块数
+static uint64_t codec_bench_load( const std::string& name, std::vector< CODEC_BENCH_RECORD >& records, std::vector< SENSOR_DB >& frames )
+{
+    std::vector< uint8_t >              block( capture_block_size );
+    std::vector< SENSOR_DB >            buffer;
+    std::vector< SENSOR_DELTA_DECODER > decoders;
+    uint32_t                            sequence = 0;
+    for ( uint32_t part = 0;; part++ )
+    {
+        FILE* file = fopen( capture_part_name( name, part ).c_str(), "rb" );
+        if ( file == nullptr )
+        {
+            break;
+        }
+        uint32_t read = 0;
+        bool     ok   = true;
+        while ( ok && fread( block.data(), 1, capture_block_size, file ) == capture_block_size )
+        {
+            ok = capture_block_read( block.data(), sequence, buffer, decoders, [ & ]( int sensor, const std::vector< SENSOR_DB >& records_frames, uint32_t mask ) {
+                records.push_back( { sensor, mask, frames.size(), ( int )records_frames.size() } );
+                frames.insert( frames.end(), records_frames.begin(), records_frames.end() );
+            } );
+            if ( ok )
+            {
+                sequence++;
+                read++;
+            }
+        }
+        fclose( file );
+        if ( ! ok || read < capture_part_blocks )
+        {
+            break;
+        }
+    }
+    return sequence;
+}
+// 按记录顺序装块并封装, 返回块数; out 非空时保存封装后的块
+static uint64_t codec_bench_pack( const std::vector< CODEC_BENCH_RECORD >& records, const std::vector< SENSOR_DB >& frames, bool delta, std::vector< uint8_t >* out )
+{
+    CAPTURE_BLOCK       block;
+    CAPTURE_DELTA_STATE state;
+    uint64_t            blocks = 0;
+    auto                seal   = [ & ]() {
+        block.seal( ( uint32_t )blocks++ );
+        if ( out != nullptr )
+        {
+            out->insert( out->end(), block.data, block.data + capture_block_size );
+        }
+        block.clear();
+        state.restart();
+    };
+    for ( const CODEC_BENCH_RECORD& record : records )
+    {
+        const SENSOR_DB* source = frames.data() + record.first;
+        int              count  = record.count;
+        while ( count > 0 )
+        {
+            const int written = block.append( source, count, record.mask, ( uint8_t )record.sensor, delta ? &state : nullptr );
+            if ( written == 0 )
+            {
+                seal();
+                continue;
+            }
+            source += written;
+            count -= written;
+        }
+    }
+    if ( block.frames > 0 )
+    {
+        seal();
+    }
+    return blocks;
+}
+//
+int main( int argc, char** argv )
+{
+    using clock = std::chrono::steady_clock;
+    CODEC_BENCH_OPTIONS options;
+    if ( ! codec_bench_parse( argc, argv, options ) )
+    {
+        printf( "usage: codec_bench [--file capture]... [--devices n] [--rate hz] [--seconds s] [--seed n]\n" );
+        return 1;
+    }
+    std::vector< CODEC_BENCH_RECORD > records;
+    std::vector< SENSOR_DB >          frames;
+    if ( options.files.empty() )
+    {
+        SYNTH_SOURCE source;
+        source.seed = options.seed;
+        source.reset( options.devices, options.rate );
+        for ( double elapsed = 0.0; elapsed < options.seconds; )
+        {
+            elapsed = std::min( options.seconds, elapsed + 0.01 );
+            source.pump( elapsed, [ & ]( int device, const std::vector< SENSOR_DB >& batch ) {
+                records.push_back( { device, sensor_mask_all, frames.size(), ( int )batch.size() } );
+                frames.insert( frames.end(), batch.begin(), batch.end() );
+            } );
+        }
+        printf( "synthetic: %d devices, %.0f Hz, %.0f s\n", options.devices, options.rate, options.seconds );
+    }
+    for ( const std::string& file : options.files )
+    {
+        const uint64_t blocks = codec_bench_load( file, records, frames );
+        printf( "%s: %llu blocks\n", file.c_str(), ( unsigned long long )blocks );
+    }
+    if ( frames.empty() )
+    {
+        printf( "No frames\nFAIL\n" );
+        return 1;
+    }
+    // 编码: 原始与差分各装一遍块
+    auto           begin        = clock::now();
+    const uint64_t raw_blocks   = codec_bench_pack( records, frames, false, nullptr );
+    const double   raw_seconds  = std::chrono::duration< double >( clock::now() - begin ).count();
+    std::vector< uint8_t > raw, packed;
+    raw.reserve( raw_blocks * capture_block_size );
+    codec_bench_pack( records, frames, false, &raw );
+    packed.reserve( raw_blocks * capture_block_size );
+    begin                       = clock::now();
+    const uint64_t delta_blocks = codec_bench_pack( records, frames, true, &packed );
+    const double   encode       = std::chrono::duration< double >( clock::now() - begin ).count();
+    // 解码: 逐块校验并解出全部记录
+    std::vector< SENSOR_DB >            decoded;
+    std::vector< SENSOR_DB >            buffer;
+    std::vector< SENSOR_DELTA_DECODER > decoders;
+    decoded.reserve( frames.size() );
+    bool ok = true;
+    begin   = clock::now();
+    for ( uint64_t b = 0; b < delta_blocks; b++ )
+    {
+        ok = ok && capture_block_read( packed.data() + b * capture_block_size, ( uint32_t )b, buffer, decoders,
+                                       [ & ]( int, const std::vector< SENSOR_DB >& records_frames, uint32_t ) { decoded.insert( decoded.end(), records_frames.begin(), records_frames.end() ); } );
+    }
+    const double decode = std::chrono::duration< double >( clock::now() - begin ).count();
+    uint64_t     raw_frames = 0;
+    begin                   = clock::now();
+    for ( uint64_t b = 0; b < raw_blocks; b++ )
+    {
+        ok = ok && capture_block_read( raw.data() + b * capture_block_size, ( uint32_t )b, buffer, decoders,
+                                       [ & ]( int, const std::vector< SENSOR_DB >& records_frames, uint32_t ) { raw_frames += records_frames.size(); } );
+    }
+    const double raw_decode = std::chrono::duration< double >( clock::now() - begin ).count();
+    // 误差以分辨率为单位; 原值的 float 舍入 (例如较大的 time) 另外放宽
+    float resolution[ sensor_field_count ];
+    sensor_delta_default_resolution( resolution );
+    double  worst    = 0.0;
+    int     worst_at = 0;
+    int64_t skipped  = 0;
+    ok               = ok && decoded.size() == frames.size() && raw_frames == frames.size();
+    size_t  index    = 0;
+    for ( const CODEC_BENCH_RECORD& record : records )
+    {
+        for ( int i = 0; i < record.count && index < decoded.size(); i++, index++ )
+        {
+            for ( uint32_t m = record.mask & sensor_mask_all; m != 0; m &= m - 1 )
+            {
+                const int   f        = __builtin_ctz( m );
+                const float original = sensor_field( frames[ index ], f );
+                if ( ! std::isfinite( original ) )
+                {
+                    skipped++;
+                    continue;
+                }
+                const double ulp   = std::nextafter( std::fabs( original ), INFINITY ) - std::fabs( original );
+                const double error = ( std::fabs( ( double )sensor_field( decoded[ index ], f ) - original ) - ulp ) / resolution[ f ];
+                if ( error > worst )
+                {
+                    worst    = error;
+                    worst_at = f;
+                }
+            }
+        }
+    }
+    const double mb = capture_block_size / 1e6;
+    printf( "%llu frames in %llu records | raw %llu blocks, %.1f MB | delta %llu blocks, %.1f MB | ratio %.2fx\n", ( unsigned long long )frames.size(),
+            ( unsigned long long )records.size(), ( unsigned long long )raw_blocks, raw_blocks * mb, ( unsigned long long )delta_blocks, delta_blocks * mb,
+            ( double )raw_blocks / std::max< uint64_t >( delta_blocks, 1 ) );
+    printf( "pack raw %.1f M frames/s | encode delta %.1f M frames/s | decode delta %.1f M frames/s, %.0f MB/s | decode raw %.1f M frames/s\n",
+            frames.size() / std::max( raw_seconds, 1e-9 ) / 1e6, frames.size() / std::max( encode, 1e-9 ) / 1e6, frames.size() / std::max( decode, 1e-9 ) / 1e6,
+            delta_blocks * mb / std::max( decode, 1e-9 ), frames.size() / std::max( raw_decode, 1e-9 ) / 1e6 );
+    printf( "worst error %.3f of resolution (%s), %lld non-finite values skipped\n", worst, sensor_field_keys[ worst_at ], ( long long )skipped );
+    ok = ok && worst <= 0.5 + 1e-6;
+    printf( "%s\n", ok ? "PASS" : "FAIL" );
+    return ok ? 0 : 1;
+}
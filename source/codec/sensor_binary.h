@@ -0,0 +1,142 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+//
+// 二进制数据帧 (小端):
+//   uint8  type      消息类型, sensor_binary_raw
+//   uint8  sensor    传感器编号, 0 为主数据流, 其余用于多传感器动作捕捉
+//   uint16 count     帧数
+//   uint32 mask      字段掩码, 同 sensor_mask_all 的位定义
+//   float  values[ count ][ popcount( mask ) ]   每帧只含掩码内的字段, 按字段顺序排列
+// 快照 (sensor_binary_snapshot) 在头部之后多一个 uint32 sequence, 经不可靠无序通道发送, 接收端丢弃过期的快照
+enum SENSOR_BINARY_TYPE : uint8_t
+{
+    sensor_binary_raw      = 1,
+    sensor_binary_snapshot = 3,
+};
+//
+struct SENSOR_BINARY_HEADER
+{
+    uint8_t  type;
+    uint8_t  sensor;
+    uint16_t count;
+    uint32_t mask;
+};
+static_assert( sizeof( SENSOR_BINARY_HEADER ) == 8, "binary header must be packed" );
+// 各字段在 SENSOR_DB 中的字节偏移
+static const size_t* sensor_field_offsets()
+{
+    static size_t offsets[ sensor_field_count ];
+    static bool   ready = [] {
+        SENSOR_DB sensor_db;
+        for ( int f = 0; f < sensor_field_count; f++ )
+        {
+            offsets[ f ] = ( size_t )( ( const char* )&sensor_field( sensor_db, f ) - ( const char* )&sensor_db );
+        }
+        return true;
+    }();
+    ( void )ready;
+    return offsets;
+}
+// 掩码展开为字段偏移列表, 返回字段数
+static int sensor_mask_offsets( uint32_t mask, size_t* offsets )
+{
+    const size_t* all   = sensor_field_offsets();
+    int           count = 0;
+    for ( uint32_t m = mask & sensor_mask_all; m != 0; m &= m - 1 )
+    {
+        offsets[ count++ ] = all[ __builtin_ctz( m ) ];
+    }
+    return count;
+}
+// 帧数据按掩码紧密排列, 写入 p 之后的 count * fields 个 float
+static void sensor_binary_pack( const SENSOR_DB* frames, int count, const size_t* offsets, int fields, uint8_t* p )
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        const char* src = ( const char* )&frames[ i ];
+        for ( int k = 0; k < fields; k++, p += sizeof( float ) )
+        {
+            memcpy( p, src + offsets[ k ], sizeof( float ) );
+        }
+    }
+}
+static void sensor_binary_unpack( const uint8_t* p, int count, const size_t* offsets, int fields, std::vector< SENSOR_DB >& frames )
+{
+    const size_t begin = frames.size();
+    frames.resize( begin + count );
+    for ( int i = 0; i < count; i++ )
+    {
+        char* dst = ( char* )&frames[ begin + i ];
+        for ( int k = 0; k < fields; k++, p += sizeof( float ) )
+        {
+            memcpy( dst + offsets[ k ], p, sizeof( float ) );
+        }
+    }
+}
+//
+static void sensor_binary_encode( const SENSOR_DB* frames, int count, uint32_t mask, std::vector< uint8_t >& out, uint8_t sensor = 0 )
+{
+    size_t               offsets[ sensor_field_count ];
+    const int            fields = sensor_mask_offsets( mask, offsets );
+    SENSOR_BINARY_HEADER header = { sensor_binary_raw, sensor, ( uint16_t )count, mask & sensor_mask_all };
+    const size_t         begin  = out.size();
+    out.resize( begin + sizeof( header ) + ( size_t )count * fields * sizeof( float ) );
+    memcpy( out.data() + begin, &header, sizeof( header ) );
+    sensor_binary_pack( frames, count, offsets, fields, out.data() + begin + sizeof( header ) );
+}
+// 追加解码出的帧, 未包含的字段为 0. 数据不完整或类型不符时返回 false
+static bool sensor_binary_decode( const uint8_t* data, size_t size, std::vector< SENSOR_DB >& frames, uint32_t& mask )
+{
+    SENSOR_BINARY_HEADER header;
+    if ( size < sizeof( header ) )
+    {
+        return false;
+    }
+    memcpy( &header, data, sizeof( header ) );
+    size_t    offsets[ sensor_field_count ];
+    const int fields = sensor_mask_offsets( header.mask, offsets );
+    if ( header.type != sensor_binary_raw || size < sizeof( header ) + ( size_t )header.count * fields * sizeof( float ) )
+    {
+        return false;
+    }
+    mask = header.mask & sensor_mask_all;
+    sensor_binary_unpack( data + sizeof( header ), header.count, offsets, fields, frames );
+    return true;
+}
+//
+static void sensor_snapshot_encode( const SENSOR_DB* frames, int count, uint32_t mask, uint32_t sequence, std::vector< uint8_t >& out, uint8_t sensor = 0 )
+{
+    size_t               offsets[ sensor_field_count ];
+    const int            fields = sensor_mask_offsets( mask, offsets );
+    SENSOR_BINARY_HEADER header = { sensor_binary_snapshot, sensor, ( uint16_t )count, mask & sensor_mask_all };
+    const size_t         begin  = out.size();
+    out.resize( begin + sizeof( header ) + sizeof( sequence ) + ( size_t )count * fields * sizeof( float ) );
+    memcpy( out.data() + begin, &header, sizeof( header ) );
+    memcpy( out.data() + begin + sizeof( header ), &sequence, sizeof( sequence ) );
+    sensor_binary_pack( frames, count, offsets, fields, out.data() + begin + sizeof( header ) + sizeof( sequence ) );
+}
+//
+static bool sensor_snapshot_decode( const uint8_t* data, size_t size, std::vector< SENSOR_DB >& frames, uint32_t& mask, uint32_t& sequence )
+{
+    SENSOR_BINARY_HEADER header;
+    if ( size < sizeof( header ) + sizeof( sequence ) )
+    {
+        return false;
+    }
+    memcpy( &header, data, sizeof( header ) );
+    size_t    offsets[ sensor_field_count ];
+    const int fields = sensor_mask_offsets( header.mask, offsets );
+    if ( header.type != sensor_binary_snapshot || size < sizeof( header ) + sizeof( sequence ) + ( size_t )header.count * fields * sizeof( float ) )
+    {
+        return false;
+    }
+    memcpy( &sequence, data + sizeof( header ), sizeof( sequence ) );
+    mask = header.mask & sensor_mask_all;
+    sensor_binary_unpack( data + sizeof( header ) + sizeof( sequence ), header.count, offsets, fields, frames );
+    return true;
+}
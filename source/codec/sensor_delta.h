@@ -0,0 +1,267 @@
+#pragma once
+//
+#include "codec/sensor_binary.h"
+#include <cmath>
+//
+// 差分压缩帧 (小端), 适用于低带宽链路与采集文件:
+//   SENSOR_DELTA_HEADER               flags 的 bit 0 为关键帧, 高 7 位为传感器编号 (见 codec/sensor_binary.h)
+//   关键帧: float resolution[ fields ], int32 base[ fields ]      fields = popcount( mask )
+//   每个字段: uint8 width, 随后 deltas 个 width 位的 zigzag 差分 (按字段连续存放, 位紧密排列)
+//   末尾补 8 字节 0, 使解码可以整字读取而不越界
+// 每个字段按各自的分辨率量化为 int32, 与前一帧作差 (模 2^32). 关键帧的第一帧即 base, 差分从第二帧开始;
+// 非关键帧的差分相对上一条消息的最后一帧, 序号不连续或掩码变化时解码端丢弃直到下一个关键帧
+static constexpr uint8_t sensor_binary_delta   = 2;
+static constexpr uint8_t sensor_delta_keyframe = 1;
+static constexpr int     sensor_delta_padding  = 8;
+//
+static inline int sensor_delta_sensor( const uint8_t* data )
+{
+    return data[ 1 ] >> 1;
+}
+//
+struct SENSOR_DELTA_HEADER
+{
+    uint8_t  type;
+    uint8_t  flags;
+    uint16_t count;
+    uint32_t mask;
+    uint32_t sequence;
+};
+static_assert( sizeof( SENSOR_DELTA_HEADER ) == 12, "delta header must be packed" );
+// 默认分辨率, 按字段顺序: time, 加速度计, 陀螺仪, 磁力计, 四元数, 欧拉角, 加速度, 速度, 位置
+static void sensor_delta_default_resolution( float* resolution )
+{
+    static const float defaults[ sensor_field_count ] = {
+        1e-4f,                                   // time
+        1e-4f, 1e-4f, 1e-4f,                     // acc
+        1e-3f, 1e-3f, 1e-3f,                     // gyro
+        1e-2f, 1e-2f, 1e-2f,                     // mag
+        1e-5f, 1e-5f, 1e-5f, 1e-5f,              // quaternion
+        1e-3f, 1e-3f, 1e-3f,                     // roll pitch yaw
+        1e-4f, 1e-4f, 1e-4f,                     // eacc
+        1e-4f, 1e-4f, 1e-4f,                     // vel
+        1e-4f, 1e-4f, 1e-4f,                     // pos
+    };
+    memcpy( resolution, defaults, sizeof( defaults ) );
+}
+//
+static inline uint32_t sensor_zigzag( uint32_t delta )
+{
+    return ( delta << 1 ) ^ ( uint32_t )( ( int32_t )delta >> 31 );
+}
+static inline uint32_t sensor_unzigzag( uint32_t value )
+{
+    return ( value >> 1 ) ^ ( 0u - ( value & 1 ) );
+}
+//
+static inline int32_t sensor_quantize( float value, float resolution )
+{
+    const double q = std::isnan( value ) ? 0.0 : ( double )value / resolution;
+    return ( int32_t )std::llround( std::max( -2147483648.0, std::min( 2147483647.0, q ) ) );
+}
+//
+struct SENSOR_DELTA_ENCODER
+{
+    uint32_t mask              = sensor_mask_all;
+    float    resolution[ sensor_field_count ];
+    int      keyframe_interval = 64;  // 每隔多少条消息强制一个关键帧
+    uint8_t  sensor            = 0;   // 传感器编号, 0..127
+    //
+    int32_t                 previous[ sensor_field_count ];
+    bool                    has_previous   = false;
+    int                     since_keyframe = 0;
+    uint32_t                sequence       = 0;
+    std::vector< uint32_t > zigzag;
+    //
+    SENSOR_DELTA_ENCODER()
+    {
+        sensor_delta_default_resolution( resolution );
+    }
+    // 掩码或分辨率修改后调用, 下一条消息为关键帧
+    void restart()
+    {
+        has_previous = false;
+    }
+    //
+    void encode( const SENSOR_DB* frames, int count, std::vector< uint8_t >& out )
+    {
+        if ( count <= 0 )
+        {
+            return;
+        }
+        count = std::min( count, 0xFFFF );
+        int fields[ sensor_field_count ];
+        int field_count = 0;
+        for ( uint32_t m = mask & sensor_mask_all; m != 0; m &= m - 1 )
+        {
+            fields[ field_count++ ] = __builtin_ctz( m );
+        }
+        const bool key = ! has_previous || since_keyframe >= keyframe_interval;
+        since_keyframe = key ? 1 : since_keyframe + 1;
+        //
+        const uint8_t       flags  = ( uint8_t )( ( sensor << 1 ) | ( key ? sensor_delta_keyframe : 0 ) );
+        SENSOR_DELTA_HEADER header = { sensor_binary_delta, flags, ( uint16_t )count, mask & sensor_mask_all, sequence++ };
+        const size_t        begin  = out.size();
+        out.resize( begin + sizeof( header ) );
+        memcpy( out.data() + begin, &header, sizeof( header ) );
+        //
+        const int first = key ? 1 : 0;
+        if ( key )
+        {
+            for ( int k = 0; k < field_count; k++ )
+            {
+                previous[ k ] = sensor_quantize( sensor_field( frames[ 0 ], fields[ k ] ), resolution[ fields[ k ] ] );
+            }
+            const size_t at = out.size();
+            out.resize( at + field_count * ( sizeof( float ) + sizeof( int32_t ) ) );
+            for ( int k = 0; k < field_count; k++ )
+            {
+                memcpy( out.data() + at + k * sizeof( float ), &resolution[ fields[ k ] ], sizeof( float ) );
+            }
+            memcpy( out.data() + at + field_count * sizeof( float ), previous, field_count * sizeof( int32_t ) );
+        }
+        // 每个字段先求出全部 zigzag 差分与最大位宽, 再紧密打包
+        zigzag.resize( count );
+        for ( int k = 0; k < field_count; k++ )
+        {
+            const float field_resolution = resolution[ fields[ k ] ];
+            uint32_t    bits             = 0;
+            int32_t     last             = previous[ k ];
+            for ( int i = first; i < count; i++ )
+            {
+                const int32_t q = sensor_quantize( sensor_field( frames[ i ], fields[ k ] ), field_resolution );
+                zigzag[ i ]     = sensor_zigzag( ( uint32_t )q - ( uint32_t )last );
+                bits |= zigzag[ i ];
+                last = q;
+            }
+            previous[ k ]       = last;
+            const uint8_t width = bits == 0 ? 0 : ( uint8_t )( 32 - __builtin_clz( bits ) );
+            out.push_back( width );
+            //
+            uint64_t accumulator = 0;
+            int      filled      = 0;
+            for ( int i = first; i < count; i++ )
+            {
+                accumulator |= ( uint64_t )zigzag[ i ] << filled;
+                filled += width;
+                while ( filled >= 8 )
+                {
+                    out.push_back( ( uint8_t )accumulator );
+                    accumulator >>= 8;
+                    filled -= 8;
+                }
+            }
+            if ( filled > 0 )
+            {
+                out.push_back( ( uint8_t )accumulator );
+            }
+        }
+        out.insert( out.end(), sensor_delta_padding, 0 );
+        has_previous = true;
+    }
+};
+//
+struct SENSOR_DELTA_DECODER
+{
+    uint32_t mask = 0;
+    float    resolution[ sensor_field_count ];
+    int32_t  previous[ sensor_field_count ];
+    uint32_t next_sequence = 0;
+    bool     synced        = false;
+    int64_t  skipped       = 0;  // 等待关键帧期间丢弃的消息数
+    std::vector< int32_t > values;
+    //
+    void reset()
+    {
+        synced = false;
+    }
+    // 追加解码出的帧, 未包含的字段为 0. 数据不完整或尚未同步时返回 false. consumed 非空时写入消息的字节数 (含末尾补零),
+    // 供多条消息连续存放时定位下一条 (录制文件的块)
+    bool decode( const uint8_t* data, size_t size, std::vector< SENSOR_DB >& frames, uint32_t& frame_mask, size_t* consumed = nullptr )
+    {
+        SENSOR_DELTA_HEADER header;
+        if ( size < sizeof( header ) + sensor_delta_padding )
+        {
+            return false;
+        }
+        memcpy( &header, data, sizeof( header ) );
+        const bool key = ( header.flags & sensor_delta_keyframe ) != 0;
+        if ( header.type != sensor_binary_delta || header.count == 0 || ( ! key && ( ! synced || header.sequence != next_sequence || header.mask != mask ) ) )
+        {
+            synced = false;
+            skipped++;
+            return false;
+        }
+        size_t    offsets[ sensor_field_count ];
+        const int field_count = sensor_mask_offsets( header.mask, offsets );
+        const uint8_t* p      = data + sizeof( header );
+        const uint8_t* end    = data + size - sensor_delta_padding;
+        if ( key )
+        {
+            if ( p + field_count * ( sizeof( float ) + sizeof( int32_t ) ) > end )
+            {
+                synced = false;
+                return false;
+            }
+            memcpy( resolution, p, field_count * sizeof( float ) );
+            memcpy( previous, p + field_count * sizeof( float ), field_count * sizeof( int32_t ) );
+            p += field_count * ( sizeof( float ) + sizeof( int32_t ) );
+        }
+        //
+        const int    first  = key ? 1 : 0;
+        const int    deltas = header.count - first;
+        const size_t begin  = frames.size();
+        frames.resize( begin + header.count );
+        SENSOR_DB*             out = frames.data() + begin;
+        values.resize( header.count );
+        for ( int k = 0; k < field_count; k++ )
+        {
+            if ( p >= end )
+            {
+                frames.resize( begin );
+                synced = false;
+                return false;
+            }
+            const int    width = *p++;
+            const size_t bytes = ( ( size_t )width * deltas + 7 ) / 8;
+            if ( width > 32 || p + bytes > end )
+            {
+                frames.resize( begin );
+                synced = false;
+                return false;
+            }
+            // 定宽位解包: 每个值从所在字节起整字读取后移位, 无分支
+            const uint64_t value_mask = width == 0 ? 0 : ( ~0ull >> ( 64 - width ) );
+            uint32_t       last       = ( uint32_t )previous[ k ];
+            values[ 0 ]               = previous[ k ];
+            for ( int i = 0; i < deltas; i++ )
+            {
+                const size_t bit = ( size_t )i * width;
+                uint64_t     word;
+                memcpy( &word, p + ( bit >> 3 ), sizeof( word ) );
+                last += sensor_unzigzag( ( uint32_t )( ( word >> ( bit & 7 ) ) & value_mask ) );
+                values[ first + i ] = ( int32_t )last;
+            }
+            previous[ k ] = ( int32_t )last;
+            p += bytes;
+            //
+            // 大数值 (例如 time) 的量化值可能超出 float 的精确整数范围, 先在 double 中还原
+            const double scale  = resolution[ k ];
+            const size_t offset = offsets[ k ];
+            for ( int i = 0; i < header.count; i++ )
+            {
+                const float value = ( float )( values[ i ] * scale );
+                memcpy( ( char* )&out[ i ] + offset, &value, sizeof( float ) );
+            }
+        }
+        mask          = header.mask;
+        frame_mask    = header.mask & sensor_mask_all;
+        next_sequence = header.sequence + 1;
+        synced        = true;
+        if ( consumed != nullptr )
+        {
+            *consumed = ( size_t )( p - data ) + sensor_delta_padding;
+        }
+        return true;
+    }
+};
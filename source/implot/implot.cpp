@@ -161,6 +161,59 @@ ImPlotContext* GImPlot = nullptr;
 // Struct Implementations
 //-----------------------------------------------------------------------------
 
+// Upper bound on interned tick labels before the arena starts over
+static const int LABEL_ARENA_CAPACITY = 8192;
+
+ImPlotTick& ImPlotTicker::AddTick(double value, bool major, int level, bool show_label, ImPlotFormatter formatter, void* data) {
+    ImPlotTick tick(value, major, level, show_label);
+    if (show_label && formatter != nullptr) {
+        tick.TextOffset = TextBuffer.size();
+        // only the default formatter is known to be a pure function of (value, spec); time and user
+        // formatters may carry per-call state in their data, so they are always invoked
+        if (formatter == ImPlot::Formatter_Default && GImPlot != nullptr) {
+            ImPlotLabelArena& arena = GImPlot->LabelArena;
+            const char* spec        = (const char*)data;
+            const float font_size   = ImGui::GetFontSize();
+            ImFont* font            = ImGui::GetFont();
+            ImGuiID key = ImHashStr(spec);
+            key = ImHashData(&font, sizeof(font), key);
+            key = ImHashData(&font_size, sizeof(font_size), key);
+            key = ImHashData(&value, sizeof(value), key);
+            int idx = arena.Index.GetInt(key, 0) - 1;
+            // the key is only a hash: an entry for other inputs is replaced rather than shown
+            if (idx < 0 || !arena.Matches(arena.Entries[idx], value, spec, font, font_size)) {
+                if (arena.Count() >= LABEL_ARENA_CAPACITY)
+                    arena.Reset();
+                char buff[IMPLOT_LABEL_MAX_SIZE];
+                formatter(value, buff, sizeof(buff), data);
+                ImPlotLabelEntry entry;
+                entry.Value      = value;
+                entry.Font       = font;
+                entry.FontSize   = font_size;
+                entry.SpecOffset = arena.Text.size();
+                arena.Text.append(spec, spec + strlen(spec) + 1);
+                entry.TextOffset = arena.Text.size();
+                arena.Text.append(buff, buff + strlen(buff) + 1);
+                entry.Size = ImGui::CalcTextSize(buff);
+                idx = arena.Count();
+                arena.Entries.push_back(entry);
+                arena.Index.SetInt(key, idx + 1);
+            }
+            const ImPlotLabelEntry& entry = arena.Entries[idx];
+            const char* label = arena.Text.Buf.Data + entry.TextOffset;
+            TextBuffer.append(label, label + strlen(label) + 1);
+            tick.LabelSize = entry.Size;
+        }
+        else {
+            char buff[IMPLOT_LABEL_MAX_SIZE];
+            formatter(tick.PlotPos, buff, sizeof(buff), data);
+            TextBuffer.append(buff, buff + strlen(buff) + 1);
+            tick.LabelSize = ImGui::CalcTextSize(TextBuffer.Buf.Data + tick.TextOffset);
+        }
+    }
+    return AddTick(tick);
+}
+
 ImPlotInputMap::ImPlotInputMap() {
     ImPlot::MapInputDefault(this);
 }
@@ -437,6 +490,13 @@ void DestroyContext(ImPlotContext* ctx) {
         ctx = GImPlot;
     if (GImPlot == ctx)
         SetCurrentContext(nullptr);
+    if (ctx->TextureCallbacks.Destroy != nullptr) {
+        for (int i = 0; i < ctx->HeatmapTextures.GetBufSize(); ++i) {
+            ImPlotHeatmapTexture* heatmap = ctx->HeatmapTextures.GetByIndex(i);
+            if (heatmap->Texture != nullptr)
+                ctx->TextureCallbacks.Destroy(heatmap->Texture, ctx->TextureCallbacks.UserData);
+        }
+    }
     IM_DELETE(ctx);
 }
 
@@ -456,6 +516,10 @@ void Initialize(ImPlotContext* ctx) {
     ResetCtxForNextAlignedPlots(ctx);
     ResetCtxForNextSubplot(ctx);
 
+    ctx->ParallelFor      = nullptr;
+    ctx->ParallelForData  = nullptr;
+    ctx->ParallelMinPrims = 65536;
+
     const ImU32 Deep[]     = {4289753676, 4283598045, 4285048917, 4283584196, 4289950337, 4284512403, 4291005402, 4287401100, 4285839820, 4291671396                        };
     const ImU32 Dark[]     = {4280031972, 4290281015, 4283084621, 4288892568, 4278222847, 4281597951, 4280833702, 4290740727, 4288256409                                    };
     const ImU32 Pastel[]   = {4289639675, 4293119411, 4291161036, 4293184478, 4289124862, 4291624959, 4290631909, 4293712637, 4294111986                                    };
@@ -732,6 +796,68 @@ void Locator_Default(ImPlotTicker& ticker, const ImPlotRange& range, float pixel
     }
 }
 
+static inline bool TickerCacheMatches(const ImPlotTickerCache& cache, const ImPlotAxis& axis, float pixels, ImFont* font, float font_size) {
+    if (cache.Range.Min != axis.Range.Min || cache.Range.Max != axis.Range.Max || cache.Pixels != pixels)
+        return false;
+    if (cache.Scale != axis.Scale || cache.Locator != axis.Locator || cache.Formatter != axis.Formatter)
+        return false;
+    if (cache.Font != font || cache.FontSize != font_size)
+        return false;
+    // the default formatter points at each axis' own format spec, so compare the spec itself
+    if (axis.Formatter == Formatter_Default)
+        return strcmp(cache.FormatSpec, (const char*)axis.FormatterData) == 0;
+    return cache.FormatterData == axis.FormatterData;
+}
+
+// copies into the destination's existing capacity; ImVector::operator= frees and reallocates every time
+template <typename T>
+static inline void CopyIntoCapacity(ImVector<T>& dst, const ImVector<T>& src) {
+    dst.resize(src.Size);
+    if (src.Size > 0)
+        memcpy(dst.Data, src.Data, (size_t)src.Size * sizeof(T));
+}
+
+void LocateAxisTicks(ImPlotAxis& axis, float pixels) {
+    ImPlotContext& gp = *GImPlot;
+    // axes with custom ticks and time axes (whose formatter is stateful) always run their locator.
+    // scrolled axes (SetupAxisScroll) move every frame and would miss the cache every time, so they
+    // skip it too: their locator still runs, but most labels are found in the label arena and skip
+    // formatting and measuring
+    if (axis.Ticker.TickCount() > 0 || axis.Scale == ImPlotScale_Time || axis.Scrolled) {
+        axis.Locator(axis.Ticker, axis.Range, pixels, axis.Vertical, axis.Formatter, axis.FormatterData);
+        return;
+    }
+    ImFont* font          = ImGui::GetFont();
+    const float font_size = ImGui::GetFontSize();
+    ImPlotTickerCache* cache = &axis.TickerCache;
+    if (axis.LinkedMin != nullptr) {
+        const ImGuiID key = ImHashData(&axis.LinkedMin, sizeof(axis.LinkedMin), axis.Vertical ? 1 : 0);
+        cache = gp.SharedTickers.GetOrAddByKey(key);
+    }
+    if (!TickerCacheMatches(*cache, axis, pixels, font, font_size)) {
+        cache->Range         = axis.Range;
+        cache->Pixels        = pixels;
+        cache->Scale         = axis.Scale;
+        cache->Locator       = axis.Locator;
+        cache->Formatter     = axis.Formatter;
+        cache->FormatterData = axis.FormatterData;
+        cache->Font          = font;
+        cache->FontSize      = font_size;
+        if (axis.Formatter == Formatter_Default)
+            ImStrncpy(cache->FormatSpec, (const char*)axis.FormatterData, sizeof(cache->FormatSpec));
+        else
+            cache->FormatSpec[0] = '\0';
+        cache->Ticker.Reset();
+        axis.Locator(cache->Ticker, axis.Range, pixels, axis.Vertical, axis.Formatter, axis.FormatterData);
+    }
+    const ImPlotTicker& src = cache->Ticker;
+    CopyIntoCapacity(axis.Ticker.Ticks, src.Ticks);
+    CopyIntoCapacity(axis.Ticker.TextBuffer.Buf, src.TextBuffer.Buf);
+    axis.Ticker.Levels         = src.Levels;
+    axis.Ticker.MaxSize.x      = ImMax(axis.Ticker.MaxSize.x, src.MaxSize.x);
+    axis.Ticker.MaxSize.y      = ImMax(axis.Ticker.MaxSize.y, src.MaxSize.y);
+}
+
 bool CalcLogarithmicExponents(const ImPlotRange& range, float pix, bool vertical, int& exp_min, int& exp_max, int& exp_step) {
     if (range.Min * range.Max > 0) {
         const int nMajor = vertical ? ImMax(2, (int)IM_ROUND(pix * 0.02f)) : ImMax(2, (int)IM_ROUND(pix * 0.01f)); // TODO: magic numbers
@@ -2129,6 +2255,11 @@ void SetupAxisLimits(ImAxis idx, double min_lim, double max_lim, ImPlotCond cond
     axis.RangeCond = cond;
 }
 
+void SetupAxisScroll(ImAxis idx, double latest, double span) {
+    SetupAxisLimits(idx, latest - span, latest, ImPlotCond_Always);
+    GImPlot->CurrentPlot->Axes[idx].Scrolled = true;
+}
+
 void SetupAxisFormat(ImAxis idx, const char* fmt) {
     ImPlotContext& gp = *GImPlot;
     IM_ASSERT_USER_ERROR(gp.CurrentPlot != nullptr && !gp.CurrentPlot->SetupLocked,
@@ -2560,7 +2691,7 @@ void SetupFinish() {
     for (int i = 0; i < IMPLOT_NUM_Y_AXES; i++) {
         ImPlotAxis& axis = plot.YAxis(i);
         if (axis.WillRender() && axis.ShowDefaultTicks) {
-            axis.Locator(axis.Ticker, axis.Range, plot_height, true, axis.Formatter, axis.FormatterData);
+            LocateAxisTicks(axis, plot_height);
         }
     }
 
@@ -2573,7 +2704,7 @@ void SetupFinish() {
     for (int i = 0; i < IMPLOT_NUM_X_AXES; i++) {
         ImPlotAxis& axis = plot.XAxis(i);
         if (axis.WillRender() && axis.ShowDefaultTicks) {
-            axis.Locator(axis.Ticker, axis.Range, plot_width, false, axis.Formatter, axis.FormatterData);
+            LocateAxisTicks(axis, plot_width);
         }
     }
 
@@ -4748,6 +4879,19 @@ void PopPlotClipRect() {
     ImGui::PopClipRect();
 }
 
+void SetTextureCallbacks(const ImPlotTextureCallbacks& callbacks) {
+    IM_ASSERT_USER_ERROR(GImPlot != nullptr, "No current context. Did you call ImPlot::CreateContext() or ImPlot::SetCurrentContext()?");
+    GImPlot->TextureCallbacks = callbacks;
+}
+
+void SetParallelFor(ImPlotParallelFor parallel_for, void* user_data, int min_prims) {
+    IM_ASSERT_USER_ERROR(GImPlot != nullptr, "No current context. Did you call ImPlot::CreateContext() or ImPlot::SetCurrentContext()?");
+    ImPlotContext& gp = *GImPlot;
+    gp.ParallelFor      = parallel_for;
+    gp.ParallelForData  = user_data;
+    gp.ParallelMinPrims = ImMax(min_prims, 1);
+}
+
 static void HelpMarker(const char* desc) {
     ImGui::TextDisabled("(?)");
     if (ImGui::IsItemHovered()) {
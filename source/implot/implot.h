@@ -588,6 +588,25 @@ typedef ImPlotPoint (*ImPlotGetter)(int idx, void* user_data);
 // Callback signature for axis transform.
 typedef double (*ImPlotTransform)(double value, void* user_data);
 
+// Callbacks backing texture heatmaps (see PlotHeatmapTexture). Textures are RGBA8 and sampled with nearest filtering; texture
+// coordinates never leave [0,1], so any addressing mode works. Create returns an opaque handle for a #width x #height texture, Update uploads the #w x #h rectangle at
+// (#x,#y) from #pixels (row pitch #w), GetID returns the ImTextureID to draw it with and Destroy releases it.
+struct ImPlotTextureCallbacks {
+    void*       (*Create)(int width, int height, void* user_data);
+    void        (*Update)(void* texture, int x, int y, int w, int h, const ImU32* pixels, void* user_data);
+    ImTextureID (*GetID)(void* texture, void* user_data);
+    void        (*Destroy)(void* texture, void* user_data);
+    void*       UserData;
+    ImPlotTextureCallbacks() { Create = nullptr; Update = nullptr; GetID = nullptr; Destroy = nullptr; UserData = nullptr; }
+};
+
+// Callback signature for a unit of parallel work over [begin, end).
+typedef void (*ImPlotParallelTask)(int begin, int end, void* task_data);
+
+// Callback signature for a parallel-for. It must call #task over every index of [0, count) exactly once, possibly split
+// into ranges on several threads, and return only when all of them have completed.
+typedef void (*ImPlotParallelFor)(int count, ImPlotParallelTask task, void* task_data, void* user_data);
+
 namespace ImPlot {
 
 //-----------------------------------------------------------------------------
@@ -744,6 +763,10 @@ IMPLOT_API void SetupAxisTicks(ImAxis axis, double v_min, double v_max, int n_ti
 IMPLOT_API void SetupAxisScale(ImAxis axis, ImPlotScale scale);
 // Sets an axis' scale using user supplied forward and inverse transfroms.
 IMPLOT_API void SetupAxisScale(ImAxis axis, ImPlotTransform forward, ImPlotTransform inverse, void* data=nullptr);
+// Scrolls an axis to show the #span units that end at #latest (e.g. the newest timestamp of a ring plot) and locks it there.
+// Scrolled axes bypass the located-tick cache, since their range changes every frame.
+// The axis is not fitted, so do not combine this with ImPlotAxisFlags_AutoFit on the same axis.
+IMPLOT_API void SetupAxisScroll(ImAxis axis, double latest, double span);
 // Sets an axis' limits constraints.
 IMPLOT_API void SetupAxisLimitsConstraints(ImAxis axis, double v_min, double v_max);
 // Sets an axis' zoom constraints.
@@ -865,6 +888,15 @@ IMPLOT_TMP void PlotStairs(const char* label_id, const T* values, int count, dou
 IMPLOT_TMP void PlotStairs(const char* label_id, const T* xs, const T* ys, int count, ImPlotStairsFlags flags=0, int offset=0, int stride=sizeof(T));
 IMPLOT_API void PlotStairsG(const char* label_id, ImPlotGetter getter, void* data, int count, ImPlotStairsFlags flags=0);
 
+// Ring (streaming) variants of PlotLine and PlotStairs. Samples live in a circular buffer of #capacity slots. #tail and #head are
+// running sample counters that never wrap: samples [tail, head) are plotted, sample i is stored in slot i % capacity, and
+// head - tail must not exceed capacity. Samples must not change once written. Fit extents are cached per item and updated only
+// for the samples that entered or left the window since the last fit. Without #xs, sample i is plotted at x = xstart + i * xscale.
+IMPLOT_TMP void PlotLineRing(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, double xscale=1, double xstart=0, ImPlotLineFlags flags=0, int stride=sizeof(T));
+IMPLOT_TMP void PlotLineRing(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, ImPlotLineFlags flags=0, int stride=sizeof(T));
+IMPLOT_TMP void PlotStairsRing(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, double xscale=1, double xstart=0, ImPlotStairsFlags flags=0, int stride=sizeof(T));
+IMPLOT_TMP void PlotStairsRing(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, ImPlotStairsFlags flags=0, int stride=sizeof(T));
+
 // Plots a shaded (filled) region between two lines, or a line and a horizontal reference. Set yref to +/-INFINITY for infinite fill extents.
 IMPLOT_TMP void PlotShaded(const char* label_id, const T* values, int count, double yref=0, double xscale=1, double xstart=0, ImPlotShadedFlags flags=0, int offset=0, int stride=sizeof(T));
 IMPLOT_TMP void PlotShaded(const char* label_id, const T* xs, const T* ys, int count, double yref=0, ImPlotShadedFlags flags=0, int offset=0, int stride=sizeof(T));
@@ -896,6 +928,12 @@ IMPLOT_TMP void PlotPieChart(const char* const label_ids[], const T* values, int
 // Plots a 2D heatmap chart. Values are expected to be in row-major order by default. Leave #scale_min and scale_max both at 0 for automatic color scaling, or set them to a predefined range. #label_fmt can be set to nullptr for no labels.
 IMPLOT_TMP void PlotHeatmap(const char* label_id, const T* values, int rows, int cols, double scale_min=0, double scale_max=0, const char* label_fmt="%.1f", const ImPlotPoint& bounds_min=ImPlotPoint(0,0), const ImPlotPoint& bounds_max=ImPlotPoint(1,1), ImPlotHeatmapFlags flags=0);
 
+// Plots a 2D heatmap by color mapping #values into a texture drawn as a single quad, so cost does not depend on the cell count (requires
+// SetTextureCallbacks). #values holds #cols columns of #rows values each, column c starting at values + c*rows, used as a ring whose
+// oldest column #head is drawn at bounds_min.x. Only the #dirty_count columns from #dirty_begin (wrapping) are uploaded, unless the size,
+// colormap or scale changed; pass -1 to upload all of them. Prefer fixed #scale_min/#scale_max for scrolling data.
+IMPLOT_TMP void PlotHeatmapTexture(const char* label_id, const T* values, int rows, int cols, int head=0, int dirty_begin=0, int dirty_count=-1, double scale_min=0, double scale_max=0, const ImPlotPoint& bounds_min=ImPlotPoint(0,0), const ImPlotPoint& bounds_max=ImPlotPoint(1,1));
+
 // Plots a horizontal histogram. #bins can be a positive integer or an ImPlotBin_ method. If #range is left unspecified, the min/max of #values will be used as the range.
 // Otherwise, outlier values outside of the range are not binned. The largest bin count or density is returned.
 IMPLOT_TMP double PlotHistogram(const char* label_id, const T* values, int count, int bins=ImPlotBin_Sturges, double bar_scale=1.0, ImPlotRange range=ImPlotRange(), ImPlotHistogramFlags flags=0);
@@ -904,6 +942,13 @@ IMPLOT_TMP double PlotHistogram(const char* label_id, const T* values, int count
 // #xs an #ys will be used as the ranges. Otherwise, outlier values outside of range are not binned. The largest bin count or density is returned.
 IMPLOT_TMP double PlotHistogram2D(const char* label_id, const T* xs, const T* ys, int count, int x_bins=ImPlotBin_Sturges, int y_bins=ImPlotBin_Sturges, ImPlotRect range=ImPlotRect(), ImPlotHistogramFlags flags=0);
 
+// Streaming versions of PlotHistogram and PlotHistogram2D over the ring window [#tail, #head) (see PlotLineRing). Bin counts persist between frames and
+// only the samples that entered or left the window are counted, so the cost per frame does not depend on the window size. ImPlotBin_ methods are
+// resolved against #capacity (Scott falls back to Sturges). Automatic ranges are padded by 5% and rebinned only when the window leaves them or
+// shrinks below half of them.
+IMPLOT_TMP double PlotHistogramRing(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, int bins=ImPlotBin_Sturges, double bar_scale=1.0, ImPlotRange range=ImPlotRange(), ImPlotHistogramFlags flags=0, int stride=sizeof(T));
+IMPLOT_TMP double PlotHistogram2DRing(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, int x_bins=ImPlotBin_Sturges, int y_bins=ImPlotBin_Sturges, ImPlotRect range=ImPlotRect(), ImPlotHistogramFlags flags=0, int stride=sizeof(T));
+
 // Plots digital data. Digital plots do not respond to y drag or zoom, and are always referenced to the bottom of the plot.
 IMPLOT_TMP void PlotDigital(const char* label_id, const T* xs, const T* ys, int count, ImPlotDigitalFlags flags=0, int offset=0, int stride=sizeof(T));
 IMPLOT_API void PlotDigitalG(const char* label_id, ImPlotGetter getter, void* data, int count, ImPlotDigitalFlags flags=0);
@@ -1117,6 +1162,9 @@ IMPLOT_API void SetNextFillStyle(const ImVec4& col = IMPLOT_AUTO_COL, float alph
 IMPLOT_API void SetNextMarkerStyle(ImPlotMarker marker = IMPLOT_AUTO, float size = IMPLOT_AUTO, const ImVec4& fill = IMPLOT_AUTO_COL, float weight = IMPLOT_AUTO, const ImVec4& outline = IMPLOT_AUTO_COL);
 // Set the error bar style for the next item only.
 IMPLOT_API void SetNextErrorBarStyle(const ImVec4& col = IMPLOT_AUTO_COL, float size = IMPLOT_AUTO, float weight = IMPLOT_AUTO);
+// Set the data revision of the next ring plot item only. Cached ring fits and histogram counts are rebuilt when it changes,
+// e.g. after the ring buffer was reallocated, possibly at the same address.
+IMPLOT_API void SetNextRingRevision(ImU64 revision);
 
 // Gets the last item primary color (i.e. its legend icon color)
 IMPLOT_API ImVec4 GetLastItemColor();
@@ -1220,6 +1268,14 @@ IMPLOT_API void PushPlotClipRect(float expand=0);
 // Pop plot clip rect. Call between Begin/EndPlot.
 IMPLOT_API void PopPlotClipRect();
 
+// Installs a parallel-for used to generate the vertices of line, stairs, bar and marker series with at least #min_prims
+// primitives on several threads. Output is identical to the single-threaded path. Getters and axis transforms of such
+// series must be safe to call concurrently. Pass nullptr to render single-threaded (the default).
+IMPLOT_API void SetParallelFor(ImPlotParallelFor parallel_for, void* user_data=nullptr, int min_prims=65536);
+
+// Installs the callbacks that create and upload textures for PlotHeatmapTexture.
+IMPLOT_API void SetTextureCallbacks(const ImPlotTextureCallbacks& callbacks);
+
 // Shows ImPlot style selector dropdown menu.
 IMPLOT_API bool ShowStyleSelector(const char* label);
 // Shows ImPlot colormap selector dropdown menu.
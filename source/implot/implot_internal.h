@@ -572,17 +572,8 @@ struct ImPlotTicker {
         return AddTick(tick);
     }
 
-    ImPlotTick& AddTick(double value, bool major, int level, bool show_label, ImPlotFormatter formatter, void* data) {
-        ImPlotTick tick(value, major, level, show_label);
-        if (show_label && formatter != nullptr) {
-            char buff[IMPLOT_LABEL_MAX_SIZE];
-            tick.TextOffset = TextBuffer.size();
-            formatter(tick.PlotPos, buff, sizeof(buff), data);
-            TextBuffer.append(buff, buff + strlen(buff) + 1);
-            tick.LabelSize = ImGui::CalcTextSize(TextBuffer.Buf.Data + tick.TextOffset);
-        }
-        return AddTick(tick);
-    }
+    // labels from the default formatter are interned in the context's ImPlotLabelArena (see implot.cpp)
+    ImPlotTick& AddTick(double value, bool major, int level, bool show_label, ImPlotFormatter formatter, void* data);
 
     inline ImPlotTick& AddTick(ImPlotTick tick) {
         if (tick.ShowLabel) {
@@ -620,6 +611,61 @@ struct ImPlotTicker {
     }
 };
 
+// One interned label with the inputs that produced it; a lookup only hits when all of them match,
+// so a collision of the 32-bit key costs a reformat instead of showing another value's label
+struct ImPlotLabelEntry {
+    double  Value;
+    ImFont* Font;
+    float   FontSize;
+    int     SpecOffset;   // format spec in ImPlotLabelArena::Text
+    int     TextOffset;   // formatted label in ImPlotLabelArena::Text
+    ImVec2  Size;
+};
+
+// Formatted tick labels interned per context, so a label seen in an earlier frame is neither formatted nor measured again
+struct ImPlotLabelArena {
+    ImGuiStorage               Index;   // label key -> 1 + entry index
+    ImVector<ImPlotLabelEntry> Entries;
+    ImGuiTextBuffer            Text;
+
+    int  Count() const { return Entries.Size; }
+    bool Matches(const ImPlotLabelEntry& entry, double value, const char* spec, ImFont* font, float font_size) const {
+        return entry.Value == value && entry.Font == font && entry.FontSize == font_size && strcmp(Text.Buf.Data + entry.SpecOffset, spec) == 0;
+    }
+    void Reset() {
+        Index.Clear();
+        Entries.shrink(0);
+        Text.Buf.shrink(0);
+    }
+};
+
+// Located ticks memoised with the inputs that produced them. Each axis keeps one across frames,
+// and linked axes share one from the context so a link group is located once.
+struct ImPlotTickerCache {
+    ImPlotRange     Range;
+    float           Pixels;
+    ImPlotScale     Scale;
+    ImPlotLocator   Locator;
+    ImPlotFormatter Formatter;
+    void*           FormatterData;
+    char            FormatSpec[16];
+    ImFont*         Font;
+    float           FontSize;
+    ImPlotTicker    Ticker;
+
+    ImPlotTickerCache() {
+        Range         = ImPlotRange(0,0);
+        Pixels        = 0;
+        Scale         = ImPlotScale_Linear;
+        Locator       = nullptr;
+        Formatter     = nullptr;
+        FormatterData = nullptr;
+        FormatSpec[0] = '\0';
+        Font          = nullptr;
+        FontSize      = 0;
+    }
+};
+
 // Axis state information that must persist after EndPlot
 struct ImPlotAxis
 {
@@ -635,6 +681,7 @@ struct ImPlotAxis
     ImPlotRange          ConstraintZoom;
 
     ImPlotTicker         Ticker;
+    ImPlotTickerCache    TickerCache;
     ImPlotFormatter      Formatter;
     void*                FormatterData;
     char                 FormatSpec[16];
@@ -662,6 +709,7 @@ struct ImPlotAxis
     bool                 Vertical;
     bool                 FitThisFrame;
     bool                 HasRange;
+    bool                 Scrolled;
     bool                 HasFormatSpec;
     bool                 ShowDefaultTicks;
     bool                 Hovered;
@@ -690,7 +738,7 @@ struct ImPlotAxis
         Formatter        = nullptr;
         FormatterData    = nullptr;
         Locator          = nullptr;
-        Enabled          = Hovered = Held = FitThisFrame = HasRange = HasFormatSpec = false;
+        Enabled          = Hovered = Held = FitThisFrame = HasRange = Scrolled = HasFormatSpec = false;
         ShowDefaultTicks = true;
     }
 
@@ -700,6 +748,7 @@ struct ImPlotAxis
         TransformForward = TransformInverse = nullptr;
         TransformData    = nullptr;
         LabelOffset      = -1;
+        Scrolled         = false;
         HasFormatSpec    = false;
         Formatter        = nullptr;
         FormatterData    = nullptr;
@@ -958,6 +1007,120 @@ struct ImPlotItem
     ~ImPlotItem() { ID = 0; }
 };
 
+// One sample of a ring plot's sliding-window extremum
+struct ImPlotRingSample {
+    ImS64  Idx;
+    double Value;
+};
+
+// Monotonic deque giving the min (or max) of a sliding window in amortised O(1) per sample
+struct ImPlotRingExtremum {
+    ImVector<ImPlotRingSample> Buf;
+    int                        Front;
+    int                        Size;
+    bool                       IsMax;
+
+    ImPlotRingExtremum() { Front = Size = 0; IsMax = false; }
+
+    ImPlotRingSample& At(int i) {
+        int j = Front + i;
+        return Buf[j >= Buf.Size ? j - Buf.Size : j];
+    }
+    void Clear() { Front = Size = 0; }
+    void Push(ImS64 idx, double value) {
+        while (Size > 0 && (IsMax ? At(Size-1).Value <= value : At(Size-1).Value >= value))
+            --Size;
+        if (Size == Buf.Size) {
+            // grow and unwrap so the deque stays contiguous from Front
+            ImVector<ImPlotRingSample> grown;
+            grown.resize(ImMax(16, Buf.Size * 2));
+            for (int i = 0; i < Size; ++i)
+                grown[i] = At(i);
+            Buf.swap(grown);
+            Front = 0;
+        }
+        ImPlotRingSample& back = At(Size++);
+        back.Idx   = idx;
+        back.Value = value;
+    }
+    void PopBefore(ImS64 tail) {
+        while (Size > 0 && At(0).Idx < tail) {
+            Front = Front + 1 == Buf.Size ? 0 : Front + 1;
+            --Size;
+        }
+    }
+    bool   Empty() const { return Size == 0; }
+    double Value() { return At(0).Value; }
+};
+
+// Cached fit extents of one ring plot item, advanced with the samples that entered and left the window
+struct ImPlotRingFit {
+    const void*        DataX;
+    const void*        DataY;
+    ImU64              Revision;  // SetNextRingRevision() of the data, a reallocated buffer may reuse the same address
+    double             XScale, XStart;
+    int                Capacity;
+    ImS64              Head, Tail;
+    bool               Valid;
+    ImPlotRingExtremum MinX, MaxX, MinY, MaxY;
+
+    ImPlotRingFit() {
+        DataX = DataY = nullptr;
+        Revision = 0;
+        XScale = XStart = 0;
+        Capacity = 0;
+        Head = Tail = 0;
+        Valid = false;
+        MaxX.IsMax = MaxY.IsMax = true;
+    }
+};
+
+// Bin counts of one ring histogram item, advanced with the samples that entered and left the window. Each ring slot remembers
+// the bin its sample was counted in, so samples can be removed after their slot has been overwritten.
+struct ImPlotRingHistogram {
+    const void*        DataX;
+    const void*        DataY;
+    ImU64              Revision;  // see ImPlotRingFit::Revision
+    int                Capacity;
+    int                Stride;
+    ImS64              Head, Tail;
+    int                BinsX, BinsY;
+    ImPlotRect         Range;     // binned range (Y unused by 1D histograms)
+    ImVector<int>      Counts;    // BinsX * BinsY counts, row y major
+    ImVector<int>      SlotBins;  // bin of the sample in each ring slot, -1 below Range.X, -2 otherwise outside, -3 NaN or infinite
+    int                Below;     // samples below Range.X
+    int                Counted;   // samples inside Range
+    int                Skipped;   // NaN or infinite samples, excluded from the extents and from density normalization
+    bool               Valid;
+    ImPlotRingExtremum MinX, MaxX, MinY, MaxY;
+
+    ImPlotRingHistogram() {
+        DataX = DataY = nullptr;
+        Revision = 0;
+        Capacity = Stride = 0;
+        Head = Tail = 0;
+        BinsX = BinsY = 0;
+        Below = Counted = Skipped = 0;
+        Valid = false;
+        MaxX.IsMax = MaxY.IsMax = true;
+    }
+};
+
+// Texture of one texture heatmap item and the parameters its pixels were mapped with
+struct ImPlotHeatmapTexture {
+    void*          Texture;
+    int            Width, Height;
+    ImPlotColormap Colormap;
+    double         ScaleMin, ScaleMax;
+
+    ImPlotHeatmapTexture() {
+        Texture = nullptr;
+        Width = Height = 0;
+        Colormap = -1;
+        ScaleMin = ScaleMax = 0;
+    }
+};
+
 // Holds Legend state
 struct ImPlotLegend
 {
@@ -1187,6 +1350,7 @@ struct ImPlotNextItemData {
     bool            HasHidden;
     bool            Hidden;
     ImPlotCond      HiddenCond;
+    ImU64           RingRevision;
     ImPlotNextItemData() { Reset(); }
     void Reset() {
         for (int i = 0; i < 5; ++i)
@@ -1194,6 +1358,7 @@ struct ImPlotNextItemData {
         LineWeight    = MarkerSize = MarkerWeight = FillAlpha = ErrorBarSize = ErrorBarWeight = DigitalBitHeight = DigitalBitGap = IMPLOT_AUTO;
         Marker        = IMPLOT_AUTO;
         HasHidden     = Hidden = false;
+        RingRevision  = 0;
     }
 };
 
@@ -1209,7 +1374,28 @@ struct ImPlotContext {
     ImPlotItem*           PreviousItem;
 
     // Tick Marks and Labels
-    ImPlotTicker CTicker;
+    ImPlotTicker              CTicker;
+    ImPool<ImPlotTickerCache> SharedTickers;
+    ImPlotLabelArena          LabelArena;
+
+    // Ring plot fit caches, keyed by item ID
+    ImPool<ImPlotRingFit> RingFits;
+
+    // Ring histograms, keyed by label ID
+    ImPool<ImPlotRingHistogram> RingHistograms;
+
+    // Texture heatmaps, keyed by item ID (see SetTextureCallbacks)
+    ImPlotTextureCallbacks       TextureCallbacks;
+    ImPool<ImPlotHeatmapTexture> HeatmapTextures;
+    ImVector<ImU32>              HeatmapPixels;
+
+    // Parallel primitive generation (see SetParallelFor)
+    ImPlotParallelFor  ParallelFor;
+    void*              ParallelForData;
+    int                ParallelMinPrims;
+    ImVector<ImDrawVert> ParallelVtx;
+    ImVector<ImDrawIdx>  ParallelIdx;
+    ImVector<int>        ParallelCounts;
 
     // Annotation and Tabs
     ImPlotAnnotationCollection Annotations;
@@ -1664,4 +1850,7 @@ void Locator_Time(ImPlotTicker& ticker, const ImPlotRange& range, float pixels,
 void Locator_Log10(ImPlotTicker& ticker, const ImPlotRange& range, float pixels, bool vertical, ImPlotFormatter formatter, void* formatter_data);
 void Locator_SymLog(ImPlotTicker& ticker, const ImPlotRange& range, float pixels, bool vertical, ImPlotFormatter formatter, void* formatter_data);
 
+// Runs an axis' locator unless its memoised ticks (or those of an axis linked to the same range) are still valid
+void LocateAxisTicks(ImPlotAxis& axis, float pixels);
+
 } // namespace ImPlot
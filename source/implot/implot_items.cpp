@@ -347,6 +347,11 @@ void SetNextErrorBarStyle(const ImVec4& col, float size, float weight) {
     gp.NextItemData.ErrorBarWeight             = weight;
 }
 
+void SetNextRingRevision(ImU64 revision) {
+    ImPlotContext& gp = *GImPlot;
+    gp.NextItemData.RingRevision = revision;
+}
+
 ImVec4 GetLastItemColor() {
     ImPlotContext& gp = *GImPlot;
     if (gp.PreviousItem)
@@ -551,6 +556,27 @@ struct IndexerConst {
     const double Ref;
 };
 
+// Indexes a circular buffer starting at running sample counter #tail, i.e. idx 0 is the oldest sample in the window
+template <typename T>
+struct IndexerRing {
+    IndexerRing(const T* data, int capacity, ImS64 tail, int stride = sizeof(T)) :
+        Data(data),
+        Capacity(capacity),
+        Start(capacity ? (int)(tail % capacity) : 0),
+        Stride(stride)
+    { }
+    template <typename I> IMPLOT_INLINE double operator()(I idx) const {
+        int slot = Start + (int)idx;
+        if (slot >= Capacity)
+            slot -= Capacity;
+        return (double)*(const T*)(const void*)((const unsigned char*)Data + (size_t)slot * Stride);
+    }
+    const T* Data;
+    int Capacity;
+    int Start;
+    int Stride;
+};
+
 //-----------------------------------------------------------------------------
 // [SECTION] Getters
 //-----------------------------------------------------------------------------
@@ -685,6 +711,83 @@ struct FitterY {
     const _Getter1& Getter;
 };
 
+// Fits a ring plot from its cached sliding-window extrema (see ImPlotRingFit). Axes whose fit depends on state
+// the cache cannot see (range fit, limit constraints) scan the whole window instead.
+template <typename _Getter1>
+struct FitterRing {
+    FitterRing(const _Getter1& getter, const void* xs, const void* ys, double xscale, double xstart, int capacity, ImS64 head, ImS64 tail) :
+        Getter(getter),
+        DataX(xs),
+        DataY(ys),
+        XScale(xscale),
+        XStart(xstart),
+        Capacity(capacity),
+        Head(head),
+        Tail(tail)
+    { }
+    static bool IsUnconstrained(const ImPlotAxis& axis) {
+        return !ImHasFlag(axis.Flags, ImPlotAxisFlags_RangeFit) && axis.ConstraintRange.Min == -INFINITY && axis.ConstraintRange.Max == INFINITY;
+    }
+    void Fit(ImPlotAxis& x_axis, ImPlotAxis& y_axis) const {
+        ImPlotContext& gp = *GImPlot;
+        if (!IsUnconstrained(x_axis) || !IsUnconstrained(y_axis) || gp.CurrentItem == nullptr) {
+            Fitter1<_Getter1>(Getter).Fit(x_axis, y_axis);
+            return;
+        }
+        ImPlotRingFit& fit = *gp.RingFits.GetOrAddByKey(gp.CurrentItem->ID);
+        const ImU64 revision = gp.NextItemData.RingRevision;
+        const bool advance = fit.Valid && fit.DataX == DataX && fit.DataY == DataY && fit.Revision == revision && fit.XScale == XScale
+                          && fit.XStart == XStart && fit.Capacity == Capacity && Tail >= fit.Tail && Head >= fit.Head;
+        ImS64 from = Tail;
+        if (advance) {
+            // samples before fit.Head are already in the deques
+            from = ImMax(fit.Head, Tail);
+        }
+        else {
+            fit.MinX.Clear(); fit.MaxX.Clear();
+            fit.MinY.Clear(); fit.MaxY.Clear();
+        }
+        fit.MinX.PopBefore(Tail); fit.MaxX.PopBefore(Tail);
+        fit.MinY.PopBefore(Tail); fit.MaxY.PopBefore(Tail);
+        for (ImS64 i = from; i < Head; ++i) {
+            ImPlotPoint p = Getter((int)(i - Tail));
+            if (!ImNanOrInf(p.x)) {
+                fit.MinX.Push(i, p.x);
+                fit.MaxX.Push(i, p.x);
+            }
+            if (!ImNanOrInf(p.y)) {
+                fit.MinY.Push(i, p.y);
+                fit.MaxY.Push(i, p.y);
+            }
+        }
+        fit.DataX    = DataX;
+        fit.DataY    = DataY;
+        fit.Revision = revision;
+        fit.XScale   = XScale;
+        fit.XStart   = XStart;
+        fit.Capacity = Capacity;
+        fit.Head     = Head;
+        fit.Tail     = Tail;
+        fit.Valid    = true;
+        if (!fit.MinX.Empty()) {
+            x_axis.ExtendFit(fit.MinX.Value());
+            x_axis.ExtendFit(fit.MaxX.Value());
+        }
+        if (!fit.MinY.Empty()) {
+            y_axis.ExtendFit(fit.MinY.Value());
+            y_axis.ExtendFit(fit.MaxY.Value());
+        }
+    }
+    const _Getter1& Getter;
+    const void* DataX;
+    const void* DataY;
+    const double XScale;
+    const double XStart;
+    const int Capacity;
+    const ImS64 Head;
+    const ImS64 Tail;
+};
+
 template <typename _Getter1, typename _Getter2>
 struct Fitter2 {
     Fitter2(const _Getter1& getter1, const _Getter2& getter2) : Getter1(getter1), Getter2(getter2) { }
@@ -858,6 +961,8 @@ struct RendererBase {
     Transformer2 Transformer;
     const int IdxConsumed;
     const int VtxConsumed;
+    // Whether the renderer's state at any primitive can be rebuilt by rendering only the one before it (required to split it into chunks)
+    static const bool Chunkable = true;
 };
 
 template <class _Getter>
@@ -901,6 +1006,8 @@ struct RendererLineStripSkip : RendererBase {
     {
         P1 = this->Transformer(Getter(0));
     }
+    // P1 is the last non-NaN point, which may lie arbitrarily far behind a chunk start
+    static const bool Chunkable = false;
     void Init(ImDrawList& draw_list) const {
         GetLineRenderProps(draw_list, HalfWeight, UV0, UV1);
     }
@@ -1356,9 +1463,110 @@ struct RendererRectC : RendererBase {
 // [SECTION] RenderPrimitives
 //-----------------------------------------------------------------------------
 
+// Primitives generated per parallel chunk.
+static const int PARALLEL_CHUNK_PRIMS = 16384;
+
+/// Renders one chunk of primitives per index into the context's scratch buffers. Vertex indices are relative to the chunk.
+template <class _Renderer>
+struct PrimitiveChunks {
+    const _Renderer* Renderer;
+    const ImDrawList* DrawList;
+    const ImRect* CullRect;
+    int ChunkPrims;
+    ImDrawVert* Vtx;
+    ImDrawIdx* Idx;
+    int* Counts;
+
+    static void Run(int begin, int end, void* task_data) {
+        const PrimitiveChunks& task = *(const PrimitiveChunks*)task_data;
+        ImDrawList proxy(task.DrawList->_Data);
+        proxy.Flags = task.DrawList->Flags;
+        for (int chunk = begin; chunk < end; ++chunk) {
+            _Renderer renderer(*task.Renderer);
+            renderer.Init(proxy);
+            const int first = chunk * task.ChunkPrims;
+            const int last  = ImMin(first + task.ChunkPrims, task.Renderer->Prims);
+            ImDrawVert* vtx = task.Vtx + (size_t)first * renderer.VtxConsumed;
+            ImDrawIdx*  idx = task.Idx + (size_t)first * renderer.IdxConsumed;
+            // bring stateful renderers (strips, stairs, shaded) up to the chunk start; the output is overwritten below
+            if (first > 0) {
+                proxy._VtxWritePtr   = vtx;
+                proxy._IdxWritePtr   = idx;
+                proxy._VtxCurrentIdx = 0;
+                renderer.Render(proxy, *task.CullRect, first - 1);
+            }
+            proxy._VtxWritePtr   = vtx;
+            proxy._IdxWritePtr   = idx;
+            proxy._VtxCurrentIdx = 0;
+            int rendered = 0;
+            for (int prim = first; prim < last; ++prim) {
+                if (renderer.Render(proxy, *task.CullRect, prim))
+                    rendered++;
+            }
+            task.Counts[chunk] = rendered;
+        }
+        proxy._VtxWritePtr = nullptr;
+        proxy._IdxWritePtr = nullptr;
+    }
+};
+
+/// Renders primitives in chunks through the context's parallel-for, then appends the chunks to the draw list in order.
+template <class _Renderer>
+void RenderPrimitivesParallel(const _Renderer& renderer, ImDrawList& draw_list, const ImRect& cull_rect) {
+    ImPlotContext& gp = *GImPlot;
+    const unsigned int vtx_consumed = renderer.VtxConsumed;
+    const unsigned int idx_consumed = renderer.IdxConsumed;
+    // chunk-relative indices have to fit ImDrawIdx
+    const int chunk_prims = (int)ImMin((unsigned int)PARALLEL_CHUNK_PRIMS, MaxIdx<ImDrawIdx>::Value / vtx_consumed);
+    const int chunks      = (renderer.Prims + chunk_prims - 1) / chunk_prims;
+    gp.ParallelVtx.resize(renderer.Prims * renderer.VtxConsumed);
+    gp.ParallelIdx.resize(renderer.Prims * renderer.IdxConsumed);
+    gp.ParallelCounts.resize(chunks);
+
+    PrimitiveChunks<_Renderer> task;
+    task.Renderer   = &renderer;
+    task.DrawList   = &draw_list;
+    task.CullRect   = &cull_rect;
+    task.ChunkPrims = chunk_prims;
+    task.Vtx        = gp.ParallelVtx.Data;
+    task.Idx        = gp.ParallelIdx.Data;
+    task.Counts     = gp.ParallelCounts.Data;
+    gp.ParallelFor(chunks, &PrimitiveChunks<_Renderer>::Run, &task, gp.ParallelForData);
+
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        const ImDrawVert* vtx = task.Vtx + (size_t)chunk * chunk_prims * vtx_consumed;
+        const ImDrawIdx*  idx = task.Idx + (size_t)chunk * chunk_prims * idx_consumed;
+        unsigned int prims    = (unsigned int)gp.ParallelCounts[chunk];
+        unsigned int vtx_base = 0;
+        while (prims) {
+            // same reservation policy as RenderPrimitivesEx
+            unsigned int cnt = ImMin(prims, (MaxIdx<ImDrawIdx>::Value - draw_list._VtxCurrentIdx) / vtx_consumed);
+            if (cnt < ImMin(64u, prims))
+                cnt = ImMin(prims, MaxIdx<ImDrawIdx>::Value / vtx_consumed);
+            draw_list.PrimReserve(cnt * idx_consumed, cnt * vtx_consumed);
+            memcpy(draw_list._VtxWritePtr, vtx, cnt * vtx_consumed * sizeof(ImDrawVert));
+            const unsigned int offset = draw_list._VtxCurrentIdx - vtx_base;
+            for (unsigned int i = 0; i < cnt * idx_consumed; ++i)
+                draw_list._IdxWritePtr[i] = (ImDrawIdx)(idx[i] + offset);
+            draw_list._VtxWritePtr   += cnt * vtx_consumed;
+            draw_list._IdxWritePtr   += cnt * idx_consumed;
+            draw_list._VtxCurrentIdx += cnt * vtx_consumed;
+            vtx      += cnt * vtx_consumed;
+            idx      += cnt * idx_consumed;
+            vtx_base += cnt * vtx_consumed;
+            prims    -= cnt;
+        }
+    }
+}
+
 /// Renders primitive shapes in bulk as efficiently as possible.
 template <class _Renderer>
 void RenderPrimitivesEx(const _Renderer& renderer, ImDrawList& draw_list, const ImRect& cull_rect) {
+    ImPlotContext& gp = *GImPlot;
+    if (_Renderer::Chunkable && gp.ParallelFor != nullptr && renderer.Prims >= gp.ParallelMinPrims && renderer.Prims > PARALLEL_CHUNK_PRIMS) {
+        RenderPrimitivesParallel(renderer, draw_list, cull_rect);
+        return;
+    }
     unsigned int prims        = renderer.Prims;
     unsigned int prims_culled = 0;
     unsigned int idx          = 0;
@@ -1566,9 +1774,9 @@ void RenderMarkers(const _Getter& getter, ImPlotMarker marker, float size, bool
 // [SECTION] PlotLine
 //-----------------------------------------------------------------------------
 
-template <typename _Getter>
-void PlotLineEx(const char* label_id, const _Getter& getter, ImPlotLineFlags flags) {
-    if (BeginItemEx(label_id, Fitter1<_Getter>(getter), flags, ImPlotCol_Line)) {
+template <typename _Getter, typename _Fitter>
+void PlotLineEx(const char* label_id, const _Getter& getter, const _Fitter& fitter, ImPlotLineFlags flags) {
+    if (BeginItemEx(label_id, fitter, flags, ImPlotCol_Line)) {
         const ImPlotNextItemData& s = GetItemData();
         if (getter.Count > 1) {
             if (ImHasFlag(flags, ImPlotLineFlags_Shaded) && s.RenderFill) {
@@ -1609,6 +1817,11 @@ void PlotLineEx(const char* label_id, const _Getter& getter, ImPlotLineFlags fla
     }
 }
 
+template <typename _Getter>
+void PlotLineEx(const char* label_id, const _Getter& getter, ImPlotLineFlags flags) {
+    PlotLineEx(label_id, getter, Fitter1<_Getter>(getter), flags);
+}
+
 template <typename T>
 void PlotLine(const char* label_id, const T* values, int count, double xscale, double x0, ImPlotLineFlags flags, int offset, int stride) {
     GetterXY<IndexerLin,IndexerIdx<T>> getter(IndexerLin(xscale,x0),IndexerIdx<T>(values,count,offset,stride),count);
@@ -1633,6 +1846,27 @@ void PlotLineG(const char* label_id, ImPlotGetter getter_func, void* data, int c
     PlotLineEx(label_id, getter, flags);
 }
 
+// ring
+template <typename T>
+void PlotLineRing(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, double xscale, double x0, ImPlotLineFlags flags, int stride) {
+    tail = ImClamp(tail, head - capacity, head);
+    GetterXY<IndexerLin,IndexerRing<T>> getter(IndexerLin(xscale,x0 + xscale * (double)tail),IndexerRing<T>(values,capacity,tail,stride),(int)(head - tail));
+    PlotLineEx(label_id, getter, FitterRing<decltype(getter)>(getter,nullptr,values,xscale,x0,capacity,head,tail), flags);
+}
+
+template <typename T>
+void PlotLineRing(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, ImPlotLineFlags flags, int stride) {
+    tail = ImClamp(tail, head - capacity, head);
+    GetterXY<IndexerRing<T>,IndexerRing<T>> getter(IndexerRing<T>(xs,capacity,tail,stride),IndexerRing<T>(ys,capacity,tail,stride),(int)(head - tail));
+    PlotLineEx(label_id, getter, FitterRing<decltype(getter)>(getter,xs,ys,0,0,capacity,head,tail), flags);
+}
+
+#define INSTANTIATE_MACRO(T) \
+    template IMPLOT_API void PlotLineRing<T>(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, double xscale, double x0, ImPlotLineFlags flags, int stride); \
+    template IMPLOT_API void PlotLineRing<T>(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, ImPlotLineFlags flags, int stride);
+CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
+#undef INSTANTIATE_MACRO
+
 //-----------------------------------------------------------------------------
 // [SECTION] PlotScatter
 //-----------------------------------------------------------------------------
@@ -1683,9 +1917,9 @@ void PlotScatterG(const char* label_id, ImPlotGetter getter_func, void* data, in
 // [SECTION] PlotStairs
 //-----------------------------------------------------------------------------
 
-template <typename Getter>
-void PlotStairsEx(const char* label_id, const Getter& getter, ImPlotStairsFlags flags) {
-    if (BeginItemEx(label_id, Fitter1<Getter>(getter), flags, ImPlotCol_Line)) {
+template <typename Getter, typename Fitter>
+void PlotStairsEx(const char* label_id, const Getter& getter, const Fitter& fitter, ImPlotStairsFlags flags) {
+    if (BeginItemEx(label_id, fitter, flags, ImPlotCol_Line)) {
         const ImPlotNextItemData& s = GetItemData();
         if (getter.Count > 1 ) {
             if (s.RenderFill && ImHasFlag(flags,ImPlotStairsFlags_Shaded)) {
@@ -1715,6 +1949,11 @@ void PlotStairsEx(const char* label_id, const Getter& getter, ImPlotStairsFlags
     }
 }
 
+template <typename Getter>
+void PlotStairsEx(const char* label_id, const Getter& getter, ImPlotStairsFlags flags) {
+    PlotStairsEx(label_id, getter, Fitter1<Getter>(getter), flags);
+}
+
 template <typename T>
 void PlotStairs(const char* label_id, const T* values, int count, double xscale, double x0, ImPlotStairsFlags flags, int offset, int stride) {
     GetterXY<IndexerLin,IndexerIdx<T>> getter(IndexerLin(xscale,x0),IndexerIdx<T>(values,count,offset,stride),count);
@@ -1739,6 +1978,27 @@ void PlotStairsG(const char* label_id, ImPlotGetter getter_func, void* data, int
     return PlotStairsEx(label_id, getter, flags);
 }
 
+// ring
+template <typename T>
+void PlotStairsRing(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, double xscale, double x0, ImPlotStairsFlags flags, int stride) {
+    tail = ImClamp(tail, head - capacity, head);
+    GetterXY<IndexerLin,IndexerRing<T>> getter(IndexerLin(xscale,x0 + xscale * (double)tail),IndexerRing<T>(values,capacity,tail,stride),(int)(head - tail));
+    PlotStairsEx(label_id, getter, FitterRing<decltype(getter)>(getter,nullptr,values,xscale,x0,capacity,head,tail), flags);
+}
+
+template <typename T>
+void PlotStairsRing(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, ImPlotStairsFlags flags, int stride) {
+    tail = ImClamp(tail, head - capacity, head);
+    GetterXY<IndexerRing<T>,IndexerRing<T>> getter(IndexerRing<T>(xs,capacity,tail,stride),IndexerRing<T>(ys,capacity,tail,stride),(int)(head - tail));
+    PlotStairsEx(label_id, getter, FitterRing<decltype(getter)>(getter,xs,ys,0,0,capacity,head,tail), flags);
+}
+
+#define INSTANTIATE_MACRO(T) \
+    template IMPLOT_API void PlotStairsRing<T>(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, double xscale, double x0, ImPlotStairsFlags flags, int stride); \
+    template IMPLOT_API void PlotStairsRing<T>(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, ImPlotStairsFlags flags, int stride);
+CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
+#undef INSTANTIATE_MACRO
+
 //-----------------------------------------------------------------------------
 // [SECTION] PlotShaded
 //-----------------------------------------------------------------------------
@@ -2385,6 +2645,96 @@ void PlotHeatmap(const char* label_id, const T* values, int rows, int cols, doub
 CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
 #undef INSTANTIATE_MACRO
 
+/// Color maps columns [first, first + count) into the texture, which must not wrap within the range.
+template <typename T>
+void UploadHeatmapColumns(const ImPlotHeatmapTexture& heatmap, const T* values, int first, int count) {
+    ImPlotContext& gp = *GImPlot;
+    const int rows = heatmap.Height;
+    gp.HeatmapPixels.resize(rows * count);
+    ImU32* pixels = gp.HeatmapPixels.Data;
+    for (int c = 0; c < count; ++c) {
+        const T* column = values + (size_t)(first + c) * rows;
+        for (int r = 0; r < rows; ++r) {
+            const float t = (float)ImClamp(ImRemap01((double)column[r], heatmap.ScaleMin, heatmap.ScaleMax), 0.0, 1.0);
+            pixels[r * count + c] = gp.ColormapData.LerpTable(heatmap.Colormap, t);
+        }
+    }
+    gp.TextureCallbacks.Update(heatmap.Texture, first, 0, count, rows, pixels, gp.TextureCallbacks.UserData);
+}
+
+template <typename T>
+void PlotHeatmapTexture(const char* label_id, const T* values, int rows, int cols, int head, int dirty_begin, int dirty_count, double scale_min, double scale_max, const ImPlotPoint& bounds_min, const ImPlotPoint& bounds_max) {
+    ImPlotContext& gp = *GImPlot;
+    const ImPlotTextureCallbacks& callbacks = gp.TextureCallbacks;
+    IM_ASSERT_USER_ERROR(callbacks.Create != nullptr && callbacks.Update != nullptr && callbacks.GetID != nullptr, "PlotHeatmapTexture() needs SetTextureCallbacks()!");
+    if (rows <= 0 || cols <= 0)
+        return;
+    if (BeginItemEx(label_id, FitterRect(bounds_min, bounds_max))) {
+        ImDrawList& draw_list = *GetPlotDrawList();
+        Transformer2 transformer;
+        if (scale_min == 0 && scale_max == 0) {
+            T temp_min, temp_max;
+            ImMinMaxArray(values,rows*cols,&temp_min,&temp_max);
+            scale_min = (double)temp_min;
+            scale_max = (double)temp_max;
+        }
+        if (scale_min == scale_max) {
+            ImVec2 a = transformer(bounds_min);
+            ImVec2 b = transformer(bounds_max);
+            ImU32  col = GetColormapColorU32(0,gp.Style.Colormap);
+            draw_list.AddRectFilled(a, b, col);
+            EndItem();
+            return;
+        }
+        ImPlotHeatmapTexture& heatmap = *gp.HeatmapTextures.GetOrAddByKey(gp.CurrentItem->ID);
+        if (heatmap.Texture == nullptr || heatmap.Width != cols || heatmap.Height != rows) {
+            if (heatmap.Texture != nullptr && callbacks.Destroy != nullptr)
+                callbacks.Destroy(heatmap.Texture, callbacks.UserData);
+            heatmap.Texture = callbacks.Create(cols, rows, callbacks.UserData);
+            heatmap.Width   = cols;
+            heatmap.Height  = rows;
+            dirty_count     = -1;
+        }
+        if (heatmap.Colormap != gp.Style.Colormap || heatmap.ScaleMin != scale_min || heatmap.ScaleMax != scale_max) {
+            heatmap.Colormap = gp.Style.Colormap;
+            heatmap.ScaleMin = scale_min;
+            heatmap.ScaleMax = scale_max;
+            dirty_count      = -1;
+        }
+        if (heatmap.Texture != nullptr) {
+            if (dirty_count < 0 || dirty_count >= cols) {
+                UploadHeatmapColumns(heatmap, values, 0, cols);
+            }
+            else if (dirty_count > 0) {
+                const int first = ((dirty_begin % cols) + cols) % cols;
+                const int count = ImMin(dirty_count, cols - first);
+                UploadHeatmapColumns(heatmap, values, first, count);
+                if (count < dirty_count)
+                    UploadHeatmapColumns(heatmap, values, 0, dirty_count - count);
+            }
+            // the oldest column sits at the left edge; a ring that has wrapped is drawn as two quads split at the seam,
+            // so texture coordinates stay within [0,1] and no particular sampler addressing mode is required
+            const ImTextureID id = callbacks.GetID(heatmap.Texture, callbacks.UserData);
+            const int first = ((head % cols) + cols) % cols;
+            const ImVec2 p_min = transformer(ImPlotPoint(bounds_min.x, bounds_max.y));
+            const ImVec2 p_max = transformer(ImPlotPoint(bounds_max.x, bounds_min.y));
+            if (first == 0) {
+                draw_list.AddImage(id, p_min, p_max, ImVec2(0, 0), ImVec2(1, 1));
+            }
+            else {
+                const float u0 = (float)first / cols;
+                const float x_seam = p_min.x + (p_max.x - p_min.x) * (1 - u0);
+                draw_list.AddImage(id, p_min, ImVec2(x_seam, p_max.y), ImVec2(u0, 0), ImVec2(1, 1));
+                draw_list.AddImage(id, ImVec2(x_seam, p_min.y), p_max, ImVec2(0, 0), ImVec2(u0, 1));
+            }
+        }
+        EndItem();
+    }
+}
+#define INSTANTIATE_MACRO(T) template IMPLOT_API void PlotHeatmapTexture<T>(const char* label_id, const T* values, int rows, int cols, int head, int dirty_begin, int dirty_count, double scale_min, double scale_max, const ImPlotPoint& bounds_min, const ImPlotPoint& bounds_max);
+CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
+#undef INSTANTIATE_MACRO
+
 //-----------------------------------------------------------------------------
 // [SECTION] PlotHistogram
 //-----------------------------------------------------------------------------
@@ -2549,6 +2899,251 @@ double PlotHistogram2D(const char* label_id, const T* xs, const T* ys, int count
 CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
 #undef INSTANTIATE_MACRO
 
+//-----------------------------------------------------------------------------
+// [SECTION] PlotHistogramRing / PlotHistogram2DRing
+//-----------------------------------------------------------------------------
+
+/// Resolves an ImPlotBin_ method against the ring capacity so the bin count stays fixed while the window fills and slides.
+static inline int RingHistogramBins(int bins, int capacity) {
+    if (bins > 0)
+        return bins;
+    switch (bins) {
+        case ImPlotBin_Sqrt: return (int)ceil(sqrt(capacity));
+        case ImPlotBin_Rice: return (int)ceil(2 * cbrt(capacity));
+        default:             return (int)ceil(1.0 + log2(capacity));
+    }
+}
+
+/// Picks the binned range of one axis. Automatic ranges are padded and kept until the window extents leave them or shrink below half.
+static inline ImPlotRange RingHistogramRange(const ImPlotRange& requested, const ImPlotRange& binned, bool valid, ImPlotRingExtremum& min, ImPlotRingExtremum& max) {
+    if (requested.Min != 0 || requested.Max != 0 || min.Empty())
+        return requested;
+    const double lo = min.Value();
+    const double hi = max.Value();
+    if (valid && binned.Min <= lo && hi <= binned.Max && (hi - lo) * 2 >= binned.Size())
+        return binned;
+    const double pad = hi > lo ? (hi - lo) * 0.05 : 0.5;
+    return ImPlotRange(lo - pad, hi + pad);
+}
+
+template <typename T>
+IMPLOT_INLINE double RingHistogramValue(const T* data, int slot, int stride) {
+    return (double)*(const T*)(const void*)((const unsigned char*)data + (size_t)slot * stride);
+}
+
+/// Bin of the sample in #slot, -1 below the x range, -2 otherwise outside and -3 if a coordinate is NaN or infinite.
+template <typename T>
+IMPLOT_INLINE int RingHistogramBin(const ImPlotRingHistogram& hist, const T* xs, const T* ys, int slot) {
+    const double x = RingHistogramValue(xs, slot, hist.Stride);
+    const double y = ys != nullptr ? RingHistogramValue(ys, slot, hist.Stride) : 0.0;
+    if (ImNanOrInf(x) || ImNanOrInf(y))
+        return -3;
+    if (x < hist.Range.X.Min)
+        return -1;
+    if (!hist.Range.X.Contains(x))
+        return -2;
+    const int xb = ImClamp((int)((x - hist.Range.X.Min) / hist.Range.X.Size() * hist.BinsX), 0, hist.BinsX - 1);
+    if (ys == nullptr)
+        return xb;
+    if (!hist.Range.Y.Contains(y))
+        return -2;
+    const int yb = ImClamp((int)((y - hist.Range.Y.Min) / hist.Range.Y.Size() * hist.BinsY), 0, hist.BinsY - 1);
+    return yb * hist.BinsX + xb;
+}
+
+template <typename T>
+IMPLOT_INLINE void RingHistogramAdd(ImPlotRingHistogram& hist, const T* xs, const T* ys, int slot) {
+    const int b = RingHistogramBin(hist, xs, ys, slot);
+    hist.SlotBins[slot] = b;
+    if (b >= 0) {
+        hist.Counts[b]++;
+        hist.Counted++;
+    }
+    else if (b == -1) {
+        hist.Below++;
+    }
+    else if (b == -3) {
+        hist.Skipped++;
+    }
+}
+
+IMPLOT_INLINE void RingHistogramRemove(ImPlotRingHistogram& hist, int slot) {
+    const int b = hist.SlotBins[slot];
+    if (b >= 0) {
+        hist.Counts[b]--;
+        hist.Counted--;
+    }
+    else if (b == -1) {
+        hist.Below--;
+    }
+    else if (b == -3) {
+        hist.Skipped--;
+    }
+}
+
+/// Brings the counts of a ring histogram up to the window [tail, head), rebinning only when the bins, range or data changed.
+template <typename T>
+ImPlotRingHistogram& UpdateRingHistogram(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, int x_bins, int y_bins, const ImPlotRect& range, int stride) {
+    ImPlotContext& gp = *GImPlot;
+    IM_ASSERT_USER_ERROR(gp.CurrentItems != nullptr, "PlotHistogramRing() needs to be called between BeginPlot() and EndPlot()!");
+    ImPlotRingHistogram& hist = *gp.RingHistograms.GetOrAddByKey(gp.CurrentItems->GetItemID(label_id));
+    tail = ImMax(tail, head - capacity);
+    const ImU64 revision = gp.NextItemData.RingRevision;
+    const bool advance = hist.Valid && hist.DataX == xs && hist.DataY == ys && hist.Revision == revision && hist.Capacity == capacity
+                      && hist.Stride == stride && tail >= hist.Tail && head >= hist.Head && tail < hist.Head;
+    // window extents, for automatic ranges; NaN and infinite samples are left out (as in FitterRing) and never binned
+    ImS64 from = tail;
+    if (advance) {
+        from = ImMax(hist.Head, tail);
+        hist.MinX.PopBefore(tail); hist.MaxX.PopBefore(tail);
+        hist.MinY.PopBefore(tail); hist.MaxY.PopBefore(tail);
+    }
+    else {
+        hist.MinX.Clear(); hist.MaxX.Clear();
+        hist.MinY.Clear(); hist.MaxY.Clear();
+    }
+    for (ImS64 i = from; i < head; ++i) {
+        const int slot = (int)(i % capacity);
+        const double x = RingHistogramValue(xs, slot, stride);
+        const double y = ys != nullptr ? RingHistogramValue(ys, slot, stride) : 0.0;
+        if (ImNanOrInf(x) || ImNanOrInf(y))
+            continue;
+        hist.MinX.Push(i, x); hist.MaxX.Push(i, x);
+        if (ys != nullptr) {
+            hist.MinY.Push(i, y); hist.MaxY.Push(i, y);
+        }
+    }
+    ImPlotRect binned;
+    binned.X = RingHistogramRange(range.X, hist.Range.X, hist.Valid, hist.MinX, hist.MaxX);
+    binned.Y = ys != nullptr ? RingHistogramRange(range.Y, hist.Range.Y, hist.Valid, hist.MinY, hist.MaxY) : ImPlotRange();
+    const bool rebin = !advance || hist.BinsX != x_bins || hist.BinsY != y_bins || hist.Range.X.Min != binned.X.Min || hist.Range.X.Max != binned.X.Max
+                    || hist.Range.Y.Min != binned.Y.Min || hist.Range.Y.Max != binned.Y.Max;
+    if (rebin) {
+        hist.DataX    = xs;
+        hist.DataY    = ys;
+        hist.Revision = revision;
+        hist.Capacity = capacity;
+        hist.Stride   = stride;
+        hist.BinsX    = x_bins;
+        hist.BinsY    = y_bins;
+        hist.Range    = binned;
+        hist.Counts.resize(x_bins * y_bins);
+        memset(hist.Counts.Data, 0, sizeof(int) * hist.Counts.Size);
+        hist.SlotBins.resize(capacity);
+        hist.Below = hist.Counted = hist.Skipped = 0;
+        for (ImS64 i = tail; i < head; ++i)
+            RingHistogramAdd(hist, xs, ys, (int)(i % capacity));
+    }
+    else {
+        // remove everything first: added samples may reuse the slots of removed ones
+        for (ImS64 i = hist.Tail; i < tail; ++i)
+            RingHistogramRemove(hist, (int)(i % capacity));
+        for (ImS64 i = hist.Head; i < head; ++i)
+            RingHistogramAdd(hist, xs, ys, (int)(i % capacity));
+    }
+    hist.Head  = head;
+    hist.Tail  = tail;
+    hist.Valid = tail < head;
+    return hist;
+}
+
+template <typename T>
+double PlotHistogramRing(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, int bins, double bar_scale, ImPlotRange range, ImPlotHistogramFlags flags, int stride) {
+
+    const bool cumulative = ImHasFlag(flags, ImPlotHistogramFlags_Cumulative);
+    const bool density    = ImHasFlag(flags, ImPlotHistogramFlags_Density);
+    const bool outliers   = !ImHasFlag(flags, ImPlotHistogramFlags_NoOutliers);
+
+    if (capacity <= 0 || head <= tail || bins == 0)
+        return 0;
+    bins = RingHistogramBins(bins, capacity);
+    const ImPlotRingHistogram& hist = UpdateRingHistogram<T>(label_id, values, nullptr, capacity, head, tail, bins, 1, ImPlotRect(range.Min, range.Max, 0, 0), stride);
+    const int count = (int)(hist.Head - hist.Tail) - hist.Skipped;
+    const double width = hist.Range.X.Size() / bins;
+
+    ImPlotContext& gp = *GImPlot;
+    ImVector<double>& bin_centers = gp.TempDouble1;
+    ImVector<double>& bin_counts  = gp.TempDouble2;
+    bin_centers.resize(bins);
+    bin_counts.resize(bins);
+    double max_count = 0;
+    for (int b = 0; b < bins; ++b) {
+        bin_centers[b] = hist.Range.X.Min + b * width + width * 0.5;
+        bin_counts[b]  = (double)hist.Counts[b];
+        if (bin_counts[b] > max_count)
+            max_count = bin_counts[b];
+    }
+    if (cumulative) {
+        if (outliers)
+            bin_counts[0] += hist.Below;
+        for (int b = 1; b < bins; ++b)
+            bin_counts[b] += bin_counts[b-1];
+        max_count = bin_counts[bins-1];
+        if (density && (outliers ? count : hist.Counted) > 0) {
+            double scale = 1.0 / (outliers ? count : hist.Counted);
+            for (int b = 0; b < bins; ++b)
+                bin_counts[b] *= scale;
+            max_count = bin_counts[bins-1];
+        }
+    }
+    else if (density && (outliers ? count : hist.Counted) > 0 && width > 0) {
+        double scale = 1.0 / ((outliers ? count : hist.Counted) * width);
+        for (int b = 0; b < bins; ++b)
+            bin_counts[b] *= scale;
+        max_count *= scale;
+    }
+    if (ImHasFlag(flags, ImPlotHistogramFlags_Horizontal))
+        PlotBars(label_id, &bin_counts.Data[0], &bin_centers.Data[0], bins, bar_scale*width, ImPlotBarsFlags_Horizontal);
+    else
+        PlotBars(label_id, &bin_centers.Data[0], &bin_counts.Data[0], bins, bar_scale*width);
+    return max_count;
+}
+#define INSTANTIATE_MACRO(T) template IMPLOT_API double PlotHistogramRing<T>(const char* label_id, const T* values, int capacity, ImS64 head, ImS64 tail, int bins, double bar_scale, ImPlotRange range, ImPlotHistogramFlags flags, int stride);
+CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
+#undef INSTANTIATE_MACRO
+
+template <typename T>
+double PlotHistogram2DRing(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, int x_bins, int y_bins, ImPlotRect range, ImPlotHistogramFlags flags, int stride) {
+
+    const bool density  = ImHasFlag(flags, ImPlotHistogramFlags_Density);
+    const bool outliers = !ImHasFlag(flags, ImPlotHistogramFlags_NoOutliers);
+    const bool col_maj  = ImHasFlag(flags, ImPlotHistogramFlags_ColMajor);
+
+    if (capacity <= 0 || head <= tail || x_bins == 0 || y_bins == 0)
+        return 0;
+    x_bins = RingHistogramBins(x_bins, capacity);
+    y_bins = RingHistogramBins(y_bins, capacity);
+    const ImPlotRingHistogram& hist = UpdateRingHistogram<T>(label_id, xs, ys, capacity, head, tail, x_bins, y_bins, range, stride);
+    const int count = (int)(hist.Head - hist.Tail) - hist.Skipped;
+    const int bins  = x_bins * y_bins;
+
+    ImPlotContext& gp = *GImPlot;
+    ImVector<double>& bin_counts = gp.TempDouble1;
+    bin_counts.resize(bins);
+    double max_count = 0;
+    for (int b = 0; b < bins; ++b) {
+        bin_counts[b] = (double)hist.Counts[b];
+        if (bin_counts[b] > max_count)
+            max_count = bin_counts[b];
+    }
+    if (density && (outliers ? count : hist.Counted) > 0 && hist.Range.X.Size() > 0 && hist.Range.Y.Size() > 0) {
+        double scale = 1.0 / ((outliers ? count : hist.Counted) * (hist.Range.X.Size() / x_bins) * (hist.Range.Y.Size() / y_bins));
+        for (int b = 0; b < bins; ++b)
+            bin_counts[b] *= scale;
+        max_count *= scale;
+    }
+
+    if (BeginItemEx(label_id, FitterRect(hist.Range))) {
+        ImDrawList& draw_list = *GetPlotDrawList();
+        RenderHeatmap(draw_list, &bin_counts.Data[0], y_bins, x_bins, 0, max_count, nullptr, hist.Range.Min(), hist.Range.Max(), false, col_maj);
+        EndItem();
+    }
+    return max_count;
+}
+#define INSTANTIATE_MACRO(T) template IMPLOT_API double PlotHistogram2DRing<T>(const char* label_id, const T* xs, const T* ys, int capacity, ImS64 head, ImS64 tail, int x_bins, int y_bins, ImPlotRect range, ImPlotHistogramFlags flags, int stride);
+CALL_INSTANTIATE_FOR_NUMERIC_TYPES()
+#undef INSTANTIATE_MACRO
+
 //-----------------------------------------------------------------------------
 // [SECTION] PlotDigital
 //-----------------------------------------------------------------------------
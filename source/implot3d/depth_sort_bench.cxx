@@ -0,0 +1,188 @@
+#include "implot3d/implot3d_internal.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+//
+// 3D 绘图的三角形深度排序基准: 基数排序 (ImDrawList3D::SortedMoveToImGuiDrawList 所用) 对比原先逐帧分配 + ImQsort 的路径
+//   depth_sort_bench                                    10k / 100k / 1M 个三角形, 旋转中的曲面
+//   depth_sort_bench --triangles 250000 --scene random  指定规模, 深度均匀随机
+// 每个规模各自重复到至少 --seconds 秒, 输出每帧耗时, 加速比, 以及视角不变时复用上一帧顺序的检查耗时
+// 两种排序得到的深度序列必须一致且基数排序稳定, 否则返回 1
+struct DEPTH_SORT_OPTIONS
+{
+    std::vector< int > triangles = { 10000, 100000, 1000000 };
+    std::string        scene     = "surface";
+    double             seconds   = 0.5;
+    uint64_t           seed      = 1;
+};
+//
+static bool depth_sort_parse( int argc, char** argv, DEPTH_SORT_OPTIONS& options )
+{
+    bool custom = false;
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg   = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--triangles" ) == 0 )
+        {
+            options.triangles.resize( custom ? options.triangles.size() : 0 );
+            options.triangles.push_back( std::max( 1, atoi( value ) ) );
+            custom = true;
+        }
+        else if ( strcmp( arg, "--scene" ) == 0 )
+            options.scene = value;
+        else if ( strcmp( arg, "--seconds" ) == 0 )
+            options.seconds = atof( value );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else
+            return false;
+        i++;
+    }
+    return options.scene == "surface" || options.scene == "random";
+}
+// 一帧的三角形深度. surface: 网格曲面上三角形中心到视线方向的投影, 视角随帧号绕竖轴旋转
+static void depth_sort_scene( const DEPTH_SORT_OPTIONS& options, int count, int frame, std::mt19937_64& random, std::vector< float >& z )
+{
+    z.resize( count );
+    if ( options.scene == "random" )
+    {
+        std::uniform_real_distribution< float > uniform( -1.0f, 1.0f );
+        for ( float& depth : z )
+        {
+            depth = uniform( random );
+        }
+        return;
+    }
+    const int   side  = std::max( 1, ( int )sqrt( count / 2.0 ) );
+    const float angle = 0.6f + frame * 0.01f;
+    const float vx = cosf( angle ) * 0.8f, vy = 0.6f, vz = sinf( angle ) * 0.8f;
+    for ( int t = 0; t < count; t++ )
+    {
+        const int   cell = ( t / 2 ) % ( side * side );
+        const float x    = ( cell % side + ( t & 1 ? 0.66f : 0.33f ) ) / side * 2.0f - 1.0f;
+        const float y    = ( cell / side + ( t & 1 ? 0.66f : 0.33f ) ) / side * 2.0f - 1.0f;
+        const float h    = sinf( x * 3.0f ) * cosf( y * 2.0f ) * 0.5f;
+        z[ t ]           = x * vx + h * vy + y * vz;
+    }
+}
+// 原先的路径: 每帧分配 (z, tri_idx) 数组并用 ImQsort 排序
+struct DEPTH_SORT_TRI_REF
+{
+    float z;
+    int   tri_idx;
+};
+static void depth_sort_qsort( const std::vector< float >& z, std::vector< int >& order )
+{
+    const int           count = ( int )z.size();
+    DEPTH_SORT_TRI_REF* tris  = ( DEPTH_SORT_TRI_REF* )IM_ALLOC( sizeof( DEPTH_SORT_TRI_REF ) * count );
+    for ( int i = 0; i < count; i++ )
+    {
+        tris[ i ].z       = z[ i ];
+        tris[ i ].tri_idx = i;
+    }
+    ImQsort( tris, ( size_t )count, sizeof( DEPTH_SORT_TRI_REF ), []( const void* a, const void* b ) {
+        const float za = ( ( const DEPTH_SORT_TRI_REF* )a )->z;
+        const float zb = ( ( const DEPTH_SORT_TRI_REF* )b )->z;
+        return ( za < zb ) ? -1 : ( za > zb ) ? 1 : 0;
+    } );
+    for ( int i = 0; i < count; i++ )
+    {
+        order[ i ] = tris[ i ].tri_idx;
+    }
+    IM_FREE( tris );
+}
+// 现在的路径: 持久的键与乒乓缓冲 (对应 ImPlot3DContext 的 SortKeys / SortKeysTmp / SortTrisTmp)
+struct DEPTH_SORT_SCRATCH
+{
+    std::vector< ImU32 > keys, keys_tmp;
+    std::vector< int >   tris_tmp;
+};
+static const int* depth_sort_radix( const std::vector< float >& z, std::vector< int >& order, DEPTH_SORT_SCRATCH& scratch )
+{
+    const int count = ( int )z.size();
+    scratch.keys.resize( count );
+    scratch.keys_tmp.resize( count );
+    scratch.tris_tmp.resize( count );
+    for ( int i = 0; i < count; i++ )
+    {
+        scratch.keys[ i ] = ImPlot3D::DepthSortKey( z[ i ] );
+        order[ i ]        = i;
+    }
+    return ImPlot3D::RadixSortTriangles( scratch.keys.data(), scratch.keys_tmp.data(), order.data(), scratch.tris_tmp.data(), count );
+}
+// 两种结果的深度序列一致, 且基数排序在深度相同时保持原始顺序
+static bool depth_sort_check( const std::vector< float >& z, const int* radix, const std::vector< int >& qsorted )
+{
+    for ( size_t i = 0; i < z.size(); i++ )
+    {
+        if ( z[ radix[ i ] ] != z[ qsorted[ i ] ] || ( i > 0 && z[ radix[ i ] ] == z[ radix[ i - 1 ] ] && radix[ i ] < radix[ i - 1 ] ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+//
+int main( int argc, char** argv )
+{
+    using clock = std::chrono::steady_clock;
+    DEPTH_SORT_OPTIONS options;
+    if ( ! depth_sort_parse( argc, argv, options ) )
+    {
+        printf( "usage: depth_sort_bench [--triangles n]... [--scene surface|random] [--seconds s] [--seed n]\n" );
+        return 1;
+    }
+    // 预先生成若干帧的深度, 计时只覆盖排序
+    const int          frames = 8;
+    std::mt19937_64    random( options.seed );
+    DEPTH_SORT_SCRATCH scratch;
+    bool               ok = true;
+    for ( int count : options.triangles )
+    {
+        std::vector< std::vector< float > > scene( frames );
+        for ( int f = 0; f < frames; f++ )
+        {
+            depth_sort_scene( options, count, f, random, scene[ f ] );
+        }
+        std::vector< int > qsorted( count ), order( count );
+        const int*         radix = depth_sort_radix( scene[ 0 ], order, scratch );
+        depth_sort_qsort( scene[ 0 ], qsorted );
+        const bool same = depth_sort_check( scene[ 0 ], radix, qsorted );
+        ok              = ok && same;
+        // 每种路径各自计时: 重复整轮帧直到超过 seconds
+        auto measure = [ & ]( auto&& sort ) {
+            int64_t    runs  = 0;
+            const auto begin = clock::now();
+            double     elapsed = 0.0;
+            while ( elapsed < options.seconds || runs < frames )
+            {
+                sort( scene[ runs % frames ] );
+                runs++;
+                elapsed = std::chrono::duration< double >( clock::now() - begin ).count();
+            }
+            return elapsed / runs;
+        };
+        const double qsort_seconds = measure( [ & ]( const std::vector< float >& z ) { depth_sort_qsort( z, qsorted ); } );
+        const double radix_seconds = measure( [ & ]( const std::vector< float >& z ) { depth_sort_radix( z, order, scratch ); } );
+        // 视角与数据不变: 与上一帧的 Z 缓冲逐字节比较后直接复用顺序
+        const std::vector< float > previous    = scene[ 0 ];
+        volatile int               reused      = 0;
+        const double               reuse_check = measure( [ & ]( const std::vector< float >& ) {
+            reused += memcmp( previous.data(), scene[ 0 ].data(), sizeof( float ) * count ) == 0;
+        } );
+        printf( "%8d triangles (%s) | ImQsort %9.3f ms | radix %9.3f ms, %5.1fx | order reuse check %7.3f ms | %s\n", count, options.scene.c_str(), qsort_seconds * 1e3,
+                radix_seconds * 1e3, qsort_seconds / std::max( radix_seconds, 1e-12 ), reuse_check * 1e3, same ? "same order" : "ORDER MISMATCH" );
+    }
+    printf( "%s\n", ok ? "PASS" : "FAIL" );
+    return ok ? 0 : 1;
+}
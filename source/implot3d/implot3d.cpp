@@ -2839,10 +2839,12 @@ void ImDrawList3D::SortedMoveToImGuiDrawList() {
 
     const int tri_count = ZBuffer.Size;
     if (tri_count == 0) {
-        // No triangles, just clear and return
-        VtxBuffer.clear();
-        IdxBuffer.clear();
-        ZBuffer.clear();
+        // No triangles, just empty the buffers (keeping their storage) and return
+        VtxBuffer.resize(0);
+        IdxBuffer.resize(0);
+        ZBuffer.resize(0);
+        _ZPrevBuffer.resize(0);
+        _SortedTris.resize(0);
         _VtxCurrentIdx = 0;
         _VtxWritePtr = VtxBuffer.Data;
         _IdxWritePtr = IdxBuffer.Data;
@@ -2850,25 +2852,25 @@ void ImDrawList3D::SortedMoveToImGuiDrawList() {
         return;
     }
 
-    // Build an array of (z, tri_idx)
-    struct TriRef {
-        float z;
-        int tri_idx;
-    };
-    TriRef* tris = (TriRef*)IM_ALLOC(sizeof(TriRef) * tri_count);
-    for (int i = 0; i < tri_count; i++) {
-        tris[i].z = ZBuffer[i];
-        tris[i].tri_idx = i;
+    // Sort by z (distance from viewer). The order only depends on the depth of each triangle, so it is reused as long as
+    // rotation and data leave the Z buffer unchanged since last frame
+    const bool order_valid = _ZPrevBuffer.Size == tri_count && _SortedTris.Size == tri_count &&
+                             memcmp(_ZPrevBuffer.Data, ZBuffer.Data, sizeof(float) * tri_count) == 0;
+    if (!order_valid) {
+        ImPlot3DContext& gp = *ImPlot3D::GImPlot3D;
+        gp.SortKeys.resize(tri_count);
+        gp.SortKeysTmp.resize(tri_count);
+        gp.SortTrisTmp.resize(tri_count);
+        _SortedTris.resize(tri_count);
+        for (int i = 0; i < tri_count; i++) {
+            gp.SortKeys[i] = ImPlot3D::DepthSortKey(ZBuffer[i]);
+            _SortedTris[i] = i;
+        }
+        int* sorted = ImPlot3D::RadixSortTriangles(gp.SortKeys.Data, gp.SortKeysTmp.Data, _SortedTris.Data, gp.SortTrisTmp.Data, tri_count);
+        if (sorted != _SortedTris.Data)
+            _SortedTris.swap(gp.SortTrisTmp);
     }
-
-    // Sort by z (distance from viewer)
-    ImQsort(tris, (size_t)tri_count, sizeof(TriRef),
-            [](const void* a, const void* b) {
-                float za = ((const TriRef*)a)->z;
-                float zb = ((const TriRef*)b)->z;
-                return (za < zb) ? -1 : (za > zb) ? 1
-                                                  : 0;
-            });
+    const int* tris = _SortedTris.Data;
 
     // Reserve space in the ImGui draw list
     draw_list.PrimReserve(IdxBuffer.Size, VtxBuffer.Size);
@@ -2887,8 +2889,7 @@ void ImDrawList3D::SortedMoveToImGuiDrawList() {
     ImDrawIdx* idx_in = IdxBuffer.Data;
     int triangles_added = 0;
     for (int i = 0; i < tri_count; i++) {
-        int tri_i = tris[i].tri_idx;
-        int base_idx = tri_i * 3;
+        int base_idx = tris[i] * 3;
         unsigned int i0 = (unsigned int)idx_in[base_idx + 0];
         unsigned int i1 = (unsigned int)idx_in[base_idx + 1];
         unsigned int i2 = (unsigned int)idx_in[base_idx + 2];
@@ -2906,16 +2907,16 @@ void ImDrawList3D::SortedMoveToImGuiDrawList() {
     }
     draw_list._IdxWritePtr = idx_out;
 
-    // Clear local buffers since we've moved them
-    VtxBuffer.clear();
-    IdxBuffer.clear();
-    ZBuffer.clear();
+    // Empty local buffers since we've moved them, keeping this frame's depths to validate the order next frame. resize(0)
+    // rather than clear() keeps the storage, so steady frames do not allocate
+    VtxBuffer.resize(0);
+    IdxBuffer.resize(0);
+    ZBuffer.swap(_ZPrevBuffer);
+    ZBuffer.resize(0);
     _VtxCurrentIdx = 0;
     _VtxWritePtr = VtxBuffer.Data;
     _IdxWritePtr = IdxBuffer.Data;
     _ZWritePtr = ZBuffer.Data;
-
-    IM_FREE(tris);
 }
 
 //-----------------------------------------------------------------------------
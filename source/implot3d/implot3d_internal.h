@@ -96,6 +96,40 @@ static inline ImU32 ImMixU32(ImU32 a, ImU32 b, ImU32 s) {
     return (mh & 0xff00ff00) | ((ml & 0xff00ff00) >> 8);
 #endif
 }
+// Maps a float to an unsigned key with the same ordering (negative values flipped, positive values sign-tagged)
+static inline ImU32 DepthSortKey(float z) {
+    ImU32 bits;
+    memcpy(&bits, &z, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+// Stable LSD radix sort of triangle indices by key, 11 bits per pass. Passes in which all keys share a digit are skipped.
+// Ping-pongs between the two buffer pairs and returns the one holding the sorted indices
+static inline int* RadixSortTriangles(ImU32* keys, ImU32* keys_tmp, int* tris, int* tris_tmp, int count) {
+    const int radix_bits = 11;
+    const int radix_size = 1 << radix_bits;
+    unsigned int histogram[radix_size];
+    for (int shift = 0; shift < 32; shift += radix_bits) {
+        memset(histogram, 0, sizeof(histogram));
+        for (int i = 0; i < count; i++)
+            histogram[(keys[i] >> shift) & (radix_size - 1)]++;
+        if (histogram[(keys[0] >> shift) & (radix_size - 1)] == (unsigned int)count)
+            continue;
+        unsigned int sum = 0;
+        for (int d = 0; d < radix_size; d++) {
+            unsigned int c = histogram[d];
+            histogram[d] = sum;
+            sum += c;
+        }
+        for (int i = 0; i < count; i++) {
+            unsigned int dst = histogram[(keys[i] >> shift) & (radix_size - 1)]++;
+            keys_tmp[dst] = keys[i];
+            tris_tmp[dst] = tris[i];
+        }
+        ImSwap(keys, keys_tmp);
+        ImSwap(tris, tris_tmp);
+    }
+    return tris;
+}
 
 } // namespace ImPlot3D
 
@@ -125,6 +159,8 @@ struct ImDrawList3D {
     float* _ZWritePtr;                 // [Internal] point within ZBuffer.Data after each add command (to avoid using the ImVector<> operators too much)
     ImDrawListFlags _Flags;            // [Internal] draw list flags
     ImDrawListSharedData* _SharedData; // [Internal] shared draw list data
+    ImVector<float> _ZPrevBuffer;      // [Internal] Z buffer of the last sorted frame
+    ImVector<int> _SortedTris;         // [Internal] triangle order of the last sorted frame (back to front)
 
     ImDrawList3D() {
         memset(this, 0, sizeof(*this));
@@ -588,6 +624,11 @@ struct ImPlot3DContext {
     ImVector<ImGuiStyleMod> StyleModifiers;
     ImVector<ImPlot3DColormap> ColormapModifiers;
     ImPlot3DColormapData ColormapData;
+
+    // Depth sort scratch, shared by all plots
+    ImVector<ImU32> SortKeys;
+    ImVector<ImU32> SortKeysTmp;
+    ImVector<int> SortTrisTmp;
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,267 @@
+#pragma once
+//
+#include "mocap/bake_segments.h"
+#include "mocap/sensor_orientation.h"
+#include "queue/sensor_db.h"
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Animation.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+//
+// 烘焙录制: 每个传感器只保留姿态与位置, 一小时 100 Hz 的单个传感器约 10 MB
+struct BAKE_SAMPLE
+{
+    float roll, pitch, yaw;
+    float pos_x, pos_y, pos_z;
+};
+//
+struct BAKE_CAPTURE
+{
+    std::vector< BAKE_SAMPLE > sensors[ mocap_max_sensors ];
+    BAKE_SEGMENTS              segments;
+    double                     last_index[ mocap_max_sensors ] = {};
+    //
+    void push( int sensor, const SENSOR_DB& sensor_db, double index )
+    {
+        if ( segments.starts[ sensor ].empty() || index != last_index[ sensor ] + 1.0 )
+        {
+            segments.starts[ sensor ].emplace_back( sensors[ sensor ].size(), index );
+        }
+        last_index[ sensor ] = index;
+        sensors[ sensor ].push_back( { sensor_db.roll, sensor_db.pitch, sensor_db.yaw, sensor_db.pos_x, sensor_db.pos_y, sensor_db.pos_z } );
+        segments.counts[ sensor ] = sensors[ sensor ].size();
+    }
+    size_t size() const
+    {
+        size_t count = 0;
+        for ( const auto& samples : sensors )
+        {
+            count += samples.size();
+        }
+        return count;
+    }
+    void clear()
+    {
+        for ( int s = 0; s < mocap_max_sensors; s++ )
+        {
+            std::vector< BAKE_SAMPLE >().swap( sensors[ s ] );
+        }
+        segments = BAKE_SEGMENTS();
+    }
+};
+//
+static Urho3D::Quaternion bake_orientation( const BAKE_SAMPLE& sample )
+{
+    return Urho3D::Quaternion( sample.roll, sample.yaw, sample.pitch );
+}
+//
+struct BAKE_KEY
+{
+    float              time;
+    Urho3D::Quaternion rotation;
+    Urho3D::Vector3    position;
+};
+// 一条轨道对应一个场景节点. 旋转 = parent^-1 * ( pre * 传感器姿态 * post ),
+// parent 为 parent_pre * 父传感器姿态 * parent_post, 没有父传感器时取固定的 parent_fixed
+struct BAKE_TRACK
+{
+    ea::string         name;
+    int                sensor        = 0;
+    int                parent_sensor = -1;
+    Urho3D::Quaternion pre, post;
+    Urho3D::Quaternion parent_pre, parent_post, parent_fixed;
+    bool               position = false;  // 只有 3D 视图的节点带位置, 骨骼只有旋转
+    Urho3D::Vector3    position_offset;
+    std::vector< BAKE_KEY > keys;         // 完成后为简化后的关键帧
+};
+//
+// 关键帧简化: 分块的 Douglas-Peucker, 误差为按时间插值 (旋转 slerp, 位置线性) 与原始样本的偏差,
+// 旋转以角度计, 位置以米计, 两者各自除以容差后取最大值. 每块独立, 块边界总是关键帧, 最坏情况下 O( n * chunk )
+static constexpr int bake_chunk = 4096;
+//
+static float bake_error( const BAKE_KEY& a, const BAKE_KEY& b, const BAKE_KEY& k, float rotation_tolerance, float position_tolerance, bool position )
+{
+    const float              t = ( k.time - a.time ) / ( b.time - a.time );
+    const Urho3D::Quaternion q = a.rotation.Slerp( b.rotation, t );
+    // |q - k| = 2 sin( 角度 / 4 ): 小角度时远比 acos( 点积 ) 精确, 后者在 float 下的分辨率约为 0.04 度
+    const Urho3D::Quaternion d = q - ( q.DotProduct( k.rotation ) < 0.0f ? -k.rotation : k.rotation );
+    float                    e = 4.0f * asinf( Urho3D::Min( sqrtf( d.DotProduct( d ) ) * 0.5f, 1.0f ) ) * Urho3D::M_RADTODEG / rotation_tolerance;
+    if ( position )
+    {
+        e = Urho3D::Max( e, ( a.position.Lerp( b.position, t ) - k.position ).Length() / position_tolerance );
+    }
+    return e;
+}
+//
+static void bake_simplify( std::vector< BAKE_KEY >& keys, float rotation_tolerance, float position_tolerance, bool position )
+{
+    const int count = ( int )keys.size();
+    if ( count <= 2 )
+    {
+        return;
+    }
+    std::vector< char > keep( count, 0 );
+    std::vector< std::pair< int, int > > stack;
+    for ( int begin = 0; begin < count - 1; begin += bake_chunk )
+    {
+        const int end = Urho3D::Min( begin + bake_chunk, count - 1 );
+        keep[ begin ] = keep[ end ] = 1;
+        stack.emplace_back( begin, end );
+        while ( ! stack.empty() )
+        {
+            const auto [ a, b ] = stack.back();
+            stack.pop_back();
+            float worst = 1.0f;
+            int   split = -1;
+            for ( int k = a + 1; k < b; k++ )
+            {
+                const float e = bake_error( keys[ a ], keys[ b ], keys[ k ], rotation_tolerance, position_tolerance, position );
+                if ( e > worst )
+                {
+                    worst = e;
+                    split = k;
+                }
+            }
+            if ( split >= 0 )
+            {
+                keep[ split ] = 1;
+                stack.emplace_back( a, split );
+                stack.emplace_back( split, b );
+            }
+        }
+    }
+    int out = 0;
+    for ( int k = 0; k < count; k++ )
+    {
+        if ( keep[ k ] )
+        {
+            keys[ out++ ] = keys[ k ];
+        }
+    }
+    keys.resize( out );
+    keys.shrink_to_fit();
+}
+//
+// 录制 -> Animation: 每条轨道在 WorkQueue 上独立求值与简化, 全部完成后在主线程生成 Animation 资源
+struct BAKE_JOB
+{
+    float                             sample_rate        = 100.0f;
+    float                             rotation_tolerance = 0.1f;   // 度
+    float                             position_tolerance = 0.001f; // 米
+    std::shared_ptr< BAKE_CAPTURE >   capture;
+    BAKE_SEGMENTS                     segments;  // 录制的分段, 不随录制数据释放
+    std::vector< BAKE_TRACK >         tracks;
+    std::atomic< int64_t >            sample_count{ 0 };
+    std::atomic< int >                remaining{ 0 };
+    std::atomic< bool >               cancelled{ false };
+    //
+    bool finished() const
+    {
+        return remaining.load( std::memory_order_acquire ) == 0;
+    }
+    int64_t key_count() const
+    {
+        int64_t count = 0;
+        for ( const BAKE_TRACK& track : tracks )
+        {
+            count += ( int64_t )track.keys.size();
+        }
+        return count;
+    }
+    float length() const
+    {
+        float length = 0.0f;
+        for ( const BAKE_TRACK& track : tracks )
+        {
+            length = track.keys.empty() ? length : Urho3D::Max( length, track.keys.back().time );
+        }
+        return length;
+    }
+};
+//
+static void bake_track_task( const std::shared_ptr< BAKE_JOB >& job, int t )
+{
+    BAKE_TRACK& track = job->tracks[ t ];
+    if ( ! job->cancelled.load( std::memory_order_relaxed ) )
+    {
+        const std::vector< BAKE_SAMPLE >& samples = job->capture->sensors[ track.sensor ];
+        const std::vector< BAKE_SAMPLE >* parent  = track.parent_sensor >= 0 ? &job->capture->sensors[ track.parent_sensor ] : nullptr;
+        // 各传感器按相同采样率录制, 以样本序号对齐
+        const size_t count = parent != nullptr ? Urho3D::Min( samples.size(), parent->size() ) : samples.size();
+        track.keys.resize( count );
+        for ( size_t i = 0; i < count; i++ )
+        {
+            const BAKE_SAMPLE& sample = samples[ i ];
+            BAKE_KEY&          key    = track.keys[ i ];
+            key.time                  = ( float )( ( double )i / job->sample_rate );
+            const Urho3D::Quaternion world = track.pre * bake_orientation( sample ) * track.post;
+            const Urho3D::Quaternion base  = parent != nullptr ? track.parent_pre * bake_orientation( ( *parent )[ i ] ) * track.parent_post : track.parent_fixed;
+            key.rotation                   = ( base.Inverse() * world ).Normalized();
+            // 保持半球连续, 否则相邻关键帧之间会绕远路
+            if ( i > 0 && key.rotation.DotProduct( track.keys[ i - 1 ].rotation ) < 0.0f )
+            {
+                key.rotation = -key.rotation;
+            }
+            key.position = Urho3D::Vector3( sample.pos_x, sample.pos_y, sample.pos_z ) + track.position_offset;
+        }
+        job->sample_count.fetch_add( ( int64_t )count, std::memory_order_relaxed );
+        bake_simplify( track.keys, job->rotation_tolerance, job->position_tolerance, track.position );
+    }
+    // 最后一条轨道完成后释放录制数据
+    if ( job->remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+        job->capture.reset();
+    }
+}
+// 接管录制数据并开始烘焙, tracks 已由调用方描述好
+static std::shared_ptr< BAKE_JOB > bake_start( Urho3D::WorkQueue* queue, BAKE_CAPTURE& capture, std::vector< BAKE_TRACK > tracks, float sample_rate,
+                                               float rotation_tolerance, float position_tolerance )
+{
+    auto job                = std::make_shared< BAKE_JOB >();
+    job->sample_rate        = sample_rate;
+    job->rotation_tolerance = rotation_tolerance;
+    job->position_tolerance = position_tolerance;
+    job->capture            = std::make_shared< BAKE_CAPTURE >();
+    for ( int s = 0; s < mocap_max_sensors; s++ )
+    {
+        job->capture->sensors[ s ].swap( capture.sensors[ s ] );
+    }
+    job->segments = std::move( capture.segments );
+    capture.clear();
+    job->tracks = std::move( tracks );
+    job->remaining.store( ( int )job->tracks.size(), std::memory_order_release );
+    for ( int t = 0; t < ( int )job->tracks.size(); t++ )
+    {
+        queue->PostTask( [ job, t ]( unsigned, Urho3D::WorkQueue* ) { bake_track_task( job, t ); }, Urho3D::TaskPriority::Low );
+    }
+    return job;
+}
+// 在主线程上调用: 由完成的任务生成 Animation. 之后由 AnimationController 按时间插值, 拖动进度只是设置时间.
+// 简化只去掉运动平缓处的样本, 噪声大或持续运动的录制关键帧仍然很多. 引擎从上一次的关键帧下标线性查找,
+// 跳转的代价与跨过的关键帧数成正比, 顺序播放几乎不跨过关键帧. 关键帧数与跳转代价由 mocap/bake_bench.cxx 测量
+static Urho3D::SharedPtr< Urho3D::Animation > bake_finish( Urho3D::Context* context, const BAKE_JOB& job, const ea::string& name )
+{
+    using namespace Urho3D;
+    SharedPtr< Animation > animation( new Animation( context ) );
+    animation->SetName( name );
+    animation->SetAnimationName( name );
+    animation->SetLength( job.length() );
+    for ( const BAKE_TRACK& track : job.tracks )
+    {
+        if ( track.keys.empty() )
+        {
+            continue;
+        }
+        AnimationTrack* animation_track = animation->CreateTrack( track.name );
+        animation_track->channelMask_   = track.position ? CHANNEL_POSITION | CHANNEL_ROTATION : AnimationChannelFlags( CHANNEL_ROTATION );
+        animation_track->keyFrames_.reserve( ( unsigned )track.keys.size() );
+        for ( const BAKE_KEY& key : track.keys )
+        {
+            animation_track->AddKeyFrame( AnimationKeyFrame( key.time, key.position, key.rotation ) );
+        }
+    }
+    return animation;
+}
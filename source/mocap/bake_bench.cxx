@@ -0,0 +1,235 @@
+#include "synthetic/imu_synth.h"  // 先于引擎头文件: 引擎的 MathDefs.h 会 #undef M_PI
+#include "mocap/animation_baker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+//
+// 动画烘焙的关键帧简化与回放代价基准, 数据来自合成数据源:
+//   bake_bench                                         15 个传感器, 100 Hz, 60 分钟, 容差 0.1 度 / 1 mm
+//   bake_bench --minutes 10 --rotation 0.5 --position 0.005 --noise 0.05
+// 每条轨道与 bake_track_task 相同地求值与简化 (每条轨道一个线程), 输出关键帧数, 压缩比与耗时, 并用引擎的关键帧查找
+// (KeyFrameSet::GetKeyFrames, 以上一次的下标为起点线性查找) 逐样本插值回原始姿态, 检查误差不超过容差.
+// 回放代价: 按 --fps 顺序播放, 随机拖动进度 (--seeks 次, 每次所有轨道各查找一次), 另以二分查找作对照.
+// 误差超出容差或拖动一次的 p99 超出 --seek-budget-ms 时返回 1
+struct BAKE_BENCH_OPTIONS
+{
+    int      sensors        = 15;
+    double   rate           = 100.0;
+    double   minutes        = 60.0;
+    float    rotation       = 0.1f;    // 度
+    float    position       = 0.001f;  // 米
+    double   noise          = 0.02;    // 度, 姿态噪声
+    double   fps            = 60.0;
+    int      seeks          = 2000;
+    double   seek_budget_ms = 16.0;
+    uint64_t seed           = 1;
+};
+//
+static bool bake_bench_parse( int argc, char** argv, BAKE_BENCH_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg   = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--sensors" ) == 0 )
+            options.sensors = std::max( 1, std::min( atoi( value ), mocap_max_sensors ) );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--minutes" ) == 0 )
+            options.minutes = atof( value );
+        else if ( strcmp( arg, "--rotation" ) == 0 )
+            options.rotation = ( float )atof( value );
+        else if ( strcmp( arg, "--position" ) == 0 )
+            options.position = ( float )atof( value );
+        else if ( strcmp( arg, "--noise" ) == 0 )
+            options.noise = atof( value );
+        else if ( strcmp( arg, "--fps" ) == 0 )
+            options.fps = atof( value );
+        else if ( strcmp( arg, "--seeks" ) == 0 )
+            options.seeks = std::max( 1, atoi( value ) );
+        else if ( strcmp( arg, "--seek-budget-ms" ) == 0 )
+            options.seek_budget_ms = atof( value );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else
+            return false;
+        i++;
+    }
+    return options.rate > 0.0 && options.minutes > 0.0 && options.rotation > 0.0f && options.position > 0.0f && options.fps > 0.0;
+}
+//
+int main( int argc, char** argv )
+{
+    using namespace Urho3D;
+    using clock = std::chrono::steady_clock;
+    BAKE_BENCH_OPTIONS options;
+    if ( ! bake_bench_parse( argc, argv, options ) )
+    {
+        printf( "usage: bake_bench [--sensors n] [--rate hz] [--minutes m] [--rotation deg] [--position m] [--noise deg] [--fps hz] [--seeks n]\n"
+                "                  [--seek-budget-ms ms] [--seed n]\n" );
+        return 1;
+    }
+    // 录制: 每个设备一个传感器, 按 10 秒一段产生, 帧序号连续
+    SYNTH_SOURCE source;
+    source.seed                 = options.seed;
+    source.noise.attitude_noise = options.noise;
+    source.reset( options.sensors, options.rate );
+    auto    capture = std::make_shared< BAKE_CAPTURE >();
+    int64_t indices[ mocap_max_sensors ] = {};
+    for ( double elapsed = 0.0; elapsed < options.minutes * 60.0; )
+    {
+        elapsed = std::min( elapsed + 10.0, options.minutes * 60.0 );
+        source.pump( elapsed, [ & ]( int device, const std::vector< SENSOR_DB >& frames ) {
+            for ( const SENSOR_DB& frame : frames )
+            {
+                capture->push( device, frame, ( double )indices[ device ]++ );
+            }
+        } );
+    }
+    // 烘焙后录制会被释放, 留一份原始样本用于核对
+    std::vector< std::vector< BAKE_SAMPLE > > originals( capture->sensors, capture->sensors + options.sensors );
+    auto                                      job = std::make_shared< BAKE_JOB >();
+    job->sample_rate                              = ( float )options.rate;
+    job->rotation_tolerance                       = options.rotation;
+    job->position_tolerance                       = options.position;
+    job->capture                                  = capture;
+    capture.reset();
+    for ( int s = 0; s < options.sensors; s++ )
+    {
+        BAKE_TRACK track;
+        track.name     = ( "Sensor" + std::to_string( s ) ).c_str();
+        track.sensor   = s;
+        track.position = true;
+        job->tracks.push_back( std::move( track ) );
+    }
+    job->remaining.store( ( int )job->tracks.size() );
+    const auto                 bake_begin = clock::now();
+    std::vector< std::thread > workers;
+    for ( int t = 0; t < ( int )job->tracks.size(); t++ )
+    {
+        workers.emplace_back( [ job, t ]() { bake_track_task( job, t ); } );
+    }
+    for ( std::thread& worker : workers )
+    {
+        worker.join();
+    }
+    const double bake_seconds = std::chrono::duration< double >( clock::now() - bake_begin ).count();
+    // 与 bake_finish 相同地填入引擎的关键帧轨道
+    std::vector< AnimationTrack > tracks( job->tracks.size() );
+    for ( size_t t = 0; t < tracks.size(); t++ )
+    {
+        tracks[ t ].keyFrames_.reserve( ( unsigned )job->tracks[ t ].keys.size() );
+        for ( const BAKE_KEY& key : job->tracks[ t ].keys )
+        {
+            tracks[ t ].AddKeyFrame( AnimationKeyFrame( key.time, key.position, key.rotation ) );
+        }
+    }
+    const float length = job->length();
+    // 逐样本插值回原始姿态 (与 bake_track_task 相同的算式, 没有父传感器), 误差以容差为单位
+    float worst = 0.0f;
+    for ( size_t t = 0; t < tracks.size(); t++ )
+    {
+        const BAKE_TRACK&                 track   = job->tracks[ t ];
+        const std::vector< BAKE_SAMPLE >& samples = originals[ track.sensor ];
+        unsigned                          index   = 0;
+        for ( size_t i = 0; i < samples.size(); i++ )
+        {
+            BAKE_KEY original;
+            original.time     = ( float )( ( double )i / options.rate );
+            original.rotation = ( track.parent_fixed.Inverse() * ( track.pre * bake_orientation( samples[ i ] ) * track.post ) ).Normalized();
+            original.position = Vector3( samples[ i ].pos_x, samples[ i ].pos_y, samples[ i ].pos_z );
+            unsigned next     = 0;
+            float    blend    = 0.0f;
+            tracks[ t ].GetKeyFrames( original.time, length, false, index, next, blend );
+            if ( index == next )
+            {
+                continue;
+            }
+            const AnimationKeyFrame& a = tracks[ t ].keyFrames_[ index ];
+            const AnimationKeyFrame& b = tracks[ t ].keyFrames_[ next ];
+            worst = std::max( worst, bake_error( { a.time_, a.rotation_, a.position_ }, { b.time_, b.rotation_, b.position_ }, original, options.rotation,
+                                                 options.position, true ) );
+        }
+    }
+    // 顺序播放: 每帧每条轨道一次查找, 下标跟随上一帧
+    std::vector< unsigned > hints( tracks.size(), 0 );
+    const int64_t           frames     = std::max< int64_t >( 1, ( int64_t )( length * options.fps ) );
+    volatile float          checksum   = 0.0f;
+    const auto              play_begin = clock::now();
+    for ( int64_t f = 0; f < frames; f++ )
+    {
+        const float time = ( float )( f / options.fps );
+        for ( size_t t = 0; t < tracks.size(); t++ )
+        {
+            unsigned next  = 0;
+            float    blend = 0.0f;
+            tracks[ t ].GetKeyFrames( time, length, false, hints[ t ], next, blend );
+            checksum = checksum + blend;
+        }
+    }
+    const double play_seconds = std::chrono::duration< double >( clock::now() - play_begin ).count() / frames;
+    // 拖动进度: 随机跳转, 引擎从上一次的下标线性走到目标; 对照为整段二分查找
+    std::mt19937_64                         random( options.seed );
+    std::uniform_real_distribution< float > uniform( 0.0f, length );
+    std::vector< float >                    times( options.seeks );
+    for ( float& time : times )
+    {
+        time = uniform( random );
+    }
+    std::vector< double > seek_costs;
+    int64_t               crossed = 0;
+    std::fill( hints.begin(), hints.end(), 0u );
+    for ( float time : times )
+    {
+        const auto begin = clock::now();
+        for ( size_t t = 0; t < tracks.size(); t++ )
+        {
+            const unsigned previous = hints[ t ];
+            unsigned       next     = 0;
+            float          blend    = 0.0f;
+            tracks[ t ].GetKeyFrames( time, length, false, hints[ t ], next, blend );
+            crossed += previous > hints[ t ] ? previous - hints[ t ] : hints[ t ] - previous;
+        }
+        seek_costs.push_back( std::chrono::duration< double >( clock::now() - begin ).count() );
+    }
+    const auto search_begin = clock::now();
+    for ( float time : times )
+    {
+        for ( const AnimationTrack& track : tracks )
+        {
+            auto it  = std::upper_bound( track.keyFrames_.begin(), track.keyFrames_.end(), time,
+                                         []( float value, const AnimationKeyFrame& key ) { return value < key.time_; } );
+            checksum = checksum + ( float )( it - track.keyFrames_.begin() );
+        }
+    }
+    const double search_seconds = std::chrono::duration< double >( clock::now() - search_begin ).count() / times.size();
+    //
+    std::vector< double > sorted = seek_costs;
+    std::sort( sorted.begin(), sorted.end() );
+    double seek_total = 0.0;
+    for ( double cost : seek_costs )
+    {
+        seek_total += cost;
+    }
+    const double  seek_p99 = sorted[ std::min( sorted.size() - 1, ( size_t )( sorted.size() * 0.99 ) ) ];
+    const int64_t samples  = job->sample_count.load();
+    const int64_t keys     = job->key_count();
+    printf( "%d tracks, %.0f min at %.0f Hz | %lld samples -> %lld keys (%.0f per track, %.1fx) | bake %.2f s | worst error %.3f of tolerance (%.2f deg / %.1f mm)\n",
+            ( int )tracks.size(), options.minutes, options.rate, ( long long )samples, ( long long )keys, ( double )keys / tracks.size(),
+            ( double )samples / std::max< int64_t >( keys, 1 ), bake_seconds, worst, options.rotation, options.position * 1e3 );
+    printf( "playback %.0f fps: %.3f us/frame | scrub %d seeks: mean %.3f ms, p99 %.3f ms, max %.3f ms, %.0f keys walked per track | binary search %.3f us/seek\n",
+            options.fps, play_seconds * 1e6, options.seeks, seek_total / seek_costs.size() * 1e3, seek_p99 * 1e3, sorted.back() * 1e3,
+            ( double )crossed / seek_costs.size() / tracks.size(), search_seconds * 1e6 );
+    const bool ok = worst <= 1.0f + 1e-3f && keys > 0 && seek_p99 * 1e3 < options.seek_budget_ms;
+    printf( "%s\n", ok ? "PASS" : "FAIL" );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#pragma once
+//
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+//
+// 动作捕捉的传感器数量上限, 编号即二进制帧头中的 sensor
+static constexpr int mocap_max_sensors = 16;
+//
+// 每段连续录制的起点 ( 样本下标, 数据流帧序号 ), 用于事件标注 (帧序号) 与回放时间 (样本下标 / 采样率) 的换算.
+// 烘焙时随录制数据交给 BAKE_JOB, 之后由回放方与烘焙出的动画一起保留. 不依赖引擎
+struct BAKE_SEGMENTS
+{
+    std::vector< std::pair< size_t, double > > starts[ mocap_max_sensors ];
+    size_t                                     counts[ mocap_max_sensors ] = {};  // 各传感器的样本数
+    // 帧序号 -> 样本下标, 落在两段录制之间时取后一段的起点; 没有录制时返回 -1
+    double sample_of( int sensor, double index ) const
+    {
+        const auto& list = starts[ sensor ];
+        auto        it   = std::upper_bound( list.begin(), list.end(), index, []( double value, const std::pair< size_t, double >& segment ) { return value < segment.second; } );
+        if ( it == list.begin() )
+        {
+            return list.empty() ? -1.0 : ( double )list.front().first;
+        }
+        --it;
+        const size_t end = it + 1 != list.end() ? ( it + 1 )->first : counts[ sensor ];
+        return std::min( ( double )it->first + ( index - it->second ), ( double )end );
+    }
+    // 样本下标 -> 帧序号
+    double index_of( int sensor, double sample ) const
+    {
+        const auto& list = starts[ sensor ];
+        auto        it   = std::upper_bound( list.begin(), list.end(), sample, []( double value, const std::pair< size_t, double >& segment ) { return value < segment.first; } );
+        if ( it == list.begin() )
+        {
+            return list.empty() ? 0.0 : list.front().second;
+        }
+        --it;
+        return it->second + ( sample - it->first );
+    }
+};
@@ -0,0 +1,164 @@
+#include "synthetic/imu_synth.h"  // 先于引擎头文件: 引擎的 MathDefs.h 会 #undef M_PI
+#include "mocap/mocap_rig.h"
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IK/IK.h>
+#include <Urho3D/Scene/Scene.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+//
+// 动作捕捉求解的耗时基准: 手工搭建的 Mixamo 骨架层级, 合成数据源按采样率逐帧写入各传感器的最近一帧
+//   mocap_bench                                      15 个传感器, 200 Hz, 10 秒数据, 预算 1 ms
+//   mocap_bench --sensors 15 --rate 400 --budget-ms 0.5
+// 每个采样计时一次 MOCAP_RIG::update (取帧, FK, 脚部接触) 加 IKSolver::Solve, 不按实时节奏等待.
+// 骨架前面插入一根未绑定的骨骼, 检查校准仍以骨盆为根; 另绑定一根没有传感器的中间骨骼 (Spine1), 它不能充当 Spine2 的祖先.
+// FK 写入后逐根核对节点的世界朝向.
+// p99 超出预算, 根骨骼不是骨盆或朝向不符时返回 1
+struct MOCAP_BENCH_OPTIONS
+{
+    int      sensors   = 15;
+    double   rate      = 200.0;
+    double   seconds   = 10.0;
+    double   budget_ms = 1.0;
+    uint64_t seed      = 1;
+};
+//
+static bool mocap_bench_parse( int argc, char** argv, MOCAP_BENCH_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg   = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--sensors" ) == 0 )
+            options.sensors = std::max( 1, std::min( atoi( value ), 15 ) );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--seconds" ) == 0 )
+            options.seconds = atof( value );
+        else if ( strcmp( arg, "--budget-ms" ) == 0 )
+            options.budget_ms = atof( value );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else
+            return false;
+        i++;
+    }
+    return options.rate > 0.0 && options.seconds > 0.0 && options.budget_ms > 0.0;
+}
+// Mixamo 命名的骨架: 名字, 父骨骼下标, 相对父节点的位置 (米)
+struct MOCAP_BENCH_JOINT
+{
+    const char* name;
+    int         parent;
+    float       x, y, z;
+};
+static const MOCAP_BENCH_JOINT mocap_bench_skeleton[] = {
+    { "Hips", -1, 0.0f, 1.0f, 0.0f },          { "Spine", 0, 0.0f, 0.1f, 0.0f },          { "Spine1", 1, 0.0f, 0.1f, 0.0f },
+    { "Spine2", 2, 0.0f, 0.1f, 0.0f },         { "Neck", 3, 0.0f, 0.15f, 0.0f },          { "Head", 4, 0.0f, 0.1f, 0.0f },
+    { "LeftShoulder", 3, 0.05f, 0.1f, 0.0f },  { "LeftArm", 6, 0.1f, 0.0f, 0.0f },        { "LeftForeArm", 7, 0.28f, 0.0f, 0.0f },
+    { "LeftHand", 8, 0.25f, 0.0f, 0.0f },      { "RightShoulder", 3, -0.05f, 0.1f, 0.0f }, { "RightArm", 10, -0.1f, 0.0f, 0.0f },
+    { "RightForeArm", 11, -0.28f, 0.0f, 0.0f }, { "RightHand", 12, -0.25f, 0.0f, 0.0f },   { "LeftUpLeg", 0, 0.1f, -0.05f, 0.0f },
+    { "LeftLeg", 14, 0.0f, -0.42f, 0.0f },     { "LeftFoot", 15, 0.0f, -0.42f, 0.0f },    { "LeftToeBase", 16, 0.0f, -0.05f, 0.12f },
+    { "RightUpLeg", 0, -0.1f, -0.05f, 0.0f },  { "RightLeg", 18, 0.0f, -0.42f, 0.0f },     { "RightFoot", 19, 0.0f, -0.42f, 0.0f },
+    { "RightToeBase", 20, 0.0f, -0.05f, 0.12f },
+};
+//
+int main( int argc, char** argv )
+{
+    using namespace Urho3D;
+    using clock = std::chrono::steady_clock;
+    MOCAP_BENCH_OPTIONS options;
+    if ( ! mocap_bench_parse( argc, argv, options ) )
+    {
+        printf( "usage: mocap_bench [--sensors n] [--rate hz] [--seconds s] [--budget-ms ms] [--seed n]\n" );
+        return 1;
+    }
+    SharedPtr< Context > context( new Context() );
+    RegisterSceneLibrary( context );
+    RegisterIKLibrary( context );
+    SharedPtr< Scene > scene( new Scene( context ) );
+    //
+    MOCAP_RIG rig;
+    rig.bones.resize( options.sensors );
+    rig.bones.insert( rig.bones.begin(), MOCAP_BONE{ -1, "Tail" } );
+    rig.bones.push_back( MOCAP_BONE{ -1, "Spine1" } );
+    rig.node = scene->CreateChild( "Mocap" );
+    ea::vector< Node* > joints;
+    for ( const MOCAP_BENCH_JOINT& joint : mocap_bench_skeleton )
+    {
+        Node* parent = joint.parent < 0 ? rig.node.Get() : joints[ joint.parent ];
+        Node* child  = parent->CreateChild( rig.prefix + joint.name );
+        child->SetPosition( Vector3( joint.x, joint.y, joint.z ) );
+        joints.push_back( child );
+    }
+    rig.skeleton_root = joints[ 0 ];
+    rig.bind();
+    rig.aligned  = false;
+    rig.enabled  = true;
+    auto* solver = rig.node->GetComponent< IKSolver >();
+    // 合成数据: 每个设备对应一个传感器编号, 最新一帧写入 mocap_latest
+    SYNTH_SOURCE source;
+    source.seed = options.seed;
+    source.reset( options.sensors, options.rate );
+    auto pump = [ & ]( double elapsed ) {
+        source.pump( elapsed, [ & ]( int device, const std::vector< SENSOR_DB >& frames ) {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            mocap_latest[ device ].frame = frames.back();
+            mocap_latest[ device ].generation++;
+        } );
+    };
+    pump( 1.0 / options.rate );
+    rig.calibrate();
+    const int  root       = rig.root();
+    const bool root_is_ok = root >= 0 && rig.bones[ root ].bone == "Hips";
+    //
+    const int64_t         samples = std::max< int64_t >( 1, ( int64_t )( options.seconds * options.rate ) );
+    std::vector< double > costs;
+    costs.reserve( samples );
+    float worst_error = 0.0f;
+    for ( int64_t i = 1; i <= samples; i++ )
+    {
+        pump( ( i + 1 ) / options.rate );
+        const auto begin = clock::now();
+        rig.update();
+        if ( solver != nullptr )
+        {
+            solver->Solve( ( float )( 1.0 / options.rate ) );
+        }
+        costs.push_back( std::chrono::duration< double >( clock::now() - begin ).count() );
+        // 重新做一次 FK 后核对节点的世界朝向 (IK 会修正腿部, 因此不在求解之后检查)
+        if ( i % 64 == 0 )
+        {
+            rig.update();
+            for ( const MOCAP_BONE& bone : rig.bones )
+            {
+                if ( bone.node && bone.sensor >= 0 )
+                {
+                    worst_error = std::max( worst_error, ( bone.node->GetWorldRotation().Inverse() * bone.world ).Angle() );
+                }
+            }
+        }
+    }
+    //
+    std::vector< double > sorted = costs;
+    std::sort( sorted.begin(), sorted.end() );
+    double total = 0.0;
+    for ( double cost : costs )
+    {
+        total += cost;
+    }
+    const double mean = total / costs.size();
+    const double p99  = sorted[ std::min( sorted.size() - 1, ( size_t )( sorted.size() * 0.99 ) ) ];
+    printf( "%d sensors, %.0f Hz, %lld samples | solve mean %.3f ms, p99 %.3f ms, max %.3f ms (budget %.3f ms) | %.1f%% of the sample interval\n", options.sensors,
+            options.rate, ( long long )samples, mean * 1e3, p99 * 1e3, sorted.back() * 1e3, options.budget_ms, mean * options.rate * 100.0 );
+    printf( "root bone %s | worst FK orientation error %.4f deg\n", root >= 0 ? rig.bones[ root ].bone.c_str() : "(none)", worst_error );
+    const bool ok = root_is_ok && worst_error < 0.1f && p99 * 1e3 < options.budget_ms;
+    printf( "%s\n", ok ? "PASS" : "FAIL" );
+    return ok ? 0 : 1;
+}
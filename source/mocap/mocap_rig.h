@@ -0,0 +1,309 @@
+#pragma once
+//
+#include "websocket/wasmsocket.h"
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/IK/IKLegSolver.h>
+#include <Urho3D/IK/IKSolver.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Node.h>
+#include <EASTL/sort.h>
+#include <climits>
+//
+struct MOCAP_BONE
+{
+    int                             sensor = -1;
+    ea::string                      bone;
+    Urho3D::WeakPtr< Urho3D::Node > node;
+    int                             ancestor = -1;       // 最近的有传感器的已绑定祖先骨骼 (bones 下标), -1 表示无
+    Urho3D::Quaternion              ancestor_to_parent;  // 绑定姿态下 祖先 -> 父节点 的相对旋转 (中间没有传感器的骨骼保持绑定姿态)
+    Urho3D::Quaternion              rest_world;          // 绑定姿态下骨骼的世界朝向
+    Urho3D::Quaternion              mount;               // 安装校准: 传感器朝向 -> 骨骼朝向
+    Urho3D::Quaternion              world;               // 本帧计算出的世界朝向
+};
+//
+struct MOCAP_LEG
+{
+    ea::string                      thigh, calf, heel, toe;
+    Urho3D::WeakPtr< Urho3D::Node > toe_node;
+    Urho3D::WeakPtr< Urho3D::Node > target;
+};
+// 多传感器动作捕捉: 每个传感器驱动 AnimatedModel 的一根骨骼, 双脚交替着地固定, 由 IKLegSolver 修正脚的位置并推动根节点
+// 每帧先按父到子的顺序算出全部骨骼的世界朝向, 静默写入局部旋转, 最后对骨架根节点只标记一次 dirty
+struct MOCAP_RIG
+{
+    bool                            enabled      = false;
+    bool                            foot_contact = true;
+    bool                            aligned      = true;  // 使用时间对齐后的帧 (sensor_timeline), 否则直接取各传感器的最近一帧
+    bool                            calibrated   = false;
+    ea::string                      model_path   = "Models/Mocap/Character.mdl";
+    ea::string                      prefix       = "mixamorig:";
+    float                           ground       = 0.0f;
+    float                           hysteresis   = 0.02f;  // 另一只脚低出这么多才切换支撑脚
+    Urho3D::WeakPtr< Urho3D::Node > node;
+    Urho3D::WeakPtr< Urho3D::Node > skeleton_root;
+    ea::vector< MOCAP_BONE >        bones;
+    MOCAP_LEG                       legs[ 2 ];
+    Urho3D::Quaternion              heading;  // 传感器世界坐标系的朝向 -> 模型朝向
+    int                             stance = -1;
+    Urho3D::Vector3                 stance_pin;
+    uint32_t                        generations[ mocap_max_sensors ] = {};
+    SENSOR_DB                       frames[ mocap_max_sensors ];
+    Urho3D::Quaternion              orientations[ mocap_max_sensors ];  // 显示插值开启时取 pose_interpolator 的结果, 否则由 frames 换算
+    //
+    MOCAP_RIG()
+    {
+        // 15 个传感器的默认布局 (Mixamo 骨骼命名)
+        static const char* names[] = { "Hips", "Spine2", "Head", "LeftArm", "LeftForeArm", "LeftHand", "RightArm", "RightForeArm", "RightHand",
+                                       "LeftUpLeg", "LeftLeg", "LeftFoot", "RightUpLeg", "RightLeg", "RightFoot" };
+        for ( int s = 0; s < 15; s++ )
+        {
+            MOCAP_BONE bone;
+            bone.sensor = s;
+            bone.bone   = names[ s ];
+            bones.push_back( bone );
+        }
+        legs[ 0 ] = { "LeftUpLeg", "LeftLeg", "LeftFoot", "LeftToeBase" };
+        legs[ 1 ] = { "RightUpLeg", "RightLeg", "RightFoot", "RightToeBase" };
+    }
+    // 加载模型并解析骨骼绑定, 失败时返回 false
+    bool load( Urho3D::Scene* scene )
+    {
+        using namespace Urho3D;
+        if ( node )
+        {
+            node->Remove();
+        }
+        calibrated = false;
+        stance     = -1;
+        auto* cache = scene->GetSubsystem< ResourceCache >();
+        auto* model = cache->GetResource< Model >( model_path );
+        if ( model == nullptr )
+        {
+            return false;
+        }
+        node           = scene->CreateChild( "Mocap" );
+        auto* animated = node->CreateComponent< AnimatedModel >();
+        animated->SetModel( model );
+        animated->SetCastShadows( true );
+        Bone* root_bone = animated->GetSkeleton().GetRootBone();
+        skeleton_root   = root_bone != nullptr ? root_bone->node_.Get() : nullptr;
+        bind();
+        return true;
+    }
+    // 在 node 之下按名字解析骨骼绑定并创建腿部 IK. 骨骼节点通常来自 AnimatedModel 的骨架, 原生基准中为手工搭建的层级
+    void bind()
+    {
+        using namespace Urho3D;
+        // 父到子的顺序: 按层级深度排序, 祖先一定排在前面; 未绑定的骨骼排在最后
+        auto depth = []( Node* n ) {
+            if ( n == nullptr )
+            {
+                return INT_MAX;
+            }
+            int d = 0;
+            for ( ; n != nullptr; n = n->GetParent() )
+            {
+                d++;
+            }
+            return d;
+        };
+        for ( MOCAP_BONE& bone : bones )
+        {
+            bone.node = node->GetChild( prefix + bone.bone, true );
+        }
+        ea::stable_sort( bones.begin(), bones.end(), [ & ]( const MOCAP_BONE& a, const MOCAP_BONE& b ) { return depth( a.node.Get() ) < depth( b.node.Get() ); } );
+        for ( int i = 0; i < ( int )bones.size(); i++ )
+        {
+            MOCAP_BONE& bone = bones[ i ];
+            bone.ancestor    = -1;
+            if ( ! bone.node )
+            {
+                continue;
+            }
+            bone.rest_world = bone.node->GetWorldRotation();
+            bone.mount      = Quaternion::IDENTITY;
+            for ( Node* p = bone.node->GetParent(); p != nullptr && bone.ancestor < 0; p = p->GetParent() )
+            {
+                for ( int j = 0; j < i; j++ )
+                {
+                    // 没有传感器的骨骼不写入 world, 不能作为祖先; 与 bake_tracks 的父传感器一致
+                    if ( bones[ j ].node.Get() == p && bones[ j ].sensor >= 0 && bones[ j ].sensor < mocap_max_sensors )
+                    {
+                        bone.ancestor = j;
+                        break;
+                    }
+                }
+            }
+            if ( bone.ancestor >= 0 )
+            {
+                bone.ancestor_to_parent = bones[ bone.ancestor ].rest_world.Inverse() * bone.node->GetParent()->GetWorldRotation();
+            }
+        }
+        // 腿部 IK: 目标节点必须位于求解器节点之下
+        node->CreateComponent< IKSolver >();
+        for ( int l = 0; l < 2; l++ )
+        {
+            MOCAP_LEG& leg = legs[ l ];
+            leg.toe_node   = node->GetChild( prefix + leg.toe, true );
+            leg.target     = node->CreateChild( l == 0 ? "MocapLeftFootTarget" : "MocapRightFootTarget" );
+            if ( leg.toe_node )
+            {
+                leg.target->SetWorldPosition( leg.toe_node->GetWorldPosition() );
+            }
+            auto* solver = node->CreateComponent< IKLegSolver >();
+            solver->SetThighBoneName( prefix + leg.thigh );
+            solver->SetCalfBoneName( prefix + leg.calf );
+            solver->SetHeelBoneName( prefix + leg.heel );
+            solver->SetToeBoneName( prefix + leg.toe );
+            solver->SetTargetName( leg.target->GetName() );
+        }
+    }
+    // 取出各传感器的帧与朝向, 只在有新数据时返回 true. 时间对齐时取同一播放时刻的插值结果, 尚未对齐的传感器退回最近一帧
+    bool fetch()
+    {
+        bool changed = false;
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        for ( int s = 0; s < mocap_max_sensors; s++ )
+        {
+            const bool timed  = aligned && ( sensor_timeline.current_mask & ( 1u << s ) ) != 0;
+            const bool smooth = pose_interpolator.enabled && ( pose_interpolator.valid_mask & ( 1u << s ) ) != 0;
+            if ( mocap_latest[ s ].generation != generations[ s ] || timed || smooth )
+            {
+                generations[ s ]  = mocap_latest[ s ].generation;
+                frames[ s ]       = timed ? sensor_timeline.current[ s ] : mocap_latest[ s ].frame;
+                orientations[ s ] = smooth ? pose_interpolator.rotation[ s ] : sensor_orientation( frames[ s ] );
+                changed           = true;
+            }
+        }
+        return changed;
+    }
+    // 层级最浅的已绑定且有传感器的骨骼 (通常为骨盆), 没有时返回 -1
+    int root() const
+    {
+        for ( int i = 0; i < ( int )bones.size(); i++ )
+        {
+            if ( bones[ i ].node && bones[ i ].sensor >= 0 && bones[ i ].sensor < mocap_max_sensors )
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+    // 安装校准: 人以模型的绑定姿态站立, 以根骨骼 (骨盆) 传感器的朝向作为正前方
+    void calibrate()
+    {
+        using namespace Urho3D;
+        fetch();
+        const int pelvis_bone = root();
+        if ( pelvis_bone < 0 )
+        {
+            return;
+        }
+        const Quaternion pelvis = orientations[ bones[ pelvis_bone ].sensor ];
+        heading                 = Quaternion( -pelvis.YawAngle(), Vector3::UP );
+        for ( MOCAP_BONE& bone : bones )
+        {
+            if ( bone.node && bone.sensor >= 0 && bone.sensor < mocap_max_sensors )
+            {
+                bone.mount = ( heading * orientations[ bone.sensor ] ).Inverse() * bone.rest_world;
+            }
+        }
+        stance     = -1;
+        calibrated = true;
+    }
+    //
+    void update()
+    {
+        using namespace Urho3D;
+        if ( ! enabled || ! calibrated || ! node || ! skeleton_root )
+        {
+            return;
+        }
+        // 即使没有新数据也重写骨骼, IK 在本帧的 FK 姿态上求解
+        fetch();
+        for ( MOCAP_BONE& bone : bones )
+        {
+            if ( ! bone.node || bone.sensor < 0 || bone.sensor >= mocap_max_sensors )
+            {
+                continue;
+            }
+            bone.world = heading * orientations[ bone.sensor ] * bone.mount;
+            const Quaternion parent_world =
+                bone.ancestor >= 0 ? bones[ bone.ancestor ].world * bone.ancestor_to_parent : bone.node->GetParent()->GetWorldRotation();
+            bone.node->SetRotationSilent( parent_world.Inverse() * bone.world );
+        }
+        skeleton_root->MarkDirty();
+        if ( foot_contact )
+        {
+            update_contact();
+        }
+    }
+    // 烘焙: 与 update 相同的 FK, 每根已绑定骨骼一条局部旋转轨道 (不含脚部接触与 IK)
+    void bake_tracks( std::vector< BAKE_TRACK >& tracks ) const
+    {
+        using namespace Urho3D;
+        if ( ! calibrated || ! node )
+        {
+            return;
+        }
+        for ( const MOCAP_BONE& bone : bones )
+        {
+            if ( ! bone.node || bone.sensor < 0 || bone.sensor >= mocap_max_sensors )
+            {
+                continue;
+            }
+            BAKE_TRACK track;
+            track.name   = bone.node->GetName();
+            track.sensor = bone.sensor;
+            track.pre    = heading;
+            track.post   = bone.mount;
+            if ( bone.ancestor >= 0 )
+            {
+                const MOCAP_BONE& ancestor = bones[ bone.ancestor ];
+                track.parent_sensor        = ancestor.sensor;
+                track.parent_pre           = heading;
+                track.parent_post          = ancestor.mount * bone.ancestor_to_parent;
+            }
+            else
+            {
+                track.parent_fixed = bone.node->GetParent()->GetWorldRotation();
+            }
+            tracks.push_back( std::move( track ) );
+        }
+    }
+    // 回放烘焙动画时停用 IK, 骨骼姿态完全由动画决定
+    void set_solver_enabled( bool enable )
+    {
+        if ( node )
+        {
+            if ( auto* solver = node->GetComponent< Urho3D::IKSolver >() )
+            {
+                solver->SetEnabled( enable );
+            }
+        }
+    }
+    // 较低的脚为支撑脚并固定在地面上: 根节点按支撑脚的滑移反向平移, 高度使支撑脚贴地; IK 目标跟随
+    void update_contact()
+    {
+        using namespace Urho3D;
+        if ( ! legs[ 0 ].toe_node || ! legs[ 1 ].toe_node )
+        {
+            return;
+        }
+        Vector3   feet[ 2 ] = { legs[ 0 ].toe_node->GetWorldPosition(), legs[ 1 ].toe_node->GetWorldPosition() };
+        const int lower     = feet[ 0 ].y_ <= feet[ 1 ].y_ ? 0 : 1;
+        if ( stance < 0 || ( lower != stance && feet[ lower ].y_ + hysteresis < feet[ stance ].y_ ) )
+        {
+            stance     = lower;
+            stance_pin = Vector3( feet[ lower ].x_, ground, feet[ lower ].z_ );
+        }
+        const Vector3 offset = stance_pin - feet[ stance ];
+        node->Translate( offset, TS_WORLD );
+        for ( int l = 0; l < 2; l++ )
+        {
+            Vector3 target = l == stance ? stance_pin : feet[ l ] + offset;
+            target.y_      = Max( target.y_, ground );
+            legs[ l ].target->SetWorldPosition( target );
+        }
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+//
+#include "mocap/sensor_orientation.h"
+#include "queue/sensor_timeline.h"
+#include <Urho3D/Math/Vector3.h>
+#include <algorithm>
+#include <cmath>
+//
+// 显示插值: 每个传感器保留最近几个带时间戳的姿态与位置关键帧, 在 (现在 - latency) 时刻采样
+// 姿态用 squad (球面四边形插值, 关键帧处角速度连续), 位置用非均匀 Catmull-Rom 三次样条
+// 关键帧时间取 sensor_timeline 的对齐时间, 时钟模型尚未建立时用到达时间
+// 关键帧间隔不小于 latency / 8, 更密的帧直接跳过; 环形缓冲容纳 16 个关键帧, 覆盖两倍的 latency
+// 存储按分量与关键帧分列 (每一列是所有传感器), 采样分两步: 先逐个传感器找到所在区间的四个关键帧下标,
+// 再逐个传感器做 squad 与样条插值 (含 acos, atan2 等超越函数, 不跨传感器向量化); 全部是定长数组, 每帧不分配内存
+static constexpr int pose_interpolator_keys = 16;
+//
+struct POSE_QUAT
+{
+    float w, x, y, z;
+};
+static inline POSE_QUAT pose_multiply( const POSE_QUAT& a, const POSE_QUAT& b )
+{
+    return { a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y, a.w * b.y + a.y * b.w + a.z * b.x - a.x * b.z,
+             a.w * b.z + a.z * b.w + a.x * b.y - a.y * b.x };
+}
+static inline float pose_dot( const POSE_QUAT& a, const POSE_QUAT& b )
+{
+    return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+}
+// 翻转到 reference 的同一半球, 保证插值走最短路径
+static inline POSE_QUAT pose_align( const POSE_QUAT& q, const POSE_QUAT& reference )
+{
+    const float sign = pose_dot( q, reference ) < 0.0f ? -1.0f : 1.0f;
+    return { q.w * sign, q.x * sign, q.y * sign, q.z * sign };
+}
+// 单位四元数的对数, 结果的 w 为 0
+static inline POSE_QUAT pose_log( const POSE_QUAT& q )
+{
+    const float v     = sqrtf( q.x * q.x + q.y * q.y + q.z * q.z );
+    const float scale = v > 1e-6f ? atan2f( v, q.w ) / v : 1.0f;
+    return { 0.0f, q.x * scale, q.y * scale, q.z * scale };
+}
+static inline POSE_QUAT pose_exp( const POSE_QUAT& q )
+{
+    const float v     = sqrtf( q.x * q.x + q.y * q.y + q.z * q.z );
+    const float scale = v > 1e-6f ? sinf( v ) / v : 1.0f;
+    return { cosf( v ), q.x * scale, q.y * scale, q.z * scale };
+}
+static inline POSE_QUAT pose_slerp( const POSE_QUAT& a, const POSE_QUAT& b, float t )
+{
+    const float cosine = std::min( pose_dot( a, b ), 1.0f );
+    const float angle  = acosf( cosine );
+    const float sine   = sinf( angle );
+    // 夹角很小时退化为线性插值
+    const float wa = sine > 1e-4f ? sinf( ( 1.0f - t ) * angle ) / sine : 1.0f - t;
+    const float wb = sine > 1e-4f ? sinf( t * angle ) / sine : t;
+    POSE_QUAT   q  = { a.w * wa + b.w * wb, a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb };
+    const float n  = 1.0f / sqrtf( pose_dot( q, q ) );
+    return { q.w * n, q.x * n, q.y * n, q.z * n };
+}
+// squad 的控制点: q * exp( -( log( q^-1 next ) + log( q^-1 prev ) ) / 4 )
+static inline POSE_QUAT pose_squad_control( const POSE_QUAT& prev, const POSE_QUAT& q, const POSE_QUAT& next )
+{
+    const POSE_QUAT inverse = { q.w, -q.x, -q.y, -q.z };
+    const POSE_QUAT a       = pose_log( pose_multiply( inverse, next ) );
+    const POSE_QUAT b       = pose_log( pose_multiply( inverse, prev ) );
+    return pose_multiply( q, pose_exp( { 0.0f, -( a.x + b.x ) * 0.25f, -( a.y + b.y ) * 0.25f, -( a.z + b.z ) * 0.25f } ) );
+}
+//
+struct POSE_INTERPOLATOR
+{
+    static constexpr int sessions = sensor_timeline_sensors;
+    static constexpr int keys     = pose_interpolator_keys;
+    //
+    bool  enabled     = true;
+    float latency     = 0.05f;  // 秒, 显示相对于数据的延迟, 限制在 [ 0, max_latency ]
+    float max_latency = 0.5f;
+    // 关键帧环: [ 关键帧 ][ 传感器 ]
+    double time[ keys ][ sessions ];
+    float  qw[ keys ][ sessions ], qx[ keys ][ sessions ], qy[ keys ][ sessions ], qz[ keys ][ sessions ];
+    float  px[ keys ][ sessions ], py[ keys ][ sessions ], pz[ keys ][ sessions ];
+    int    newest[ sessions ];  // 最新关键帧的下标
+    int    count[ sessions ];
+    // 采样结果, valid_mask 的第 s 位表示第 s 个传感器有效
+    Urho3D::Quaternion rotation[ sessions ];
+    Urho3D::Vector3    position[ sessions ];
+    uint32_t           valid_mask = 0;
+    uint64_t           holds[ sessions ];  // 采样时刻超出最新关键帧, 只能保持不动的次数
+    //
+    POSE_INTERPOLATOR()
+    {
+        reset();
+    }
+    void reset()
+    {
+        // 没有关键帧的传感器也参与第二步的运算, 以单位姿态占位, 结果不计入 valid_mask
+        std::fill_n( &time[ 0 ][ 0 ], keys * sessions, 0.0 );
+        std::fill_n( &qw[ 0 ][ 0 ], keys * sessions, 1.0f );
+        for ( float* column : { &qx[ 0 ][ 0 ], &qy[ 0 ][ 0 ], &qz[ 0 ][ 0 ], &px[ 0 ][ 0 ], &py[ 0 ][ 0 ], &pz[ 0 ][ 0 ] } )
+        {
+            std::fill_n( column, keys * sessions, 0.0f );
+        }
+        std::fill_n( newest, sessions, 0 );
+        std::fill_n( count, sessions, 0 );
+        std::fill_n( holds, sessions, 0 );
+        valid_mask = 0;
+    }
+    // 接收线程 (调用方持有 queue_mutex)
+    void push( int session, const SENSOR_DB* frames, int frame_count, const SENSOR_CLOCK& clock, double arrival )
+    {
+        const double spacing = std::max( latency, 0.0f ) / 8.0;
+        for ( int i = 0; i < frame_count; i++ )
+        {
+            const SENSOR_DB& frame = frames[ i ];
+            const double     t     = clock.ready() ? clock.align( frame.time ) : arrival;
+            int              k     = newest[ session ];
+            if ( count[ session ] > 0 && t < time[ k ][ session ] )
+            {
+                // 时钟重建或设备重启, 时间倒退: 丢弃旧的关键帧
+                count[ session ] = 0;
+            }
+            if ( count[ session ] > 0 && t - time[ k ][ session ] < std::max( spacing, 1e-6 ) )
+            {
+                continue;
+            }
+            k                          = count[ session ] > 0 ? ( k + 1 ) % keys : 0;
+            newest[ session ]          = k;
+            count[ session ]           = std::min( count[ session ] + 1, keys );
+            const Urho3D::Quaternion q = sensor_orientation( frame );
+            time[ k ][ session ]       = t;
+            qw[ k ][ session ]         = q.w_;
+            qx[ k ][ session ]         = q.x_;
+            qy[ k ][ session ]         = q.y_;
+            qz[ k ][ session ]         = q.z_;
+            px[ k ][ session ]         = frame.pos_x;
+            py[ k ][ session ]         = frame.pos_y;
+            pz[ k ][ session ]         = frame.pos_z;
+        }
+    }
+    // 渲染线程每帧调用一次 (调用方持有 queue_mutex)
+    void sample( double now )
+    {
+        latency = std::max( 0.0f, std::min( latency, max_latency ) );
+        const double at = now - latency;
+        // 第一步: 每个传感器取出区间 [ k1, k2 ] 及两侧的 k0, k3, 区间两端不足时重复端点
+        int   k[ 4 ][ sessions ];
+        float tau[ sessions ], h[ sessions ], h0[ sessions ], h3[ sessions ];
+        valid_mask = 0;
+        for ( int s = 0; s < sessions; s++ )
+        {
+            const int n = count[ s ];
+            if ( n == 0 )
+            {
+                k[ 0 ][ s ] = k[ 1 ][ s ] = k[ 2 ][ s ] = k[ 3 ][ s ] = 0;
+                tau[ s ] = h[ s ] = h0[ s ] = h3[ s ] = 1.0f;
+                continue;
+            }
+            valid_mask |= 1u << s;
+            const int oldest = ( newest[ s ] - n + 1 + keys ) % keys;
+            int       i      = 0;  // 从最旧的关键帧数起
+            while ( i < n - 1 && time[ ( oldest + i + 1 ) % keys ][ s ] <= at )
+            {
+                i++;
+            }
+            auto index  = [ & ]( int j ) { return ( oldest + std::max( 0, std::min( j, n - 1 ) ) ) % keys; };
+            k[ 0 ][ s ] = index( i - 1 );
+            k[ 1 ][ s ] = index( i );
+            k[ 2 ][ s ] = index( i + 1 );
+            k[ 3 ][ s ] = index( i + 2 );
+            const double t1 = time[ k[ 1 ][ s ] ][ s ], t2 = time[ k[ 2 ][ s ] ][ s ];
+            h[ s ]          = ( float )( t2 - t1 );
+            h0[ s ]         = ( float )( t2 - time[ k[ 0 ][ s ] ][ s ] );
+            h3[ s ]         = ( float )( time[ k[ 3 ][ s ] ][ s ] - t1 );
+            tau[ s ]        = h[ s ] > 0.0f ? std::max( 0.0f, std::min( ( float )( ( at - t1 ) / ( t2 - t1 ) ), 1.0f ) ) : 0.0f;
+            holds[ s ] += at > time[ newest[ s ] ][ s ];
+        }
+        // 第二步: 逐个传感器插值
+        for ( int s = 0; s < sessions; s++ )
+        {
+            POSE_QUAT q[ 4 ];
+            float     p[ 4 ][ 3 ];
+            for ( int j = 0; j < 4; j++ )
+            {
+                const int kj = k[ j ][ s ];
+                q[ j ]       = { qw[ kj ][ s ], qx[ kj ][ s ], qy[ kj ][ s ], qz[ kj ][ s ] };
+                p[ j ][ 0 ]  = px[ kj ][ s ];
+                p[ j ][ 1 ]  = py[ kj ][ s ];
+                p[ j ][ 2 ]  = pz[ kj ][ s ];
+            }
+            q[ 0 ]              = pose_align( q[ 0 ], q[ 1 ] );
+            q[ 2 ]              = pose_align( q[ 2 ], q[ 1 ] );
+            q[ 3 ]              = pose_align( q[ 3 ], q[ 2 ] );
+            const float     t   = tau[ s ];
+            const POSE_QUAT s1  = pose_squad_control( q[ 0 ], q[ 1 ], q[ 2 ] );
+            const POSE_QUAT s2  = pose_align( pose_squad_control( q[ 1 ], q[ 2 ], q[ 3 ] ), s1 );
+            const POSE_QUAT out = pose_slerp( pose_slerp( q[ 1 ], q[ 2 ], t ), pose_align( pose_slerp( s1, s2, t ), pose_slerp( q[ 1 ], q[ 2 ], t ) ),
+                                              2.0f * t * ( 1.0f - t ) );
+            rotation[ s ]       = Urho3D::Quaternion( out.w, out.x, out.y, out.z );
+            // 非均匀 Catmull-Rom: 端点切线取两侧关键帧的差商, 换算到区间长度
+            const float t2 = t * t, t3 = t2 * t;
+            const float a = 2.0f * t3 - 3.0f * t2 + 1.0f, b = t3 - 2.0f * t2 + t, c = -2.0f * t3 + 3.0f * t2, d = t3 - t2;
+            const float m1 = h[ s ] / std::max( h0[ s ], 1e-6f ), m2 = h[ s ] / std::max( h3[ s ], 1e-6f );
+            float       v[ 3 ];
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                v[ axis ] = a * p[ 1 ][ axis ] + b * ( p[ 2 ][ axis ] - p[ 0 ][ axis ] ) * m1 + c * p[ 2 ][ axis ] + d * ( p[ 3 ][ axis ] - p[ 1 ][ axis ] ) * m2;
+            }
+            position[ s ] = Urho3D::Vector3( v[ 0 ], v[ 1 ], v[ 2 ] );
+        }
+    }
+};
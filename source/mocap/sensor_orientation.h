@@ -0,0 +1,10 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <Urho3D/Math/Quaternion.h>
+//
+// 传感器姿态, 与 ToCtrlAxesNode 的坐标约定一致
+static Urho3D::Quaternion sensor_orientation( const SENSOR_DB& sensor_db )
+{
+    return Urho3D::Quaternion( sensor_db.roll, sensor_db.yaw, sensor_db.pitch );
+}
@@ -1,6 +1,10 @@
 #pragma once
 //
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/format.h>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -41,6 +45,11 @@ static std::string transaction_to_string( float value )
     return out;
 }
 //
+static inline float transaction_to_value( float value )
+{
+    return std::isnan( value ) ? 0.0f : value;
+}
+//
 struct SENSOR_DB
 {
     float time    = 0.0f;
@@ -97,6 +106,20 @@ struct SENSOR_DB
         info += "Position: (" + transaction_to_string( pos_x ) + ", " + transaction_to_string( pos_y ) + ", " + transaction_to_string( pos_z ) + ")\n";
         return info;
     }
+    // 格式同 to_info, 直接写入可复用的缓冲区, 不产生临时字符串
+    void format_info( fmt::memory_buffer& out ) const
+    {
+        auto it = std::back_inserter( out );
+        fmt::format_to( it, "Time: {:f}\n", transaction_to_value( time ) );
+        fmt::format_to( it, "Accelerometer: ({:f}, {:f}, {:f})\n", transaction_to_value( acc_x ), transaction_to_value( acc_y ), transaction_to_value( acc_z ) );
+        fmt::format_to( it, "Gyroscope: ({:f}, {:f}, {:f})\n", transaction_to_value( gyro_x ), transaction_to_value( gyro_y ), transaction_to_value( gyro_z ) );
+        fmt::format_to( it, "Magnetometer: ({:f}, {:f}, {:f})\n", transaction_to_value( mag_x ), transaction_to_value( mag_y ), transaction_to_value( mag_z ) );
+        fmt::format_to( it, "Quaternion: ({:f}, {:f}, {:f}, {:f})\n", transaction_to_value( quate_x ), transaction_to_value( quate_y ), transaction_to_value( quate_z ), transaction_to_value( quate_w ) );
+        fmt::format_to( it, "Roll: {:f} pitch: {:f} yaw: {:f}\n", transaction_to_value( roll ), transaction_to_value( pitch ), transaction_to_value( yaw ) );
+        fmt::format_to( it, "Estimated Accelerometer: ({:f}, {:f}, {:f})\n", transaction_to_value( eacc_x ), transaction_to_value( eacc_y ), transaction_to_value( eacc_z ) );
+        fmt::format_to( it, "Estimated Velocity: ({:f}, {:f}, {:f})\n", transaction_to_value( vel_x ), transaction_to_value( vel_y ), transaction_to_value( vel_z ) );
+        fmt::format_to( it, "Position: ({:f}, {:f}, {:f})\n", transaction_to_value( pos_x ), transaction_to_value( pos_y ), transaction_to_value( pos_z ) );
+    }
     //
     void getValueFromString( std::string v )
     {
@@ -133,4 +156,127 @@ struct SENSOR_DB
             pos_z   = std::stof( values[ 25 ] );
         }
     }
-};
\ No newline at end of file
+};
+//
+// 可绘制的通道, 按 SENSOR_DB 字段顺序 (time 作为横轴, 不在其中)
+struct SENSOR_CHANNEL
+{
+    const char* name;
+    const char* axis;
+    float SENSOR_DB::*member;
+};
+//
+static constexpr int sensor_channel_count = 25;
+//
+static const SENSOR_CHANNEL sensor_channels[ sensor_channel_count ] = {
+    { "Accelerometer X", "X", &SENSOR_DB::acc_x },
+    { "Accelerometer Y", "Y", &SENSOR_DB::acc_y },
+    { "Accelerometer Z", "Z", &SENSOR_DB::acc_z },
+    { "Gyroscope X", "X", &SENSOR_DB::gyro_x },
+    { "Gyroscope Y", "Y", &SENSOR_DB::gyro_y },
+    { "Gyroscope Z", "Z", &SENSOR_DB::gyro_z },
+    { "Magnetometer X", "X", &SENSOR_DB::mag_x },
+    { "Magnetometer Y", "Y", &SENSOR_DB::mag_y },
+    { "Magnetometer Z", "Z", &SENSOR_DB::mag_z },
+    { "Quaternion X", "X", &SENSOR_DB::quate_x },
+    { "Quaternion Y", "Y", &SENSOR_DB::quate_y },
+    { "Quaternion Z", "Z", &SENSOR_DB::quate_z },
+    { "Quaternion W", "W", &SENSOR_DB::quate_w },
+    { "Roll", "Roll", &SENSOR_DB::roll },
+    { "Pitch", "Pitch", &SENSOR_DB::pitch },
+    { "Yaw", "Yaw", &SENSOR_DB::yaw },
+    { "Acceleration X", "X", &SENSOR_DB::eacc_x },
+    { "Acceleration Y", "Y", &SENSOR_DB::eacc_y },
+    { "Acceleration Z", "Z", &SENSOR_DB::eacc_z },
+    { "Speed X", "X", &SENSOR_DB::vel_x },
+    { "Speed Y", "Y", &SENSOR_DB::vel_y },
+    { "Speed Z", "Z", &SENSOR_DB::vel_z },
+    { "Position X", "X", &SENSOR_DB::pos_x },
+    { "Position Y", "Y", &SENSOR_DB::pos_y },
+    { "Position Z", "Z", &SENSOR_DB::pos_z },
+};
+//
+// 字段掩码: bit 0 为 time, bit c + 1 对应 sensor_channels[ c ]
+static constexpr int      sensor_field_count = sensor_channel_count + 1;
+static constexpr uint32_t sensor_mask_all    = ( 1u << sensor_field_count ) - 1;
+//
+// 导出文件的列名, 按字段顺序
+static const char* const sensor_field_keys[ sensor_field_count ] = {
+    "time",
+    "acc_x",   "acc_y",   "acc_z",   "gyro_x", "gyro_y", "gyro_z", "mag_x", "mag_y", "mag_z",
+    "quate_x", "quate_y", "quate_z", "quate_w", "roll",  "pitch",  "yaw",
+    "eacc_x",  "eacc_y",  "eacc_z",  "vel_x",  "vel_y",  "vel_z",  "pos_x", "pos_y", "pos_z",
+};
+//
+static inline uint32_t sensor_channel_bit( int channel )
+{
+    return 1u << ( channel + 1 );
+}
+// 掩码是否包含从 first_channel 起的 count 个通道
+static bool sensor_mask_has( uint32_t mask, int first_channel, int count )
+{
+    for ( int c = first_channel; c < first_channel + count; c++ )
+    {
+        if ( ( mask & sensor_channel_bit( c ) ) == 0 )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+//
+static inline float& sensor_field( SENSOR_DB& sensor_db, int field )
+{
+    return field == 0 ? sensor_db.time : sensor_db.*sensor_channels[ field - 1 ].member;
+}
+static inline float sensor_field( const SENSOR_DB& sensor_db, int field )
+{
+    return field == 0 ? sensor_db.time : sensor_db.*sensor_channels[ field - 1 ].member;
+}
+// 按掩码解析一行 CSV: 只包含掩码内的字段, 按字段顺序排列. 只读取 [ line, line + length ), 行尾的 '\r' 忽略;
+// 字段数不符, 字段为空, 或字段不是一个完整的数值时返回 false
+static bool sensor_parse_masked( SENSOR_DB& sensor_db, const char* line, size_t length, uint32_t mask )
+{
+    if ( length > 0 && line[ length - 1 ] == '\r' )
+    {
+        length--;
+    }
+    int fields = 1;
+    for ( size_t i = 0; i < length; i++ )
+    {
+        fields += line[ i ] == ',';
+    }
+    if ( fields != __builtin_popcount( mask ) )
+    {
+        return false;
+    }
+    const char* p   = line;
+    const char* eol = line + length;
+    for ( int f = 0; f < sensor_field_count; f++ )
+    {
+        if ( ( mask & ( 1u << f ) ) == 0 )
+        {
+            continue;
+        }
+        // 字段复制到以 0 结尾的缓冲再解析, strtof 不会越过字段 (行内没有结尾的 0, 也不能跳过换行读到下一行)
+        const char*  comma = ( const char* )memchr( p, ',', eol - p );
+        const char*  next  = comma != nullptr ? comma : eol;
+        const size_t size  = next - p;
+        char         field[ 48 ];
+        if ( size == 0 || size >= sizeof( field ) )
+        {
+            return false;
+        }
+        memcpy( field, p, size );
+        field[ size ] = '\0';
+        char*       end;
+        const float v = strtof( field, &end );
+        if ( end == field || end != field + size )
+        {
+            return false;
+        }
+        sensor_field( sensor_db, f ) = v;
+        p = comma != nullptr ? comma + 1 : eol;
+    }
+    return true;
+}
@@ -0,0 +1,322 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <vector>
+//
+// 多传感器时间对齐: 每个传感器一个时钟模型 (设备时间 -> 本地时间) 和一个抖动缓冲, 渲染时在同一时刻对所有传感器插值
+// 设备协议没有 ping / pong, 时钟模型只用到达时间. 思路与引擎的 Network/ClockSynchronizer 相同: 排队最少的帧延迟最小,
+// 以一段时间内的最小延迟为基准滤掉抖动; 这里按窗口取最小延迟并拟合直线, 斜率即两边时钟的漂移
+//   单位:  SENSOR_DB::time 的单位由开始 0.5 秒的到达间隔推断, 取 10 的整数次幂 (秒, 毫秒, 微秒)
+//   对齐:  本地时间 = base + drift * base, base = scale * 设备时间 + offset
+//   抖动:  到达时间 - 对齐后的时间, 模型正确时 >= 0; 明显为负 (early) 说明延迟基准变小了, 立即下调 offset
+// 播放时刻 = 现在 - delay. delay 取各传感器近期抖动的 95 分位加一个采样间隔, 需要时立即增大, 之后缓慢减小
+static constexpr int sensor_timeline_sensors = 16;  // 与 mocap_max_sensors 相同
+//
+struct SENSOR_CLOCK
+{
+    static constexpr double window  = 0.5;  // 秒, 每个窗口记录一个最小延迟
+    static constexpr int    windows = 32;   // 拟合使用的窗口数, 约 16 秒
+    //
+    double scale  = 0.0;  // 设备时间单位 -> 秒, 0 表示尚未确定
+    double offset = 0.0;
+    double drift  = 0.0;
+    bool   started = false;
+    double first_device = 0.0, first_local = 0.0, last_device = 0.0;
+    double window_begin = 0.0, window_delay = 0.0, window_local = 0.0;
+    std::vector< std::pair< double, double > > minima;  // ( 本地时间, 最小延迟 )
+    //
+    bool ready() const
+    {
+        return scale > 0.0 && ! minima.empty();
+    }
+    double align( double device ) const
+    {
+        const double base = scale * device + offset;
+        return base + drift * base;
+    }
+    //
+    void reset()
+    {
+        *this = SENSOR_CLOCK();
+    }
+    // 记录一帧的到达. 设备时间倒退超过 1 秒或前跳超过 10 秒 (设备重启) 时从头开始, 返回 false; 小幅倒退的乱序帧不参与估计
+    bool observe( double device, double local )
+    {
+        bool continuous = true;
+        if ( started && scale > 0.0 && device < last_device && scale * ( last_device - device ) < 1.0 )
+        {
+            return true;
+        }
+        if ( started && ( device < last_device || ( scale > 0.0 && scale * ( device - last_device ) > 10.0 ) ) )
+        {
+            reset();
+            continuous = false;
+        }
+        if ( ! started )
+        {
+            started      = true;
+            first_device = device;
+            first_local  = local;
+        }
+        last_device = device;
+        if ( scale <= 0.0 )
+        {
+            if ( local - first_local < window || device <= first_device )
+            {
+                return continuous;
+            }
+            scale        = pow( 10.0, std::round( log10( ( local - first_local ) / ( device - first_device ) ) ) );
+            window_begin = local;
+            window_delay = local - scale * device;
+            window_local = local;
+            minima.emplace_back( local, window_delay );
+            fit();
+            return continuous;
+        }
+        const double delay = local - scale * device;
+        if ( local - window_begin >= window )
+        {
+            minima.emplace_back( window_local, window_delay );
+            if ( ( int )minima.size() > windows )
+            {
+                minima.erase( minima.begin() );
+            }
+            fit();
+            window_begin = local;
+            window_delay = delay;
+            window_local = local;
+        }
+        else if ( delay < window_delay )
+        {
+            window_delay = delay;
+            window_local = local;
+        }
+        return continuous;
+    }
+    // 最小二乘拟合 delay = offset' + drift' * local; 跨度不足 4 秒时只取偏移
+    void fit()
+    {
+        const int n = ( int )minima.size();
+        double    t0 = minima.front().first, st = 0.0, sd = 0.0, stt = 0.0, std_ = 0.0;
+        for ( const auto& [ t, d ] : minima )
+        {
+            st += t - t0;
+            sd += d;
+            stt += ( t - t0 ) * ( t - t0 );
+            std_ += ( t - t0 ) * d;
+        }
+        const double span  = minima.back().first - t0;
+        const double denom = n * stt - st * st;
+        double       slope = n >= 4 && span >= 4.0 && denom > 0.0 ? ( n * std_ - st * sd ) / denom : 0.0;
+        slope              = std::max( -1e-3, std::min( slope, 1e-3 ) );  // 晶振漂移不会超过 1000 ppm
+        // 直线以最近的窗口为准: 整体平移到所有窗口最小值的下方
+        double intercept = sd / n - slope * st / n;
+        for ( const auto& [ t, d ] : minima )
+        {
+            intercept = std::min( intercept, d - slope * ( t - t0 ) );
+        }
+        // delay( L ) = intercept + slope * ( L - t0 ), 代入 L ~= base 得到 base + drift * base 的形式
+        drift  = slope;
+        offset = intercept - slope * t0;
+    }
+};
+//
+struct SENSOR_TIMELINE_TRACK
+{
+    struct ENTRY
+    {
+        double    time;  // 对齐后的本地时间
+        SENSOR_DB frame;
+    };
+    static constexpr int capacity = 1024;
+    static constexpr int samples  = 512;  // 抖动统计的样本数
+    //
+    SENSOR_CLOCK          clock;
+    std::deque< ENTRY >   entries;
+    std::vector< float >  jitter;
+    int                   jitter_next = 0;
+    double                period      = 0.0;  // 对齐后的帧间隔, 指数平均
+    double                last_arrival = 0.0;
+    // 统计
+    uint64_t frames = 0, late = 0, early = 0, duplicates = 0, underruns = 0, overflows = 0;
+    float    jitter_p95 = 0.0f;
+    //
+    void reset()
+    {
+        *this = SENSOR_TIMELINE_TRACK();
+    }
+};
+//
+struct SENSOR_TIMELINE
+{
+    std::chrono::steady_clock::time_point epoch     = std::chrono::steady_clock::now();
+    SENSOR_TIMELINE_TRACK                 tracks[ sensor_timeline_sensors ];
+    double                                delay     = 0.0;
+    double                                max_delay = 0.5;  // 秒, 缓冲深度的上限
+    double                                playout   = 0.0;  // 最近一次采样的播放时刻
+    double                                next_adapt = 0.0;
+    // 渲染线程: 最近一次采样的结果, current_mask 的第 s 位表示 current[ s ] 有效
+    SENSOR_DB current[ sensor_timeline_sensors ];
+    uint32_t  current_mask = 0;
+    //
+    double now() const
+    {
+        return std::chrono::duration< double >( std::chrono::steady_clock::now() - epoch ).count();
+    }
+    //
+    void reset()
+    {
+        for ( SENSOR_TIMELINE_TRACK& track : tracks )
+        {
+            track.reset();
+        }
+        delay        = 0.0;
+        playout      = 0.0;
+        next_adapt   = 0.0;
+        current_mask = 0;
+    }
+    // 接收线程 (调用方持有 queue_mutex): 一批帧在 arrival 时刻到达
+    void push( int sensor, const SENSOR_DB* frames, int count, double arrival )
+    {
+        SENSOR_TIMELINE_TRACK& track = tracks[ sensor ];
+        for ( int i = 0; i < count; i++ )
+        {
+            const SENSOR_DB& frame = frames[ i ];
+            if ( ! track.clock.observe( frame.time, arrival ) )
+            {
+                track.entries.clear();
+            }
+            track.frames++;
+            if ( ! track.clock.ready() )
+            {
+                continue;
+            }
+            double time = track.clock.align( frame.time );
+            if ( ! track.entries.empty() && time <= track.entries.back().time )
+            {
+                track.duplicates++;
+                continue;
+            }
+            float jitter = ( float )( arrival - time );
+            if ( jitter < -0.002f )
+            {
+                // 比模型预测的更早到达: 延迟基准变小, 平移模型
+                track.early++;
+                track.clock.offset += jitter;
+                time += jitter;
+                jitter = 0.0f;
+            }
+            if ( time < playout )
+            {
+                track.late++;
+            }
+            if ( ! track.entries.empty() )
+            {
+                const double spacing = time - track.entries.back().time;
+                track.period         = track.period > 0.0 ? track.period + ( spacing - track.period ) * 0.05 : spacing;
+            }
+            if ( ( int )track.jitter.size() < SENSOR_TIMELINE_TRACK::samples )
+            {
+                track.jitter.push_back( jitter );
+            }
+            else
+            {
+                track.jitter[ track.jitter_next ] = jitter;
+                track.jitter_next                 = ( track.jitter_next + 1 ) % SENSOR_TIMELINE_TRACK::samples;
+            }
+            if ( ( int )track.entries.size() >= SENSOR_TIMELINE_TRACK::capacity )
+            {
+                track.entries.pop_front();
+                track.overflows++;
+            }
+            track.entries.push_back( { time, frame } );
+        }
+        track.last_arrival = arrival;
+    }
+    // 渲染线程每帧调用一次 (调用方持有 queue_mutex): 调整缓冲深度, 在播放时刻对每个传感器插值, 结果写入 current
+    void update( double now )
+    {
+        if ( now >= next_adapt )
+        {
+            adapt();
+            next_adapt = now + 0.25;
+        }
+        playout      = now - delay;
+        current_mask = 0;
+        for ( int s = 0; s < sensor_timeline_sensors; s++ )
+        {
+            SENSOR_TIMELINE_TRACK& track = tracks[ s ];
+            if ( track.entries.empty() )
+            {
+                continue;
+            }
+            // 保留播放时刻之前的最后一帧作为插值起点
+            while ( track.entries.size() >= 2 && track.entries[ 1 ].time <= playout )
+            {
+                track.entries.pop_front();
+            }
+            const auto& a = track.entries.front();
+            if ( track.entries.size() < 2 || a.time > playout )
+            {
+                // 缓冲耗尽 (或尚未到达播放时刻), 保持最近一帧
+                track.underruns += a.time <= playout;
+                current[ s ] = track.entries.back().frame;
+            }
+            else
+            {
+                const auto& b = track.entries[ 1 ];
+                current[ s ]  = sensor_interpolate( a.frame, b.frame, ( float )( ( playout - a.time ) / ( b.time - a.time ) ) );
+            }
+            current_mask |= 1u << s;
+        }
+    }
+    // 缓冲深度: 所有活动传感器中最大的 (抖动 95 分位 + 帧间隔), 增大立即生效, 减小每次只走 10%
+    void adapt()
+    {
+        double target = 0.0;
+        for ( SENSOR_TIMELINE_TRACK& track : tracks )
+        {
+            if ( track.jitter.empty() )
+            {
+                continue;
+            }
+            std::vector< float > sorted = track.jitter;
+            const size_t         rank   = sorted.size() * 95 / 100;
+            std::nth_element( sorted.begin(), sorted.begin() + rank, sorted.end() );
+            track.jitter_p95 = sorted[ rank ];
+            target           = std::max( target, ( double )track.jitter_p95 + track.period );
+        }
+        target = std::min( target + 0.002, max_delay );
+        delay  = target > delay ? target : delay + ( target - delay ) * 0.1;
+    }
+    // 线性插值; 欧拉角走最短路径, 四元数先对齐符号再插值并归一化
+    static SENSOR_DB sensor_interpolate( const SENSOR_DB& a, const SENSOR_DB& b, float t )
+    {
+        SENSOR_DB out;
+        for ( int f = 0; f < sensor_field_count; f++ )
+        {
+            sensor_field( out, f ) = sensor_field( a, f ) + ( sensor_field( b, f ) - sensor_field( a, f ) ) * t;
+        }
+        for ( float SENSOR_DB::*angle : { &SENSOR_DB::roll, &SENSOR_DB::pitch, &SENSOR_DB::yaw } )
+        {
+            const float d = remainderf( b.*angle - a.*angle, 360.0f );
+            out.*angle    = remainderf( a.*angle + d * t, 360.0f );
+        }
+        const float sign = a.quate_x * b.quate_x + a.quate_y * b.quate_y + a.quate_z * b.quate_z + a.quate_w * b.quate_w < 0.0f ? -1.0f : 1.0f;
+        float       q[ 4 ] = { a.quate_x + ( sign * b.quate_x - a.quate_x ) * t, a.quate_y + ( sign * b.quate_y - a.quate_y ) * t,
+                               a.quate_z + ( sign * b.quate_z - a.quate_z ) * t, a.quate_w + ( sign * b.quate_w - a.quate_w ) * t };
+        const float n      = sqrtf( q[ 0 ] * q[ 0 ] + q[ 1 ] * q[ 1 ] + q[ 2 ] * q[ 2 ] + q[ 3 ] * q[ 3 ] );
+        if ( n > 0.0f )
+        {
+            out.quate_x = q[ 0 ] / n;
+            out.quate_y = q[ 1 ] / n;
+            out.quate_z = q[ 2 ] / n;
+            out.quate_w = q[ 3 ] / n;
+        }
+        return out;
+    }
+};
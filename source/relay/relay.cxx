@@ -0,0 +1,239 @@
+#include "relay/relay_server.h"
+#include "synthetic/imu_synth.h"
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Network/DataChannelConnection.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+//
+// 无界面 relay:
+//   relay --listen ws://0.0.0.0:18081 --source ws://192.168.254.115:18080/     设备端 -> relay -> 浏览器 (Connect 时勾选 Relay)
+//   relay --load 32 --sensors 15 --source-rate 200 --duration 10            本机回环压测: 内置数据源 + N 个回环观众
+// 每秒输出一行统计: 接收帧率, 快照编码数, 发送数与带宽, 回环观众的接收率
+// --record 同时在 <file>.events.csv 中保存检测到的事件
+struct RELAY_OPTIONS
+{
+    std::string listen = "ws://0.0.0.0:18081";
+    std::string source;
+    std::string record;
+    float       tick_rate   = 60.0f;
+    int         load        = 0;
+    int         sensors     = 1;
+    float       source_rate = 100.0f;
+    float       duration    = 0.0f;  // 秒, 0 为一直运行
+    uint32_t    mask        = 0;
+};
+//
+static std::atomic< bool > relay_running{ true };
+static FILE*               relay_record = nullptr;
+//
+static void relay_signal( int )
+{
+    relay_running = false;
+}
+// 录制旁路: 在接收线程上把每批帧按原始二进制帧格式追加写入
+static void relay_record_tap( const std::vector< SENSOR_DB >& frames, uint32_t mask, int sensor )
+{
+    static std::vector< uint8_t > buffer;
+    buffer.clear();
+    sensor_binary_encode( frames.data(), ( int )frames.size(), mask, buffer, ( uint8_t )sensor );
+    fwrite( buffer.data(), 1, buffer.size(), relay_record );
+}
+// 内置数据源: 合成数据 (source/synthetic) 不经过网络, 直接进入与设备数据相同的处理流程, 每毫秒一批
+static void relay_source_main( int sensors, float rate, uint32_t mask )
+{
+    using clock = std::chrono::steady_clock;
+    SYNTH_SOURCE source;
+    source.reset( sensors, rate );
+    const auto begin = clock::now();
+    while ( relay_running )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        const double elapsed = std::chrono::duration< double >( clock::now() - begin ).count();
+        source.pump( elapsed, [ mask ]( int sensor, const std::vector< SENSOR_DB >& frames ) { sensor_ingest_publish( frames, mask, sensor ); } );
+    }
+}
+// 回环观众: 与浏览器端相同的连接方式, 只计数
+struct RELAY_LOOPBACK
+{
+    Urho3D::SharedPtr< Urho3D::DataChannelConnection > connection;
+    std::atomic< uint64_t >                            received{ 0 };
+    std::atomic< uint64_t >                            bytes{ 0 };
+};
+//
+static bool relay_parse( int argc, char** argv, RELAY_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg   = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--listen" ) == 0 )
+            options.listen = value;
+        else if ( strcmp( arg, "--source" ) == 0 )
+            options.source = value;
+        else if ( strcmp( arg, "--record" ) == 0 )
+            options.record = value;
+        else if ( strcmp( arg, "--tick" ) == 0 )
+            options.tick_rate = ( float )atof( value );
+        else if ( strcmp( arg, "--load" ) == 0 )
+            options.load = atoi( value );
+        else if ( strcmp( arg, "--sensors" ) == 0 )
+            options.sensors = std::max( 1, std::min( atoi( value ), mocap_max_sensors ) );
+        else if ( strcmp( arg, "--source-rate" ) == 0 )
+            options.source_rate = ( float )atof( value );
+        else if ( strcmp( arg, "--duration" ) == 0 )
+            options.duration = ( float )atof( value );
+        else if ( strcmp( arg, "--mask" ) == 0 )
+            options.mask = ( uint32_t )strtoul( value, nullptr, 16 ) & sensor_mask_all;
+        else
+            return false;
+        i++;
+    }
+    return options.tick_rate > 0.0f && options.source_rate > 0.0f;
+}
+//
+int main( int argc, char** argv )
+{
+    RELAY_OPTIONS options;
+    if ( ! relay_parse( argc, argv, options ) )
+    {
+        printf( "usage: relay [--listen ws://0.0.0.0:18081] [--source ws://host:port/] [--record file] [--tick hz]\n"
+                "             [--load viewers] [--sensors n] [--source-rate hz] [--duration s] [--mask hex]\n" );
+        return 1;
+    }
+    signal( SIGINT, relay_signal );
+    signal( SIGTERM, relay_signal );
+    //
+    Urho3D::SharedPtr< Urho3D::Context > context( new Urho3D::Context() );
+    RELAY_SERVER                         relay;
+    if ( options.mask != 0 )
+    {
+        relay.mask = options.mask;
+    }
+    if ( ! relay.listen( context, options.listen ) )
+    {
+        printf( "Relay failed to listen on %s\n", options.listen.c_str() );
+        return 1;
+    }
+    if ( ! options.record.empty() )
+    {
+        relay_record = fopen( options.record.c_str(), "wb" );
+        if ( relay_record == nullptr )
+        {
+            printf( "Cannot open %s for recording\n", options.record.c_str() );
+            return 1;
+        }
+        sensor_ingest_tap = relay_record_tap;
+    }
+    // 数据源: 设备端 WebSocket, 否则使用内置数据源
+    std::thread source;
+    sensor_ingest_reset();
+    if ( ! options.source.empty() )
+    {
+        ingest_start( options.source );
+    }
+    else
+    {
+        source = std::thread( relay_source_main, options.sensors, options.source_rate, relay.mask );
+    }
+    // 回环观众连接到本机的信令地址
+    std::vector< std::unique_ptr< RELAY_LOOPBACK > > loopback;
+    const Urho3D::URL                                listen_url( options.listen.c_str() );
+    const std::string                                loopback_url = fmt::format( "ws://127.0.0.1:{}", listen_url.port_ );
+    for ( int v = 0; v < options.load; v++ )
+    {
+        auto            viewer         = std::make_unique< RELAY_LOOPBACK >();
+        RELAY_LOOPBACK* p              = viewer.get();
+        viewer->connection             = Urho3D::MakeShared< Urho3D::DataChannelConnection >( context );
+        viewer->connection->onMessage_ = [ p ]( ea::string_view data ) {
+            p->received.fetch_add( 1, std::memory_order_relaxed );
+            p->bytes.fetch_add( data.size(), std::memory_order_relaxed );
+        };
+        viewer->connection->Connect( Urho3D::URL( loopback_url.c_str() ) );
+        loopback.push_back( std::move( viewer ) );
+    }
+    //
+    using clock             = std::chrono::steady_clock;
+    const auto tick         = std::chrono::duration_cast< clock::duration >( std::chrono::duration< double >( 1.0 / options.tick_rate ) );
+    const auto begin        = clock::now();
+    auto       next_tick    = begin;
+    auto       next_log     = begin + std::chrono::seconds( 1 );
+    uint64_t   last_frames  = 0, last_snapshots = 0, last_sends = 0, last_bytes = 0, last_received = 0;
+    double     tick_seconds = 0.0;
+    int        ticks        = 0;
+    while ( relay_running )
+    {
+        std::this_thread::sleep_until( next_tick );
+        next_tick += tick;
+        const auto tick_begin = clock::now();
+        relay.tick();
+        tick_seconds += std::chrono::duration< double >( clock::now() - tick_begin ).count();
+        ticks++;
+        //
+        const auto now = clock::now();
+        if ( now >= next_log )
+        {
+            next_log += std::chrono::seconds( 1 );
+            const uint64_t frames    = sensor_ingest_frames.load();
+            const uint64_t snapshots = relay.snapshot_count.load();
+            const uint64_t sends     = relay.send_count.load();
+            const uint64_t bytes     = relay.send_bytes.load();
+            uint64_t       received  = 0;
+            for ( const auto& viewer : loopback )
+            {
+                received += viewer->received.load();
+            }
+            const uint64_t sent = sends - last_sends;
+            printf( "ingest %llu frames/s | %d viewers | %llu snapshots/s -> %llu sends/s, %.2f MB/s | tick %.1f us",
+                    ( unsigned long long )( frames - last_frames ), relay.viewer_count(), ( unsigned long long )( snapshots - last_snapshots ),
+                    ( unsigned long long )sent, ( bytes - last_bytes ) / 1e6, ticks > 0 ? tick_seconds / ticks * 1e6 : 0.0 );
+            if ( ! loopback.empty() )
+            {
+                printf( " | loopback %llu msgs/s (%.1f%% delivered)", ( unsigned long long )( received - last_received ),
+                        sent > 0 ? 100.0 * ( received - last_received ) / sent : 0.0 );
+            }
+            printf( "\n" );
+            fflush( stdout );
+            last_frames    = frames;
+            last_snapshots = snapshots;
+            last_sends     = sends;
+            last_bytes     = bytes;
+            last_received  = received;
+            tick_seconds   = 0.0;
+            ticks          = 0;
+        }
+        if ( options.duration > 0.0f && std::chrono::duration< double >( now - begin ).count() >= options.duration )
+        {
+            relay_running = false;
+        }
+    }
+    //
+    for ( const auto& viewer : loopback )
+    {
+        viewer->connection->Disconnect();
+    }
+    ingest_stop();
+    if ( source.joinable() )
+    {
+        source.join();
+    }
+    sensor_ingest_tap = nullptr;
+    if ( relay_record != nullptr )
+    {
+        fclose( relay_record );
+        // 录制期间检测到的事件写在录制文件旁边, 帧序号按各传感器在录制文件中的帧计
+        const std::string events = options.record + ".events.csv";
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        if ( ! sensor_events.save_csv( events.c_str() ) )
+        {
+            printf( "Cannot write %s\n", events.c_str() );
+        }
+    }
+    relay.stop();
+    return 0;
+}
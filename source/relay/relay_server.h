@@ -0,0 +1,169 @@
+#pragma once
+//
+#include "websocket/ingest_thread.h"
+#include <Urho3D/Network/DataChannelServer.h>
+#include <atomic>
+#include <mutex>
+//
+// relay: 设备数据在这里只解析, 校准, 录制一次; 每个 tick 把各传感器的最近一帧编码为快照, 编码一次后发给所有观众
+// 位姿快照走不可靠无序通道 (过期的帧没有重传的价值, 接收端按序号丢弃乱序的旧帧), 状态与控制消息走可靠有序通道
+struct RELAY_SERVER
+{
+    // 快照字段: time, 欧拉角, 位置 (观众端 3D 视图与动作捕捉所需)
+    uint32_t mask = 1u | sensor_channel_bit( 13 ) | sensor_channel_bit( 14 ) | sensor_channel_bit( 15 ) | sensor_channel_bit( 22 ) | sensor_channel_bit( 23 ) |
+                    sensor_channel_bit( 24 );
+    //
+    Urho3D::SharedPtr< Urho3D::DataChannelServer >               server;
+    std::mutex                                                   viewers_mutex;
+    ea::vector< Urho3D::SharedPtr< Urho3D::NetworkConnection > > viewers;
+    uint32_t                                                     sequence                         = 0;
+    uint32_t                                                     generations[ mocap_max_sensors ] = {};
+    uint32_t                                                     status_generation                = 0;
+    std::vector< uint8_t >                                       snapshots[ mocap_max_sensors ];
+    eastl::string                                                status;
+    // 统计, 由主循环按时间间隔取差值
+    std::atomic< uint64_t > snapshot_count{ 0 };
+    std::atomic< uint64_t > send_count{ 0 };
+    std::atomic< uint64_t > send_bytes{ 0 };
+    //
+    bool listen( Urho3D::Context* context, const std::string& url )
+    {
+        using namespace Urho3D;
+        server                  = MakeShared< DataChannelServer >( context );
+        server->onConnected_    = [ this ]( NetworkConnection* connection ) { connected( connection ); };
+        server->onDisconnected_ = [ this ]( NetworkConnection* connection ) { disconnected( connection ); };
+        return server->Listen( URL( url.c_str() ) );
+    }
+    //
+    void stop()
+    {
+        if ( server )
+        {
+            server->Stop();
+        }
+        std::lock_guard< std::mutex > lock( viewers_mutex );
+        viewers.clear();
+    }
+    //
+    int viewer_count()
+    {
+        std::lock_guard< std::mutex > lock( viewers_mutex );
+        return ( int )viewers.size();
+    }
+    // 在网络线程上调用
+    void connected( Urho3D::NetworkConnection* connection )
+    {
+        using namespace Urho3D;
+        WeakPtr< NetworkConnection > weak( connection );
+        connection->onMessage_ = [ this, weak ]( ea::string_view data ) {
+            if ( SharedPtr< NetworkConnection > viewer = weak.Lock() )
+            {
+                control( viewer, data );
+            }
+        };
+        eastl::string current;
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            current = websocket_receive_message;
+        }
+        if ( ! current.empty() )
+        {
+            connection->SendMessage( current, PacketType::ReliableOrdered );
+        }
+        std::lock_guard< std::mutex > lock( viewers_mutex );
+        viewers.push_back( SharedPtr< NetworkConnection >( connection ) );
+    }
+    //
+    void disconnected( Urho3D::NetworkConnection* connection )
+    {
+        std::lock_guard< std::mutex > lock( viewers_mutex );
+        viewers.erase( ea::remove_if( viewers.begin(), viewers.end(), [ connection ]( const auto& viewer ) { return viewer.Get() == connection; } ), viewers.end() );
+    }
+    // 观众的控制消息: 流量协商由 relay 直接应答 (快照格式固定, 所有观众共用), Stats 忽略, 其余转发给设备端
+    void control( Urho3D::NetworkConnection* viewer, ea::string_view data )
+    {
+        if ( data.empty() || ( uint8_t )data[ 0 ] < 0x20 )
+        {
+            return;
+        }
+        const std::string text( data.data(), data.size() );
+        if ( text.compare( 0, 5, "Rate:" ) == 0 )
+        {
+            viewer->SendMessage( fmt::format( "Rate:decimate=1,batch=1,mask={:x},format=binary", mask ).c_str(), Urho3D::PacketType::ReliableOrdered );
+        }
+        else if ( text.compare( 0, 6, "Stats:" ) != 0 )
+        {
+            ingest_send_text( text.c_str() );
+        }
+    }
+    // 主循环按固定频率调用
+    void tick()
+    {
+        using namespace Urho3D;
+        SENSOR_DB frames[ mocap_max_sensors ];
+        bool      changed[ mocap_max_sensors ] = {};
+        bool      has_status                   = false;
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            // 没有渲染线程取走显示帧
+            sensor_data_pending = 0;
+            for ( int s = 0; s < mocap_max_sensors; s++ )
+            {
+                if ( mocap_latest[ s ].generation != generations[ s ] )
+                {
+                    generations[ s ] = mocap_latest[ s ].generation;
+                    frames[ s ]      = mocap_latest[ s ].frame;
+                    changed[ s ]     = true;
+                }
+            }
+            if ( status_generation != websocket_status_generation )
+            {
+                status_generation = websocket_status_generation;
+                status            = websocket_receive_message;
+                has_status        = true;
+            }
+        }
+        // 编码一次
+        int encoded = 0;
+        for ( int s = 0; s < mocap_max_sensors; s++ )
+        {
+            if ( changed[ s ] )
+            {
+                snapshots[ s ].clear();
+                sensor_snapshot_encode( &frames[ s ], 1, mask, sequence, snapshots[ s ], ( uint8_t )s );
+                encoded++;
+            }
+        }
+        sequence++;
+        snapshot_count.fetch_add( encoded, std::memory_order_relaxed );
+        if ( encoded == 0 && ! has_status )
+        {
+            return;
+        }
+        // 分发 N 次
+        uint64_t                      sends = 0, bytes = 0;
+        std::lock_guard< std::mutex > lock( viewers_mutex );
+        for ( const SharedPtr< NetworkConnection >& viewer : viewers )
+        {
+            if ( viewer->GetState() != NetworkConnection::State::Connected )
+            {
+                continue;
+            }
+            for ( int s = 0; s < mocap_max_sensors; s++ )
+            {
+                if ( changed[ s ] )
+                {
+                    viewer->SendMessage( ea::string_view( ( const char* )snapshots[ s ].data(), snapshots[ s ].size() ), PacketType::UnreliableUnordered );
+                    sends++;
+                    bytes += snapshots[ s ].size();
+                }
+            }
+            if ( has_status )
+            {
+                viewer->SendMessage( status, PacketType::ReliableOrdered );
+            }
+        }
+        send_count.fetch_add( sends, std::memory_order_relaxed );
+        send_bytes.fetch_add( bytes, std::memory_order_relaxed );
+    }
+};
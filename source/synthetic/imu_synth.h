@@ -0,0 +1,456 @@
+#pragma once
+//
+#include "codec/sensor_binary.h"
+#include "codec/sensor_delta.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+//
+// 合成 IMU 数据源: 按脚本轨迹生成确定性的 SENSOR_DB 帧, 用于没有硬件时的压测与回归
+// 坐标与 sensor_orientation 一致: Y 轴向上, 姿态 = Ry( yaw ) * Rx( roll ) * Rz( pitch )
+// 单位: acc 为 g (比力, 静止时为 +1g 朝上), gyro 为 deg/s (机体系), mag 为 uT (机体系),
+//       eacc 为 m/s^2 (世界系线加速度), vel 为 m/s, pos 为 m, 欧拉角为度, time 为秒
+static constexpr double synth_gravity = 9.80665;
+//
+struct SYNTH_VEC3
+{
+    double x = 0.0, y = 0.0, z = 0.0;
+};
+static inline SYNTH_VEC3 operator+( const SYNTH_VEC3& a, const SYNTH_VEC3& b )
+{
+    return { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+static inline SYNTH_VEC3 operator*( const SYNTH_VEC3& a, double s )
+{
+    return { a.x * s, a.y * s, a.z * s };
+}
+//
+struct SYNTH_QUAT
+{
+    double w = 1.0, x = 0.0, y = 0.0, z = 0.0;
+};
+static inline SYNTH_QUAT operator*( const SYNTH_QUAT& a, const SYNTH_QUAT& b )
+{
+    return { a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+             a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w };
+}
+static inline SYNTH_QUAT synth_conjugate( const SYNTH_QUAT& q )
+{
+    return { q.w, -q.x, -q.y, -q.z };
+}
+// 与 Urho3D::Quaternion( x, y, z ) 相同: Ry( y ) * Rx( x ) * Rz( z ), 角度为度
+static SYNTH_QUAT synth_euler( double x, double y, double z )
+{
+    const double d = M_PI / 360.0;
+    const double sx = sin( x * d ), cx = cos( x * d ), sy = sin( y * d ), cy = cos( y * d ), sz = sin( z * d ), cz = cos( z * d );
+    return { cy * cx * cz + sy * sx * sz, cy * sx * cz + sy * cx * sz, sy * cx * cz - cy * sx * sz, cy * cx * sz - sy * sx * cz };
+}
+// 欧拉角输出到 ( -180, 180 ]
+static inline double synth_wrap_angle( double degrees )
+{
+    return degrees - 360.0 * ceil( ( degrees - 180.0 ) / 360.0 );
+}
+// 世界系向量转到机体系: q^-1 * v * q
+static SYNTH_VEC3 synth_to_body( const SYNTH_QUAT& q, const SYNTH_VEC3& v )
+{
+    const SYNTH_QUAT r = synth_conjugate( q ) * SYNTH_QUAT{ 0.0, v.x, v.y, v.z } * q;
+    return { r.x, r.y, r.z };
+}
+//
+// 轨迹关键点, 脚本每行一个: "time x y z roll pitch yaw", # 开头为注释, 轨迹循环播放
+struct SYNTH_KEY
+{
+    double time;
+    double value[ 6 ];  // x y z roll pitch yaw
+};
+//
+struct SYNTH_TRAJECTORY
+{
+    std::vector< SYNTH_KEY > keys;
+    //
+    SYNTH_TRAJECTORY()
+    {
+        // 默认: 8 秒一圈的水平绕行, 带起伏, 转弯时侧倾, 中途停顿 1 秒
+        parse( "0   0.0 0.0  0.0   0  0    0\n"
+               "1   1.0 0.1  0.5   5  10   20\n"
+               "2   1.5 0.0  1.5  15  -5   80\n"
+               "3   1.0 0.2  2.5  10  0   150\n"
+               "4   0.0 0.0  3.0   0  10  180\n"
+               "5   0.0 0.0  3.0   0  10  180\n"
+               "6  -1.0 0.1  2.0 -15  -5  250\n"
+               "7  -1.0 0.0  0.5 -10  5   320\n"
+               "8   0.0 0.0  0.0   0  0   360\n" );
+    }
+    // 解析成功且至少两个关键点时返回 true
+    bool parse( const std::string& script )
+    {
+        std::vector< SYNTH_KEY > parsed;
+        std::istringstream       lines( script );
+        std::string              line;
+        while ( std::getline( lines, line ) )
+        {
+            if ( line.empty() || line[ 0 ] == '#' )
+            {
+                continue;
+            }
+            SYNTH_KEY          key;
+            std::istringstream fields( line );
+            fields >> key.time;
+            for ( double& v : key.value )
+            {
+                fields >> v;
+            }
+            if ( fields.fail() || ( ! parsed.empty() && key.time <= parsed.back().time ) )
+            {
+                return false;
+            }
+            parsed.push_back( key );
+        }
+        if ( parsed.size() < 2 )
+        {
+            return false;
+        }
+        keys.swap( parsed );
+        return true;
+    }
+    //
+    double duration() const
+    {
+        return keys.back().time - keys.front().time;
+    }
+    // 三次 Hermite, 切线取 Catmull-Rom (按时间加权), 极值点与停顿处切线为 0, 停顿段保持静止
+    // 循环播放: 首尾之差按圈累加 (例如 yaw 每圈 +360), 位置首尾不同时会逐圈漂移. 输出值及其一阶, 二阶导数
+    void sample( double t, double value[ 6 ], double d1[ 6 ], double d2[ 6 ] ) const
+    {
+        const int    n      = ( int )keys.size();
+        const double period = duration();
+        const double loops  = floor( ( t - keys.front().time ) / period );
+        t -= loops * period;
+        int i = 0;
+        while ( i < n - 2 && t >= keys[ i + 1 ].time )
+        {
+            i++;
+        }
+        // 第 k 个关键点 (可越过首尾) 的时间与第 c 个值
+        auto key_time = [ & ]( int k ) {
+            return k < 0 ? keys[ k + n - 1 ].time - period : k >= n ? keys[ k - n + 1 ].time + period : keys[ k ].time;
+        };
+        auto key_value = [ & ]( int k, int c ) {
+            const double lap = keys.back().value[ c ] - keys.front().value[ c ];
+            return k < 0 ? keys[ k + n - 1 ].value[ c ] - lap : k >= n ? keys[ k - n + 1 ].value[ c ] + lap : keys[ k ].value[ c ];
+        };
+        auto tangent = [ & ]( int k, int c ) {
+            const double prev = key_value( k, c ) - key_value( k - 1, c ), next = key_value( k + 1, c ) - key_value( k, c );
+            return prev * next <= 0.0 ? 0.0 : ( key_value( k + 1, c ) - key_value( k - 1, c ) ) / ( key_time( k + 1 ) - key_time( k - 1 ) );
+        };
+        const double t0 = key_time( i ), h = key_time( i + 1 ) - t0;
+        const double s   = ( t - t0 ) / h;
+        const double h00 = 2 * s * s * s - 3 * s * s + 1, h10 = s * s * s - 2 * s * s + s, h01 = -2 * s * s * s + 3 * s * s, h11 = s * s * s - s * s;
+        const double d00 = 6 * s * s - 6 * s, d10 = 3 * s * s - 4 * s + 1, d01 = -6 * s * s + 6 * s, d11 = 3 * s * s - 2 * s;
+        const double e00 = 12 * s - 6, e10 = 6 * s - 4, e01 = -12 * s + 6, e11 = 6 * s - 2;
+        for ( int c = 0; c < 6; c++ )
+        {
+            const double v0 = key_value( i, c ) + loops * ( keys.back().value[ c ] - keys.front().value[ c ] );
+            const double v1 = v0 + key_value( i + 1, c ) - key_value( i, c );
+            const double m0 = tangent( i, c ) * h, m1 = tangent( i + 1, c ) * h;
+            value[ c ]      = h00 * v0 + h10 * m0 + h01 * v1 + h11 * m1;
+            d1[ c ]         = ( d00 * v0 + d10 * m0 + d01 * v1 + d11 * m1 ) / h;
+            d2[ c ]         = ( e00 * v0 + e10 * m0 + e01 * v1 + e11 * m1 ) / ( h * h );
+        }
+    }
+};
+//
+// 噪声与故障模型, 标准差按每个样本计
+struct SYNTH_NOISE
+{
+    double acc_noise        = 0.002;  // g
+    double gyro_noise       = 0.05;   // deg/s
+    double mag_noise        = 0.3;    // uT
+    double attitude_noise   = 0.02;   // deg, 服务端融合输出的姿态
+    double gyro_bias        = 0.5;    // deg/s, 初始零偏
+    double gyro_bias_walk   = 0.002;  // deg/s/sqrt(s), 零偏随机游走
+    double acc_bias         = 0.01;   // g
+    double hard_iron        = 15.0;   // uT, 每个设备固定的硬铁偏移
+    double disturb_period   = 20.0;   // 秒, 每个周期开始时出现一次磁场干扰, 0 为关闭
+    double disturb_length   = 2.0;    // 秒
+    double disturb_strength = 30.0;   // uT
+    double drop_rate        = 0.0;    // 丢包概率 (按帧)
+    double duplicate_rate   = 0.0;    // 重复概率 (按帧)
+};
+//
+// 单个虚拟设备. 帧 i 的时间为 i / rate, 相同的种子与参数总是产生相同的序列
+struct SYNTH_DEVICE
+{
+    int             id          = 0;
+    double          rate        = 100.0;
+    double          time_offset = 0.0;  // 多个设备在同一轨迹上错开
+    SYNTH_NOISE     noise;
+    std::mt19937_64 rng;
+    SYNTH_VEC3      gyro_bias, acc_bias, hard_iron;
+    int64_t         index = 0;
+    //
+    void reset( int device, double sample_rate, const SYNTH_NOISE& model, uint64_t seed )
+    {
+        id          = device;
+        rate        = sample_rate;
+        time_offset = device * 0.37;
+        noise       = model;
+        index       = 0;
+        rng.seed( seed * 0x9E3779B97F4A7C15ull + ( uint64_t )device );
+        gyro_bias = { gauss() * noise.gyro_bias, gauss() * noise.gyro_bias, gauss() * noise.gyro_bias };
+        acc_bias  = { gauss() * noise.acc_bias, gauss() * noise.acc_bias, gauss() * noise.acc_bias };
+        hard_iron = { gauss() * noise.hard_iron, gauss() * noise.hard_iron, gauss() * noise.hard_iron };
+    }
+    //
+    double gauss()
+    {
+        return std::normal_distribution< double >( 0.0, 1.0 )( rng );
+    }
+    double uniform()
+    {
+        return std::uniform_real_distribution< double >( 0.0, 1.0 )( rng );
+    }
+    // 磁场干扰: 每个周期开始时一段平滑升降的附加场, 方向按周期序号确定
+    SYNTH_VEC3 disturbance( double t ) const
+    {
+        if ( noise.disturb_period <= 0.0 || noise.disturb_length <= 0.0 )
+        {
+            return {};
+        }
+        const double phase = fmod( t, noise.disturb_period );
+        if ( phase >= noise.disturb_length )
+        {
+            return {};
+        }
+        const double   window = sin( M_PI * phase / noise.disturb_length );
+        const uint64_t cycle  = ( uint64_t )( t / noise.disturb_period ) * 2654435761u + ( uint64_t )id;
+        const double   a = ( cycle % 360 ) * M_PI / 180.0, b = ( ( cycle / 360 ) % 180 ) * M_PI / 180.0;
+        return SYNTH_VEC3{ cos( a ) * sin( b ), cos( b ), sin( a ) * sin( b ) } * ( noise.disturb_strength * window );
+    }
+    // 生成一帧 (无噪声的真值由轨迹解析求得, 再叠加传感器模型)
+    SENSOR_DB frame( const SYNTH_TRAJECTORY& trajectory, int64_t i )
+    {
+        const double t = ( double )i / rate;
+        const double h = 1e-3;
+        double       v[ 6 ], d1[ 6 ], d2[ 6 ], w[ 6 ], wd1[ 6 ], wd2[ 6 ];
+        trajectory.sample( t + time_offset, v, d1, d2 );
+        trajectory.sample( t + time_offset + h, w, wd1, wd2 );
+        const SYNTH_QUAT q  = synth_euler( v[ 3 ], v[ 5 ], v[ 4 ] );
+        const SYNTH_QUAT qn = synth_euler( w[ 3 ], w[ 5 ], w[ 4 ] );
+        // 机体角速度: 2 * vec( q^-1 * q( t + h ) ) / h
+        SYNTH_QUAT dq = synth_conjugate( q ) * qn;
+        if ( dq.w < 0.0 )
+        {
+            dq = { -dq.w, -dq.x, -dq.y, -dq.z };
+        }
+        const double rad_to_deg = 180.0 / M_PI;
+        const double walk       = noise.gyro_bias_walk / sqrt( rate );
+        gyro_bias               = gyro_bias + SYNTH_VEC3{ gauss() * walk, gauss() * walk, gauss() * walk };
+        //
+        const SYNTH_VEC3 accel{ d2[ 0 ], d2[ 1 ], d2[ 2 ] };
+        const SYNTH_VEC3 specific = synth_to_body( q, accel + SYNTH_VEC3{ 0.0, synth_gravity, 0.0 } ) * ( 1.0 / synth_gravity );
+        const SYNTH_VEC3 field    = synth_to_body( q, SYNTH_VEC3{ 0.0, -40.0, 20.0 } + disturbance( t ) ) + hard_iron;
+        //
+        SENSOR_DB db;
+        db.time    = ( float )t;
+        db.acc_x   = ( float )( specific.x + acc_bias.x + gauss() * noise.acc_noise );
+        db.acc_y   = ( float )( specific.y + acc_bias.y + gauss() * noise.acc_noise );
+        db.acc_z   = ( float )( specific.z + acc_bias.z + gauss() * noise.acc_noise );
+        db.gyro_x  = ( float )( 2.0 * dq.x / h * rad_to_deg + gyro_bias.x + gauss() * noise.gyro_noise );
+        db.gyro_y  = ( float )( 2.0 * dq.y / h * rad_to_deg + gyro_bias.y + gauss() * noise.gyro_noise );
+        db.gyro_z  = ( float )( 2.0 * dq.z / h * rad_to_deg + gyro_bias.z + gauss() * noise.gyro_noise );
+        db.mag_x   = ( float )( field.x + gauss() * noise.mag_noise );
+        db.mag_y   = ( float )( field.y + gauss() * noise.mag_noise );
+        db.mag_z   = ( float )( field.z + gauss() * noise.mag_noise );
+        db.quate_x = ( float )q.x;
+        db.quate_y = ( float )q.y;
+        db.quate_z = ( float )q.z;
+        db.quate_w = ( float )q.w;
+        db.roll    = ( float )synth_wrap_angle( v[ 3 ] + gauss() * noise.attitude_noise );
+        db.pitch   = ( float )synth_wrap_angle( v[ 4 ] + gauss() * noise.attitude_noise );
+        db.yaw     = ( float )synth_wrap_angle( v[ 5 ] + gauss() * noise.attitude_noise );
+        db.eacc_x  = ( float )d2[ 0 ];
+        db.eacc_y  = ( float )d2[ 1 ];
+        db.eacc_z  = ( float )d2[ 2 ];
+        db.vel_x   = ( float )d1[ 0 ];
+        db.vel_y   = ( float )d1[ 1 ];
+        db.vel_z   = ( float )d1[ 2 ];
+        db.pos_x   = ( float )v[ 0 ];
+        db.pos_y   = ( float )v[ 1 ];
+        db.pos_z   = ( float )v[ 2 ];
+        return db;
+    }
+    // 追加到 elapsed 秒为止应产生的帧, 含丢包与重复
+    void generate( const SYNTH_TRAJECTORY& trajectory, double elapsed, std::vector< SENSOR_DB >& out )
+    {
+        const int64_t target = ( int64_t )( elapsed * rate );
+        for ( ; index < target; index++ )
+        {
+            const SENSOR_DB db = frame( trajectory, index );
+            if ( noise.drop_rate > 0.0 && uniform() < noise.drop_rate )
+            {
+                continue;
+            }
+            out.push_back( db );
+            if ( noise.duplicate_rate > 0.0 && uniform() < noise.duplicate_rate )
+            {
+                out.push_back( db );
+            }
+        }
+    }
+};
+//
+// 一组虚拟设备共用一条轨迹, 设备 d 的帧以传感器编号 d 发出. 接收端只接受 mocap_max_sensors 个编号
+static constexpr int synth_max_devices = 16;
+//
+struct SYNTH_SOURCE
+{
+    SYNTH_TRAJECTORY            trajectory;
+    SYNTH_NOISE                 noise;
+    std::vector< SYNTH_DEVICE > devices;
+    uint64_t                    seed = 1;
+    std::vector< SENSOR_DB >    frames;
+    //
+    void reset( int device_count, double rate )
+    {
+        devices.assign( std::max( 1, std::min( device_count, synth_max_devices ) ), SYNTH_DEVICE() );
+        for ( int d = 0; d < ( int )devices.size(); d++ )
+        {
+            devices[ d ].reset( d, rate, noise, seed );
+        }
+    }
+    // 产生到 elapsed 秒为止的帧, 每个有新帧的设备回调一次: sink( int device, const std::vector< SENSOR_DB >& frames )
+    template < class SINK > void pump( double elapsed, SINK&& sink )
+    {
+        for ( int d = 0; d < ( int )devices.size(); d++ )
+        {
+            frames.clear();
+            devices[ d ].generate( trajectory, elapsed, frames );
+            if ( ! frames.empty() )
+            {
+                sink( d, frames );
+            }
+        }
+    }
+};
+//
+// 一个接收端的消息流, 按 Rate 协商 (见 websocket/flow_control.h) 降采样, 批量, 裁剪字段并编码
+// 文本协议没有传感器编号, 文本格式下只有设备 0 以文本发出, 其余设备仍为二进制帧
+enum SYNTH_FORMAT
+{
+    synth_format_text,
+    synth_format_binary,
+    synth_format_delta,
+};
+static constexpr const char* synth_format_names[] = { "text", "binary", "delta" };
+//
+struct SYNTH_STREAM
+{
+    SYNTH_FORMAT             format   = synth_format_binary;
+    int                      decimate = 1;
+    int                      batch    = 1;
+    uint32_t                 mask     = sensor_mask_all;
+    SENSOR_DELTA_ENCODER     delta[ synth_max_devices ];
+    int64_t                  counter[ synth_max_devices ] = {};
+    std::vector< SENSOR_DB > pending[ synth_max_devices ];
+    std::vector< uint8_t >   message;
+    std::string              text;
+    // 处理 "Rate:decimate=<n>,batch=<n>,mask=<hex>,format=<name>", 返回应答; 缺省的项保持不变
+    std::string control( const std::string& line )
+    {
+        auto value = [ & ]( const char* key, std::string& out ) {
+            size_t at = line.find( key );
+            if ( at == std::string::npos )
+            {
+                return false;
+            }
+            at += strlen( key );
+            out = line.substr( at, line.find( ',', at ) - at );
+            return true;
+        };
+        std::string v;
+        if ( value( "decimate=", v ) )
+        {
+            decimate = std::max( 1, atoi( v.c_str() ) );
+        }
+        if ( value( "batch=", v ) )
+        {
+            batch = std::max( 1, std::min( atoi( v.c_str() ), 0xFFFF ) );
+        }
+        if ( value( "mask=", v ) )
+        {
+            const uint32_t m = ( uint32_t )strtoul( v.c_str(), nullptr, 16 ) & sensor_mask_all;
+            mask             = m != 0 ? m : sensor_mask_all;
+        }
+        if ( value( "format=", v ) )
+        {
+            for ( int f = 0; f < 3; f++ )
+            {
+                format = v == synth_format_names[ f ] ? ( SYNTH_FORMAT )f : format;
+            }
+        }
+        for ( SENSOR_DELTA_ENCODER& encoder : delta )
+        {
+            encoder.restart();
+        }
+        return fmt::format( "Rate:decimate={},batch={},mask={:x}", decimate, batch, mask );
+    }
+    // 送入一个设备的新帧, 每凑满一批发出一条消息: emit( const uint8_t* data, size_t size, bool text )
+    template < class EMIT > void push( int device, const std::vector< SENSOR_DB >& frames, EMIT&& emit )
+    {
+        std::vector< SENSOR_DB >& queued = pending[ device ];
+        for ( const SENSOR_DB& sensor_db : frames )
+        {
+            if ( counter[ device ]++ % decimate == 0 )
+            {
+                queued.push_back( sensor_db );
+            }
+        }
+        size_t begin = 0;
+        for ( ; queued.size() - begin >= ( size_t )batch; begin += batch )
+        {
+            encode( device, queued.data() + begin, batch, emit );
+        }
+        queued.erase( queued.begin(), queued.begin() + begin );
+    }
+    //
+    template < class EMIT > void encode( int device, const SENSOR_DB* frames, int count, EMIT&& emit )
+    {
+        message.clear();
+        if ( format == synth_format_text && device == 0 )
+        {
+            // 只写掩码内的字段, 接收端按已应答的掩码解析
+            text.clear();
+            for ( int i = 0; i < count; i++ )
+            {
+                for ( int f = 0; f < sensor_field_count; f++ )
+                {
+                    if ( mask & ( 1u << f ) )
+                    {
+                        text += transaction_to_string( sensor_field( frames[ i ], f ) );
+                        text.push_back( ',' );
+                    }
+                }
+                text.back() = '\n';
+            }
+            text.pop_back();
+            emit( ( const uint8_t* )text.c_str(), text.size(), true );
+            return;
+        }
+        if ( format == synth_format_delta )
+        {
+            delta[ device ].mask   = mask;
+            delta[ device ].sensor = ( uint8_t )device;
+            delta[ device ].encode( frames, count, message );
+        }
+        else
+        {
+            sensor_binary_encode( frames, count, mask, message, ( uint8_t )device );
+        }
+        emit( message.data(), message.size(), false );
+    }
+};
@@ -0,0 +1,387 @@
+#include "synthetic/synth_ingest.h"
+#include "synthetic/synth_server.h"
+#include "websocket/flow_control.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+//
+// 合成数据源与接收压测, 作为接收吞吐, 队列行为与渲染开销的回归基准:
+//   synth --serve 18080 --devices 15 --rate 200                      模拟设备端, 浏览器 / relay 照常连接
+//   synth --bench --devices 16 --rate 6250 --format delta --batch 32  进程内实时数据源 + 模拟渲染循环, 经过完整的接收路径与流量控制
+//   synth --bench --connect ws://127.0.0.1:18080/ --format delta       同上, 但数据来自 --serve (或真实设备), 经过本机 WebSocket
+//   synth --flat --devices 16 --rate 6250 --format binary             预先编码 1 秒数据, 单线程全速解析与发布, 测上限
+// 每秒输出一行统计, --duration 秒后退出并输出汇总. 同样的 --seed 与参数产生完全相同的数据
+struct SYNTH_OPTIONS
+{
+    std::string mode      = "bench";
+    int         port      = 18080;
+    int         devices   = 1;
+    double      rate      = 100.0;  // 每个设备
+    std::string format    = "binary";
+    int         batch     = 1;
+    int         decimate  = 1;
+    bool        adaptive  = false;
+    uint32_t    mask      = sensor_mask_all;
+    float       fps       = 60.0f;
+    float       duration  = 10.0f;  // 秒, 0 为一直运行 (--flat 时不能为 0)
+    uint64_t    seed      = 1;
+    double      drop      = 0.0;
+    double      duplicate = 0.0;
+    std::string script;
+    std::string connect;
+};
+//
+static std::atomic< bool > synth_running{ true };
+//
+static void synth_signal( int )
+{
+    synth_running = false;
+}
+//
+static bool synth_parse( int argc, char** argv, SYNTH_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg = argv[ i ];
+        if ( strcmp( arg, "--bench" ) == 0 || strcmp( arg, "--flat" ) == 0 )
+        {
+            options.mode = arg + 2;
+            continue;
+        }
+        if ( strcmp( arg, "--adaptive" ) == 0 )
+        {
+            options.adaptive = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--serve" ) == 0 )
+        {
+            options.mode = "serve";
+            options.port = atoi( value );
+        }
+        else if ( strcmp( arg, "--devices" ) == 0 )
+            options.devices = std::max( 1, std::min( atoi( value ), synth_max_devices ) );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--format" ) == 0 )
+            options.format = value;
+        else if ( strcmp( arg, "--batch" ) == 0 )
+            options.batch = std::max( 1, atoi( value ) );
+        else if ( strcmp( arg, "--decimate" ) == 0 )
+            options.decimate = std::max( 1, atoi( value ) );
+        else if ( strcmp( arg, "--mask" ) == 0 )
+            options.mask = ( uint32_t )strtoul( value, nullptr, 16 ) & sensor_mask_all;
+        else if ( strcmp( arg, "--fps" ) == 0 )
+            options.fps = ( float )atof( value );
+        else if ( strcmp( arg, "--duration" ) == 0 )
+            options.duration = ( float )atof( value );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else if ( strcmp( arg, "--drop" ) == 0 )
+            options.drop = atof( value );
+        else if ( strcmp( arg, "--duplicate" ) == 0 )
+            options.duplicate = atof( value );
+        else if ( strcmp( arg, "--script" ) == 0 )
+            options.script = value;
+        else if ( strcmp( arg, "--connect" ) == 0 )
+            options.connect = value;
+        else
+            return false;
+        i++;
+    }
+    int format = -1;
+    for ( int f = 0; f < 3; f++ )
+    {
+        format = options.format == synth_format_names[ f ] ? f : format;
+    }
+    return format >= 0 && options.rate > 0.0 && options.fps > 0.0f && options.mask != 0 && ( options.mode != "flat" || options.duration > 0.0f );
+}
+//
+static bool synth_setup( const SYNTH_OPTIONS& options, SYNTH_SOURCE& source )
+{
+    if ( ! options.script.empty() )
+    {
+        std::ifstream file( options.script );
+        std::string   script( ( std::istreambuf_iterator< char >( file ) ), std::istreambuf_iterator< char >() );
+        if ( ! source.trajectory.parse( script ) )
+        {
+            printf( "Invalid trajectory script %s\n", options.script.c_str() );
+            return false;
+        }
+    }
+    source.seed                 = options.seed;
+    source.noise.drop_rate      = options.drop;
+    source.noise.duplicate_rate = options.duplicate;
+    source.reset( options.devices, options.rate );
+    return true;
+}
+//
+static std::string synth_rate_request( const SYNTH_OPTIONS& options )
+{
+    return fmt::format( "Rate:decimate={},batch={},mask={:x},format={}", options.decimate, options.batch, options.mask, options.format );
+}
+// 模拟设备端
+static int synth_serve( const SYNTH_OPTIONS& options )
+{
+    using clock = std::chrono::steady_clock;
+    SYNTH_SOURCE source;
+    SYNTH_SERVER server;
+    if ( ! synth_setup( options, source ) )
+    {
+        return 1;
+    }
+    if ( ! server.listen( options.port ) )
+    {
+        printf( "Cannot listen on port %d\n", options.port );
+        return 1;
+    }
+    printf( "Serving %d devices x %.0f Hz on ws://0.0.0.0:%d/\n", options.devices, options.rate, options.port );
+    const auto begin    = clock::now();
+    auto       last     = begin;
+    auto       next_log = begin + std::chrono::seconds( 1 );
+    double     elapsed  = 0.0;
+    uint64_t   last_messages = 0, last_bytes = 0;
+    while ( synth_running )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        const auto now = clock::now();
+        if ( server.restart.exchange( false ) )
+        {
+            source.reset( options.devices, options.rate );
+            elapsed = 0.0;
+        }
+        if ( ! server.paused )
+        {
+            elapsed += std::chrono::duration< double >( now - last ).count();
+        }
+        last = now;
+        source.pump( elapsed, [ & ]( int device, const std::vector< SENSOR_DB >& frames ) { server.push( device, frames ); } );
+        if ( now >= next_log )
+        {
+            next_log += std::chrono::seconds( 1 );
+            const uint64_t messages = server.message_count.load(), bytes = server.byte_count.load();
+            std::string    stats;
+            {
+                std::lock_guard< std::mutex > lock( server.stats_mutex );
+                stats = server.stats;
+            }
+            printf( "%d clients | %llu msgs/s, %.2f MB/s%s | %s\n", server.client_count(), ( unsigned long long )( messages - last_messages ), ( bytes - last_bytes ) / 1e6,
+                    server.paused ? " | paused" : "", stats.c_str() );
+            fflush( stdout );
+            last_messages = messages;
+            last_bytes    = bytes;
+        }
+        if ( options.duration > 0.0f && std::chrono::duration< double >( now - begin ).count() >= options.duration )
+        {
+            synth_running = false;
+        }
+    }
+    server.stop();
+    return 0;
+}
+// 进程内实时数据源 + 模拟渲染循环: 每帧取历史快照并遍历订阅的字段 (代替绘图), 取走显示队列, 读取各传感器最近一帧, 更新流量控制
+static int synth_bench( const SYNTH_OPTIONS& options )
+{
+    using clock = std::chrono::steady_clock;
+    if ( ! synth_setup( options, synth_local.source ) )
+    {
+        return 1;
+    }
+    FLOW_CONTROL flow;
+    flow.adaptive = options.adaptive;
+    flow.decimate = options.decimate;
+    flow.batch    = options.batch;
+    for ( int f = 0; f < 3; f++ )
+    {
+        flow.format = options.format == synth_format_names[ f ] ? f : flow.format;
+    }
+    // 轨迹, 噪声与种子保留在 synth_local.source 中, 启动时只按地址重建设备
+    if ( options.connect.empty() )
+    {
+        synth_local_start( fmt::format( "synth://{}x{}", options.devices, options.rate ) );
+    }
+    else
+    {
+        ingest_start( options.connect );
+    }
+    flow.negotiate();
+    //
+    const auto frame          = std::chrono::duration_cast< clock::duration >( std::chrono::duration< double >( 1.0 / options.fps ) );
+    const auto begin          = clock::now();
+    auto       next_frame     = begin;
+    auto       next_log       = begin + std::chrono::seconds( 1 );
+    double     render_seconds = 0.0, render_peak = 0.0;
+    int        frames         = 0;
+    uint64_t   last_busy      = 0;
+    double     checksum       = 0.0;
+    // 汇总
+    double  total_rate = 0.0, total_render = 0.0;
+    int     total_depth_peak = 0, intervals = 0;
+    int64_t total_dropped    = 0;
+    while ( synth_running )
+    {
+        std::this_thread::sleep_until( next_frame );
+        next_frame += frame;
+        const auto frame_begin = clock::now();
+        //
+        SENSOR_HISTORY_VIEW history = sensor_history_acquire();
+        flow.need( options.mask );
+        for ( int f = 0; f < sensor_field_count; f++ )
+        {
+            if ( history.column( f ) != nullptr )
+            {
+                for ( int64_t i = history.tail; i < history.head; i++ )
+                {
+                    checksum += history.at( f, i );
+                }
+            }
+        }
+        int depth;
+        {
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            depth               = sensor_data_pending;
+            sensor_data_pending = 0;
+            const double now = sensor_timeline.now();
+            sensor_timeline.update( now );
+            pose_interpolator.sample( now );
+            for ( int s = 0; s < options.devices; s++ )
+            {
+                checksum += mocap_latest[ s ].frame.yaw + sensor_timeline.current[ s ].yaw + pose_interpolator.rotation[ s ].w_;
+            }
+        }
+        flow.consume( depth );
+        flow.update();
+        sensor_history_release();
+        sensor_history_set_mask( flow.mask );
+        //
+        const double seconds = std::chrono::duration< double >( clock::now() - frame_begin ).count();
+        render_seconds += seconds;
+        render_peak = std::max( render_peak, seconds );
+        frames++;
+        const auto now = clock::now();
+        if ( now >= next_log )
+        {
+            next_log += std::chrono::seconds( 1 );
+            const uint64_t busy = synth_local.busy_us.load();
+            double         delay;
+            uint64_t       late = 0, underruns = 0;
+            {
+                std::lock_guard< std::mutex > lock( queue_mutex );
+                delay = sensor_timeline.delay;
+                for ( const SENSOR_TIMELINE_TRACK& track : sensor_timeline.tracks )
+                {
+                    late += track.late;
+                    underruns += track.underruns;
+                }
+            }
+            printf( "ingest %.0f frames/s, %.0f msgs/s | render %.1f fps, %.1f us/frame (peak %.1f) | depth %.1f (peak %d) | dropped %lld | "
+                    "decimate %d batch %d mask %x | timeline %.1f ms, late %llu, underrun %llu | source+ingest %.1f%% cpu\n",
+                    flow.ingest_rate, flow.message_rate, flow.render_rate, render_seconds / frames * 1e6, render_peak * 1e6, flow.depth_avg, flow.depth_peak,
+                    ( long long )flow.dropped, flow.decimate, flow.batch, flow.mask, delay * 1000.0, ( unsigned long long )late, ( unsigned long long )underruns,
+                    ( busy - last_busy ) / 1e4 );
+            fflush( stdout );
+            if ( flow.ingest_rate > 0.0f )
+            {
+                total_rate += flow.ingest_rate;
+                total_render += render_seconds / frames;
+                total_depth_peak = std::max( total_depth_peak, flow.depth_peak );
+                total_dropped += flow.dropped;
+                intervals++;
+            }
+            last_busy      = busy;
+            render_seconds = 0.0;
+            render_peak    = 0.0;
+            frames         = 0;
+        }
+        if ( options.duration > 0.0f && std::chrono::duration< double >( now - begin ).count() >= options.duration )
+        {
+            synth_running = false;
+        }
+    }
+    synth_local_stop();
+    ingest_stop();
+    if ( intervals > 0 )
+    {
+        const std::string source = options.connect.empty() ? fmt::format( "{} devices x {} Hz", options.devices, options.rate ) : options.connect;
+        printf( "summary: %s, %s, batch %d | ingest %.0f frames/s | render %.1f us/frame | depth peak %d | dropped %lld (checksum %g)\n", source.c_str(),
+                options.format.c_str(), options.batch, total_rate / intervals, total_render / intervals * 1e6, total_depth_peak, ( long long )total_dropped, checksum );
+    }
+    return 0;
+}
+// 全速解析: 预先编码 1 秒的数据, 在单线程上反复送入接收路径, 每条消息后取走显示队列 (否则队列无限增长)
+static int synth_flat( const SYNTH_OPTIONS& options )
+{
+    using clock = std::chrono::steady_clock;
+    SYNTH_SOURCE source;
+    SYNTH_STREAM stream;
+    if ( ! synth_setup( options, source ) )
+    {
+        return 1;
+    }
+    stream.control( synth_rate_request( options ) );
+    std::vector< std::vector< uint8_t > > messages;
+    std::vector< bool >                   texts;
+    size_t                                bytes = 0;
+    source.pump( 1.0, [ & ]( int device, const std::vector< SENSOR_DB >& frames ) {
+        stream.push( device, frames, [ & ]( const uint8_t* data, size_t size, bool text ) {
+            messages.emplace_back( data, data + size + ( text ? 1 : 0 ) );
+            texts.push_back( text );
+            bytes += size;
+        } );
+    } );
+    sensor_ingest_mask = stream.mask;
+    sensor_history_set_mask( options.mask );
+    //
+    const uint64_t frames_begin = sensor_ingest_frames.load();
+    const auto     begin        = clock::now();
+    uint64_t       rounds       = 0;
+    double         seconds      = 0.0;
+    while ( synth_running && seconds < options.duration )
+    {
+        sensor_ingest_reset();
+        for ( size_t m = 0; m < messages.size(); m++ )
+        {
+            if ( texts[ m ] )
+            {
+                sensor_ingest_text( ( const char* )messages[ m ].data() );
+            }
+            else
+            {
+                sensor_ingest_binary( messages[ m ].data(), messages[ m ].size() );
+            }
+            std::lock_guard< std::mutex > lock( queue_mutex );
+            sensor_data_pending = 0;
+        }
+        rounds++;
+        seconds = std::chrono::duration< double >( clock::now() - begin ).count();
+    }
+    const uint64_t frames = sensor_ingest_frames.load() - frames_begin;
+    printf( "flat: %d devices, %s, batch %d, mask %x | %zu msgs / %.2f MB per simulated second | %.0f frames/s, %.1f ns/frame, %.1f MB/s, %.1fx real time\n",
+            options.devices, options.format.c_str(), options.batch, options.mask, messages.size(), bytes / 1e6, frames / seconds, seconds * 1e9 / frames,
+            rounds * bytes / seconds / 1e6, rounds / seconds );
+    return 0;
+}
+//
+int main( int argc, char** argv )
+{
+    SYNTH_OPTIONS options;
+    if ( ! synth_parse( argc, argv, options ) )
+    {
+        printf( "usage: synth [--serve port | --bench | --flat] [--devices n] [--rate hz] [--format text|binary|delta] [--batch n] [--decimate n]\n"
+                "             [--adaptive] [--mask hex] [--fps hz] [--duration s] [--seed n] [--drop p] [--duplicate p] [--script file] [--connect url]\n" );
+        return 1;
+    }
+    signal( SIGINT, synth_signal );
+    signal( SIGTERM, synth_signal );
+    if ( options.mode == "serve" )
+    {
+        return synth_serve( options );
+    }
+    return options.mode == "flat" ? synth_flat( options ) : synth_bench( options );
+}
@@ -0,0 +1,143 @@
+#pragma once
+//
+#include "synthetic/imu_synth.h"
+#include "websocket/ingest_thread.h"
+#include <chrono>
+//
+// 进程内合成数据源: 与设备端走同一条解析与发布路径 (sensor_ingest_text / sensor_ingest_binary), 只是不经过网络
+// synth://<设备数>x<每个设备的采样率>, 例如 synth://15x100; 格式, 批量与掩码和设备端一样由客户端的 Rate 协商决定
+// 轨迹, 噪声模型与种子取 synth_local.source 中的设置
+// 有线程时在独立线程上每毫秒产生一批, 否则 (WASM 无 pthread) 由主循环调用 synth_local_poll
+// 控制消息经 ingest_local_send 进入这里: Rate 在数据线程上应答, Start / Pause / Reset 与设备端含义相同
+struct SYNTH_LOCAL
+{
+    SYNTH_SOURCE               source;
+    SYNTH_STREAM               stream;
+    std::mutex                 control_mutex;
+    std::vector< std::string > controls;  // 待处理的控制消息
+    std::atomic< bool >        running{ false };
+    std::thread                thread;
+    bool                       paused  = false;
+    double                     elapsed = 0.0;  // 数据源时间, 暂停时不前进
+    std::chrono::steady_clock::time_point last;
+    // 统计: 数据线程上产生与解析所用的时间
+    std::atomic< uint64_t > busy_us{ 0 };
+};
+static SYNTH_LOCAL synth_local;
+//
+static bool synth_local_send( const char* text )
+{
+    if ( ! synth_local.running )
+    {
+        return false;
+    }
+    std::lock_guard< std::mutex > lock( synth_local.control_mutex );
+    synth_local.controls.emplace_back( text );
+    return true;
+}
+// 在数据线程上调用
+static void synth_local_poll()
+{
+    using clock = std::chrono::steady_clock;
+    if ( ! synth_local.running )
+    {
+        return;
+    }
+    const auto                 begin = clock::now();
+    std::vector< std::string > controls;
+    {
+        std::lock_guard< std::mutex > lock( synth_local.control_mutex );
+        controls.swap( synth_local.controls );
+    }
+    for ( const std::string& text : controls )
+    {
+        if ( text.compare( 0, 5, "Rate:" ) == 0 )
+        {
+            sensor_ingest_text( synth_local.stream.control( text ).c_str() );
+        }
+        else if ( text == "Start" )
+        {
+            synth_local.paused = false;
+        }
+        else if ( text == "Pause" || text == "Stop" )
+        {
+            synth_local.paused = true;
+        }
+        else if ( text == "Reset" || text == "Clear" )
+        {
+            synth_local.source.reset( ( int )synth_local.source.devices.size(), synth_local.source.devices[ 0 ].rate );
+            synth_local.elapsed = 0.0;
+        }
+    }
+    if ( ! synth_local.paused )
+    {
+        synth_local.elapsed += std::chrono::duration< double >( begin - synth_local.last ).count();
+    }
+    synth_local.last = begin;
+    synth_local.source.pump( synth_local.elapsed, []( int device, const std::vector< SENSOR_DB >& frames ) {
+        synth_local.stream.push( device, frames, []( const uint8_t* data, size_t size, bool text ) {
+            if ( text )
+            {
+                sensor_ingest_text( ( const char* )data );
+            }
+            else
+            {
+                sensor_ingest_binary( data, size );
+            }
+        } );
+    } );
+    synth_local.busy_us.fetch_add( ( uint64_t )std::chrono::duration_cast< std::chrono::microseconds >( clock::now() - begin ).count(), std::memory_order_relaxed );
+}
+//
+static void synth_local_stop()
+{
+    synth_local.running = false;
+    if ( synth_local.thread.joinable() )
+    {
+        synth_local.thread.join();
+    }
+    if ( ingest_local_send == synth_local_send )
+    {
+        ingest_local_send = nullptr;
+        websocket_staus   = websocket_staus_closed;
+    }
+}
+// 返回 false 表示地址无效
+static bool synth_local_start( const std::string& url )
+{
+    synth_local_stop();
+    int   devices = 1;
+    float rate    = 100.0f;
+    if ( sscanf( url.c_str(), "synth://%dx%f", &devices, &rate ) != 2 || devices < 1 || rate <= 0.0f )
+    {
+        return false;
+    }
+    synth_local.stream = SYNTH_STREAM();
+    synth_local.source.reset( devices, rate );
+    synth_local.controls.clear();
+    synth_local.paused  = false;
+    synth_local.elapsed = 0.0;
+    synth_local.last    = std::chrono::steady_clock::now();
+    sensor_ingest_reset();
+    ingest_local_send   = synth_local_send;
+    synth_local.running = true;
+    websocket_staus     = websocket_staus_open;
+#if ! defined( __EMSCRIPTEN__ ) || defined( __EMSCRIPTEN_PTHREADS__ )
+    synth_local.thread = std::thread( [] {
+        while ( synth_local.running )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            synth_local_poll();
+        }
+    } );
+#endif
+    return true;
+}
+// 主循环每帧调用, 只在没有数据线程时产生数据
+static void synth_local_update()
+{
+    if ( ! synth_local.thread.joinable() )
+    {
+        synth_local_poll();
+    }
+}
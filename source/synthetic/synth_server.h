@@ -0,0 +1,396 @@
+#pragma once
+//
+#include "synthetic/imu_synth.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+//
+// 原生 Linux 的最小 WebSocket 服务端, 模拟设备端: 浏览器或 relay 像连接真实设备一样连接, 协议见 websocket/flow_control.h
+// 每个客户端独立协商 Rate (降采样, 批量, 掩码, 格式); 客户端的 Start / Pause / Reset 控制数据源, Stats 只记录
+static void synth_sha1( const uint8_t* data, size_t size, uint8_t digest[ 20 ] )
+{
+    uint32_t h[ 5 ] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::vector< uint8_t > m( data, data + size );
+    m.push_back( 0x80 );
+    while ( m.size() % 64 != 56 )
+    {
+        m.push_back( 0 );
+    }
+    for ( int i = 7; i >= 0; i-- )
+    {
+        m.push_back( ( uint8_t )( ( uint64_t )size * 8 >> ( i * 8 ) ) );
+    }
+    auto rol = []( uint32_t x, int n ) { return ( x << n ) | ( x >> ( 32 - n ) ); };
+    for ( size_t chunk = 0; chunk < m.size(); chunk += 64 )
+    {
+        uint32_t w[ 80 ];
+        for ( int i = 0; i < 16; i++ )
+        {
+            w[ i ] = ( uint32_t )m[ chunk + i * 4 ] << 24 | ( uint32_t )m[ chunk + i * 4 + 1 ] << 16 | ( uint32_t )m[ chunk + i * 4 + 2 ] << 8 | m[ chunk + i * 4 + 3 ];
+        }
+        for ( int i = 16; i < 80; i++ )
+        {
+            w[ i ] = rol( w[ i - 3 ] ^ w[ i - 8 ] ^ w[ i - 14 ] ^ w[ i - 16 ], 1 );
+        }
+        uint32_t a = h[ 0 ], b = h[ 1 ], c = h[ 2 ], d = h[ 3 ], e = h[ 4 ];
+        for ( int i = 0; i < 80; i++ )
+        {
+            const uint32_t f = i < 20 ? ( b & c ) | ( ~b & d ) : i < 40 ? b ^ c ^ d : i < 60 ? ( b & c ) | ( b & d ) | ( c & d ) : b ^ c ^ d;
+            const uint32_t k = i < 20 ? 0x5A827999 : i < 40 ? 0x6ED9EBA1 : i < 60 ? 0x8F1BBCDC : 0xCA62C1D6;
+            const uint32_t t = rol( a, 5 ) + f + e + k + w[ i ];
+            e = d;
+            d = c;
+            c = rol( b, 30 );
+            b = a;
+            a = t;
+        }
+        h[ 0 ] += a;
+        h[ 1 ] += b;
+        h[ 2 ] += c;
+        h[ 3 ] += d;
+        h[ 4 ] += e;
+    }
+    for ( int i = 0; i < 20; i++ )
+    {
+        digest[ i ] = ( uint8_t )( h[ i / 4 ] >> ( 24 - ( i % 4 ) * 8 ) );
+    }
+}
+//
+static std::string synth_base64( const uint8_t* data, size_t size )
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string       out;
+    for ( size_t i = 0; i < size; i += 3 )
+    {
+        const uint32_t v = ( uint32_t )data[ i ] << 16 | ( i + 1 < size ? ( uint32_t )data[ i + 1 ] << 8 : 0 ) | ( i + 2 < size ? data[ i + 2 ] : 0 );
+        out.push_back( table[ v >> 18 & 63 ] );
+        out.push_back( table[ v >> 12 & 63 ] );
+        out.push_back( i + 1 < size ? table[ v >> 6 & 63 ] : '=' );
+        out.push_back( i + 2 < size ? table[ v & 63 ] : '=' );
+    }
+    return out;
+}
+//
+static bool synth_read_all( int fd, uint8_t* data, size_t size )
+{
+    while ( size > 0 )
+    {
+        ssize_t n = ::recv( fd, data, size, 0 );
+        if ( n <= 0 )
+        {
+            return false;
+        }
+        data += n;
+        size -= ( size_t )n;
+    }
+    return true;
+}
+//
+static bool synth_write_all( int fd, const uint8_t* data, size_t size )
+{
+    while ( size > 0 )
+    {
+        ssize_t n = ::send( fd, data, size, MSG_NOSIGNAL );
+        if ( n <= 0 )
+        {
+            return false;
+        }
+        data += n;
+        size -= ( size_t )n;
+    }
+    return true;
+}
+//
+struct SYNTH_CLIENT
+{
+    int                    fd = -1;
+    std::atomic< bool >    open{ false };
+    std::atomic< bool >    finished{ false };  // 读线程已退出, 可以回收
+    std::mutex             mutex;  // 保护 stream 与写入, 数据与应答不会交错
+    SYNTH_STREAM           stream;
+    std::vector< uint8_t > frame;
+    std::thread            reader;
+    // 服务端发出的帧不加掩码 (调用方持有 mutex)
+    bool send( uint8_t opcode, const uint8_t* payload, size_t size )
+    {
+        frame.clear();
+        frame.push_back( 0x80 | opcode );
+        if ( size < 126 )
+        {
+            frame.push_back( ( uint8_t )size );
+        }
+        else if ( size <= 0xFFFF )
+        {
+            frame.push_back( 126 );
+            frame.push_back( ( uint8_t )( size >> 8 ) );
+            frame.push_back( ( uint8_t )size );
+        }
+        else
+        {
+            frame.push_back( 127 );
+            for ( int i = 7; i >= 0; i-- )
+            {
+                frame.push_back( ( uint8_t )( ( uint64_t )size >> ( i * 8 ) ) );
+            }
+        }
+        frame.insert( frame.end(), payload, payload + size );
+        if ( ! synth_write_all( fd, frame.data(), frame.size() ) )
+        {
+            open = false;
+            return false;
+        }
+        return true;
+    }
+};
+//
+struct SYNTH_SERVER
+{
+    int                                            listen_fd = -1;
+    std::atomic< bool >                            running{ false };
+    std::atomic< bool >                            paused{ false };
+    std::atomic< bool >                            restart{ false };  // 客户端发送 Reset, 数据源从 0 时刻重新开始
+    std::thread                                    acceptor;
+    std::mutex                                     clients_mutex;
+    std::vector< std::shared_ptr< SYNTH_CLIENT > > clients;
+    std::mutex                                     stats_mutex;
+    std::string                                    stats;  // 最近一次客户端报告
+    // 统计, 由主循环按时间间隔取差值
+    std::atomic< uint64_t > message_count{ 0 };
+    std::atomic< uint64_t > byte_count{ 0 };
+    //
+    bool listen( int port )
+    {
+        listen_fd = ::socket( AF_INET, SOCK_STREAM, 0 );
+        int on    = 1;
+        setsockopt( listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+        sockaddr_in addr     = {};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons( ( uint16_t )port );
+        addr.sin_addr.s_addr = htonl( INADDR_ANY );
+        if ( listen_fd < 0 || ::bind( listen_fd, ( sockaddr* )&addr, sizeof( addr ) ) != 0 || ::listen( listen_fd, 16 ) != 0 )
+        {
+            if ( listen_fd >= 0 )
+            {
+                ::close( listen_fd );
+            }
+            listen_fd = -1;
+            return false;
+        }
+        running  = true;
+        acceptor = std::thread( [ this ] { accept_main(); } );
+        return true;
+    }
+    //
+    void stop()
+    {
+        running = false;
+        if ( listen_fd >= 0 )
+        {
+            ::shutdown( listen_fd, SHUT_RDWR );
+        }
+        if ( acceptor.joinable() )
+        {
+            acceptor.join();
+        }
+        if ( listen_fd >= 0 )
+        {
+            ::close( listen_fd );
+            listen_fd = -1;
+        }
+        std::vector< std::shared_ptr< SYNTH_CLIENT > > closing;
+        {
+            std::lock_guard< std::mutex > lock( clients_mutex );
+            closing.swap( clients );
+        }
+        for ( auto& client : closing )
+        {
+            ::shutdown( client->fd, SHUT_RDWR );
+            client->reader.join();
+            ::close( client->fd );
+        }
+    }
+    //
+    int client_count()
+    {
+        std::lock_guard< std::mutex > lock( clients_mutex );
+        return ( int )std::count_if( clients.begin(), clients.end(), []( const auto& client ) { return client->open.load(); } );
+    }
+    //
+    void accept_main()
+    {
+        while ( running )
+        {
+            const int fd = ::accept( listen_fd, nullptr, nullptr );
+            if ( fd < 0 )
+            {
+                continue;
+            }
+            int on = 1;
+            setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+            auto client    = std::make_shared< SYNTH_CLIENT >();
+            client->fd     = fd;
+            client->reader = std::thread( [ this, client ] {
+                client_main( *client );
+                client->open     = false;
+                client->finished = true;
+            } );
+            std::lock_guard< std::mutex > lock( clients_mutex );
+            // 顺便回收读线程已结束的客户端
+            for ( auto it = clients.begin(); it != clients.end(); )
+            {
+                if ( ( *it )->finished )
+                {
+                    ( *it )->reader.join();
+                    ::close( ( *it )->fd );
+                    it = clients.erase( it );
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            clients.push_back( client );
+        }
+    }
+    // 每个客户端一个读线程: 握手, 然后处理控制消息
+    void client_main( SYNTH_CLIENT& client )
+    {
+        std::string request;
+        char        c;
+        while ( request.size() < 8192 && ( request.size() < 4 || request.compare( request.size() - 4, 4, "\r\n\r\n" ) != 0 ) && ::recv( client.fd, &c, 1, 0 ) == 1 )
+        {
+            request.push_back( c );
+        }
+        const size_t at = request.find( "Sec-WebSocket-Key:" );
+        if ( at == std::string::npos )
+        {
+            return;
+        }
+        const size_t begin = request.find_first_not_of( ' ', at + 18 );
+        std::string  key   = request.substr( begin, request.find( "\r\n", begin ) - begin ) + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        uint8_t      digest[ 20 ];
+        synth_sha1( ( const uint8_t* )key.data(), key.size(), digest );
+        const std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " +
+                                     synth_base64( digest, 20 ) + "\r\n\r\n";
+        if ( ! synth_write_all( client.fd, ( const uint8_t* )response.data(), response.size() ) )
+        {
+            return;
+        }
+        client.open = true;
+        std::vector< uint8_t > payload;
+        std::string            message;
+        while ( client.open )
+        {
+            uint8_t header[ 2 ];
+            if ( ! synth_read_all( client.fd, header, 2 ) )
+            {
+                break;
+            }
+            const uint8_t opcode = header[ 0 ] & 0x0F;
+            uint64_t      size   = header[ 1 ] & 0x7F;
+            if ( size >= 126 )
+            {
+                uint8_t ext[ 8 ];
+                int     n = size == 126 ? 2 : 8;
+                if ( ! synth_read_all( client.fd, ext, n ) )
+                {
+                    break;
+                }
+                size = 0;
+                for ( int i = 0; i < n; i++ )
+                {
+                    size = ( size << 8 ) | ext[ i ];
+                }
+            }
+            uint8_t mask[ 4 ] = { 0, 0, 0, 0 };
+            if ( ( ( header[ 1 ] & 0x80 ) && ! synth_read_all( client.fd, mask, 4 ) ) || size > ( 1u << 20 ) )
+            {
+                break;
+            }
+            payload.resize( size );
+            if ( ! synth_read_all( client.fd, payload.data(), size ) )
+            {
+                break;
+            }
+            for ( uint64_t i = 0; i < size; i++ )
+            {
+                payload[ i ] ^= mask[ i & 3 ];
+            }
+            if ( opcode == 0x8 )
+            {
+                break;
+            }
+            if ( opcode == 0x9 )
+            {
+                std::lock_guard< std::mutex > lock( client.mutex );
+                client.send( 0xA, payload.data(), payload.size() );
+                continue;
+            }
+            // 控制消息都很短, 不处理分片
+            if ( opcode == 0x1 && ( header[ 0 ] & 0x80 ) )
+            {
+                control( client, std::string( payload.begin(), payload.end() ) );
+            }
+        }
+    }
+    //
+    void control( SYNTH_CLIENT& client, const std::string& text )
+    {
+        if ( text.compare( 0, 5, "Rate:" ) == 0 )
+        {
+            std::lock_guard< std::mutex > lock( client.mutex );
+            const std::string             ack = client.stream.control( text );
+            client.send( 0x1, ( const uint8_t* )ack.data(), ack.size() );
+        }
+        else if ( text.compare( 0, 6, "Stats:" ) == 0 )
+        {
+            std::lock_guard< std::mutex > lock( stats_mutex );
+            stats = text;
+        }
+        else if ( text == "Start" )
+        {
+            paused = false;
+        }
+        else if ( text == "Pause" || text == "Stop" )
+        {
+            paused = true;
+        }
+        else if ( text == "Reset" || text == "Clear" )
+        {
+            restart = true;
+        }
+    }
+    // 数据源线程调用: 新帧按各客户端的协商编码后发出. 写入阻塞时数据源随之落后, 与设备端的 TCP 背压一致
+    void push( int device, const std::vector< SENSOR_DB >& frames )
+    {
+        std::vector< std::shared_ptr< SYNTH_CLIENT > > targets;
+        {
+            std::lock_guard< std::mutex > lock( clients_mutex );
+            targets = clients;
+        }
+        uint64_t messages = 0, bytes = 0;
+        for ( auto& client : targets )
+        {
+            if ( ! client->open )
+            {
+                continue;
+            }
+            std::lock_guard< std::mutex > lock( client->mutex );
+            client->stream.push( device, frames, [ & ]( const uint8_t* data, size_t size, bool text ) {
+                if ( client->open && client->send( text ? 0x1 : 0x2, data, size ) )
+                {
+                    messages++;
+                    bytes += size;
+                }
+            } );
+        }
+        message_count.fetch_add( messages, std::memory_order_relaxed );
+        byte_count.fetch_add( bytes, std::memory_order_relaxed );
+    }
+};
@@ -0,0 +1,173 @@
+#pragma once
+//
+#include "websocket/ingest_thread.h"
+#include <fmt/format.h>
+//
+// 流量控制: 每秒向服务端报告消费情况, 并按需协商降采样, 批量与字段掩码
+// 客户端 -> 服务端:
+//   Stats:rate=<帧/s>,messages=<消息/s>,fps=<渲染帧率>,depth=<平均队列深度>,max_depth=<最大队列深度>,dropped=<丢弃的历史帧>
+//   Rate:decimate=<n>,batch=<n>,mask=<hex>,format=<text|binary|delta>
+//     每 n 帧发送 1 帧, 每条消息携带 batch 帧, 只发送掩码内的字段. 文本帧以换行分隔,
+//     二进制帧见 codec/sensor_binary.h, 差分压缩帧 (弱网络) 见 codec/sensor_delta.h
+// 服务端 -> 客户端:
+//   Rate:decimate=<n>,batch=<n>,mask=<hex>   应答实际生效的设置, 客户端据此解析数据帧
+struct FLOW_CONTROL
+{
+    bool     adaptive   = true;
+    int      decimate   = 1;
+    int      batch      = 1;
+    uint32_t mask       = sensor_mask_all;
+    int      format     = 1;  // format_names 的下标
+    // 本间隔与本帧内各面板声明需要的字段. 新增字段立即协商, 不再需要的字段在间隔结束时退订
+    uint32_t wanted_mask = 0;
+    uint32_t frame_mask  = 0;
+    // 是否需要全速率完整数据 (例如 Allan 方差录制)
+    bool     full_rate   = false;
+    // 最近一次统计结果
+    float    ingest_rate  = 0.0f;
+    float    message_rate = 0.0f;
+    float    render_rate  = 0.0f;
+    float    depth_avg    = 0.0f;
+    int      depth_peak   = 0;
+    int64_t  dropped      = 0;
+    //
+    int64_t  interval_begin   = 0;
+    uint64_t frames_begin     = 0;
+    uint64_t messages_begin   = 0;
+    int64_t  dropped_begin    = 0;
+    int      render_frames    = 0;
+    int64_t  depth_sum        = 0;
+    int      depth_max        = 0;
+    int      calm_intervals   = 0;
+    int      sent_decimate    = 1;
+    int      sent_batch       = 1;
+    uint32_t sent_mask        = sensor_mask_all;
+    int      sent_format      = -1;
+    //
+    static constexpr const char* format_names[] = { "text", "binary", "delta" };
+    static constexpr int         max_decimate     = 64;
+    static constexpr int         max_batch        = 64;
+    static constexpr int         messages_per_sec = 120;  // 批量后的目标消息速率
+    static constexpr int         calm_to_recover  = 5;    // 连续多少个正常间隔后放宽降采样
+    static constexpr int64_t     interval         = 1000000;
+    //
+    void need( uint32_t fields )
+    {
+        wanted_mask |= fields;
+        frame_mask |= fields;
+    }
+    // 渲染线程每帧调用: depth 为本帧取走的队列帧数
+    void consume( int depth )
+    {
+        render_frames++;
+        depth_sum += depth;
+        depth_max = std::max( depth_max, depth );
+    }
+    // 渲染线程每帧结束时调用, 每个统计间隔发送一次报告与协商
+    void update()
+    {
+        const int64_t now = getMicrosecondTimestamp();
+        if ( interval_begin == 0 )
+        {
+            restart( now );
+        }
+        if ( ! full_rate && ( frame_mask & ~mask ) != 0 )
+        {
+            mask |= frame_mask;
+            negotiate();
+        }
+        frame_mask = 0;
+        if ( now - interval_begin < interval || render_frames == 0 )
+        {
+            return;
+        }
+        const double   seconds  = ( double )( now - interval_begin ) / 1000000.0;
+        const uint64_t frames   = sensor_ingest_frames.load( std::memory_order_relaxed );
+        const uint64_t messages = sensor_ingest_messages.load( std::memory_order_relaxed );
+        ingest_rate             = ( float )( ( double )( frames - frames_begin ) / seconds );
+        message_rate            = ( float )( ( double )( messages - messages_begin ) / seconds );
+        render_rate             = ( float )( render_frames / seconds );
+        depth_avg               = ( float )depth_sum / ( float )render_frames;
+        depth_peak              = depth_max;
+        dropped                 = sensor_history_dropped.load( std::memory_order_relaxed ) - dropped_begin;
+        //
+        ingest_send_text( fmt::format( "Stats:rate={:.0f},messages={:.0f},fps={:.1f},depth={:.1f},max_depth={},dropped={}", ingest_rate, message_rate, render_rate, depth_avg, depth_peak, dropped ).c_str() );
+        if ( adaptive )
+        {
+            adapt();
+        }
+        // time 始终保留, 作为图表横轴
+        mask = full_rate || wanted_mask == 0 ? sensor_mask_all : wanted_mask | 1u;
+        negotiate();
+        restart( now );
+    }
+    // 两次渲染之间到达的帧数上限: 读者持有快照时写者最多还能追加 sensor_history_capacity - item_count 帧, 留一半余量
+    static int depth_budget()
+    {
+        return std::max( 1, ( sensor_history_capacity - item_count ) / 2 );
+    }
+    // 落后 (历史丢帧, 或两次渲染之间到达的帧数超出预算) 时加倍降采样; 连续正常若干间隔,
+    // 且减半后预计的帧数仍在预算内时才减半. 只看到达量而不看帧率, 低刷新率显示器或被节流的页面不会因此降采样
+    void adapt()
+    {
+        const int  old_decimate = decimate;
+        const bool behind       = dropped > 0 || depth_peak > depth_budget();
+        if ( full_rate )
+        {
+            decimate       = 1;
+            calm_intervals = 0;
+        }
+        else if ( behind )
+        {
+            decimate       = std::min( decimate * 2, max_decimate );
+            calm_intervals = 0;
+        }
+        else if ( decimate > 1 && depth_peak * 2 <= depth_budget() && ++calm_intervals >= calm_to_recover )
+        {
+            decimate /= 2;
+            calm_intervals = 0;
+        }
+        // 按调整后的帧率批量, 使消息速率不超过 messages_per_sec
+        const float expected_rate = ingest_rate * ( float )old_decimate / ( float )decimate;
+        batch                     = std::max( 1, std::min( max_batch, ( int )( expected_rate / messages_per_sec ) ) );
+    }
+    //
+    void negotiate()
+    {
+        if ( decimate == sent_decimate && batch == sent_batch && mask == sent_mask && format == sent_format )
+        {
+            return;
+        }
+        ingest_send_text( fmt::format( "Rate:decimate={},batch={},mask={:x},format={}", decimate, batch, mask, format_names[ format ] ).c_str() );
+        sent_decimate = decimate;
+        sent_batch    = batch;
+        sent_mask     = mask;
+        sent_format   = format;
+    }
+    //
+    void restart( int64_t now )
+    {
+        interval_begin = now;
+        frames_begin   = sensor_ingest_frames.load( std::memory_order_relaxed );
+        messages_begin = sensor_ingest_messages.load( std::memory_order_relaxed );
+        dropped_begin  = sensor_history_dropped.load( std::memory_order_relaxed );
+        render_frames  = 0;
+        depth_sum      = 0;
+        depth_max      = 0;
+        wanted_mask    = 0;
+    }
+    // 新连接: 服务端从默认设置开始
+    void reset()
+    {
+        decimate       = 1;
+        batch          = 1;
+        mask           = sensor_mask_all;
+        sent_decimate  = 1;
+        sent_batch     = 1;
+        sent_mask      = sensor_mask_all;
+        sent_format    = -1;
+        calm_intervals = 0;
+        interval_begin = 0;
+        sensor_ingest_mask.store( sensor_mask_all, std::memory_order_relaxed );
+    }
+};
@@ -0,0 +1,158 @@
+#include "websocket/sensor_history.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+//
+// 环形历史 (sensor_history_append / acquire / release) 的并发压测, 以 -fsanitize=thread 编译:
+//   history_stress                               写者全速追加, 读者取快照, 持有随机时长后释放, 并周期性切换订阅掩码
+//   history_stress --seconds 30 --rate 20000     写者限速 (每秒帧数)
+// 写者与接收线程一样在 queue_mutex 内追加, 读者与 UI 线程一样不加锁读取快照.
+// 每个字段写入由帧序号与字段决定的值, 读者逐帧核对快照内的全部订阅字段; 出现错值, 快照越界或 ThreadSanitizer 报告时失败
+struct HISTORY_STRESS_OPTIONS
+{
+    double   seconds = 5.0;
+    double   rate    = 0.0;   // 0 为全速
+    int      hold_us = 2000;  // 读者持有快照的最长时间
+    int      toggle  = 64;    // 每隔多少个快照切换一次订阅掩码, 0 为不切换
+    uint64_t seed    = 1;
+};
+//
+static bool history_stress_parse( int argc, char** argv, HISTORY_STRESS_OPTIONS& options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        const char* arg   = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        if ( value == nullptr )
+        {
+            return false;
+        }
+        if ( strcmp( arg, "--seconds" ) == 0 )
+            options.seconds = atof( value );
+        else if ( strcmp( arg, "--rate" ) == 0 )
+            options.rate = atof( value );
+        else if ( strcmp( arg, "--hold-us" ) == 0 )
+            options.hold_us = std::max( 0, atoi( value ) );
+        else if ( strcmp( arg, "--toggle" ) == 0 )
+            options.toggle = std::max( 0, atoi( value ) );
+        else if ( strcmp( arg, "--seed" ) == 0 )
+            options.seed = strtoull( value, nullptr, 10 );
+        else
+            return false;
+        i++;
+    }
+    return options.seconds > 0.0 && options.rate >= 0.0;
+}
+// 第 i 帧字段 f 的值, 在 float 中精确表示
+static float history_stress_value( int64_t i, int f )
+{
+    return ( float )( ( i * 7 + f * 1000003 ) & 0xFFFFFF );
+}
+//
+int main( int argc, char** argv )
+{
+    using clock = std::chrono::steady_clock;
+    HISTORY_STRESS_OPTIONS options;
+    if ( ! history_stress_parse( argc, argv, options ) )
+    {
+        printf( "usage: history_stress [--seconds s] [--rate hz] [--hold-us n] [--toggle n] [--seed n]\n" );
+        return 1;
+    }
+    // 两个掩码交替: 全部字段, 以及只有时间戳与加速度计
+    const uint32_t masks[ 2 ] = { sensor_mask_all, 1u | sensor_channel_bit( 0 ) | sensor_channel_bit( 1 ) | sensor_channel_bit( 2 ) };
+    int64_t        since[ sensor_field_count ];  // 字段最近一次开始订阅时的 head, 之前的帧可能未写入该字段
+    sensor_history_set_mask( masks[ 0 ] );
+    for ( int f = 0; f < sensor_field_count; f++ )
+    {
+        since[ f ] = 0;
+    }
+    //
+    std::atomic< bool > running{ true };
+    std::thread         writer( [ & ]() {
+        const auto begin = clock::now();
+        for ( int64_t i = 0; running.load( std::memory_order_relaxed ); i++ )
+        {
+            SENSOR_DB frame;
+            {
+                std::lock_guard< std::mutex > lock( queue_mutex );
+                const int64_t                 index = sensor_history_head.load( std::memory_order_relaxed );
+                for ( int f = 0; f < sensor_field_count; f++ )
+                {
+                    sensor_field( frame, f ) = history_stress_value( index, f );
+                }
+                sensor_history_append( frame );
+            }
+            if ( options.rate > 0.0 )
+            {
+                std::this_thread::sleep_until( begin + std::chrono::duration< double >( ( i + 1 ) / options.rate ) );
+            }
+        }
+    } );
+    //
+    std::mt19937_64 random( options.seed );
+    const auto      begin      = clock::now();
+    int64_t         snapshots  = 0;
+    int64_t         verified   = 0;
+    int64_t         mismatches = 0;
+    int64_t         bad_views  = 0;
+    int64_t         last_head  = 0;
+    int             mask_index = 0;
+    while ( std::chrono::duration< double >( clock::now() - begin ).count() < options.seconds )
+    {
+        const SENSOR_HISTORY_VIEW view = sensor_history_acquire();
+        if ( view.head < last_head || view.tail > view.head || view.head - view.tail > item_count || view.head - view.tail > view.capacity )
+        {
+            bad_views++;
+        }
+        last_head = view.head;
+        // 模拟一帧渲染: 持有快照期间写者继续追加, 直到追上登记的 tail 后开始丢帧
+        if ( options.hold_us > 0 )
+        {
+            std::this_thread::sleep_for( std::chrono::microseconds( random() % options.hold_us ) );
+        }
+        for ( int f = 0; f < sensor_field_count; f++ )
+        {
+            const float* column = view.column( f );
+            if ( column == nullptr )
+            {
+                continue;
+            }
+            for ( int64_t i = std::max( view.tail, since[ f ] ); i < view.head; i++ )
+            {
+                mismatches += column[ i % view.capacity ] != history_stress_value( i, f );
+                verified++;
+            }
+        }
+        sensor_history_release();
+        snapshots++;
+        // 与 UI 一样在释放快照后调整订阅; 新分配的列只保证之后追加的帧
+        if ( options.toggle > 0 && snapshots % options.toggle == 0 )
+        {
+            const uint32_t previous = masks[ mask_index ];
+            mask_index ^= 1;
+            sensor_history_set_mask( masks[ mask_index ] );
+            const int64_t head = sensor_history_head.load( std::memory_order_seq_cst );
+            for ( int f = 0; f < sensor_field_count; f++ )
+            {
+                if ( ( masks[ mask_index ] & ~previous ) & ( 1u << f ) )
+                {
+                    since[ f ] = head;
+                }
+            }
+        }
+    }
+    running = false;
+    writer.join();
+    //
+    const int64_t written = sensor_history_head.load();
+    const int64_t dropped = sensor_history_dropped.load();
+    const double  elapsed = std::chrono::duration< double >( clock::now() - begin ).count();
+    printf( "%.1f s | written %lld (%.0f /s), dropped %lld | snapshots %lld, values verified %lld | mismatches %lld, bad snapshots %lld\n", elapsed,
+            ( long long )written, written / elapsed, ( long long )dropped, ( long long )snapshots, ( long long )verified, ( long long )mismatches, ( long long )bad_views );
+    const bool ok = mismatches == 0 && bad_views == 0 && snapshots > 0 && written > 0;
+    printf( "%s\n", ok ? "PASS" : "FAIL" );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,520 @@
+#pragma once
+//
+#include "websocket/wasmsocket.h"
+#include <Urho3D/Network/DataChannelConnection.h>
+#include <string>
+//
+// 数据接收线程: 解析, 校准与录制都在接收线程完成, 渲染线程只读取已发布的历史快照与最近一帧
+// WASM (pthread 构建): 常驻 worker 线程创建 socket, 回调派发到该线程
+// WASM (无 pthread):   回退为主线程接收
+// 原生 Linux:          普通 socket 线程 + 最小 WebSocket 客户端, 便于无界面压测同一套处理流程
+// relay://host:port:   连接 relay (source/relay), 信令走 WebSocket, 数据走 WebRTC 数据通道, 两个平台相同
+// synth://:            进程内的合成数据源 (source/synthetic), 不经过网络
+//
+// 进程内数据源运行时接管发往服务端的控制消息, 返回 false 表示未接管
+static bool ( *ingest_local_send )( const char* text ) = nullptr;
+static Urho3D::SharedPtr< Urho3D::DataChannelConnection > ingest_relay;
+// 数据通道的消息不区分文本与二进制: 二进制帧的首字节是类型 (< 0x20), 文本总是可打印字符开头
+static void ingest_relay_message( ea::string_view data )
+{
+    if ( data.empty() )
+    {
+        return;
+    }
+    if ( ( uint8_t )data[ 0 ] < 0x20 )
+    {
+        sensor_ingest_binary( ( const uint8_t* )data.data(), data.size() );
+        return;
+    }
+    const std::string text( data.data(), data.size() );
+    sensor_ingest_text( text.c_str() );
+}
+//
+static void ingest_relay_stop()
+{
+    if ( ingest_relay )
+    {
+        ingest_relay->Disconnect();
+        ingest_relay = nullptr;
+    }
+}
+//
+static void ingest_relay_start( Urho3D::Context* context, const std::string& url )
+{
+    ingest_relay_stop();
+    sensor_ingest_reset();
+    ingest_relay                  = Urho3D::MakeShared< Urho3D::DataChannelConnection >( context );
+    ingest_relay->onConnected_    = [] { websocket_staus = websocket_staus_open; };
+    ingest_relay->onDisconnected_ = [] { websocket_staus = websocket_staus_closed; };
+    ingest_relay->onError_        = [] { websocket_staus = websocket_staus_closed; };
+    ingest_relay->onMessage_      = ingest_relay_message;
+    const std::string signaling  = "ws://" + url.substr( url.compare( 0, 8, "relay://" ) == 0 ? 8 : 0 );
+    if ( ! ingest_relay->Connect( Urho3D::URL( signaling.c_str() ) ) )
+    {
+        printf( "Relay connection to %s failed!\n", signaling.c_str() );
+        ingest_relay = nullptr;
+    }
+}
+// 控制消息走可靠有序通道, 未连接 relay 时返回 false
+static bool ingest_relay_send( const char* text )
+{
+    if ( ! ingest_relay || ingest_relay->GetState() != Urho3D::NetworkConnection::State::Connected )
+    {
+        return false;
+    }
+    ingest_relay->SendMessage( ea::string_view( text ), Urho3D::PacketType::ReliableOrdered );
+    return true;
+}
+#ifdef __EMSCRIPTEN__
+    #include <emscripten/emscripten.h>
+    #ifdef __EMSCRIPTEN_PTHREADS__
+        #include <emscripten/threading.h>
+        #include <pthread.h>
+    #endif
+//
+static std::atomic< EMSCRIPTEN_WEBSOCKET_T > ingest_socket{ 0 };
+//
+// 在接收线程上执行: 关闭旧连接并创建新连接, 回调注册到调用线程
+static void ingest_connect( char* url )
+{
+    sensor_ingest_reset();
+    EMSCRIPTEN_WEBSOCKET_T previous = ingest_socket.exchange( 0 );
+    if ( previous > 0 )
+    {
+        emscripten_websocket_close( previous, 1000, "reconnect" );
+        emscripten_websocket_delete( previous );
+    }
+    //
+    EmscriptenWebSocketCreateAttributes attr;
+    emscripten_websocket_init_create_attributes( &attr );
+    attr.url = url;
+    //
+    EMSCRIPTEN_WEBSOCKET_T socket = emscripten_websocket_new( &attr );
+    free( url );
+    if ( socket <= 0 )
+    {
+        printf( "WebSocket creation failed, error code %d!\n", ( EMSCRIPTEN_RESULT )socket );
+        return;
+    }
+    //
+    emscripten_websocket_set_onopen_callback( socket, ( void* )42, WebSocketOpen );
+    emscripten_websocket_set_onclose_callback( socket, ( void* )43, WebSocketClose );
+    emscripten_websocket_set_onerror_callback( socket, ( void* )44, WebSocketError );
+    emscripten_websocket_set_onmessage_callback( socket, ( void* )45, WebSocketMessage );
+    ingest_socket = socket;
+}
+//
+    #ifdef __EMSCRIPTEN_PTHREADS__
+static pthread_t ingest_thread;
+static bool      ingest_thread_running = false;
+//
+static void* ingest_thread_main( void* )
+{
+    // 线程函数返回后 worker 保持存活, 继续处理派发来的连接请求与 socket 事件
+    emscripten_exit_with_live_runtime();
+    return nullptr;
+}
+    #endif
+//
+static void ingest_start( const std::string& url )
+{
+    if ( ! emscripten_websocket_is_supported() )
+    {
+        printf( "WebSockets are not supported, cannot continue!\n" );
+        return;
+    }
+    ingest_relay_stop();
+    char* url_copy = strdup( url.c_str() );
+    #ifdef __EMSCRIPTEN_PTHREADS__
+    if ( ! ingest_thread_running )
+    {
+        ingest_thread_running = pthread_create( &ingest_thread, nullptr, ingest_thread_main, nullptr ) == 0;
+    }
+    if ( ingest_thread_running )
+    {
+        emscripten_dispatch_to_thread_async( ingest_thread, EM_FUNC_SIG_VI, ( void* )ingest_connect, nullptr, url_copy );
+        return;
+    }
+    #endif
+    ingest_connect( url_copy );
+}
+//
+static void ingest_send_text( const char* text )
+{
+    if ( ( ingest_local_send != nullptr && ingest_local_send( text ) ) || ingest_relay_send( text ) )
+    {
+        return;
+    }
+    EMSCRIPTEN_WEBSOCKET_T socket = ingest_socket;
+    if ( socket > 0 )
+    {
+        emscripten_websocket_send_utf8_text( socket, text );
+    }
+}
+//
+static void ingest_stop()
+{
+    ingest_relay_stop();
+    EMSCRIPTEN_WEBSOCKET_T socket = ingest_socket.exchange( 0 );
+    if ( socket > 0 )
+    {
+        emscripten_websocket_close( socket, 1000, "stop" );
+    }
+}
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+//
+// 连接与握手都在接收线程完成, 调用 ingest_start 的线程不会阻塞.
+// ingest_fd 持有当前 socket: 谁把它从 ingest_fd 取走谁负责关闭 (ingest_stop 在 join 之后, 或接收线程自己退出时)
+static std::thread        ingest_thread;
+static std::atomic< int > ingest_fd{ -1 };
+static std::atomic< bool > ingest_stopping{ false };
+// 发送状态与握手前排队的控制消息, 受 ingest_send_mutex 保护: 连接中排队, 握手完成后按序发出, 关闭后丢弃
+static std::mutex                 ingest_send_mutex;
+static constexpr int              ingest_state_closed     = 0;
+static constexpr int              ingest_state_connecting = 1;
+static constexpr int              ingest_state_open       = 2;
+static int                        ingest_state            = ingest_state_closed;
+static std::vector< std::string > ingest_pending;
+// 单条消息 (含全部分片) 的上限. 长度来自服务端, 超出时以 1009 关闭连接, 不按其分配内存
+static constexpr uint64_t ingest_max_message = 16u << 20;
+//
+static bool ingest_write_all( int fd, const uint8_t* data, size_t size )
+{
+    while ( size > 0 )
+    {
+        ssize_t n = ::send( fd, data, size, MSG_NOSIGNAL );
+        if ( n <= 0 )
+        {
+            return false;
+        }
+        data += n;
+        size -= ( size_t )n;
+    }
+    return true;
+}
+//
+static bool ingest_read_all( int fd, uint8_t* data, size_t size )
+{
+    while ( size > 0 )
+    {
+        ssize_t n = ::recv( fd, data, size, 0 );
+        if ( n <= 0 )
+        {
+            return false;
+        }
+        data += n;
+        size -= ( size_t )n;
+    }
+    return true;
+}
+// 客户端发出的帧必须加掩码. 调用方持有 ingest_send_mutex
+static bool ingest_write_frame( int fd, uint8_t opcode, const uint8_t* payload, size_t size )
+{
+    std::vector< uint8_t > frame;
+    frame.reserve( size + 14 );
+    frame.push_back( 0x80 | opcode );
+    if ( size < 126 )
+    {
+        frame.push_back( 0x80 | ( uint8_t )size );
+    }
+    else if ( size <= 0xFFFF )
+    {
+        frame.push_back( 0x80 | 126 );
+        frame.push_back( ( uint8_t )( size >> 8 ) );
+        frame.push_back( ( uint8_t )size );
+    }
+    else
+    {
+        frame.push_back( 0x80 | 127 );
+        for ( int i = 7; i >= 0; i-- )
+        {
+            frame.push_back( ( uint8_t )( ( uint64_t )size >> ( i * 8 ) ) );
+        }
+    }
+    const uint8_t mask[ 4 ] = { 0x12, 0x34, 0x56, 0x78 };
+    frame.insert( frame.end(), mask, mask + 4 );
+    for ( size_t i = 0; i < size; i++ )
+    {
+        frame.push_back( payload[ i ] ^ mask[ i & 3 ] );
+    }
+    return ingest_write_all( fd, frame.data(), frame.size() );
+}
+//
+static bool ingest_send_frame( int fd, uint8_t opcode, const uint8_t* payload, size_t size )
+{
+    std::lock_guard< std::mutex > lock( ingest_send_mutex );
+    return ingest_write_frame( fd, opcode, payload, size );
+}
+// 切换发送状态, 离开连接中状态时丢弃排队的消息
+static void ingest_set_state( int state )
+{
+    std::lock_guard< std::mutex > lock( ingest_send_mutex );
+    ingest_state = state;
+    if ( state != ingest_state_connecting )
+    {
+        ingest_pending.clear();
+    }
+}
+// 接收线程放弃 fd: 仍由 ingest_fd 持有时取走并关闭, 否则 ingest_stop 已取走, 由它关闭
+static void ingest_release( int fd )
+{
+    int expected = fd;
+    if ( ingest_fd.compare_exchange_strong( expected, -1 ) )
+    {
+        ::close( fd );
+    }
+}
+// 非阻塞连接, 每 100 ms 检查一次 ingest_stop, 最多等待 10 秒
+static bool ingest_connect_socket( int fd, const addrinfo* ai )
+{
+    const int flags = fcntl( fd, F_GETFL, 0 );
+    fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+    bool connected   = ::connect( fd, ai->ai_addr, ai->ai_addrlen ) == 0;
+    bool in_progress = ! connected && errno == EINPROGRESS;
+    for ( int waited = 0; in_progress && waited < 10000 && ! ingest_stopping.load(); waited += 100 )
+    {
+        pollfd p = { fd, POLLOUT, 0 };
+        if ( poll( &p, 1, 100 ) > 0 )
+        {
+            int       error = 0;
+            socklen_t size  = sizeof( error );
+            connected       = getsockopt( fd, SOL_SOCKET, SO_ERROR, &error, &size ) == 0 && error == 0;
+            in_progress     = false;
+        }
+    }
+    fcntl( fd, F_SETFL, flags );
+    return connected && ! ingest_stopping.load();
+}
+// 解析 ws://host:port/path, 连接并完成握手. socket 创建后立即登记到 ingest_fd, 使 ingest_stop 能中断握手
+static int ingest_open( const std::string& url )
+{
+    std::string rest = url.compare( 0, 5, "ws://" ) == 0 ? url.substr( 5 ) : url;
+    size_t      slash = rest.find( '/' );
+    std::string path  = slash == std::string::npos ? "/" : rest.substr( slash );
+    std::string host  = rest.substr( 0, slash );
+    std::string port  = "80";
+    size_t      colon = host.rfind( ':' );
+    if ( colon != std::string::npos )
+    {
+        port = host.substr( colon + 1 );
+        host = host.substr( 0, colon );
+    }
+    //
+    addrinfo hints = {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result  = nullptr;
+    if ( getaddrinfo( host.c_str(), port.c_str(), &hints, &result ) != 0 )
+    {
+        return -1;
+    }
+    int fd = -1;
+    for ( addrinfo* ai = result; ai != nullptr && fd < 0 && ! ingest_stopping.load(); ai = ai->ai_next )
+    {
+        fd = ::socket( ai->ai_family, ai->ai_socktype, ai->ai_protocol );
+        if ( fd < 0 )
+        {
+            continue;
+        }
+        ingest_fd = fd;
+        if ( ! ingest_connect_socket( fd, ai ) )
+        {
+            ingest_release( fd );
+            fd = -1;
+        }
+    }
+    freeaddrinfo( result );
+    if ( fd < 0 )
+    {
+        return -1;
+    }
+    //
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host + ":" + port +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    std::string response;
+    char        c;
+    bool        ok = ingest_write_all( fd, ( const uint8_t* )request.data(), request.size() );
+    // 逐字节读取响应头, 避免吞掉紧随其后的数据帧
+    while ( ok && response.size() < 4096 && ( response.size() < 4 || response.compare( response.size() - 4, 4, "\r\n\r\n" ) != 0 ) )
+    {
+        ok = ::recv( fd, &c, 1, 0 ) == 1;
+        response.push_back( c );
+    }
+    if ( ! ok || response.compare( 0, 12, "HTTP/1.1 101" ) != 0 )
+    {
+        ingest_release( fd );
+        return -1;
+    }
+    // 握手完成: 先按序发出排队的控制消息, 再允许直接发送
+    std::lock_guard< std::mutex > lock( ingest_send_mutex );
+    if ( ingest_stopping.load() )
+    {
+        ingest_release( fd );
+        return -1;
+    }
+    for ( const std::string& text : ingest_pending )
+    {
+        ingest_write_frame( fd, 0x1, ( const uint8_t* )text.data(), text.size() );
+    }
+    ingest_pending.clear();
+    ingest_state = ingest_state_open;
+    return fd;
+}
+//
+static void ingest_thread_main( std::string url )
+{
+    const int fd = ingest_open( url );
+    if ( fd < 0 )
+    {
+        if ( ! ingest_stopping.load() )
+        {
+            printf( "WebSocket connection to %s failed!\n", url.c_str() );
+        }
+        ingest_set_state( ingest_state_closed );
+        return;
+    }
+    websocket_staus = websocket_staus_open;
+    sensor_ingest_reset();
+    std::vector< uint8_t > message;
+    std::vector< uint8_t > payload;
+    uint8_t                message_opcode = 0;
+    while ( true )
+    {
+        uint8_t header[ 2 ];
+        if ( ! ingest_read_all( fd, header, 2 ) )
+        {
+            break;
+        }
+        const bool    fin    = ( header[ 0 ] & 0x80 ) != 0;
+        const uint8_t opcode = header[ 0 ] & 0x0F;
+        uint64_t      size   = header[ 1 ] & 0x7F;
+        if ( size >= 126 )
+        {
+            uint8_t ext[ 8 ];
+            int     n = size == 126 ? 2 : 8;
+            if ( ! ingest_read_all( fd, ext, n ) )
+            {
+                break;
+            }
+            size = 0;
+            for ( int i = 0; i < n; i++ )
+            {
+                size = ( size << 8 ) | ext[ i ];
+            }
+        }
+        // 单帧或累计的分片超过上限: 按 1009 (Message Too Big) 关闭
+        if ( size > ingest_max_message || ( opcode == 0x0 && message.size() + size > ingest_max_message ) )
+        {
+            const uint8_t reason[ 2 ] = { 1009 >> 8, 1009 & 0xFF };
+            ingest_send_frame( fd, 0x8, reason, sizeof( reason ) );
+            printf( "WebSocket message of %llu bytes exceeds the %llu byte limit, closing\n", ( unsigned long long )( opcode == 0x0 ? message.size() + size : size ),
+                    ( unsigned long long )ingest_max_message );
+            break;
+        }
+        uint8_t mask[ 4 ] = { 0, 0, 0, 0 };
+        if ( ( header[ 1 ] & 0x80 ) && ! ingest_read_all( fd, mask, 4 ) )
+        {
+            break;
+        }
+        payload.resize( size );
+        if ( ! ingest_read_all( fd, payload.data(), size ) )
+        {
+            break;
+        }
+        for ( uint64_t i = 0; i < size; i++ )
+        {
+            payload[ i ] ^= mask[ i & 3 ];
+        }
+        //
+        if ( opcode == 0x8 )
+        {
+            break;
+        }
+        if ( opcode == 0x9 )
+        {
+            ingest_send_frame( fd, 0xA, payload.data(), payload.size() );
+            continue;
+        }
+        if ( opcode == 0x1 || opcode == 0x2 )
+        {
+            message.clear();
+            message_opcode = opcode;
+        }
+        else if ( opcode != 0x0 )
+        {
+            continue;
+        }
+        message.insert( message.end(), payload.begin(), payload.end() );
+        if ( fin && message_opcode == 0x1 && ! message.empty() )
+        {
+            message.push_back( '\0' );
+            sensor_ingest_text( ( const char* )message.data() );
+            message.clear();
+        }
+        else if ( fin && message_opcode == 0x2 )
+        {
+            sensor_ingest_binary( message.data(), message.size() );
+            message.clear();
+        }
+    }
+    ingest_set_state( ingest_state_closed );
+    ingest_release( fd );
+    websocket_staus = websocket_staus_closed;
+}
+//
+static void ingest_stop()
+{
+    ingest_relay_stop();
+    ingest_stopping = true;
+    ingest_set_state( ingest_state_closed );
+    int fd = ingest_fd.exchange( -1 );
+    if ( fd >= 0 )
+    {
+        ::shutdown( fd, SHUT_RDWR );
+    }
+    if ( ingest_thread.joinable() )
+    {
+        ingest_thread.join();
+    }
+    if ( fd >= 0 )
+    {
+        ::close( fd );
+    }
+    ingest_stopping = false;
+}
+// 立即返回; 握手完成前发送的控制消息排队, 连接失败时打印错误
+static void ingest_start( const std::string& url )
+{
+    ingest_stop();
+    ingest_set_state( ingest_state_connecting );
+    ingest_thread = std::thread( ingest_thread_main, url );
+}
+//
+static void ingest_send_text( const char* text )
+{
+    if ( ( ingest_local_send != nullptr && ingest_local_send( text ) ) || ingest_relay_send( text ) )
+    {
+        return;
+    }
+    std::lock_guard< std::mutex > lock( ingest_send_mutex );
+    if ( ingest_state == ingest_state_connecting )
+    {
+        ingest_pending.emplace_back( text );
+    }
+    else if ( ingest_state == ingest_state_open )
+    {
+        int fd = ingest_fd;
+        if ( fd >= 0 )
+        {
+            ingest_write_frame( fd, 0x1, ( const uint8_t* )text, strlen( text ) );
+        }
+    }
+}
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+//
+#include "queue/sensor_db.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+//
+// 接收线程写入, UI 线程读取的环形历史. 只依赖 SENSOR_DB 的字段定义, 不依赖引擎: history_stress.cxx 只包含本文件, 以 ThreadSanitizer 编译
+// queue_mutex 保护接收线程与 UI 线程共享的全部状态, 环形历史的写者也在锁内追加
+static std::mutex queue_mutex;
+static int        item_count = 1024;
+// 环形历史: 第 i 帧存放在 i % sensor_history_capacity, 读者看到最近 item_count 帧.
+// 写者只在已发布的 head 之后写入, 写完再原子发布 head; 读者每帧取一次快照并登记其 tail (pin),
+// 写者不会覆盖被登记的帧, 因此读者无需加锁, 写者也不会等待读者 (容量多出的 item_count 帧作为余量, 用尽时丢弃历史帧)
+// 按字段分列存放, 只有订阅掩码内的字段分配存储; 掩码由读者在快照之外调整, 写者在 queue_mutex 内追加
+static const int                  sensor_history_capacity = 2048;
+static std::unique_ptr< float[] > sensor_history_columns[ sensor_field_count ];
+static uint32_t                   sensor_history_mask     = 0;
+static uint64_t                   sensor_history_revision = 0;  // 每次调整列存储加一, 新分配的列可能复用旧列的地址
+static std::atomic< int64_t >     sensor_history_head{ 0 };
+static std::atomic< int64_t >     sensor_history_pin{ -1 };
+static std::atomic< int64_t >     sensor_history_dropped{ 0 };
+//
+struct SENSOR_HISTORY_VIEW
+{
+    const float* columns[ sensor_field_count ] = {};  // 未订阅的字段为 nullptr
+    int          capacity                      = 0;
+    int64_t      head                          = 0;  // 同时作为快照的代数
+    int64_t      tail                          = 0;
+    uint64_t     revision                      = 0;  // sensor_history_revision, 绘图缓存以它区分同一地址上的新旧列
+    //
+    const float* column( int field ) const
+    {
+        return columns[ field ];
+    }
+    const float* channel( int channel ) const
+    {
+        return columns[ channel + 1 ];
+    }
+    float at( int field, int64_t i ) const
+    {
+        return columns[ field ] != nullptr ? columns[ field ][ i % capacity ] : 0.0f;
+    }
+};
+// 写者: 追加一帧并发布 (调用方持有 queue_mutex)
+static void sensor_history_append( const SENSOR_DB& sensor_db )
+{
+    const int64_t head = sensor_history_head.load( std::memory_order_relaxed );
+    const int64_t pin  = sensor_history_pin.load( std::memory_order_seq_cst );
+    if ( pin >= 0 && head >= pin + sensor_history_capacity )
+    {
+        sensor_history_dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    const int64_t slot = head % sensor_history_capacity;
+    for ( uint32_t m = sensor_history_mask; m != 0; m &= m - 1 )
+    {
+        const int f                         = __builtin_ctz( m );
+        sensor_history_columns[ f ][ slot ] = sensor_field( sensor_db, f );
+    }
+    sensor_history_head.store( head + 1, std::memory_order_seq_cst );
+}
+// 读者: 取得快照并登记, 直到 sensor_history_release 前快照内的帧都不会被覆盖. 只支持一个读者
+static SENSOR_HISTORY_VIEW sensor_history_acquire()
+{
+    SENSOR_HISTORY_VIEW view;
+    for ( int f = 0; f < sensor_field_count; f++ )
+    {
+        view.columns[ f ] = sensor_history_columns[ f ].get();
+    }
+    view.capacity = sensor_history_capacity;
+    view.revision = sensor_history_revision;
+    int64_t head  = sensor_history_head.load( std::memory_order_seq_cst );
+    int64_t tail  = head > item_count ? head - item_count : 0;
+    sensor_history_pin.store( tail, std::memory_order_seq_cst );
+    // 登记前可能已有一帧按旧的 pin 写入, 它占用的槽位不能出现在快照里
+    view.head = sensor_history_head.load( std::memory_order_seq_cst );
+    view.tail = std::max( { tail, view.head - item_count, view.head + 1 - sensor_history_capacity, ( int64_t )0 } );
+    return view;
+}
+//
+static void sensor_history_release()
+{
+    sensor_history_pin.store( -1, std::memory_order_seq_cst );
+}
+// 读者在快照释放后调用: 为新订阅的字段分配 (清零) 存储, 释放退订字段的存储
+static void sensor_history_set_mask( uint32_t mask )
+{
+    mask &= sensor_mask_all;
+    if ( mask == sensor_history_mask )
+    {
+        return;
+    }
+    std::lock_guard< std::mutex > lock( queue_mutex );
+    for ( int f = 0; f < sensor_field_count; f++ )
+    {
+        const bool keep = ( mask & ( 1u << f ) ) != 0;
+        if ( keep && ! sensor_history_columns[ f ] )
+        {
+            sensor_history_columns[ f ].reset( new float[ sensor_history_capacity ]() );
+        }
+        else if ( ! keep )
+        {
+            sensor_history_columns[ f ].reset();
+        }
+    }
+    sensor_history_mask = mask;
+    sensor_history_revision++;
+}
@@ -1,11 +1,28 @@
 #pragma once
 //
+#include "analysis/allan_variance.h"
+#include "analysis/sensor_events.h"
+#include "calibration/mag_calibration.h"
+#include "capture/capture_writer.h"
+#include "codec/sensor_binary.h"
+#include "codec/sensor_delta.h"
+#include "mocap/animation_baker.h"
+#include "mocap/pose_interpolator.h"
 #include "queue/sensor_db.h"
+#include "queue/sensor_timeline.h"
+#include "websocket/sensor_history.h"
+#include <algorithm>
+#include <atomic>
 #include <boost/lockfree/queue.hpp>
-#include <emscripten/websocket.h>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#ifdef __EMSCRIPTEN__
+    #include <emscripten/websocket.h>
+#endif
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <stdio.h>
 #include <stdlib.h>
 #include <thread>
@@ -18,102 +35,404 @@
 //     LockFreeMessageQueue< SENSOR_DB > sensor_data_queue;
 // };
 // 全局的变量
-static eastl::string websocket_staus                    = "\xf3\xb1\x98\x96";
+// 连接状态图标, 接收线程写入, UI 线程读取
+static const char* const         websocket_staus_closed = "\xf3\xb1\x98\x96";
+static const char* const         websocket_staus_open   = "\xf3\xb0\x8c\x98";
+static std::atomic< const char* > websocket_staus{ websocket_staus_closed };
 static eastl::string websocket_receive_message          = "";
 static eastl::string websocket_receive_message_original = "";
+static uint32_t      websocket_status_generation        = 0;  // 每收到一条状态消息加一
 
-//
-static std::queue< SENSOR_DB >  sensor_data_queue;
-static std::vector< SENSOR_DB > sensor_data_vector;
-static std::mutex               queue_mutex;
-static int64_t                  start_time;
-static int                      Microsecond = 1000000;
-static int                      item_count  = 1024;
+// 最近一帧只保存原始数据, 由 UI 刷新时按需格式化. 渲染线程每帧只取最近一帧 (传感器 0),
+// sensor_data_pending 为上次取走之后到达的帧数, 即流控所用的队列深度; 中间的帧不保留, 内存不随积压增长
+static SENSOR_DB latest_sensor_db;
+static int       sensor_data_pending = 0;
+static uint32_t  latest_sensor_generation = 0;
+static bool      latest_is_sensor_frame   = false;
+// 磁力计校准: 原始读数持续参与拟合, 启用且拟合可信 (MAG_CALIBRATION::trusted) 时对进入历史的帧做校正
+static MAG_CALIBRATION mag_calibration;
+static bool            mag_calibration_apply = true;
+// Allan 方差: 录制期间的原始加速度计/陀螺仪数据
+static ALLAN_CAPTURE allan_capture;
+static bool          allan_recording = false;
+// 动画烘焙: 录制期间每个传感器的姿态与位置
+static BAKE_CAPTURE bake_capture;
+static bool         bake_recording = false;
+// 动作捕捉: 每个传感器的最近一帧
+struct MOCAP_LATEST
+{
+    SENSOR_DB frame;
+    uint32_t  generation = 0;
+};
+static MOCAP_LATEST mocap_latest[ mocap_max_sensors ];
+// 时间对齐: 所有传感器对齐到同一时间轴后的插值结果, 渲染线程每帧更新一次
+static SENSOR_TIMELINE sensor_timeline;
+static_assert( sensor_timeline_sensors == mocap_max_sensors, "sensor timeline must cover every mocap sensor" );
+// 显示插值: 3D 视图与动作捕捉模型在渲染帧率下平滑采样姿态与位置
+static POSE_INTERPOLATOR pose_interpolator;
+// 事件标注: 接收时增量检测, 图表与回放按区间查询
+static SENSOR_EVENTS sensor_events;
+static_assert( sensor_event_sensors == mocap_max_sensors, "event detectors must cover every mocap sensor" );
+// 录制: 所有传感器的原始帧按块追加到文件, 页面崩溃后可恢复到最后一个完整的块
+static CAPTURE_WRITER capture_writer;
 //
 
+// 接收统计, 由流量控制按时间间隔取差值
+static std::atomic< uint64_t > sensor_ingest_frames{ 0 };
+static std::atomic< uint64_t > sensor_ingest_messages{ 0 };
+// 服务端确认的字段掩码 (Rate 应答), 决定如何解析数据帧
+static std::atomic< uint32_t > sensor_ingest_mask{ sensor_mask_all };
+// 服务端应答 "Rate:decimate=<n>,batch=<n>,mask=<hex>", 只关心其中的掩码
+static void sensor_ingest_rate_ack( const std::string& line )
+{
+    size_t mask = line.find( "mask=" );
+    if ( mask != std::string::npos )
+    {
+        uint32_t value = ( uint32_t )strtoul( line.c_str() + mask + 5, nullptr, 16 ) & sensor_mask_all;
+        sensor_ingest_mask.store( value != 0 ? value : sensor_mask_all, std::memory_order_relaxed );
+    }
+}
+// 可选的旁路: 每批解码后的帧在进入处理流程前回调一次 (接收线程上), relay 用它录制原始数据
+static void ( *sensor_ingest_tap )( const std::vector< SENSOR_DB >& frames, uint32_t mask, int sensor ) = nullptr;
+// 解码后的帧送入处理流程: 校准, 录制, 历史与最近一帧. 在接收线程上调用, mask 为这些帧实际包含的字段
+// 动作捕捉的其他传感器只更新各自的最近一帧. timed 为 false 时 (重放录制文件) 帧不进入时间对齐与显示插值, 到达时刻没有意义
+static void sensor_ingest_publish( const std::vector< SENSOR_DB >& frames, uint32_t mask, int sensor = 0, bool timed = true )
+{
+    if ( frames.empty() || sensor >= mocap_max_sensors )
+    {
+        return;
+    }
+    sensor_ingest_frames.fetch_add( frames.size(), std::memory_order_relaxed );
+    if ( sensor_ingest_tap != nullptr )
+    {
+        sensor_ingest_tap( frames, mask, sensor );
+    }
+    // 录制中检测到的事件随帧写入录制文件, 帧序号换算为录制内的序号: capture_offset 为本批第一帧的两种序号之差
+    const int64_t ordinal        = capture_writer.push( sensor, frames.data(), ( int )frames.size(), mask );
+    double        capture_offset = 0.0;
+    auto          capture_event  = [ & ]( const SENSOR_EVENT& event ) {
+        if ( ordinal >= 0 )
+        {
+            capture_writer.push_event( { capture_record_event, event.sensor, event.kind, 0, event.peak, std::max( 0.0, event.begin - capture_offset ),
+                                         std::max( 0.0, event.end - capture_offset ) } );
+        }
+    };
+    if ( sensor != 0 )
+    {
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        capture_offset = ( double )sensor_events.frames[ sensor ] - ( double )ordinal;
+        for ( const SENSOR_DB& sensor_db : frames )
+        {
+            const double index = ( double )sensor_events.frames[ sensor ]++;
+            if ( bake_recording )
+            {
+                bake_capture.push( sensor, sensor_db, index );
+            }
+            sensor_events.push( sensor, sensor_db, mask, index, sensor_timeline.tracks[ sensor ].period, capture_event );
+        }
+        if ( timed )
+        {
+            const double arrival = sensor_timeline.now();
+            sensor_timeline.push( sensor, frames.data(), ( int )frames.size(), arrival );
+            pose_interpolator.push( sensor, frames.data(), ( int )frames.size(), sensor_timeline.tracks[ sensor ].clock, arrival );
+        }
+        mocap_latest[ sensor ].frame = frames.back();
+        mocap_latest[ sensor ].generation++;
+        return;
+    }
+    // 被掩码去掉的字段为 0, 不能参与校准与录制
+    const bool has_mag = sensor_mask_has( mask, 6, 3 );
+    const bool has_imu = sensor_mask_has( mask, 0, allan_channel_count );
+    //
+    std::lock_guard< std::mutex > lock( queue_mutex );
+    capture_offset = ( double )sensor_history_head.load( std::memory_order_relaxed ) - ( double )ordinal;
+    if ( timed )
+    {
+        const double arrival = sensor_timeline.now();
+        sensor_timeline.push( 0, frames.data(), ( int )frames.size(), arrival );
+        pose_interpolator.push( 0, frames.data(), ( int )frames.size(), sensor_timeline.tracks[ 0 ].clock, arrival );
+    }
+    for ( SENSOR_DB new_sensor_db : frames )
+    {
+        // 传感器 0 的帧序号即历史环的序号
+        const double index = ( double )sensor_history_head.load( std::memory_order_relaxed );
+        if ( allan_recording && has_imu )
+        {
+            allan_capture.push( new_sensor_db );
+        }
+        if ( bake_recording )
+        {
+            bake_capture.push( 0, new_sensor_db, index );
+        }
+        if ( has_mag )
+        {
+            mag_calibration.add_sample( new_sensor_db.mag_x, new_sensor_db.mag_y, new_sensor_db.mag_z );
+            if ( mag_calibration_apply && mag_calibration.trusted() )
+            {
+                mag_calibration.apply( new_sensor_db.mag_x, new_sensor_db.mag_y, new_sensor_db.mag_z );
+            }
+        }
+        sensor_events.push( 0, new_sensor_db, mask, index, sensor_timeline.tracks[ 0 ].period, capture_event );
+        //
+        sensor_data_pending++;
+        sensor_history_append( new_sensor_db );
+        latest_sensor_db = new_sensor_db;
+    }
+    mocap_latest[ 0 ].frame = latest_sensor_db;
+    mocap_latest[ 0 ].generation++;
+    latest_is_sensor_frame = true;
+    latest_sensor_generation++;
+}
+// 解析一条文本消息. 一条消息可批量携带多帧, 以换行分隔; 以字母开头的行是状态或控制消息
+static void sensor_ingest_text( const char* text )
+{
+    static std::vector< SENSOR_DB > frames;
+    const uint32_t                  mask       = sensor_ingest_mask.load( std::memory_order_relaxed );
+    uint32_t                        frame_mask = sensor_mask_all;
+    frames.clear();
+    sensor_ingest_messages.fetch_add( 1, std::memory_order_relaxed );
+    //
+    for ( const char* line = text; *line != '\0'; )
+    {
+        const char* end    = strchr( line, '\n' );
+        size_t      length = end != nullptr ? ( size_t )( end - line ) : strlen( line );
+        if ( length > 0 && isalpha( ( unsigned char )line[ 0 ] ) )
+        {
+            if ( strncmp( line, "Rate:", 5 ) == 0 )
+            {
+                sensor_ingest_rate_ack( std::string( line, length ) );
+            }
+            else
+            {
+                std::lock_guard< std::mutex > lock( queue_mutex );
+                //
+                websocket_receive_message_original.assign( line, line + length );
+                websocket_receive_message = websocket_receive_message_original;
+                websocket_status_generation++;
+                latest_is_sensor_frame    = false;
+                latest_sensor_generation++;
+            }
+        }
+        else if ( length > 0 )
+        {
+            // 完整帧总能解析, 否则按已确认的掩码解析, 字段数不符或字段不是完整数值的帧丢弃
+            SENSOR_DB new_sensor_db;
+            if ( sensor_parse_masked( new_sensor_db, line, length, sensor_mask_all ) )
+            {
+                frames.push_back( new_sensor_db );
+            }
+            else if ( mask != sensor_mask_all && sensor_parse_masked( new_sensor_db, line, length, mask ) )
+            {
+                frames.push_back( new_sensor_db );
+                frame_mask = mask;
+            }
+        }
+        line += end != nullptr ? length + 1 : length;
+    }
+    sensor_ingest_publish( frames, frame_mask );
+}
+// 差分解码状态跨消息保留, 每个传感器一份, 新连接时重置
+static SENSOR_DELTA_DECODER sensor_ingest_delta[ mocap_max_sensors ];
+// 每个传感器最近收到的快照序号, -1 表示尚未收到
+static int64_t sensor_ingest_snapshot[ mocap_max_sensors ];
+//
+static void sensor_ingest_reset()
+{
+    for ( SENSOR_DELTA_DECODER& decoder : sensor_ingest_delta )
+    {
+        decoder.reset();
+    }
+    for ( int64_t& sequence : sensor_ingest_snapshot )
+    {
+        sequence = -1;
+    }
+    std::lock_guard< std::mutex > lock( queue_mutex );
+    sensor_timeline.reset();
+    pose_interpolator.reset();
+    sensor_events.restart();
+}
+// 重放录制文件 (Recover): 在渲染线程上用 CAPTURE_READER 分步读取, 每次最多用 budget 秒, 帧重新走接收流程 (历史, 烘焙录制等),
+// 不进入时间对齐. 开始时记下各传感器的数据流帧序号 (传感器 0 即历史环的序号), 录制内的帧序号加上它即重放后的序号;
+// 重放期间暂停事件检测, 事件标注取录制时保存在文件中的. 调用方先停止接收与合成数据源, 重放期间不能有其他数据源
+struct SENSOR_REPLAY
+{
+    CAPTURE_READER reader;
+    double         base[ mocap_max_sensors ];
+    bool           detect = true;  // 重放前的检测开关
+    bool           active = false;
+    //
+    bool start( Urho3D::VirtualFileSystem* vfs, const std::string& scheme, const std::string& name )
+    {
+        stop();
+        sensor_ingest_reset();
+        reader.open( vfs, scheme, name );
+        if ( reader.result.parts == 0 )
+        {
+            return false;
+        }
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        base[ 0 ] = ( double )sensor_history_head.load( std::memory_order_relaxed );
+        for ( int s = 1; s < mocap_max_sensors; s++ )
+        {
+            base[ s ] = ( double )sensor_events.frames[ s ];
+        }
+        detect                = sensor_events.enabled;
+        sensor_events.enabled = false;
+        active                = true;
+        return true;
+    }
+    // 读完 (或读到文件损坏处) 时结束重放并返回 true
+    bool pump( double budget )
+    {
+        using clock      = std::chrono::steady_clock;
+        const auto start = clock::now();
+        while ( active && reader.next(
+                              []( int sensor, const std::vector< SENSOR_DB >& frames, uint32_t mask ) {
+                                  sensor_ingest_publish( frames, mask, sensor, false );
+                                  std::lock_guard< std::mutex > lock( queue_mutex );
+                                  sensor_data_pending = 0;
+                              },
+                              [ this ]( const CAPTURE_EVENT_RECORD& record ) {
+                                  if ( record.sensor < mocap_max_sensors && record.kind < sensor_event_kind_count )
+                                  {
+                                      const double                  offset = base[ record.sensor ];
+                                      std::lock_guard< std::mutex > lock( queue_mutex );
+                                      sensor_events.index.add( SENSOR_EVENT{ offset + record.begin, offset + record.end, record.peak, record.kind, record.sensor } );
+                                  }
+                              } ) )
+        {
+            if ( std::chrono::duration< double >( clock::now() - start ).count() >= budget )
+            {
+                return false;
+            }
+        }
+        stop();
+        return true;
+    }
+    // 结束 (或中途取消) 重放, 恢复事件检测
+    void stop()
+    {
+        if ( ! active )
+        {
+            return;
+        }
+        if ( reader.file )
+        {
+            reader.file->Close();
+            reader.file = nullptr;
+        }
+        reader.done = true;
+        active      = false;
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        sensor_events.enabled = detect;
+    }
+};
+// 解析一条二进制消息, 按首字节区分原始帧与差分帧. 掩码随消息携带, 无需等待 Rate 应答
+static void sensor_ingest_binary( const uint8_t* data, size_t size )
+{
+    static std::vector< SENSOR_DB > frames;
+    uint32_t                        mask = sensor_mask_all;
+    bool                            ok   = false;
+    frames.clear();
+    sensor_ingest_messages.fetch_add( 1, std::memory_order_relaxed );
+    if ( size < 2 )
+    {
+        return;
+    }
+    int sensor = data[ 1 ];
+    if ( data[ 0 ] == sensor_binary_delta )
+    {
+        sensor = sensor_delta_sensor( data );
+        ok     = sensor < mocap_max_sensors && sensor_ingest_delta[ sensor ].decode( data, size, frames, mask );
+    }
+    else if ( data[ 0 ] == sensor_binary_snapshot )
+    {
+        // 无序到达: 比已收到的更旧的快照丢弃 (序号按模 2^32 比较)
+        uint32_t sequence = 0;
+        ok                = sensor < mocap_max_sensors && sensor_snapshot_decode( data, size, frames, mask, sequence );
+        if ( ok && sensor_ingest_snapshot[ sensor ] >= 0 && ( int32_t )( sequence - ( uint32_t )sensor_ingest_snapshot[ sensor ] ) <= 0 )
+        {
+            ok = false;
+        }
+        if ( ok )
+        {
+            sensor_ingest_snapshot[ sensor ] = sequence;
+        }
+    }
+    else
+    {
+        ok = sensor_binary_decode( data, size, frames, mask );
+    }
+    if ( ok )
+    {
+        sensor_ingest_publish( frames, mask, sensor );
+    }
+}
+//
+#ifdef __EMSCRIPTEN__
 static EM_BOOL WebSocketOpen( int eventType, const EmscriptenWebSocketOpenEvent* e, void* userData )
 {
     // printf( "open(eventType=%d, userData=%ld)\n", eventType, ( long )userData );
-    // struct WASM_SOCKET_DATA* p_userData = ( struct WASM_SOCKET_DATA* )userData;
-    websocket_staus = "\xf3\xb0\x8c\x98";
-
-    // printf( "open(eventType=%d, userData=%s)\n", eventType, p_userData->websocket_staus.c_str() );
-
-    // emscripten_websocket_send_utf8_text( e->socket, "hello on the other side" );
-
-    // char data[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
-    // emscripten_websocket_send_binary( e->socket, data, sizeof( data ) );
-
-    // emscripten_websocket_close( e->socket, 0, 0 );
+    websocket_staus = websocket_staus_open;
     return 0;
 }
 //
 static EM_BOOL WebSocketClose( int eventType, const EmscriptenWebSocketCloseEvent* e, void* userData )
 {
     // printf( "close(eventType=%d, wasClean=%d, code=%d, reason=%s, userData=%ld)\n", eventType, e->wasClean, e->code, e->reason, ( long )userData );
-    websocket_staus = "\xf3\xb1\x98\x96";
+    websocket_staus = websocket_staus_closed;
     return 0;
 }
 //
 static EM_BOOL WebSocketError( int eventType, const EmscriptenWebSocketErrorEvent* e, void* userData )
 {
     // printf( "error(eventType=%d, userData=%ld)\n", eventType, ( long )userData );
-    websocket_staus = "\xf3\xb1\x98\x96";
+    websocket_staus = websocket_staus_closed;
     return 0;
 }
 //
 static EM_BOOL WebSocketMessage( int eventType, const EmscriptenWebSocketMessageEvent* e, void* userData )
 {
-    // struct WASM_SOCKET_DATA* p_userData = ( struct WASM_SOCKET_DATA* )userData;
-
     // printf( "message(eventType=%d, userData=%ld, data=%p, numBytes=%d, isText=%d)\n", eventType, ( long )userData, e->data, e->numBytes, e->isText );
     //
     if ( e->isText )
     {
-        // printf( "text data: \"%s\"\n", e->data );
-        websocket_receive_message_original = ( char* )e->data;
-        //
-        if ( ( websocket_receive_message_original != "Stoped" ) && ( websocket_receive_message_original != "Connected" ) )
-        {
-            std::lock_guard< std::mutex > lock( queue_mutex );
-            //
-            SENSOR_DB new_sensor_db;
-            new_sensor_db.getValueFromString( websocket_receive_message_original.c_str() );
-            //
-            sensor_data_queue.push( new_sensor_db );
-            // 1s存一个
-            // int64_t cur_time = getMicrosecondTimestamp();
-            // if ( ( cur_time - start_time ) > Microsecond * 5 )
-            // {
-            if ( sensor_data_vector.size() < item_count )
-            {
-                sensor_data_vector.push_back( new_sensor_db );
-            }
-            else
-            {
-                sensor_data_vector.erase( sensor_data_vector.begin() );
-                sensor_data_vector.push_back( new_sensor_db );
-            }
-            // }
-            //
-            websocket_receive_message = new_sensor_db.to_info().c_str();
-        }
-        else
-        {
-            websocket_receive_message = websocket_receive_message_original;
-        }
+        sensor_ingest_text( ( const char* )e->data );
     }
     else
     {
-        printf( "binary data:" );
-        for ( int i = 0; i < e->numBytes; ++i )
-        {
-            printf( " %02X", e->data[ i ] );
-        }
-        printf( "\n" );
-        //
-        emscripten_websocket_delete( e->socket );
-        exit( 0 );
+        sensor_ingest_binary( e->data, e->numBytes );
     }
     return 0;
 }
+#endif
+
+// UI 刷新时调用: 只有最近一帧变化时才重新格式化, 缓冲区在多次刷新间复用
+static const char* websocket_receive_view()
+{
+    static fmt::memory_buffer info_buffer;
+    static uint32_t           info_generation = 0;
+    //
+    SENSOR_DB sensor_db;
+    {
+        std::lock_guard< std::mutex > lock( queue_mutex );
+        if ( info_generation == latest_sensor_generation && info_buffer.size() > 0 )
+        {
+            return info_buffer.data();
+        }
+        info_generation = latest_sensor_generation;
+        if ( ! latest_is_sensor_frame )
+        {
+            info_buffer.clear();
+            info_buffer.append( websocket_receive_message.begin(), websocket_receive_message.end() );
+            info_buffer.push_back( '\0' );
+            return info_buffer.data();
+        }
+        sensor_db = latest_sensor_db;
+    }
+    //
+    info_buffer.clear();
+    sensor_db.format_info( info_buffer );
+    info_buffer.push_back( '\0' );
+    return info_buffer.data();
+}
\ No newline at end of file